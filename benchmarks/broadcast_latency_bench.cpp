@@ -0,0 +1,178 @@
+// Broadcast delivery latency: blocking vs busy-poll I/O threads.
+//
+// One sender fans every frame out to N loopback connections, each drained by its own
+// I/O thread the way Server::handle_client does. Latency is measured from the write to
+// the return of Connection::receive_packet; CPU usage is process-wide user+sys time
+// over wall time, so 100% == one core fully busy.
+//
+// Usage: broadcast_latency_bench [receivers=4] [broadcasts=2000] [busy_poll_us=50] [gap_us=200]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "chat/common/messages.hpp"
+#include "chat/common/protocol.hpp"
+#include "chat/common/socket_tuning.hpp"
+#include "chat/server/connection_manager.hpp"
+
+namespace
+{
+    using namespace std::chrono;
+    using boost::asio::ip::tcp;
+
+    struct RunResult
+    {
+        std::vector<int64_t> latencies_ns;
+        double wall_s{0};
+        double cpu_s{0};
+    };
+
+    double process_cpu_seconds()
+    {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        const auto to_s = [](const timeval& tv) { return static_cast<double>(tv.tv_sec) + tv.tv_usec / 1e6; };
+        return to_s(usage.ru_utime) + to_s(usage.ru_stime);
+    }
+
+    int64_t now_ns()
+    {
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    RunResult run(const int receivers, const int broadcasts, const int busy_poll_us, const int gap_us)
+    {
+        boost::asio::io_context io_context;
+        tcp::acceptor acceptor(io_context, tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+
+        chat::SocketTuning tuning;
+        tuning.busy_poll_us     = busy_poll_us;
+        tuning.prefer_busy_poll = busy_poll_us > 0;
+
+        std::vector<std::unique_ptr<tcp::socket>> senders;
+        std::vector<std::shared_ptr<chat::server::Connection>> connections;
+        for (int i = 0; i < receivers; ++i) {
+            auto tx = std::make_unique<tcp::socket>(io_context);
+            tx->connect(acceptor.local_endpoint());
+            chat::SocketHelpers::apply_tuning(*tx, tuning);
+
+            auto conn = std::make_shared<chat::server::Connection>(io_context);
+            acceptor.accept(conn->socket());
+            chat::SocketHelpers::apply_tuning(conn->socket(), tuning);
+            conn->set_busy_poll(microseconds(busy_poll_us));
+
+            senders.push_back(std::move(tx));
+            connections.push_back(std::move(conn));
+        }
+
+        RunResult result;
+        result.latencies_ns.reserve(static_cast<size_t>(receivers) * broadcasts);
+        std::mutex result_mutex;
+
+        std::vector<std::thread> io_threads;
+        for (const auto& conn : connections) {
+            io_threads.emplace_back([&, conn]() {
+                std::vector<int64_t> local;
+                local.reserve(broadcasts);
+                try {
+                    for (int i = 0; i < broadcasts; ++i) {
+                        auto [type, payload] = conn->receive_packet();
+                        const auto received  = now_ns();
+                        const auto msg       = chat::Protocol::decode<chat::BroadcastMsg>(payload);
+                        local.push_back(received - msg.timestamp_ms);
+                    }
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "receiver error: " << e.what() << std::endl;
+                }
+
+                std::lock_guard<std::mutex> lock(result_mutex);
+                result.latencies_ns.insert(result.latencies_ns.end(), local.begin(), local.end());
+            });
+        }
+
+        const auto cpu_start  = process_cpu_seconds();
+        const auto wall_start = steady_clock::now();
+
+        const std::string body(64, 'x');
+        for (int i = 0; i < broadcasts; ++i) {
+            for (const auto& tx : senders) {
+                // the timestamp field carries the steady-clock send time in ns
+                const auto packet = chat::Protocol::encode(
+                    chat::MessageType::BROADCAST, chat::BroadcastMsg{"bench", body, now_ns()});
+                chat::ProtocolHelpers::send_packet(*tx, packet);
+            }
+
+            // idle gap between broadcasts, where blocking threads go to sleep
+            const auto until = steady_clock::now() + microseconds(gap_us);
+            while (steady_clock::now() < until)
+                std::this_thread::sleep_for(microseconds(gap_us / 4 + 1));
+        }
+
+        for (auto& t : io_threads)
+            t.join();
+
+        result.wall_s = duration<double>(steady_clock::now() - wall_start).count();
+        result.cpu_s  = process_cpu_seconds() - cpu_start;
+
+        for (const auto& conn : connections)
+            conn->close();
+        return result;
+    }
+
+    int64_t percentile(std::vector<int64_t>& samples, const double p)
+    {
+        if (samples.empty())
+            return 0;
+        const auto idx = static_cast<size_t>(p * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(idx), samples.end());
+        return samples[idx];
+    }
+
+    void report(const std::string& label, RunResult& r)
+    {
+        const auto p50 = percentile(r.latencies_ns, 0.50);
+        const auto p99 = percentile(r.latencies_ns, 0.99);
+        const auto max = r.latencies_ns.empty() ? 0 : *std::ranges::max_element(r.latencies_ns);
+
+        std::cout << std::left << std::setw(22) << label
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << p50 / 1000.0
+            << std::setw(10) << p99 / 1000.0
+            << std::setw(10) << max / 1000.0
+            << std::setw(10) << 100.0 * r.cpu_s / r.wall_s << "%"
+            << std::setw(10) << r.latencies_ns.size() << std::endl;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    const int receivers    = argc > 1 ? std::atoi(argv[1]) : 4;
+    const int broadcasts   = argc > 2 ? std::atoi(argv[2]) : 2000;
+    const int busy_poll_us = argc > 3 ? std::atoi(argv[3]) : 50;
+    const int gap_us       = argc > 4 ? std::atoi(argv[4]) : 200;
+
+    std::cout << receivers << " receivers, " << broadcasts << " broadcasts, "
+        << gap_us << "us gap, " << std::thread::hardware_concurrency() << " cores\n\n";
+    std::cout << std::left << std::setw(22) << "mode"
+        << std::right << std::setw(10) << "p50(us)" << std::setw(10) << "p99(us)"
+        << std::setw(10) << "max(us)" << std::setw(11) << "cpu" << std::setw(10) << "samples" << std::endl;
+
+    auto blocking = run(receivers, broadcasts, 0, gap_us);
+    report("blocking", blocking);
+
+    auto spinning = run(receivers, broadcasts, busy_poll_us, gap_us);
+    report("busy-poll " + std::to_string(busy_poll_us) + "us", spinning);
+
+    return EXIT_SUCCESS;
+}
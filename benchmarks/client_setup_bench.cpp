@@ -0,0 +1,294 @@
+// Client startup latency: sequential vs pipelined connection setup.
+//
+// A real Server runs on loopback behind a proxy that delays every chunk by RTT/2 in each
+// direction. Each iteration times Client::connect() from the start to the point where INIT
+// has arrived, with the password "typed" by a callback that sleeps for the given think time.
+// The sequential client resolves, connects, generates A, sends SRP_INIT and waits for the
+// challenge before asking for the password; the pipelined one does all of that while the
+// user types. The proxy sits behind an established connection, so the SYN round trip (and
+// with it any TCP Fast Open saving) is not part of the injected delay.
+//
+// Usage: client_setup_bench [rtt_ms=50] [typing_ms=300] [iterations=10]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "chat/auth/srp_server.hpp"
+#include "chat/auth/verifier_engine.hpp"
+#include "chat/client/client.hpp"
+#include "chat/server/server.hpp"
+
+namespace
+{
+    using namespace std::chrono;
+    using boost::asio::ip::tcp;
+
+    constexpr auto kPassword = "bench-password";
+
+    uint16_t free_port()
+    {
+        boost::asio::io_context io_context;
+        tcp::acceptor probe(io_context, tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+        return probe.local_endpoint().port();
+    }
+
+    /**
+     * One direction of the delay proxy
+     * The reader stamps each chunk on arrival, the writer holds it until stamp + delay.
+     */
+    class DelayedPipe
+    {
+    public:
+        DelayedPipe(tcp::socket& from, tcp::socket& to, const microseconds delay)
+            : from_(from), to_(to), delay_(delay)
+        {
+            reader_ = std::thread([this]() { read_loop(); });
+            writer_ = std::thread([this]() { write_loop(); });
+        }
+
+        ~DelayedPipe()
+        {
+            reader_.join();
+            writer_.join();
+        }
+
+    private:
+        struct Chunk
+        {
+            steady_clock::time_point due;
+            std::vector<uint8_t> bytes;
+        };
+
+        tcp::socket& from_;
+        tcp::socket& to_;
+        microseconds delay_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<Chunk> chunks_;
+        bool closed_{false};
+
+        std::thread reader_;
+        std::thread writer_;
+
+        void read_loop()
+        {
+            std::vector<uint8_t> buffer(64 * 1024);
+            boost::system::error_code ec;
+            while (true) {
+                const auto n = from_.read_some(boost::asio::buffer(buffer), ec);
+                if (ec)
+                    break;
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                chunks_.push_back({steady_clock::now() + delay_, {buffer.begin(), buffer.begin() + n}});
+                cv_.notify_one();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            cv_.notify_one();
+        }
+
+        void write_loop()
+        {
+            while (true) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return closed_ || !chunks_.empty(); });
+                if (chunks_.empty())
+                    break;
+
+                auto chunk = std::move(chunks_.front());
+                chunks_.pop_front();
+                lock.unlock();
+
+                std::this_thread::sleep_until(chunk.due);
+                boost::system::error_code ec;
+                boost::asio::write(to_, boost::asio::buffer(chunk.bytes), ec);
+                if (ec)
+                    break;
+            }
+
+            boost::system::error_code ignored;
+            to_.shutdown(tcp::socket::shutdown_send, ignored);
+        }
+    };
+
+    /**
+     * Accepts client connections and relays each one to the server with RTT/2 added per direction
+     */
+    class DelayProxy
+    {
+    public:
+        DelayProxy(const uint16_t upstream_port, const microseconds rtt)
+            : acceptor_(io_context_, tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0))
+              , upstream_(boost::asio::ip::make_address("127.0.0.1"), upstream_port)
+              , one_way_(rtt / 2)
+        {
+            thread_ = std::thread([this]() { accept_loop(); });
+        }
+
+        ~DelayProxy()
+        {
+            // closing the acceptor does not wake a blocked accept(); a last connection does
+            stopping_ = true;
+            boost::system::error_code ignored;
+            tcp::socket wake(io_context_);
+            wake.connect(acceptor_.local_endpoint(), ignored);
+            thread_.join();
+            acceptor_.close(ignored);
+        }
+
+        uint16_t port() const { return acceptor_.local_endpoint().port(); }
+
+    private:
+        boost::asio::io_context io_context_;
+        tcp::acceptor acceptor_;
+        tcp::endpoint upstream_;
+        microseconds one_way_;
+        std::atomic<bool> stopping_{false};
+        std::thread thread_;
+
+        void accept_loop()
+        {
+            while (true) {
+                auto client = std::make_shared<tcp::socket>(io_context_);
+                boost::system::error_code ec;
+                acceptor_.accept(*client, ec);
+                if (ec || stopping_)
+                    return;
+
+                std::thread([this, client]() {
+                    tcp::socket server(io_context_);
+                    boost::system::error_code connect_ec;
+                    server.connect(upstream_, connect_ec);
+                    if (connect_ec)
+                        return;
+                    client->set_option(tcp::no_delay(true));
+                    server.set_option(tcp::no_delay(true));
+
+                    DelayedPipe up(*client, server, one_way_);
+                    DelayedPipe down(server, *client, one_way_);
+                }).detach();
+            }
+        }
+    };
+
+    std::vector<double> measure(const uint16_t port, const bool pipelined, const milliseconds typing,
+                                const int iterations, int& next_user)
+    {
+        std::vector<double> samples;
+        for (int i = 0; i < iterations; ++i) {
+            chat::client::ClientOptions options;
+            options.pipelined_setup = pipelined;
+            options.password_source = [typing]() {
+                std::this_thread::sleep_for(typing);
+                return std::string(kPassword);
+            };
+
+            chat::client::Client client("127.0.0.1", port, "bench" + std::to_string(next_user++), options);
+
+            const auto start = steady_clock::now();
+            client.connect();
+            samples.push_back(duration<double, std::milli>(steady_clock::now() - start).count());
+
+            client.stop();
+        }
+        return samples;
+    }
+
+    double median(std::vector<double> samples)
+    {
+        std::ranges::sort(samples);
+        return samples[samples.size() / 2];
+    }
+
+    void report(const std::string& label, const std::vector<double>& samples)
+    {
+        std::cout << std::left << std::setw(14) << label
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << median(samples)
+            << std::setw(12) << *std::ranges::min_element(samples)
+            << std::setw(12) << *std::ranges::max_element(samples) << "\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const auto rtt        = milliseconds(argc > 1 ? std::atoi(argv[1]) : 50);
+    const auto typing     = milliseconds(argc > 2 ? std::atoi(argv[2]) : 300);
+    const auto iterations = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    // the server reads and writes users.db in its working directory
+    const auto workdir = std::filesystem::temp_directory_path() / "chat_client_setup_bench";
+    std::filesystem::create_directories(workdir);
+    std::filesystem::current_path(workdir);
+    {
+        chat::auth::SRPServer users;
+        chat::auth::VerifierEngine engine;
+        for (int i = 0; i < 2 * iterations; ++i) {
+            const auto name = "bench" + std::to_string(i);
+            users.register_user(name, engine.make_credentials(name, kPassword));
+        }
+        users.save_users("users.db");
+    }
+
+    // server and clients narrate their progress on stdout; keep it out of the report
+    std::ostringstream log;
+    auto* const saved = std::cout.rdbuf(log.rdbuf());
+
+    const auto server_port = free_port();
+    chat::server::Server server(server_port);
+    std::thread server_thread([&server]() { server.run(); });
+
+    std::vector<double> sequential;
+    std::vector<double> pipelined;
+    try {
+        DelayProxy proxy(server_port, duration_cast<microseconds>(rtt));
+
+        int next_user = 0;
+        sequential    = measure(proxy.port(), false, typing, iterations, next_user);
+        pipelined     = measure(proxy.port(), true, typing, iterations, next_user);
+
+        // let the server finish the DISCONNECTs before tearing down
+        std::this_thread::sleep_for(milliseconds(200) + rtt);
+    }
+    catch (const std::exception& e) {
+        std::cout.rdbuf(saved);
+        std::cerr << "error: " << e.what() << std::endl;
+        server.stop();
+        server_thread.join();
+        return EXIT_FAILURE;
+    }
+
+    server.stop();
+    server_thread.join();
+    std::cout.rdbuf(saved);
+
+    std::cout << "rtt " << rtt.count() << " ms, typing " << typing.count() << " ms, "
+        << iterations << " iterations\n\n";
+    std::cout << std::left << std::setw(14) << "setup"
+        << std::right << std::setw(12) << "median ms" << std::setw(12) << "min ms" << std::setw(12) << "max ms"
+        << "\n";
+    report("sequential", sequential);
+    report("pipelined", pipelined);
+    std::cout << "\nsaved " << std::fixed << std::setprecision(1)
+        << median(sequential) - median(pipelined) << " ms per login\n";
+
+    std::filesystem::current_path(workdir.parent_path());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+// Chat text on the wire: AES-GCM alone vs deflate before sealing (DeflateStream).
+//
+// Messages are drawn from a vocabulary of chat words and phrases with a Zipf-like
+// skew, in three size classes (short replies, ordinary lines, pasted paragraphs).
+// Each mode sends the same sequence over one connection and reports MESSAGE frame
+// bytes on the wire and sender plus receiver CPU per message. "trained" uses a
+// dictionary built by train_dictionary() from a separate sample of the same
+// generator, standing in for one trained on real room logs.
+//
+// Usage: compression_bench [messages=20000]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chat/auth/srp_utils.hpp"
+#include "chat/common/compression.hpp"
+#include "chat/common/messages.hpp"
+#include "chat/common/protocol.hpp"
+#include "chat/crypto/aes_engine.hpp"
+
+namespace
+{
+    using namespace std::chrono;
+
+    const std::vector<std::string> kVocabulary = {
+        "the", "i", "to", "you", "a", "it", "and", "is", "that", "for", "on", "in", "this", "just", "we", "so",
+        "lol", "ok", "yeah", "thanks", "haha", "can", "what", "do", "have", "not", "be", "with", "are", "me",
+        "build", "deploy", "review", "merge", "tests", "branch", "meeting", "tomorrow", "today", "later",
+        "looks good to me", "let me check", "on my way", "sounds good", "no worries", "i think so",
+        "did you see", "can someone take a look", "thanks for the help", "makes sense", "not sure",
+        "the build is broken again", "pushed a fix", "running late", "brb", "good morning", "see you",
+        "pull request", "in a few minutes", "what do you think", "is anyone around", "coffee?",
+    };
+
+    class Corpus
+    {
+    public:
+        explicit Corpus(const uint32_t seed) : rng_(seed) {}
+
+        // short replies dominate, long pastes are rare
+        std::string next()
+        {
+            const auto cls = rng_() % 10;
+            const size_t target = cls < 5 ? 12 + rng_() % 20 : cls < 9 ? 40 + rng_() % 80 : 200 + rng_() % 300;
+            std::string text;
+            while (text.size() < target) {
+                if (!text.empty())
+                    text += ' ';
+                text += word();
+            }
+            return text;
+        }
+
+    private:
+        std::mt19937 rng_;
+
+        const std::string& word()
+        {
+            // rank r picked with probability ~ 1/r
+            std::uniform_real_distribution<double> u(0.0, 1.0);
+            const double x = std::pow(static_cast<double>(kVocabulary.size()), u(rng_));
+            return kVocabulary[static_cast<size_t>(x) - 1];
+        }
+    };
+
+    // keeps the optimizer from discarding work
+    volatile size_t g_sink = 0;
+
+    struct Mode
+    {
+        const char* label;
+        // returns the bytes that get sealed, and the receiver's inverse
+        std::function<std::vector<uint8_t>(const std::string&)> compress;
+        std::function<std::string(const std::vector<uint8_t>&)> decompress;
+    };
+
+    void run(const Mode& mode, const std::vector<std::string>& messages, const std::vector<uint8_t>& key,
+             const size_t plain_bytes)
+    {
+        size_t wire = 0;
+        std::vector<std::vector<uint8_t>> frames;
+        frames.reserve(messages.size());
+
+        const auto sent = steady_clock::now();
+        for (const auto& text : messages) {
+            const auto sealed = chat::crypto::AESEngine::encrypt(mode.compress(text), key);
+            frames.push_back(chat::Protocol::encode(chat::MessageType::MESSAGE,
+                                                    chat::TextMsg{chat::auth::SRPUtils::bytes_to_base64(sealed)}));
+            wire += frames.back().size();
+        }
+        const auto received = steady_clock::now();
+        for (const auto& frame : frames) {
+            const auto msg = chat::Protocol::try_decode<chat::TextMsg>(
+                std::span(frame).subspan(sizeof(chat::MsgHeader)));
+            const auto body = chat::crypto::AESEngine::decrypt(
+                chat::auth::SRPUtils::base64_to_bytes(msg->ciphertext_b64), key);
+            g_sink = g_sink + mode.decompress(body).size();
+        }
+        const auto done = steady_clock::now();
+
+        const auto per_message = [&](const steady_clock::duration d) {
+            return static_cast<double>(duration_cast<nanoseconds>(d).count()) / 1000.0 /
+                static_cast<double>(messages.size());
+        };
+        const double bytes = static_cast<double>(wire) / static_cast<double>(messages.size());
+        std::cout << std::left << std::setw(16) << mode.label << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << bytes << std::setw(9) << std::setprecision(0)
+            << 100.0 * static_cast<double>(wire) / static_cast<double>(plain_bytes) << "%" << std::setprecision(2)
+            << std::setw(12) << per_message(received - sent) << std::setw(12) << per_message(done - received)
+            << std::endl;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000;
+
+    Corpus corpus(42);
+    std::vector<std::string> messages;
+    size_t text_bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        messages.push_back(corpus.next());
+        text_bytes += messages.back().size();
+    }
+
+    Corpus training(7);
+    std::vector<std::string> samples;
+    for (size_t i = 0; i < 5'000; ++i)
+        samples.push_back(training.next());
+    const std::string trained = chat::train_dictionary(samples, 4096);
+    const std::span<const uint8_t> trained_span(reinterpret_cast<const uint8_t*>(trained.data()), trained.size());
+
+    const std::vector<uint8_t> key(chat::crypto::AESEngine::KEY_SIZE, 0x42);
+    const auto bytes_of = [](const std::string& text) { return std::vector<uint8_t>(text.begin(), text.end()); };
+    const auto text_of  = [](const std::vector<uint8_t>& bytes) { return std::string(bytes.begin(), bytes.end()); };
+
+    // one stream pair per mode, living as long as the simulated connection
+    const auto streaming = [](const char* label, const std::span<const uint8_t> dictionary) {
+        auto deflate = std::make_shared<chat::DeflateStream>(dictionary);
+        auto inflate = std::make_shared<chat::InflateStream>(dictionary);
+        return Mode{
+            label,
+            [deflate](const std::string& text) { return deflate->compress(text); },
+            [inflate](const std::vector<uint8_t>& body) {
+                return *inflate->decompress(body, chat::ProtocolHelpers::kMaxPayloadSize);
+            }};
+    };
+    // a fresh stream per message: what compressing each message on its own would get
+    const auto per_message = [](const char* label, const std::span<const uint8_t> dictionary) {
+        return Mode{
+            label,
+            [dictionary](const std::string& text) { return chat::DeflateStream(dictionary).compress(text); },
+            [dictionary](const std::vector<uint8_t>& body) {
+                return *chat::InflateStream(dictionary).decompress(body, chat::ProtocolHelpers::kMaxPayloadSize);
+            }};
+    };
+
+    // plain MESSAGE frames are the 100% baseline
+    size_t plain_wire = 0;
+    for (const auto& text : messages) {
+        plain_wire += chat::Protocol::encode(
+            chat::MessageType::MESSAGE,
+            chat::TextMsg{chat::auth::SRPUtils::bytes_to_base64(
+                chat::crypto::AESEngine::encrypt(bytes_of(text), key))}).size();
+    }
+
+    std::cout << count << " messages, " << std::fixed << std::setprecision(1)
+        << static_cast<double>(text_bytes) / static_cast<double>(count) << " text bytes avg, trained dictionary "
+        << trained.size() << " bytes\n\n";
+    std::cout << std::left << std::setw(16) << "mode" << std::right << std::setw(10) << "wire B" << std::setw(10)
+        << "vs plain" << std::setw(12) << "send us" << std::setw(12) << "recv us" << std::endl;
+
+    run(Mode{"none", bytes_of, text_of}, messages, key, plain_wire);
+    run(per_message("per-message", {}), messages, key, plain_wire);
+    run(per_message("per-msg + dict", chat::chat_dictionary()), messages, key, plain_wire);
+    run(streaming("stream", {}), messages, key, plain_wire);
+    run(streaming("stream + dict", chat::chat_dictionary()), messages, key, plain_wire);
+    run(streaming("stream + trained", trained_span), messages, key, plain_wire);
+
+    return EXIT_SUCCESS;
+}
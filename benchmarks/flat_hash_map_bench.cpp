@@ -0,0 +1,116 @@
+// FlatHashMap vs std::unordered_map: insert, lookup (hit/miss) and erase.
+//
+// Keys look like the server's user ids ("user_" + 8 hex digits). Lookups on the
+// flat map go through std::string_view, the way decoded wire fields are looked up;
+// std::unordered_map needs a temporary std::string for the same query.
+//
+// Usage: flat_hash_map_bench [sizes...]   (default: 100000 1000000)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "chat/common/flat_hash_map.hpp"
+
+namespace
+{
+    using namespace std::chrono;
+
+    std::vector<std::string> make_keys(const size_t count, const uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<std::string> keys;
+        keys.reserve(count);
+        char buf[16];
+        for (size_t i = 0; i < count; ++i) {
+            std::snprintf(buf, sizeof(buf), "user_%08x", static_cast<unsigned>(rng()));
+            keys.emplace_back(buf);
+        }
+        return keys;
+    }
+
+    template <class F>
+    double ns_per_op(const size_t ops, F&& f)
+    {
+        const auto start = steady_clock::now();
+        f();
+        return static_cast<double>(duration_cast<nanoseconds>(steady_clock::now() - start).count()) /
+            static_cast<double>(ops);
+    }
+
+    // keeps the optimizer from discarding lookups
+    volatile size_t g_sink = 0;
+
+    template <class Map, class Lookup>
+    void run(const char* name, const std::vector<std::string>& keys, const std::vector<std::string>& misses,
+             Lookup&& lookup)
+    {
+        Map map;
+        const double insert = ns_per_op(keys.size(), [&]() {
+            for (size_t i = 0; i < keys.size(); ++i)
+                map[keys[i]] = i;
+        });
+
+        std::vector<std::string_view> shuffled(keys.begin(), keys.end());
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(7));
+
+        const double hit = ns_per_op(shuffled.size(), [&]() {
+            size_t found = 0;
+            for (const auto key : shuffled)
+                found += lookup(map, key);
+            g_sink = found;
+        });
+
+        const double miss = ns_per_op(misses.size(), [&]() {
+            size_t found = 0;
+            for (const auto& key : misses)
+                found += lookup(map, key);
+            g_sink = found;
+        });
+
+        const double erase = ns_per_op(shuffled.size(), [&]() {
+            for (const auto& key : keys)
+                map.erase(key);
+        });
+
+        std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << insert << std::setw(10) << hit << std::setw(10) << miss
+            << std::setw(10) << erase << std::endl;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (sizes.empty())
+        sizes = {100'000, 1'000'000};
+
+    for (const auto size : sizes) {
+        const auto keys   = make_keys(size, 1);
+        const auto misses = make_keys(size, 2);
+
+        std::cout << "\n" << size << " entries (ns/op)\n";
+        std::cout << std::left << std::setw(20) << "map" << std::right << std::setw(10) << "insert"
+            << std::setw(10) << "hit" << std::setw(10) << "miss" << std::setw(10) << "erase" << std::endl;
+
+        run<std::unordered_map<std::string, size_t>>(
+            "std::unordered_map", keys, misses,
+            [](const auto& map, const std::string_view key) { return map.count(std::string(key)); });
+
+        run<chat::FlatHashMap<std::string, size_t>>(
+            "chat::FlatHashMap", keys, misses,
+            [](const auto& map, const std::string_view key) { return map.count(key); });
+    }
+
+    return EXIT_SUCCESS;
+}
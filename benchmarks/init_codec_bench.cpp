@@ -0,0 +1,87 @@
+// INIT payload: nested v1 tuple encoding vs the columnar v2 encoding (InitCodec).
+//
+// History looks like a busy room: a few dozen speakers, short texts, timestamps a
+// few seconds apart. Reports wire size plus build and parse time per INIT.
+//
+// Usage: init_codec_bench [history=100] [users=50] [iterations=20000]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chat/common/init_codec.hpp"
+#include "chat/common/messages.hpp"
+#include "chat/common/protocol.hpp"
+
+namespace
+{
+    using namespace std::chrono;
+
+    template <class F>
+    double us_per_op(const size_t iterations, F&& f)
+    {
+        const auto start = steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+            f();
+        return static_cast<double>(duration_cast<nanoseconds>(steady_clock::now() - start).count()) /
+            1000.0 / static_cast<double>(iterations);
+    }
+
+    // keeps the optimizer from discarding work
+    volatile size_t g_sink = 0;
+
+    void report(const char* label, const size_t bytes, const double build_us, const double parse_us)
+    {
+        std::cout << std::left << std::setw(10) << label << std::right << std::setw(12) << bytes << std::fixed
+            << std::setprecision(2) << std::setw(12) << build_us << std::setw(12) << parse_us << std::endl;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    const size_t history    = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100;
+    const size_t user_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50;
+    const size_t iterations = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20'000;
+
+    std::mt19937 rng(42);
+    std::vector<chat::User> users;
+    for (size_t i = 0; i < user_count; ++i)
+        users.push_back({"user" + std::to_string(i), "user_" + std::to_string(i + 1)});
+
+    std::vector<chat::Message> messages;
+    auto ts = system_clock::time_point(milliseconds(1'700'000'000'000));
+    for (size_t i = 0; i < history; ++i) {
+        ts += milliseconds(500 + rng() % 10'000);
+        messages.push_back({users[rng() % users.size()].username, std::string(8 + rng() % 64, 'x'), ts, i + 1});
+    }
+
+    const auto v1 = chat::Protocol::encode(chat::MessageType::INIT, chat::InitMsg{messages, users});
+    const auto v2 = chat::InitCodec::encode(messages, users);
+    const std::vector<uint8_t> v1_payload(v1.begin() + sizeof(chat::MsgHeader), v1.end());
+    const std::vector<uint8_t> v2_payload(v2.begin() + sizeof(chat::MsgHeader), v2.end());
+
+    const double v1_build = us_per_op(iterations, [&]() {
+        g_sink = g_sink + chat::Protocol::encode(chat::MessageType::INIT, chat::InitMsg{messages, users}).size();
+    });
+    const double v2_build = us_per_op(iterations, [&]() {
+        g_sink = g_sink + chat::InitCodec::encode(messages, users).size();
+    });
+    const double v1_parse = us_per_op(iterations, [&]() {
+        g_sink = g_sink + chat::Protocol::try_decode<chat::InitMsg>(v1_payload)->messages.size();
+    });
+    const double v2_parse = us_per_op(iterations, [&]() {
+        g_sink = g_sink + chat::InitCodec::try_decode(v2_payload)->messages.size();
+    });
+
+    std::cout << history << " messages, " << user_count << " users, " << iterations << " iterations\n\n";
+    std::cout << std::left << std::setw(10) << "encoding" << std::right << std::setw(12) << "bytes"
+        << std::setw(12) << "build us" << std::setw(12) << "parse us" << std::endl;
+    report("v1", v1.size(), v1_build, v1_parse);
+    report("v2", v2.size(), v2_build, v2_parse);
+
+    return EXIT_SUCCESS;
+}
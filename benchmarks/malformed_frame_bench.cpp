@@ -0,0 +1,90 @@
+// Cost of rejecting hostile input: throwing wrappers vs the Result-returning paths.
+//
+// Frames are truncated TextMsg payloads (decode failure) and TextMsg ciphertexts
+// with a flipped tag byte (AEAD failure), i.e. what a misbehaving client floods us with.
+//
+// Usage: malformed_frame_bench [frames=200000]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "chat/auth/srp_utils.hpp"
+#include "chat/common/messages.hpp"
+#include "chat/common/protocol.hpp"
+#include "chat/crypto/aes_engine.hpp"
+
+namespace
+{
+    using namespace std::chrono;
+
+    template <class F>
+    double ns_per_frame(const size_t frames, F&& f)
+    {
+        const auto start = steady_clock::now();
+        size_t rejected  = 0;
+        for (size_t i = 0; i < frames; ++i)
+            rejected += f();
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        if (rejected != frames)
+            std::cerr << "unexpected: only " << rejected << " of " << frames << " frames rejected" << std::endl;
+        return static_cast<double>(elapsed) / static_cast<double>(frames);
+    }
+
+    void report(const char* label, const double throwing, const double result)
+    {
+        std::cout << std::left << std::setw(18) << label << std::right << std::fixed << std::setprecision(0)
+            << std::setw(14) << throwing << std::setw(14) << result << std::setw(9) << std::setprecision(1)
+            << throwing / result << "x" << std::endl;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    const size_t frames = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200'000;
+
+    // truncated frame: length prefix promises more bytes than the payload holds
+    auto packet = chat::Protocol::encode(chat::MessageType::MESSAGE, chat::TextMsg{std::string(64, 'x')});
+    std::vector<uint8_t> truncated(packet.begin() + sizeof(chat::MsgHeader), packet.end() - 8);
+
+    // forged ciphertext: correct shape, bad tag
+    const auto key = chat::auth::SRPUtils::random_bytes(chat::crypto::AESEngine::KEY_SIZE);
+    auto forged    = chat::crypto::AESEngine::encrypt_string(std::string(64, 'x'), key);
+    forged.back() ^= 0xFF;
+
+    const double decode_throw = ns_per_frame(frames, [&]() {
+        try {
+            (void)chat::Protocol::decode<chat::TextMsg>(truncated);
+            return 0;
+        }
+        catch (const std::exception&) {
+            return 1;
+        }
+    });
+    const double decode_result = ns_per_frame(frames, [&]() {
+        return chat::Protocol::try_decode<chat::TextMsg>(truncated) ? 0 : 1;
+    });
+
+    const double aead_throw = ns_per_frame(frames, [&]() {
+        try {
+            (void)chat::crypto::AESEngine::decrypt(forged, key);
+            return 0;
+        }
+        catch (const std::exception&) {
+            return 1;
+        }
+    });
+    const double aead_result = ns_per_frame(frames, [&]() {
+        return chat::crypto::AESEngine::try_decrypt(forged, key) ? 0 : 1;
+    });
+
+    std::cout << frames << " malformed frames per case (ns/frame)\n\n";
+    std::cout << std::left << std::setw(18) << "case" << std::right << std::setw(14) << "throwing"
+        << std::setw(14) << "Result" << std::setw(10) << "speedup" << std::endl;
+    report("truncated decode", decode_throw, decode_result);
+    report("bad AEAD tag", aead_throw, aead_result);
+
+    return EXIT_SUCCESS;
+}
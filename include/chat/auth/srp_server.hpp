@@ -3,11 +3,13 @@
 #include <string>
 #include <vector>
 #include <memory>
-#include <unordered_map>
 #include <mutex>
+#include <string_view>
 
 #include "chat/auth/srp_types.hpp"
 #include "chat/auth/srp_utils.hpp"
+#include "chat/common/flat_hash_map.hpp"
+#include "chat/common/object_pool.hpp"
 
 namespace chat::auth
 {
@@ -24,25 +26,31 @@ namespace chat::auth
         std::unique_ptr<SRPUtils::BigNum> k_; // multiplier k = H(N, g)
 
         // user credentials database
-        std::unordered_map<std::string, UserCredentials> users_;
+        FlatHashMap<std::string, UserCredentials> users_;
         std::mutex users_mutex_;
 
-        // active SRP sessions
-        std::unordered_map<std::string, SRPSession> sessions_;
+        // active SRP sessions; their buffers are recycled through the pool
+        ObjectPool<SRPSession> session_pool_;
+        FlatHashMap<std::string, std::shared_ptr<SRPSession>> sessions_;
         std::mutex sessions_mutex_;
 
         // room salt for message encryption (shared by all users)
         std::vector<uint8_t> room_salt_;
 
     public:
-        SRPServer();
-        explicit SRPServer(const std::vector<uint8_t>& room_salt);
+        static constexpr size_t kSessionPoolCapacity = 256;
+
+        explicit SRPServer(size_t session_pool = kSessionPoolCapacity);
+        explicit SRPServer(const std::vector<uint8_t>& room_salt, size_t session_pool = kSessionPoolCapacity);
         ~SRPServer();
 
         // user management
         bool register_user(const std::string& username, const UserCredentials& creds);
-        bool user_exists(const std::string& username);
-        void remove_user(const std::string& username);
+        // bulk insert under one lock; existing usernames are skipped, returns the number added
+        size_t register_users(std::vector<UserCredentials>&& batch);
+        [[nodiscard]] size_t user_count();
+        bool user_exists(std::string_view username);
+        void remove_user(std::string_view username);
 
         // load/save user database
         void load_users(const std::string& filepath);
@@ -64,11 +72,11 @@ namespace chat::auth
             const std::vector<uint8_t>& A);
 
         // step 2: verify client's proof M
-        // returns: H_AMK (server proof), session_key (Fernet key)
+        // returns: H_AMK (server proof), K (shared secret; session keys are derived from it, never sent)
         struct VerifyResponse
         {
             std::vector<uint8_t> H_AMK;
-            std::vector<uint8_t> session_key;
+            std::vector<uint8_t> K;
         };
 
         VerifyResponse verify_authentication(
@@ -76,11 +84,12 @@ namespace chat::auth
             const std::vector<uint8_t>& M);
 
         // session management
-        bool is_session_valid(const std::string& user_id);
-        void clear_session(const std::string& user_id);
+        bool is_session_valid(std::string_view user_id);
+        void clear_session(std::string_view user_id);
         void clear_expired_sessions(int timeout_seconds = 3600);
 
         [[nodiscard]] std::vector<uint8_t> get_room_salt() const { return room_salt_; }
+        [[nodiscard]] PoolStats session_pool_stats() const { return session_pool_.stats(); }
 
     private:
         [[nodiscard]] std::string generate_user_id() const;
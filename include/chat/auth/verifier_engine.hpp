@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <openssl/bn.h>
+
+#include "chat/auth/srp_types.hpp"
+#include "chat/auth/srp_utils.hpp"
+
+namespace chat::auth
+{
+    /**
+     * Reusable verifier computation for bulk registration
+     * Produces the same credentials as SRPClient::register_user, but keeps N, g,
+     * the BN_CTX and the Montgomery form of N alive across calls instead of
+     * rebuilding them for every user. Not thread-safe: use one per thread.
+     */
+    class VerifierEngine
+    {
+    private:
+        SRPUtils::BigNum N_;
+        SRPUtils::BigNum g_;
+        BN_CTX* ctx_;
+        BN_MONT_CTX* mont_;
+
+    public:
+        VerifierEngine();
+        ~VerifierEngine();
+
+        VerifierEngine(const VerifierEngine&)            = delete;
+        VerifierEngine& operator=(const VerifierEngine&) = delete;
+
+        // fresh random salt
+        UserCredentials make_credentials(const std::string& username, const std::string& password);
+
+        // caller-supplied salt (migrations that keep existing salts, tests)
+        UserCredentials make_credentials(const std::string& username, const std::string& password,
+                                         std::vector<uint8_t> salt);
+    };
+} // namespace chat::auth
@@ -1,39 +1,93 @@
 #pragma once
 
 #include <string>
+#include <functional>
 #include <memory>
 #include <atomic>
 #include <thread>
 #include <vector>
 #include <mutex>
+#include <set>
+#include <optional>
 #include <boost/asio.hpp>
 
 #include "chat/auth/srp_client.hpp"
+#include "chat/common/capabilities.hpp"
+#include "chat/common/compression.hpp"
 #include "chat/common/types.hpp"
+#include "chat/common/socket_tuning.hpp"
+#include "chat/crypto/session_keys.hpp"
 
 namespace chat::client
 {
+    struct ClientOptions
+    {
+        SocketTuning socket_tuning{};
+
+        // overlap resolve/connect, SRP A generation and the password prompt instead of
+        // running them one after another
+        bool pipelined_setup{true};
+        bool tcp_fastopen{true};
+
+        // open with HELLO, announcing which optional encodings this client reads (see Capability);
+        // servers that predate it reject it, so this has to be off for them
+        bool hello{true};
+
+        // offer a per-connection deflate stream for chat text (see DeflateStream); servers that
+        // predate the offer reject it, so this has to be off for them
+        bool compression{true};
+
+        // password source for non-interactive use; empty prompts on stdin
+        std::function<std::string()> password_source{};
+    };
+
     class Client
     {
     public:
-        Client(std::string host, int port, std::string username);
+        Client(std::string host, int port, std::string username, ClientOptions options = {});
         ~Client();
 
+        // connect, authenticate and wait for INIT; returns once joined
+        void connect();
+
+        // connect() followed by the interactive loop
         void run();
         void stop();
 
+        // encrypted chat message to the room; a no-op until connected
+        void send_message(const std::string& text);
+
+        // volatile state for the rest of the room: not stored, may be collapsed or dropped
+        void send_ephemeral(EphemeralKind kind, const std::string& value);
+
+        // while away the server holds messages back and sends them in digests; coming back flushes them
+        void set_away(bool away);
+
+        [[nodiscard]] bool is_connected() const { return connected_; }
+
     private:
         boost::asio::io_context io_context_;
         boost::asio::ip::tcp::socket socket_;
 
         std::unique_ptr<auth::SRPClient> srp_client_;
-        std::vector<uint8_t> room_key_;
+        // derived from SRP's K at login: client-to-server seals, server-to-client opens
+        std::optional<crypto::Sealer> sealer_;
+        std::vector<uint8_t> receive_key_;
+
+        // what HELLO_ACK granted; stays at the pre-HELLO defaults with hello off
+        PeerFeatures server_features_;
+
+        // set once the server accepts the offer; deflate_ is used under send_mutex_, inflate_ by the receive path
+        std::unique_ptr<DeflateStream> deflate_;
+        std::unique_ptr<InflateStream> inflate_;
+        std::mutex send_mutex_;
 
         std::string host_;
         int port_;
         std::string username_;
         std::string password_;
         std::string user_id_;
+        ClientOptions options_;
 
         std::atomic<bool> running_;
         std::atomic<bool> connected_;
@@ -41,7 +95,9 @@ namespace chat::client
         std::thread receive_thread_;
 
         std::vector<Message> messages_;
+        std::vector<Message> pending_history_; // HISTORY frames received ahead of INIT
         std::vector<User> users_;
+        std::set<std::string> typing_users_; // guarded by users_mutex_
 
         std::mutex messages_mutex_;
         std::mutex users_mutex_;
@@ -49,16 +105,20 @@ namespace chat::client
 
         void disconnect();
 
+        void connect_socket();
+        void read_password();
+
         void srp_authenticate();
         void srp_register();
 
-        void send_message(const std::string& text);
         void receive_loop();
 
         void send_packet(const std::vector<uint8_t>& packet);
         std::pair<MessageType, std::vector<uint8_t>> receive_packet();
         void handle_packet(MessageType type, const std::vector<uint8_t>& payload);
         void handle_broadcast(const std::vector<uint8_t>& payload);
+        void handle_catch_up(const std::vector<uint8_t>& payload);
+        void handle_ephemeral(const std::vector<uint8_t>& payload);
 
         void render_ui();
         void clear_screen();
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <vector>
+#include <span>
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <cstring>
 #include <chrono>
 #include <stdexcept>
 
+#include "chat/common/result.hpp"
+
 namespace chat
 {
     class BufferWriter
@@ -24,21 +28,35 @@ namespace chat
 
         void write_string(const std::string& str);
         void write_bytes(const std::vector<uint8_t>& bytes);
+        void write_bytes(std::span<const uint8_t> bytes);
+
+        // LEB128: 7 bits per byte, high bit set on all but the last
+        void write_varint(uint64_t value);
+        void write_zigzag(int64_t value) { write_varint(zigzag_encode(value)); }
+
+        static constexpr uint64_t zigzag_encode(const int64_t value)
+        {
+            return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        }
     };
 
     class BufferReader
     {
     public:
-        const std::vector<uint8_t>& data;
+        std::span<const uint8_t> data;
         size_t pos = 0;
 
+        explicit BufferReader(std::span<const uint8_t> d);
         explicit BufferReader(const std::vector<uint8_t>& d);
 
+        [[nodiscard]] size_t remaining() const { return data.size() - pos; }
+
+        // non-throwing readers: on underflow the position is left unchanged
         template <typename T>
-        T read()
+        Result<T> try_read()
         {
-            if (pos + sizeof(T) > data.size())
-                throw std::runtime_error("Buffer underflow");
+            if (remaining() < sizeof(T))
+                return Errc::buffer_underflow;
 
             T value;
             std::memcpy(&value, data.data() + pos, sizeof(T));
@@ -46,6 +64,28 @@ namespace chat
             return value;
         }
 
+        Result<std::string> try_read_string();
+        [[nodiscard]] bool try_read_bytes(uint8_t* dest, size_t count);
+
+        // zero-copy: views into the underlying buffer, valid as long as it is
+        Result<std::string_view> try_read_string_view();
+        Result<std::span<const uint8_t>> try_read_span(size_t count);
+
+        Result<uint64_t> try_read_varint();
+        Result<int64_t> try_read_zigzag();
+
+        static constexpr int64_t zigzag_decode(const uint64_t value)
+        {
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        // throwing wrappers
+        template <typename T>
+        T read()
+        {
+            return try_read<T>().value();
+        }
+
         std::string read_string();
         void read_bytes(uint8_t* dest, size_t count);
     };
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace chat
+{
+    // bumped when the HELLO exchange itself changes; a peer that sends no HELLO is version 0
+    inline constexpr uint16_t kProtocolVersion = 1;
+
+    // optional protocol features, one bit each in HELLO's capability bitmap
+    enum class Capability : uint32_t
+    {
+        BinaryFields = 1U << 0, // columnar INIT_V2 and HISTORY payloads (see InitCodec); else v1 INIT tuples
+        Compression  = 1U << 1, // COMPRESS_OFFER is understood (see DeflateStream)
+        Batching     = 1U << 2, // the whole INIT snapshot as one INIT_SEALED envelope; needs BinaryFields
+        GroupKey     = 1U << 3, // one room key for every session; reserved, no server grants it yet
+        Resume       = 1U << 4, // CATCH_UP from the delivery cursor on join, and away digests
+    };
+
+    constexpr uint32_t operator|(const Capability a, const Capability b)
+    {
+        return static_cast<uint32_t>(a) | static_cast<uint32_t>(b);
+    }
+
+    constexpr uint32_t operator|(const uint32_t a, const Capability b)
+    {
+        return a | static_cast<uint32_t>(b);
+    }
+
+    /**
+     * What one connection agreed on in its HELLO exchange
+     * The default is what a peer that never sent HELLO gets: version 0 and
+     * no optional features, i.e. the encodings every client understands.
+     */
+    struct PeerFeatures
+    {
+        uint16_t version      = 0;
+        uint32_t capabilities = 0;
+
+        [[nodiscard]] constexpr bool has(const Capability capability) const
+        {
+            return (capabilities & static_cast<uint32_t>(capability)) != 0;
+        }
+
+        // the lower version and the features both sides implement, minus any whose prerequisite fell out
+        static constexpr PeerFeatures negotiate(const uint16_t offered_version, const uint32_t offered,
+                                                const uint16_t own_version, const uint32_t supported)
+        {
+            PeerFeatures agreed{std::min(offered_version, own_version), offered & supported};
+            if (!agreed.has(Capability::BinaryFields))
+                agreed.capabilities &= ~static_cast<uint32_t>(Capability::Batching);
+            return agreed;
+        }
+    };
+} // namespace chat
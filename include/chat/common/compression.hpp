@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chat/common/result.hpp"
+
+struct z_stream_s;
+
+namespace chat
+{
+    enum class Compression : uint8_t
+    {
+        None,
+        Deflate, // raw deflate, one stream per direction for the connection's lifetime
+    };
+
+    // preset dictionary both ends load before the first message (see chat_dictionary.cpp)
+    std::span<const uint8_t> chat_dictionary();
+
+    // what peers compare during negotiation: the dictionary's Adler-32
+    uint32_t dictionary_id(std::span<const uint8_t> dictionary);
+
+    /**
+     * Picks a preset dictionary from sample messages
+     * Words and short phrases are scored by how many bytes they would save
+     * (occurrences x length) and the best are concatenated up to max_size,
+     * the most valuable last, where deflate reaches them with the shortest
+     * distances. Only phrases seen at least twice are considered.
+     */
+    std::string train_dictionary(const std::vector<std::string>& samples, size_t max_size);
+
+    /**
+     * Compressing half of a per-connection deflate stream
+     * Chat text is too short to compress on its own; keeping one context for
+     * the connection's lifetime lets each message refer back to earlier ones,
+     * and the preset dictionary covers the first few. Every message ends in a
+     * sync flush, so it can be decompressed as soon as it arrives; the flush
+     * marker (00 00 ff ff) is implied rather than sent.
+     *
+     * Compression happens before AES-GCM sealing, and the frames of one
+     * direction must be decompressed in the order they were compressed, so
+     * only frames that are never dropped or reordered may use the stream.
+     * Message lengths then depend on earlier text in the same stream; the
+     * server keeps one stream per recipient and sends it nothing the
+     * recipient would not see in plaintext anyway.
+     *
+     * Window and memory level are cut down from zlib's defaults to about
+     * 48 KiB per stream, since the server keeps one per connection.
+     *
+     * Not synchronized.
+     */
+    class DeflateStream
+    {
+    public:
+        explicit DeflateStream(std::span<const uint8_t> dictionary = chat_dictionary(), int level = 6);
+        ~DeflateStream();
+
+        DeflateStream(const DeflateStream&)            = delete;
+        DeflateStream& operator=(const DeflateStream&) = delete;
+
+        [[nodiscard]] std::vector<uint8_t> compress(std::string_view text);
+
+    private:
+        std::unique_ptr<z_stream_s> stream_;
+    };
+
+    // decompressing half; once a frame fails the stream is out of sync and the connection must go
+    class InflateStream
+    {
+    public:
+        explicit InflateStream(std::span<const uint8_t> dictionary = chat_dictionary());
+        ~InflateStream();
+
+        InflateStream(const InflateStream&)            = delete;
+        InflateStream& operator=(const InflateStream&) = delete;
+
+        // Errc::payload_too_large beyond max_size, Errc::decompression_failed on corrupt input
+        Result<std::string> decompress(std::span<const uint8_t> data, size_t max_size);
+
+    private:
+        std::unique_ptr<z_stream_s> stream_;
+        bool failed_{false};
+    };
+} // namespace chat
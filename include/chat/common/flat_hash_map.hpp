@@ -0,0 +1,550 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHAT_FLAT_MAP_SSE2 1
+#endif
+
+namespace chat
+{
+    /**
+     * Transparent string hash: std::string, std::string_view and const char*
+     * keys hash identically, so lookups never materialize a temporary std::string
+     */
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(const std::string_view s) const noexcept
+        {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    template <class Key>
+    struct FlatHash : std::hash<Key>
+    {
+    };
+
+    template <>
+    struct FlatHash<std::string> : StringHash
+    {
+    };
+
+    namespace detail
+    {
+        // control byte states; full slots store the low 7 bits of the hash (0..127)
+        inline constexpr int8_t kCtrlEmpty    = -128;
+        inline constexpr int8_t kCtrlDeleted  = -2;
+        inline constexpr int8_t kCtrlSentinel = -1;
+        inline constexpr size_t kGroupWidth   = 16;
+
+        // one 16-slot probe window; each match() bit is a candidate slot
+        struct ProbeGroup
+        {
+#ifdef CHAT_FLAT_MAP_SSE2
+            __m128i ctrl;
+
+            explicit ProbeGroup(const int8_t* pos)
+                : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)))
+            {
+            }
+
+            [[nodiscard]] uint32_t match(const int8_t h2) const
+            {
+                return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+            }
+
+            [[nodiscard]] uint32_t match_empty() const
+            {
+                return match(kCtrlEmpty);
+            }
+
+            [[nodiscard]] uint32_t match_empty_or_deleted() const
+            {
+                // empty and deleted are the only states below the sentinel
+                return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(kCtrlSentinel), ctrl)));
+            }
+#else
+            int8_t ctrl[kGroupWidth];
+
+            explicit ProbeGroup(const int8_t* pos)
+            {
+                std::memcpy(ctrl, pos, kGroupWidth);
+            }
+
+            [[nodiscard]] uint32_t match(const int8_t h2) const
+            {
+                uint32_t mask = 0;
+                for (size_t i = 0; i < kGroupWidth; ++i)
+                    mask |= static_cast<uint32_t>(ctrl[i] == h2) << i;
+                return mask;
+            }
+
+            [[nodiscard]] uint32_t match_empty() const
+            {
+                return match(kCtrlEmpty);
+            }
+
+            [[nodiscard]] uint32_t match_empty_or_deleted() const
+            {
+                uint32_t mask = 0;
+                for (size_t i = 0; i < kGroupWidth; ++i)
+                    mask |= static_cast<uint32_t>(ctrl[i] < kCtrlSentinel) << i;
+                return mask;
+            }
+#endif
+        };
+
+        inline unsigned lowest_bit(const uint32_t mask)
+        {
+            return static_cast<unsigned>(std::countr_zero(mask));
+        }
+
+        inline unsigned leading_free(const uint32_t mask)
+        {
+            // leading zeros within the 16-bit group mask
+            return static_cast<unsigned>(std::countl_zero(static_cast<uint16_t>(mask)));
+        }
+
+        inline size_t mix_hash(size_t h)
+        {
+            // murmur3 finalizer: spreads weak hashes (e.g. identity for integers) over H1 and H2
+            uint64_t x = h;
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            return static_cast<size_t>(x);
+        }
+    } // namespace detail
+
+    /**
+     * Open-addressing hash map (SwissTable layout)
+     * Slots are stored inline in one array next to a control-byte array that is
+     * scanned 16 slots at a time with SSE2. Iterators and references are
+     * invalidated by any insertion that grows the table.
+     */
+    template <class Key, class Value, class Hash = FlatHash<Key>, class KeyEqual = std::equal_to<>>
+    class FlatHashMap
+    {
+    public:
+        using key_type    = Key;
+        using mapped_type = Value;
+        using value_type  = std::pair<const Key, Value>;
+        using size_type   = size_t;
+
+    private:
+        union Slot
+        {
+            Slot() {}
+            ~Slot() {}
+
+            value_type value;
+        };
+
+        int8_t* ctrl_{nullptr};
+        Slot* slots_{nullptr};
+        size_t capacity_{0}; // power of two, 0 when unallocated
+        size_t size_{0};
+        size_t growth_left_{0};
+
+        [[no_unique_address]] Hash hash_{};
+        [[no_unique_address]] KeyEqual eq_{};
+
+        template <bool Const>
+        class basic_iterator
+        {
+            friend class FlatHashMap;
+            template <bool>
+            friend class basic_iterator;
+
+            using map_ptr = std::conditional_t<Const, const FlatHashMap*, FlatHashMap*>;
+
+            map_ptr map_{nullptr};
+            size_t index_{0};
+
+            basic_iterator(map_ptr map, const size_t index)
+                : map_(map), index_(index)
+            {
+                skip_free();
+            }
+
+            void skip_free()
+            {
+                while (index_ < map_->capacity_ && map_->ctrl_[index_] < 0)
+                    ++index_;
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = FlatHashMap::value_type;
+            using difference_type   = std::ptrdiff_t;
+            using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+            using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+
+            basic_iterator() = default;
+
+            // iterator -> const_iterator
+            template <bool C = Const, class = std::enable_if_t<C>>
+            basic_iterator(const basic_iterator<false>& other)
+                : map_(other.map_), index_(other.index_)
+            {
+            }
+
+            reference operator*() const { return map_->slots_[index_].value; }
+            pointer operator->() const { return &map_->slots_[index_].value; }
+
+            basic_iterator& operator++()
+            {
+                ++index_;
+                skip_free();
+                return *this;
+            }
+
+            basic_iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            friend bool operator==(const basic_iterator& a, const basic_iterator& b)
+            {
+                return a.index_ == b.index_;
+            }
+        };
+
+    public:
+        using iterator       = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        FlatHashMap() = default;
+
+        explicit FlatHashMap(const size_t expected)
+        {
+            reserve(expected);
+        }
+
+        FlatHashMap(const FlatHashMap& other)
+        {
+            reserve(other.size_);
+            for (const auto& [k, v] : other)
+                emplace_new(k, v);
+        }
+
+        FlatHashMap(FlatHashMap&& other) noexcept
+        {
+            swap(other);
+        }
+
+        FlatHashMap& operator=(FlatHashMap other) noexcept
+        {
+            swap(other);
+            return *this;
+        }
+
+        ~FlatHashMap()
+        {
+            destroy_all();
+            deallocate();
+        }
+
+        void swap(FlatHashMap& other) noexcept
+        {
+            std::swap(ctrl_, other.ctrl_);
+            std::swap(slots_, other.slots_);
+            std::swap(capacity_, other.capacity_);
+            std::swap(size_, other.size_);
+            std::swap(growth_left_, other.growth_left_);
+        }
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, capacity_); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, capacity_); }
+
+        [[nodiscard]] size_t size() const { return size_; }
+        [[nodiscard]] bool empty() const { return size_ == 0; }
+        [[nodiscard]] size_t capacity() const { return capacity_; }
+
+        void clear()
+        {
+            destroy_all();
+            if (capacity_ > 0) {
+                std::memset(ctrl_, detail::kCtrlEmpty, capacity_ + detail::kGroupWidth - 1);
+                growth_left_ = max_load(capacity_);
+            }
+            size_ = 0;
+        }
+
+        void reserve(const size_t count)
+        {
+            size_t cap = detail::kGroupWidth;
+            while (max_load(cap) < count)
+                cap *= 2;
+            if (cap > capacity_)
+                rehash(cap);
+        }
+
+        template <class K>
+        iterator find(const K& key)
+        {
+            return iterator(this, find_index(key));
+        }
+
+        template <class K>
+        const_iterator find(const K& key) const
+        {
+            return const_iterator(this, find_index(key));
+        }
+
+        template <class K>
+        [[nodiscard]] bool contains(const K& key) const
+        {
+            return find_index(key) != capacity_;
+        }
+
+        template <class K>
+        [[nodiscard]] size_t count(const K& key) const
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        template <class K, class... Args>
+        std::pair<iterator, bool> try_emplace(K&& key, Args&&... args)
+        {
+            const size_t hash = detail::mix_hash(hash_(key));
+            if (const size_t index = find_index(key, hash); index != capacity_)
+                return {iterator(this, index), false};
+
+            const size_t index = prepare_insert(hash);
+            ::new (&slots_[index].value) value_type(
+                std::piecewise_construct,
+                std::forward_as_tuple(std::forward<K>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...));
+            ++size_;
+            return {iterator(this, index), true};
+        }
+
+        template <class K, class V>
+        std::pair<iterator, bool> insert_or_assign(K&& key, V&& value)
+        {
+            auto result = try_emplace(std::forward<K>(key), std::forward<V>(value));
+            if (!result.second)
+                result.first->second = std::forward<V>(value);
+            return result;
+        }
+
+        Value& operator[](const Key& key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        Value& operator[](Key&& key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        template <class K>
+        size_t erase(const K& key)
+        {
+            const size_t index = find_index(key);
+            if (index == capacity_)
+                return 0;
+            erase_index(index);
+            return 1;
+        }
+
+        iterator erase(const_iterator it)
+        {
+            erase_index(it.index_);
+            return iterator(this, it.index_ + 1);
+        }
+
+        iterator erase(iterator it)
+        {
+            return erase(const_iterator(it));
+        }
+
+    private:
+        static size_t max_load(const size_t capacity)
+        {
+            return capacity - capacity / 8; // 7/8 load factor
+        }
+
+        void set_ctrl(const size_t index, const int8_t h2)
+        {
+            ctrl_[index] = h2;
+            // mirror the head so a probe window starting near the end wraps without masking
+            if (index < detail::kGroupWidth - 1)
+                ctrl_[capacity_ + index] = h2;
+        }
+
+        template <class K>
+        size_t find_index(const K& key) const
+        {
+            if (size_ == 0)
+                return capacity_;
+            return find_index(key, detail::mix_hash(hash_(key)));
+        }
+
+        template <class K>
+        size_t find_index(const K& key, const size_t hash) const
+        {
+            if (capacity_ == 0)
+                return capacity_;
+
+            const auto h2     = static_cast<int8_t>(hash & 0x7F);
+            const size_t mask = capacity_ - 1;
+            size_t pos        = (hash >> 7) & mask;
+
+            for (size_t step = detail::kGroupWidth;; step += detail::kGroupWidth) {
+                const detail::ProbeGroup group(ctrl_ + pos);
+
+                for (uint32_t bits = group.match(h2); bits != 0; bits &= bits - 1) {
+                    const size_t index = (pos + detail::lowest_bit(bits)) & mask;
+                    if (eq_(slots_[index].value.first, key))
+                        return index;
+                }
+
+                if (group.match_empty() != 0)
+                    return capacity_;
+
+                pos = (pos + step) & mask;
+            }
+        }
+
+        size_t find_free(const size_t hash) const
+        {
+            const size_t mask = capacity_ - 1;
+            size_t pos        = (hash >> 7) & mask;
+
+            for (size_t step = detail::kGroupWidth;; step += detail::kGroupWidth) {
+                const detail::ProbeGroup group(ctrl_ + pos);
+                if (const uint32_t bits = group.match_empty_or_deleted(); bits != 0)
+                    return (pos + detail::lowest_bit(bits)) & mask;
+                pos = (pos + step) & mask;
+            }
+        }
+
+        size_t prepare_insert(const size_t hash)
+        {
+            if (capacity_ == 0)
+                rehash(detail::kGroupWidth);
+
+            size_t index = find_free(hash);
+            if (growth_left_ == 0 && ctrl_[index] != detail::kCtrlDeleted) {
+                // out of room: grow, or just drop tombstones if the table is mostly deleted slots
+                rehash(size_ * 2 < max_load(capacity_) ? capacity_ : capacity_ * 2);
+                index = find_free(hash);
+            }
+
+            if (ctrl_[index] == detail::kCtrlEmpty)
+                --growth_left_;
+            set_ctrl(index, static_cast<int8_t>(hash & 0x7F));
+            return index;
+        }
+
+        void erase_index(const size_t index)
+        {
+            slots_[index].value.~value_type();
+            --size_;
+
+            // if no probe window covering this slot was ever full, no chain passes through it
+            // and it can go straight back to empty instead of becoming a tombstone
+            const size_t before     = (index - detail::kGroupWidth) & (capacity_ - 1);
+            const auto empty_after  = detail::ProbeGroup(ctrl_ + index).match_empty();
+            const auto empty_before = detail::ProbeGroup(ctrl_ + before).match_empty();
+            const bool was_never_full =
+                empty_before != 0 && empty_after != 0 &&
+                detail::lowest_bit(empty_after) + detail::leading_free(empty_before) < detail::kGroupWidth;
+
+            if (was_never_full) {
+                set_ctrl(index, detail::kCtrlEmpty);
+                ++growth_left_;
+            }
+            else
+                set_ctrl(index, detail::kCtrlDeleted);
+        }
+
+        void rehash(const size_t new_capacity)
+        {
+            int8_t* old_ctrl          = ctrl_;
+            Slot* old_slots           = slots_;
+            const size_t old_capacity = capacity_;
+
+            allocate(new_capacity);
+
+            for (size_t i = 0; i < old_capacity; ++i) {
+                if (old_ctrl[i] < 0)
+                    continue;
+
+                auto& old_value    = old_slots[i].value;
+                const size_t hash  = detail::mix_hash(hash_(old_value.first));
+                const size_t index = find_free(hash);
+                set_ctrl(index, static_cast<int8_t>(hash & 0x7F));
+
+                // keys are const inside value_type, so they are copied; mapped values are moved
+                ::new (&slots_[index].value) value_type(old_value.first, std::move(old_value.second));
+                old_value.~value_type();
+                --growth_left_;
+            }
+
+            deallocate(old_ctrl, old_slots, old_capacity);
+        }
+
+        void allocate(const size_t capacity)
+        {
+            capacity_    = capacity;
+            ctrl_        = new int8_t[capacity + detail::kGroupWidth - 1];
+            slots_       = std::allocator<Slot>{}.allocate(capacity);
+            growth_left_ = max_load(capacity);
+            std::memset(ctrl_, detail::kCtrlEmpty, capacity + detail::kGroupWidth - 1);
+        }
+
+        void deallocate()
+        {
+            deallocate(ctrl_, slots_, capacity_);
+            ctrl_     = nullptr;
+            slots_    = nullptr;
+            capacity_ = 0;
+        }
+
+        static void deallocate(const int8_t* ctrl, Slot* slots, const size_t capacity)
+        {
+            delete[] ctrl;
+            if (slots)
+                std::allocator<Slot>{}.deallocate(slots, capacity);
+        }
+
+        void destroy_all()
+        {
+            if constexpr (!std::is_trivially_destructible_v<value_type>) {
+                for (size_t i = 0; i < capacity_; ++i)
+                    if (ctrl_[i] >= 0)
+                        slots_[i].value.~value_type();
+            }
+        }
+
+        template <class K, class V>
+        void emplace_new(const K& key, const V& value)
+        {
+            const size_t hash  = detail::mix_hash(hash_(key));
+            const size_t index = prepare_insert(hash);
+            ::new (&slots_[index].value) value_type(key, value);
+            ++size_;
+        }
+    };
+} // namespace chat
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "chat/common/capabilities.hpp"
+#include "chat/common/messages.hpp"
+#include "chat/common/protocol.hpp"
+#include "chat/common/result.hpp"
+
+namespace chat
+{
+    /**
+     * Columnar INIT encoding (MessageType::INIT_V2)
+     * History is sent as parallel columns rather than one nested record per
+     * message: a username dictionary shared with the user list, delta-encoded
+     * varint sequence numbers and timestamps, and a single text blob addressed
+     * by a lengths column. Unlike the v1 tuple encoding it carries timestamps.
+     *
+     * Payload layout (all integers are LEB128 varints, ts deltas zigzag-encoded):
+     *   dict_count  { len bytes }
+     *   user_count  { dict_index } { user_id_len } user_id_blob
+     *   msg_count   { dict_index } seq_first { seq_delta } ts_first { ts_delta }
+     *               { text_len } text_blob
+     */
+    class InitCodec
+    {
+    public:
+        // builds the complete INIT_V2 packet, header included
+        static std::vector<uint8_t> encode(const std::vector<Message>& messages, const std::vector<User>& users);
+
+        // the fastest INIT the peer decodes: INIT_V2, or the v1 tuples (no timestamps) without BinaryFields
+        static std::vector<uint8_t> encode(const PeerFeatures& peer, const std::vector<Message>& messages,
+                                           const std::vector<User>& users);
+
+        // payload only, for frames that wrap it (CATCH_UP seals it under AES-GCM)
+        static std::vector<uint8_t> encode_payload(const std::vector<Message>& messages,
+                                                   const std::vector<User>& users = {});
+
+        static Result<InitMsg> try_decode(std::span<const uint8_t> payload, DecodeBudget& budget);
+        static Result<InitMsg> try_decode(std::span<const uint8_t> payload);
+
+        static InitMsg decode(std::span<const uint8_t> payload);
+    };
+} // namespace chat
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "chat/common/types.hpp"
@@ -77,6 +78,99 @@ namespace chat
         [[nodiscard]] auto as_tuple() { return std::tie(error_msg); }
     };
 
+    // CATCH_UP payload is AES-GCM(session key, InitCodec history payload) with this AAD,
+    // which binds a sealed batch to its purpose so it cannot pass as a chat message
+    inline constexpr std::string_view kCatchUpAad = "catch-up";
+
+    // INIT_SEALED payload is AES-GCM(session key, InitCodec payload) with this AAD
+    inline constexpr std::string_view kInitAad = "init";
+
+    struct SlowDownMsg
+    {
+        uint32_t dropped;        // messages discarded since the last notice
+        uint32_t retry_after_ms; // until the sender's rate limit admits another message
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(dropped, retry_after_ms); }
+        [[nodiscard]] auto as_tuple() { return std::tie(dropped, retry_after_ms); }
+    };
+
+    struct RetryLaterMsg
+    {
+        uint16_t refused;        // MessageType of the frame that was turned away (SRP_INIT or MESSAGE)
+        uint32_t retry_after_ms; // how long the server expects to keep shedding it
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(refused, retry_after_ms); }
+        [[nodiscard]] auto as_tuple() { return std::tie(refused, retry_after_ms); }
+    };
+
+    // COMPRESS_OFFER and COMPRESS_ACK; once both ends agree on Deflate, the sealed text of MESSAGE
+    // and BROADCAST is compressed before encryption, one stream per direction
+    struct CompressionMsg
+    {
+        uint8_t algorithm;      // Compression
+        uint32_t dictionary_id; // see chat::dictionary_id()
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(algorithm, dictionary_id); }
+        [[nodiscard]] auto as_tuple() { return std::tie(algorithm, dictionary_id); }
+    };
+
+    // HELLO and HELLO_ACK; the ack carries the negotiated result, which both ends then go by
+    struct HelloMsg
+    {
+        uint16_t version;
+        uint32_t capabilities; // Capability bits
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(version, capabilities); }
+        [[nodiscard]] auto as_tuple() { return std::tie(version, capabilities); }
+    };
+
+    struct AwayMsg
+    {
+        uint8_t away; // 1 = away, 0 = foreground
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(away); }
+        [[nodiscard]] auto as_tuple() { return std::tie(away); }
+    };
+
+    struct EphemeralMsg
+    {
+        uint8_t kind; // EphemeralKind
+        // Base64-encoded AES-GCM payload (IV || ciphertext || tag).
+        std::string ciphertext_b64;
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(kind, ciphertext_b64); }
+        [[nodiscard]] auto as_tuple() { return std::tie(kind, ciphertext_b64); }
+    };
+
+    struct EphemeralBroadcastMsg
+    {
+        std::string username;
+        uint8_t kind; // EphemeralKind
+        // Base64-encoded AES-GCM payload (IV || ciphertext || tag).
+        std::string ciphertext_b64;
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(username, kind, ciphertext_b64); }
+        [[nodiscard]] auto as_tuple() { return std::tie(username, kind, ciphertext_b64); }
+    };
+
+    struct RejectedMsg
+    {
+        std::string reason;
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(reason); }
+        [[nodiscard]] auto as_tuple() { return std::tie(reason); }
+    };
+
+    // a client the gateway authenticated, joining on one stream of its link
+    struct StreamOpenMsg
+    {
+        std::string username;
+        std::string user_id;
+
+        [[nodiscard]] auto as_tuple() const { return std::tie(username, user_id); }
+        [[nodiscard]] auto as_tuple() { return std::tie(username, user_id); }
+    };
+
     struct SrpRegisterMsg
     {
         std::string username;
@@ -116,12 +210,12 @@ namespace chat
         [[nodiscard]] auto as_tuple() { return std::tie(user_id, M_b64); }
     };
 
+    // no key material: both ends derive the session keys from SRP's K (see derive_session_keys)
     struct SrpSuccessMsg
     {
         std::string H_AMK_b64;
-        std::string session_key_b64;
 
-        [[nodiscard]] auto as_tuple() const { return std::tie(H_AMK_b64, session_key_b64); }
-        [[nodiscard]] auto as_tuple() { return std::tie(H_AMK_b64, session_key_b64); }
+        [[nodiscard]] auto as_tuple() const { return std::tie(H_AMK_b64); }
+        [[nodiscard]] auto as_tuple() { return std::tie(H_AMK_b64); }
     };
 } // namespace chat
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace chat
+{
+    // occupancy of one ObjectPool
+    struct PoolStats
+    {
+        size_t capacity{0}; // idle objects kept for reuse; pre-warmed at construction
+        size_t in_use{0};   // handed out and not released yet
+        size_t idle{0};     // ready for reuse, in the shared list or a thread's cache
+        uint64_t reused{0}; // acquisitions served from the pool
+        uint64_t created{0}; // objects constructed, warm-up included
+    };
+
+    /**
+     * Typed object pool with per-thread free lists
+     * acquire() hands out a shared_ptr whose deleter recycles the object back
+     * into the pool and whose control block is pooled as well, so once warm an
+     * acquire/release pair never reaches the global allocator. Each thread
+     * keeps up to kThreadCache idle objects of its own and trades half of them
+     * with the shared list under one lock; a thread's cache is handed back
+     * when it exits. At most capacity objects are kept idle, extra releases
+     * are destroyed. Objects may outlive the pool object itself.
+     */
+    template <class T>
+    class ObjectPool
+    {
+    public:
+        using Factory  = std::function<std::unique_ptr<T>()>;
+        using Recycler = std::function<void(T&)>; // resets an object on release; must not throw
+
+        static constexpr size_t kThreadCache = 16;
+
+        ObjectPool(size_t capacity, Factory factory, Recycler recycle = {});
+
+        ObjectPool(const ObjectPool&)            = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        // an idle object if there is one, a new one otherwise; returns when the last reference goes
+        std::shared_ptr<T> acquire();
+
+        [[nodiscard]] PoolStats stats() const;
+
+        struct Core; // shared with released objects and the per-thread caches
+
+    private:
+        std::shared_ptr<Core> core_;
+    };
+
+    template <class T>
+    struct ObjectPool<T>::Core : std::enable_shared_from_this<Core>
+    {
+        struct Lists
+        {
+            std::vector<T*> objects;
+            std::vector<void*> blocks; // shared_ptr control blocks, all of one type
+        };
+
+        const size_t capacity;
+        const Factory factory;
+        const Recycler recycle;
+
+        std::mutex mutex;
+        Lists shared; // guarded by mutex
+
+        std::atomic<size_t> block_size{0};
+        std::atomic<size_t> idle_objects{0};
+        std::atomic<size_t> idle_blocks{0};
+        std::atomic<size_t> in_use{0};
+        std::atomic<uint64_t> reused{0};
+        std::atomic<uint64_t> created{0};
+
+        Core(const size_t cap, Factory make, Recycler reset)
+            : capacity(cap), factory(std::move(make)), recycle(std::move(reset))
+        {
+        }
+
+        ~Core() { discard(shared); }
+
+        static void discard(Lists& lists)
+        {
+            for (T* object : lists.objects)
+                delete object;
+            for (void* block : lists.blocks)
+                ::operator delete(block);
+            lists.objects.clear();
+            lists.blocks.clear();
+        }
+
+        // the calling thread's lists for this pool; a weak reference tells a reused address from a dead pool
+        Lists& local()
+        {
+            struct Entry
+            {
+                const Core* core;
+                std::weak_ptr<Core> owner;
+                Lists lists;
+            };
+            struct ThreadCaches
+            {
+                std::vector<std::unique_ptr<Entry>> entries;
+
+                ~ThreadCaches()
+                {
+                    for (const auto& entry : entries) {
+                        if (const auto core = entry->owner.lock())
+                            core->absorb(entry->lists);
+                        else
+                            discard(entry->lists);
+                    }
+                }
+            };
+            thread_local ThreadCaches t_caches;
+
+            auto& entries = t_caches.entries;
+            for (const auto& entry : entries)
+                if (entry->core == this && !entry->owner.expired())
+                    return entry->lists;
+
+            std::erase_if(entries, [](const std::unique_ptr<Entry>& entry) {
+                if (!entry->owner.expired())
+                    return false;
+                discard(entry->lists);
+                return true;
+            });
+            entries.push_back(std::make_unique<Entry>(Entry{this, this->weak_from_this(), {}}));
+            return entries.back()->lists;
+        }
+
+        // refills an empty thread cache with up to half a cache from the shared list
+        template <class P>
+        P take(std::vector<P> Lists::* list, std::atomic<size_t>& idle)
+        {
+            auto& mine = local().*list;
+            if (mine.empty()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto& from = shared.*list;
+                const auto n = static_cast<std::ptrdiff_t>(std::min(from.size(), kThreadCache / 2));
+                mine.insert(mine.end(), from.end() - n, from.end());
+                from.erase(from.end() - n, from.end());
+            }
+            if (mine.empty())
+                return nullptr;
+
+            P item = mine.back();
+            mine.pop_back();
+            idle.fetch_sub(1, std::memory_order_relaxed);
+            return item;
+        }
+
+        // false when the pool already holds capacity idle items; a full thread cache spills half
+        template <class P>
+        bool give(std::vector<P> Lists::* list, std::atomic<size_t>& idle, P item)
+        {
+            if (idle.fetch_add(1, std::memory_order_relaxed) >= capacity) {
+                idle.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            auto& mine = local().*list;
+            mine.push_back(item);
+            if (mine.size() > kThreadCache) {
+                const auto n = static_cast<std::ptrdiff_t>(kThreadCache / 2);
+                std::lock_guard<std::mutex> lock(mutex);
+                auto& to = shared.*list;
+                to.insert(to.end(), mine.end() - n, mine.end());
+                mine.erase(mine.end() - n, mine.end());
+            }
+            return true;
+        }
+
+        void absorb(Lists& lists)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shared.objects.insert(shared.objects.end(), lists.objects.begin(), lists.objects.end());
+            shared.blocks.insert(shared.blocks.end(), lists.blocks.begin(), lists.blocks.end());
+            lists.objects.clear();
+            lists.blocks.clear();
+        }
+
+        T* acquire()
+        {
+            in_use.fetch_add(1, std::memory_order_relaxed);
+            if (T* object = take(&Lists::objects, idle_objects)) {
+                reused.fetch_add(1, std::memory_order_relaxed);
+                return object;
+            }
+            try {
+                created.fetch_add(1, std::memory_order_relaxed);
+                return factory().release();
+            }
+            catch (...) {
+                in_use.fetch_sub(1, std::memory_order_relaxed);
+                throw;
+            }
+        }
+
+        void release(T* object)
+        {
+            in_use.fetch_sub(1, std::memory_order_relaxed);
+            if (recycle)
+                recycle(*object);
+            if (!give(&Lists::objects, idle_objects, object))
+                delete object;
+        }
+    };
+
+    namespace detail
+    {
+        // control blocks come from the pool's block lists; every block of a pool has the same size
+        template <class U, class Core>
+        struct PoolBlockAllocator
+        {
+            using value_type = U;
+
+            std::shared_ptr<Core> core;
+
+            explicit PoolBlockAllocator(std::shared_ptr<Core> owner) : core(std::move(owner)) {}
+
+            template <class V>
+            PoolBlockAllocator(const PoolBlockAllocator<V, Core>& other) : core(other.core) {}
+
+            U* allocate(const size_t n)
+            {
+                size_t expected = 0;
+                core->block_size.compare_exchange_strong(expected, sizeof(U), std::memory_order_relaxed);
+                if (n == 1 && sizeof(U) == core->block_size.load(std::memory_order_relaxed))
+                    if (void* block = core->take(&Core::Lists::blocks, core->idle_blocks))
+                        return static_cast<U*>(block);
+                return static_cast<U*>(::operator new(n * sizeof(U)));
+            }
+
+            void deallocate(U* p, const size_t n)
+            {
+                if (n == 1 && sizeof(U) == core->block_size.load(std::memory_order_relaxed) &&
+                    core->give(&Core::Lists::blocks, core->idle_blocks, static_cast<void*>(p)))
+                    return;
+                ::operator delete(p);
+            }
+
+            template <class V>
+            bool operator==(const PoolBlockAllocator<V, Core>& other) const { return core == other.core; }
+        };
+    }
+
+    template <class T>
+    ObjectPool<T>::ObjectPool(const size_t capacity, Factory factory, Recycler recycle)
+        : core_(std::make_shared<Core>(capacity, std::move(factory), std::move(recycle)))
+    {
+        // cycling capacity objects through once leaves both objects and control blocks idle
+        std::vector<std::shared_ptr<T>> warm;
+        warm.reserve(capacity);
+        for (size_t i = 0; i < capacity; ++i)
+            warm.push_back(acquire());
+    }
+
+    template <class T>
+    std::shared_ptr<T> ObjectPool<T>::acquire()
+    {
+        auto core = core_;
+        return std::shared_ptr<T>(core->acquire(), [core](T* object) { core->release(object); },
+                                  detail::PoolBlockAllocator<T, Core>(core));
+    }
+
+    template <class T>
+    PoolStats ObjectPool<T>::stats() const
+    {
+        return {
+            .capacity = core_->capacity,
+            .in_use = core_->in_use.load(std::memory_order_relaxed),
+            .idle = core_->idle_objects.load(std::memory_order_relaxed),
+            .reused = core_->reused.load(std::memory_order_relaxed),
+            .created = core_->created.load(std::memory_order_relaxed),
+        };
+    }
+} // namespace chat
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <string>
 #include <vector>
 #include <stdexcept>
@@ -8,9 +9,42 @@
 
 #include "chat/common/types.hpp"
 #include "chat/common/buffer.hpp"
+#include "chat/common/result.hpp"
 
 namespace chat
 {
+    /**
+     * Per-frame cap on heap bytes the decoder may allocate
+     * Every reserve and string copy is charged before it happens, so a frame
+     * declaring huge counts or lengths fails without touching the allocator.
+     */
+    struct DecodeBudget
+    {
+        static constexpr size_t kDefaultBytes = 4U * 1024U * 1024U; // 4 MiB
+
+        size_t remaining = kDefaultBytes;
+
+        [[nodiscard]] bool charge(const size_t bytes)
+        {
+            if (bytes > remaining)
+                return false;
+            remaining -= bytes;
+            return true;
+        }
+    };
+
+    // schema limit on repeated elements; types opt in with a static kMaxDecodeCount
+    inline constexpr uint32_t kDefaultMaxDecodeCount = 65536;
+
+    template <class T>
+    constexpr uint32_t max_decode_count()
+    {
+        if constexpr (requires { T::kMaxDecodeCount; })
+            return T::kMaxDecodeCount;
+        else
+            return kDefaultMaxDecodeCount;
+    }
+
     class Protocol
     {
     public:
@@ -26,10 +60,24 @@ namespace chat
             return make_packet(type, {});
         }
 
+        // non-throwing decode for untrusted input
         template <class T>
-        static T decode(const std::vector<uint8_t>& payload)
+        static Result<T> try_decode(const std::span<const uint8_t> payload, DecodeBudget& budget)
         {
-            return deserialize_object<T>(payload);
+            return deserialize_object<T>(payload, budget);
+        }
+
+        template <class T>
+        static Result<T> try_decode(const std::span<const uint8_t> payload)
+        {
+            DecodeBudget budget;
+            return deserialize_object<T>(payload, budget);
+        }
+
+        template <class T>
+        static T decode(const std::span<const uint8_t> payload)
+        {
+            return try_decode<T>(payload).value();
         }
 
     private:
@@ -56,33 +104,75 @@ namespace chat
         }
 
         template <class T>
-        static T read_field(BufferReader& r, std::type_identity<T>)
+        static Result<T> read_field(BufferReader& r, DecodeBudget&, std::type_identity<T>)
         {
-            return r.read<T>();
+            return r.try_read<T>();
         }
 
-        static std::string read_field(BufferReader& r, std::type_identity<std::string>)
+        static Result<std::string> read_field(BufferReader& r, DecodeBudget& budget,
+                                              std::type_identity<std::string>)
         {
-            return r.read_string();
+            // view first so the length is validated and charged before the copy
+            const auto view = r.try_read_string_view();
+            if (!view)
+                return view.error();
+            if (!budget.charge(view->size()))
+                return Errc::budget_exceeded;
+            return std::string(*view);
         }
 
         template <class T>
-        static std::vector<T> read_field(BufferReader& r, std::type_identity<std::vector<T>>)
+        static Result<std::vector<T>> read_field(BufferReader& r, DecodeBudget& budget,
+                                                 std::type_identity<std::vector<T>>)
         {
-            const auto count = r.read<uint32_t>();
+            const auto count = r.try_read<uint32_t>();
+            if (!count)
+                return count.error();
+
+            // every item carries at least its 4-byte size prefix, so a count the
+            // remaining bytes cannot back is rejected before reserving anything
+            if (*count > max_decode_count<T>())
+                return Errc::limit_exceeded;
+            if (*count > r.remaining() / sizeof(uint32_t))
+                return Errc::buffer_underflow;
+            if (!budget.charge(static_cast<size_t>(*count) * sizeof(T)))
+                return Errc::budget_exceeded;
+
             std::vector<T> result;
-            result.reserve(count);
+            result.reserve(*count);
+
+            for (uint32_t i = 0; i < *count; ++i) {
+                const auto item_size = r.try_read<uint32_t>();
+                if (!item_size)
+                    return item_size.error();
+
+                // nested items decode straight from a sub-span of the frame
+                const auto item_data = r.try_read_span(*item_size);
+                if (!item_data)
+                    return item_data.error();
 
-            for (uint32_t i = 0; i < count; ++i) {
-                const auto item_size = r.read<uint32_t>();
-                std::vector<uint8_t> item_data(item_size);
-                r.read_bytes(item_data.data(), item_size);
-                result.push_back(deserialize_object<T>(item_data));
+                auto item = deserialize_object<T>(*item_data, budget);
+                if (!item)
+                    return item.error();
+                result.push_back(std::move(*item));
             }
 
             return result;
         }
 
+        // reads one field in place; false (with error set) stops the fold at the first failure
+        template <class F>
+        static bool read_into(BufferReader& r, DecodeBudget& budget, F& field, Errc& error)
+        {
+            auto value = read_field(r, budget, std::type_identity<F>{});
+            if (!value) {
+                error = value.error();
+                return false;
+            }
+            field = std::move(*value);
+            return true;
+        }
+
         template <class T>
         static std::vector<uint8_t> serialize_object(const T& obj)
         {
@@ -97,19 +187,19 @@ namespace chat
         }
 
         template <class T>
-        static T deserialize_object(const std::vector<uint8_t>& data)
+        static Result<T> deserialize_object(const std::span<const uint8_t> data, DecodeBudget& budget)
         {
             BufferReader r(data);
             T obj;
+            Errc error{};
 
-            std::apply([&](auto&... fields)
+            const bool ok = std::apply([&](auto&... fields)
             {
-                using swallow = int[];
-                (void)swallow{
-                    0, (fields = read_field(r, std::type_identity<std::remove_reference_t<decltype(fields)>>{}), 0)...
-                };
+                return (read_into(r, budget, fields, error) && ...);
             }, obj.as_tuple());
 
+            if (!ok)
+                return error;
             return obj;
         }
 
@@ -136,25 +226,48 @@ namespace chat
 
         std::vector<uint8_t> make_empty_packet(MessageType type);
 
+        // header + an already-encoded payload, for frames not built from a message struct
+        std::vector<uint8_t> make_packet(MessageType type, std::span<const uint8_t> payload);
+
+        // the same with zeroed room around the payload, counted in the header's size; for frames
+        // sealed in place (see AESEngine::encrypt_in_place), where it holds the IV and the tag
+        std::vector<uint8_t> make_packet(MessageType type, std::span<const uint8_t> payload, size_t head_room,
+                                         size_t tail_room);
+
         inline void send_packet(boost::asio::ip::tcp::socket& socket, const std::vector<uint8_t>& packet)
         {
             boost::asio::write(socket, boost::asio::buffer(packet));
         }
 
-        inline std::pair<MessageType, std::vector<uint8_t>> receive_packet(boost::asio::ip::tcp::socket& socket)
+        using Packet = std::pair<MessageType, std::vector<uint8_t>>;
+
+        // non-throwing receive: disconnects and oversized frames come back as error codes
+        inline Result<Packet> try_receive_packet(boost::asio::ip::tcp::socket& socket)
         {
+            boost::system::error_code ec;
+
             // read header first
             MsgHeader header{};
-            boost::asio::read(socket, boost::asio::buffer(&header, sizeof(MsgHeader)));
+            boost::asio::read(socket, boost::asio::buffer(&header, sizeof(MsgHeader)), ec);
+            if (ec)
+                return Errc::connection_closed;
             if (header.size > kMaxPayloadSize)
-                throw std::runtime_error("Incoming payload exceeds maximum allowed size");
+                return Errc::payload_too_large;
 
             // read payload
             std::vector<uint8_t> payload(header.size);
-            if (header.size > 0)
-                boost::asio::read(socket, boost::asio::buffer(payload));
+            if (header.size > 0) {
+                boost::asio::read(socket, boost::asio::buffer(payload), ec);
+                if (ec)
+                    return Errc::connection_closed;
+            }
+
+            return Packet{static_cast<MessageType>(header.type), std::move(payload)};
+        }
 
-            return {static_cast<MessageType>(header.type), std::move(payload)};
+        inline Packet receive_packet(boost::asio::ip::tcp::socket& socket)
+        {
+            return try_receive_packet(socket).value();
         }
     }
 } // namespace chat
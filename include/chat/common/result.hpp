@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace chat
+{
+    // error codes for the non-throwing decode/receive/AEAD paths
+    enum class Errc : uint8_t
+    {
+        buffer_underflow,
+        limit_exceeded,   // element count above the schema limit for the type
+        budget_exceeded,  // frame would allocate more than its decode budget
+        invalid_encoding, // overlong varint or out-of-range index in a columnar frame
+        payload_too_large,
+        connection_closed,
+        invalid_key_size,
+        invalid_ciphertext,
+        authentication_failed,
+        crypto_failure,
+        decompression_failed, // corrupt or out-of-order frame on a compressed stream
+    };
+
+    constexpr const char* to_string(const Errc error)
+    {
+        switch (error) {
+            case Errc::buffer_underflow: return "Buffer underflow";
+            case Errc::limit_exceeded: return "Element count exceeds schema limit";
+            case Errc::budget_exceeded: return "Frame exceeds decode allocation budget";
+            case Errc::invalid_encoding: return "Malformed frame encoding";
+            case Errc::payload_too_large: return "Incoming payload exceeds maximum allowed size";
+            case Errc::connection_closed: return "Connection closed";
+            case Errc::invalid_key_size: return "Invalid key size";
+            case Errc::invalid_ciphertext: return "Invalid encrypted data size";
+            case Errc::authentication_failed: return "Authentication failed - message tampered or corrupted";
+            case Errc::crypto_failure: return "Cipher operation failed";
+            case Errc::decompression_failed: return "Compressed stream is corrupt or out of sync";
+        }
+        return "Unknown error";
+    }
+
+    /**
+     * Value-or-error return type (a C++20 stand-in for std::expected<T, Errc>)
+     * Used on paths where failure is a normal event, e.g. hostile input or a
+     * peer disconnecting, so it never takes the exception-unwinding path.
+     */
+    template <class T>
+    class [[nodiscard]] Result
+    {
+    private:
+        std::optional<T> value_;
+        Errc error_{};
+
+    public:
+        Result(T value) : value_(std::move(value)) {}
+        Result(const Errc error) : error_(error) {}
+
+        [[nodiscard]] bool has_value() const { return value_.has_value(); }
+        explicit operator bool() const { return has_value(); }
+
+        [[nodiscard]] Errc error() const { return error_; }
+
+        T& operator*() & { return *value_; }
+        const T& operator*() const & { return *value_; }
+        T&& operator*() && { return std::move(*value_); }
+        T* operator->() { return &*value_; }
+        const T* operator->() const { return &*value_; }
+
+        // throwing accessor for the compatibility wrappers
+        T value() &&
+        {
+            if (!value_)
+                throw std::runtime_error(to_string(error_));
+            return std::move(*value_);
+        }
+    };
+} // namespace chat
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <boost/asio.hpp>
+
+namespace chat
+{
+    /**
+     * Per-socket latency knobs
+     * Options the platform does not support are skipped silently
+     */
+    struct SocketTuning
+    {
+        bool tcp_nodelay{true};       // disable Nagle so small frames leave immediately
+        int busy_poll_us{0};          // SO_BUSY_POLL budget, 0 keeps the kernel default
+        bool prefer_busy_poll{false}; // SO_PREFER_BUSY_POLL (Linux 5.11+)
+        // TCP_USER_TIMEOUT: a blocking write fails once its data has sat unsent (zero window) or
+        // unacknowledged this long, so a peer that stops reading cannot hold the writing thread;
+        // 0 keeps the kernel default. SO_SNDTIMEO would not do: asio retries the write after it.
+        int user_timeout_ms{0};
+    };
+
+    namespace SocketHelpers
+    {
+        // best effort: returns false if any requested option was rejected by the kernel
+        bool apply_tuning(boost::asio::ip::tcp::socket& socket, const SocketTuning& tuning);
+
+        // TCP Fast Open, client side: the first write rides in the SYN once the peer has issued
+        // a cookie (TCP_FASTOPEN_CONNECT, Linux 4.11+). Call on an open, unconnected socket.
+        bool enable_fastopen_connect(boost::asio::ip::tcp::socket& socket);
+
+        // SO_TIMESTAMPING (Linux): software receive timestamps, plus transmit and ACK timestamps on the
+        // error queue keyed by byte count (OPT_ID), counted from here. Call before anything is sent.
+        bool enable_timestamping(boost::asio::ip::tcp::socket& socket);
+
+        // TCP Fast Open, server side: accept data in the SYN, up to `queue_length` pending requests
+        bool enable_fastopen_listen(boost::asio::ip::tcp::acceptor& acceptor, int queue_length = 16);
+    }
+} // namespace chat
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "chat/common/result.hpp"
+#include "chat/common/types.hpp"
+
+namespace chat
+{
+    // one frame of a gateway link, addressed to a single client stream; payload views the link frame
+    struct StreamFrame
+    {
+        uint64_t stream{0};
+        MessageType type{};
+        std::span<const uint8_t> payload;
+    };
+
+    /**
+     * Stream-id extended frames (MessageType::STREAM)
+     * A gateway carries many client sessions over one upstream link to the
+     * server. Frames for one session go out wrapped with its stream id;
+     * unwrapped frames on a link concern every stream on it (joins, leaves,
+     * broadcasts), so the server sends each of those once per gateway.
+     *
+     * The gateway terminates every client's AES-GCM, so inside a link the
+     * sealed fields of MESSAGE, EPHEMERAL, BROADCAST and EPHEMERAL_BROADCAST
+     * carry plaintext and CATCH_UP carries a bare INIT_V2 payload.
+     *
+     * Payload layout: stream_id varint | inner type u16 | inner payload
+     */
+    class StreamCodec
+    {
+    public:
+        // complete STREAM packet, header included
+        static std::vector<uint8_t> wrap(uint64_t stream, MessageType type, std::span<const uint8_t> payload);
+
+        // re-addresses an already-built packet (header + payload) to stream
+        static std::vector<uint8_t> wrap_packet(uint64_t stream, std::span<const uint8_t> packet);
+
+        static Result<StreamFrame> try_unwrap(std::span<const uint8_t> payload);
+    };
+} // namespace chat
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chat/common/buffer.hpp"
+#include "chat/common/types.hpp"
+
+namespace chat
+{
+    // one inbound frame as captured: who sent what kind of frame, when, and how big it was
+    struct CapturedFrame
+    {
+        uint64_t time_ns{0};    // since the capture started, monotonic
+        uint32_t connection{0}; // server-assigned, unique within a capture
+        MessageType type{};
+        uint32_t size{0}; // payload bytes; the payload itself is never recorded
+    };
+
+    /**
+     * Compact on-disk capture of inbound traffic
+     * Records are appended from every connection thread into one buffer and
+     * written out in order whenever 64 KiB have collected. Only sizes are
+     * kept, never payloads, so a capture reveals the shape of the traffic but
+     * none of its content.
+     *
+     * File: "CHATCAP1" then per frame, all LEB128 varints:
+     *   time_delta_ns | connection | type | size
+     */
+    class TrafficCapture
+    {
+    public:
+        static constexpr std::string_view kMagic = "CHATCAP1";
+
+        // truncates path; throws std::runtime_error if it cannot be opened
+        explicit TrafficCapture(const std::string& path);
+        ~TrafficCapture();
+
+        TrafficCapture(const TrafficCapture&)            = delete;
+        TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+        // never throws: a write error stops the capture and is reported by failed()
+        void record(uint32_t connection, MessageType type, size_t size);
+
+        // writes out whatever is buffered
+        void flush();
+
+        [[nodiscard]] uint64_t frames() const { return frames_.load(std::memory_order_relaxed); }
+        [[nodiscard]] bool failed() const { return failed_.load(std::memory_order_relaxed); }
+
+        // the frames of a capture file in recorded order; a torn last record is dropped
+        static std::vector<CapturedFrame> load(const std::string& path);
+
+    private:
+        static constexpr size_t kFlushBytes = 64 * 1024;
+
+        const std::string path_;
+        int fd_{-1};
+        const std::chrono::steady_clock::time_point started_;
+
+        std::mutex mutex_; // guards buffer_ and last_ns_
+        BufferWriter buffer_;
+        uint64_t last_ns_{0};
+
+        std::mutex write_mutex_; // taken before mutex_ is released, so buffers reach the file in order
+        std::atomic<uint64_t> frames_{0};
+        std::atomic<bool> failed_{false};
+
+        // false, with failed_ set, if the file could not be written
+        bool write_out(const std::vector<uint8_t>& bytes);
+    };
+} // namespace chat
@@ -34,10 +34,51 @@ namespace chat
         SRP_RESPONSE,       // client sends proof M
         SRP_SUCCESS,        // server confirms authentication
         SRP_USER_NOT_FOUND, // server rejects authentication due to user not found
+
+        // chat, continued
+        INIT_V2,   // columnar INIT with timestamps and sequence numbers (see InitCodec)
+        SLOW_DOWN, // server dropped messages from this client under its rate limit
+        CATCH_UP,  // messages missed while offline, sealed INIT_V2 history (see Server::send_catch_up)
+        MESSAGE_REJECTED, // server refused a message (invalid UTF-8 or a blocked term); not fatal
+        EPHEMERAL,           // client sends volatile state (see EphemeralKind); never stored
+        EPHEMERAL_BROADCAST, // server relays it; may be collapsed or dropped on the way
+        HISTORY,             // one already-seen message ahead of INIT, as an INIT_V2 payload (see HistorySegments)
+
+        // gateway links (see StreamCodec)
+        STREAM,       // a frame of one client stream multiplexed over a gateway link
+        STREAM_OPEN,  // gateway: a client authenticated on this stream; server: never sent
+        STREAM_CLOSE, // either side: the stream is gone
+
+        // admission control (see OverloadController)
+        RETRY_LATER, // server is overloaded and refused a login or message; not fatal
+
+        // per-connection compression (see DeflateStream), negotiated ahead of SRP_INIT
+        COMPRESS_OFFER, // client: the algorithm and dictionary it can use
+        COMPRESS_ACK,   // server: what the connection will use, possibly Compression::None
+
+        // away state: while away a client gets CATCH_UP digests instead of each BROADCAST
+        AWAY, // client: its terminal went to the background (away = 1) or came back (away = 0)
+
+        INIT_SEALED, // INIT_V2 payload as one AES-GCM envelope under the session key (see kInitAad)
+
+        // capability negotiation, the first frames on a connection (see PeerFeatures)
+        HELLO,     // client: its protocol version and the capabilities it implements
+        HELLO_ACK, // server: the version and capabilities the connection will use
+    };
+
+    // volatile per-sender state: only the latest value of each kind matters
+    enum class EphemeralKind : uint8_t
+    {
+        Typing,   // payload "1" while composing, "0" when stopped
+        Cursor,   // application-defined position
+        Presence, // "is online" ping
     };
+    inline constexpr uint8_t kEphemeralKinds = 3;
 
     struct User
     {
+        static constexpr uint32_t kMaxDecodeCount = 65536; // users per INIT
+
         std::string username;
         std::string user_id;
 
@@ -54,9 +95,12 @@ namespace chat
 
     struct Message
     {
+        static constexpr uint32_t kMaxDecodeCount = 4096; // history entries per INIT
+
         std::string username;
         std::string text;
         std::chrono::system_clock::time_point timestamp;
+        uint64_t seq = 0; // server-assigned, monotonically increasing
 
         [[nodiscard]] auto as_tuple() const
         {
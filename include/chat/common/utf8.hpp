@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+
+namespace chat
+{
+    /**
+     * Strict UTF-8 validation (RFC 3629)
+     * Rejects overlong forms, surrogates, code points above U+10FFFF and
+     * truncated sequences. On x86 CPUs with AVX2 the check runs 32 bytes at a
+     * time using the Keiser-Lemire lookup algorithm. Elsewhere it skips ASCII
+     * 16 bytes at a time with SSE2 and decodes the rest byte by byte.
+     */
+    bool is_valid_utf8(std::string_view text);
+
+    namespace detail
+    {
+        // the individual paths, exposed for tests and benchmarks
+        bool is_valid_utf8_scalar(std::string_view text);
+
+        // false if this build or CPU has no AVX2 path
+        bool utf8_avx2_available();
+        bool is_valid_utf8_avx2(std::string_view text);
+    }
+} // namespace chat
@@ -3,8 +3,11 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <span>
 #include <openssl/evp.h>
 
+#include "chat/common/result.hpp"
+
 namespace chat::crypto
 {
     /**
@@ -31,6 +34,22 @@ namespace chat::crypto
             const std::vector<uint8_t>& key,
             const std::vector<uint8_t>& aad = {});
 
+        /**
+         * Encrypt in place, into a buffer the caller laid out
+         * @param sealed IV_SIZE bytes of room, the plaintext, then TAG_SIZE
+         *        bytes of room; on return it holds IV || ciphertext || tag,
+         *        the layout encrypt() returns
+         * @param iv IV_SIZE bytes to use instead of a random IV (see Sealer);
+         *        must never repeat under the key
+         * Lets a whole frame, header included, be built in one allocation
+         * and sealed without copying the plaintext again.
+         */
+        static void encrypt_in_place(
+            std::span<uint8_t> sealed,
+            const std::vector<uint8_t>& key,
+            const std::vector<uint8_t>& aad = {},
+            std::span<const uint8_t> iv = {});
+
         /**
          * Decrypt data using AES-256-GCM
          * @param encrypted_data Encrypted data (IV || ciphertext || tag)
@@ -44,6 +63,21 @@ namespace chat::crypto
             const std::vector<uint8_t>& key,
             const std::vector<uint8_t>& aad = {});
 
+        /**
+         * Non-throwing decrypt for untrusted input
+         * @return Plaintext, or Errc::authentication_failed on a bad tag,
+         *         Errc::invalid_ciphertext / Errc::invalid_key_size on malformed input
+         */
+        static Result<std::vector<uint8_t>> try_decrypt(
+            const std::vector<uint8_t>& encrypted_data,
+            const std::vector<uint8_t>& key,
+            const std::vector<uint8_t>& aad = {});
+
+        static Result<std::string> try_decrypt_string(
+            const std::vector<uint8_t>& encrypted_data,
+            const std::vector<uint8_t>& key,
+            const std::vector<uint8_t>& aad = {});
+
         /**
          * Encrypt a string message
          */
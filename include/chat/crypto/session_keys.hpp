@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace chat::crypto
+{
+    // every IV a sender uses starts with its direction's salt; a 64-bit counter fills the rest
+    inline constexpr size_t kNonceSaltSize = 4;
+
+    // key material for one direction of a session
+    struct DirectionKey
+    {
+        std::vector<uint8_t> key; // AES-256-GCM
+        std::array<uint8_t, kNonceSaltSize> nonce_salt{};
+    };
+
+    struct SessionKeys
+    {
+        DirectionKey client_to_server;
+        DirectionKey server_to_client;
+    };
+
+    /**
+     * Both directions' keys and nonce salts, derived from SRP's shared secret K
+     * Each is an HKDF-SHA256 expansion of K under its own label, so client and
+     * server compute the same keys and no key material goes over the wire. K
+     * is fresh per login, and so are the keys.
+     */
+    SessionKeys derive_session_keys(const std::vector<uint8_t>& shared_secret);
+
+    /**
+     * Sending half of one direction: its key and a nonce counter
+     * IVs are nonce_salt || 64-bit big-endian counter, so sealing needs no
+     * RNG call and an IV never repeats under the key. The IV still travels
+     * at the front of the sealed data, so the receiver decrypts with
+     * AESEngine as before. Safe to share between threads.
+     */
+    class Sealer
+    {
+    public:
+        Sealer() = default; // no key: sealing throws
+        explicit Sealer(DirectionKey key) : key_(std::move(key)) {}
+
+        Sealer(const Sealer&)            = delete;
+        Sealer& operator=(const Sealer&) = delete;
+
+        [[nodiscard]] const std::vector<uint8_t>& key() const { return key_.key; }
+
+        // IV || ciphertext || tag, the layout AESEngine::encrypt() returns
+        [[nodiscard]] std::vector<uint8_t> seal(std::span<const uint8_t> plaintext,
+                                                const std::vector<uint8_t>& aad = {}) const;
+        [[nodiscard]] std::vector<uint8_t> seal_string(std::string_view text,
+                                                       const std::vector<uint8_t>& aad = {}) const;
+
+        // see AESEngine::encrypt_in_place
+        void seal_in_place(std::span<uint8_t> sealed, const std::vector<uint8_t>& aad = {}) const;
+
+    private:
+        DirectionKey key_;
+        mutable std::atomic<uint64_t> counter_{0};
+    };
+} // namespace chat::crypto
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+
+#include "chat/auth/srp_server.hpp"
+#include "chat/common/socket_tuning.hpp"
+#include "chat/server/connection_manager.hpp"
+
+namespace chat::gateway
+{
+    struct GatewayOptions
+    {
+        // chat_server's gateway port (ServerOptions::gateway_port)
+        std::string upstream_host{"127.0.0.1"};
+        int upstream_port{9888};
+
+        // long-lived links to the server; clients are spread over them round-robin
+        size_t links{2};
+
+        // verifier database shared with the server, read once at startup
+        std::string users_path{"users.db"};
+
+        // applied to every accepted client socket; the send timeout frees a thread writing to a stalled client
+        SocketTuning socket_tuning{.user_timeout_ms = 30'000};
+    };
+
+    /**
+     * Connection-terminating front end for chat_server
+     * Clients connect here exactly as they would to the server. The gateway
+     * runs their SRP handshake against the server's verifier database, holds
+     * their AES-GCM session keys, and forwards decrypted frames over a few
+     * multiplexed links (see StreamCodec). Broadcasts arrive once per link in
+     * plaintext and are sealed here for each local client, so connection
+     * count and per-recipient crypto scale with the number of gateways while
+     * the server stays the one authoritative room.
+     */
+    class Gateway
+    {
+    public:
+        // connects the upstream links; throws if any of them cannot be established
+        Gateway(int port, GatewayOptions options = {});
+        ~Gateway();
+
+        void run();
+        void stop();
+
+        class Link; // one upstream connection and the client streams on it
+
+    private:
+        boost::asio::io_context io_context_;
+        boost::asio::ip::tcp::acceptor acceptor_;
+
+        auth::SRPServer srp_server_;
+        std::vector<std::unique_ptr<Link>> links_;
+        std::atomic<size_t> next_link_{0};
+        std::atomic<uint64_t> next_stream_{1};
+        std::atomic<bool> running_{false};
+        std::once_flag tuning_warning_; // a rejected option fails on every socket alike
+
+        int port_;
+        GatewayOptions options_;
+
+        void start_accept();
+        void handle_client(const std::shared_ptr<server::Connection>& conn);
+
+        // SRP-6a as chat_server runs it; the client's session, or nullptr once it has been told why not
+        std::shared_ptr<server::Session> authenticate(const std::shared_ptr<server::Connection>& conn);
+
+        // next open link, or nullptr if the server is unreachable on all of them
+        Link* pick_link();
+    };
+} // namespace chat::gateway
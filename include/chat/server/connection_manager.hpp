@@ -1,11 +1,20 @@
 #pragma once
 
 #include <memory>
-#include <unordered_map>
 #include <mutex>
+#include <chrono>
+#include <deque>
+#include <span>
+#include <string_view>
 #include <boost/asio.hpp>
 
+#include "chat/common/capabilities.hpp"
+#include "chat/common/flat_hash_map.hpp"
+#include "chat/common/result.hpp"
+#include "chat/common/traffic_capture.hpp"
 #include "chat/common/types.hpp"
+#include "chat/server/session.hpp"
+#include "chat/server/wire_latency.hpp"
 
 namespace chat::server
 {
@@ -15,36 +24,127 @@ namespace chat::server
         using socket_type = boost::asio::ip::tcp::socket;
 
         socket_type socket_;
+        std::chrono::microseconds busy_poll_{0};
+        std::weak_ptr<Session> session_;
+        PeerFeatures features_;
+
+        // capture mode: every received frame's type and size, tagged with this connection's id
+        std::shared_ptr<TrafficCapture> capture_;
+        uint32_t capture_id_{0};
+
+        // instrumentation: kernel timestamps into latency_ (see WireLatency)
+        std::shared_ptr<WireLatency> latency_;
+        int64_t read_ns_{0}; // when the last frame was read
+        // send side, serialized like the writes themselves: bytes written so far, which the kernel's
+        // timestamp ids count, and the BROADCASTs still owed a transmit or ACK timestamp
+        struct PendingStamp
+        {
+            uint32_t id; // the write's last byte
+            int64_t written_ns;
+            int64_t sent_ns;
+        };
+        uint32_t tx_bytes_{0};
+        std::deque<PendingStamp> tx_pending_;
+
+        // spin on the socket until data is queued or the busy-poll window expires
+        void spin_until_readable();
+
+        // try_receive_packet with timestamping: reads through recvmsg to get the kernel receive time
+        Result<std::pair<MessageType, std::vector<uint8_t>>> receive_stamped();
+        // fills out; stamp_ns is the receive time of the last segment read, if the kernel gave one
+        bool read_stamped(std::span<uint8_t> out, int64_t& stamp_ns);
+        void note_sent(const std::vector<uint8_t>& packet);
+        // takes whatever transmit and ACK timestamps the error queue holds, without blocking
+        void drain_tx_stamps();
 
     public:
         explicit Connection(boost::asio::io_context& io_context);
 
         socket_type& socket();
 
+        // opt-in: spin this long before blocking in receive_packet (0 = always block)
+        void set_busy_poll(std::chrono::microseconds interval);
+
+        // opt-in: kernel timestamps for frames received and BROADCASTs sent, into latency; call before
+        // the first send. false if the kernel refused SO_TIMESTAMPING
+        bool set_timestamping(std::shared_ptr<WireLatency> latency);
+        // realtime ns at which the last frame was read; 0 without timestamping
+        [[nodiscard]] int64_t last_read_ns() const { return read_ns_; }
+
+        // opt-in: record inbound frames to capture under id
+        void set_capture(std::shared_ptr<TrafficCapture> capture, uint32_t id);
+
+        // settled by the HELLO exchange before SRP_INIT; a peer that skips it keeps the defaults
+        void set_features(PeerFeatures features);
+        [[nodiscard]] const PeerFeatures& features() const { return features_; }
+
+        // set once authentication succeeds; empty during the handshake
+        void attach_session(const std::shared_ptr<Session>& session);
+        [[nodiscard]] std::shared_ptr<Session> session() const;
+
         void send_packet(const std::vector<uint8_t>& packet);
+
+        // copies [offset, offset + length) of fd to the socket in the kernel (sendfile)
+        void send_file(int fd, uint64_t offset, uint64_t length);
+
+        // hot path: a disconnect or oversized frame is an error code, not an exception
+        Result<std::pair<MessageType, std::vector<uint8_t>>> try_receive_packet();
         std::pair<MessageType, std::vector<uint8_t>> receive_packet();
 
         void close();
         [[nodiscard]] bool is_open() const;
+
+        // closes the socket and forgets per-connection settings, so a pool can hand this out again
+        void reset();
     };
 
+    // immutable snapshot of the sessions a broadcast goes to
+    using FanoutTable = std::vector<std::shared_ptr<Session>>;
+
     class ConnectionManager
     {
     private:
-        std::unordered_map<std::string, std::shared_ptr<Connection>> connections_;
-        std::unordered_map<std::string, std::string> user_id_to_username_;
+        FlatHashMap<std::string, std::shared_ptr<Session>> sessions_;
+        FlatHashMap<std::string, uint32_t> username_refs_;
+
+        // rebuilt on join/leave so fanout costs one lock per message, not one lookup per recipient
+        std::shared_ptr<const FanoutTable> fanout_{std::make_shared<const FanoutTable>()};
+
+        // gateway links get one plaintext copy of every broadcast and fan it out to their own clients;
+        // the users behind them are listed here (user_id -> username) but reached only through a link
+        std::shared_ptr<const FanoutTable> links_{std::make_shared<const FanoutTable>()};
+        FlatHashMap<std::string, std::string> remote_users_;
 
         mutable std::mutex mutex_;
 
+        void rebuild_fanout();
+        void release_username(const std::string& username);
+
     public:
         ConnectionManager() = default;
 
-        void add(const std::string& user_id, const std::string& username, std::shared_ptr<Connection> conn);
-        void remove(const std::string& user_id);
-        void broadcast(const std::vector<uint8_t>& packet, const std::string& exclude_user = "");
-        bool send_to(const std::string& user_id, const std::vector<uint8_t>& packet);
-        bool username_exists(const std::string& username) const;
+        std::shared_ptr<Session> add(const std::string& user_id, const std::string& username,
+                                     std::shared_ptr<Connection> conn, crypto::SessionKeys keys = {},
+                                     Compression compression = Compression::None);
+        void remove(std::string_view user_id);
+
+        // a gateway link is a session too, but not a chat participant
+        std::shared_ptr<Session> add_link(const std::string& link_id, std::shared_ptr<Connection> conn);
+        void remove_link(const Session& link);
+        [[nodiscard]] std::shared_ptr<const FanoutTable> links() const;
+
+        // users joined through a gateway; false if the username is already logged in
+        bool add_remote(const std::string& user_id, const std::string& username);
+        void remove_remote(std::string_view user_id);
+        [[nodiscard]] size_t remote_count() const;
+        [[nodiscard]] std::shared_ptr<Session> find(std::string_view user_id) const;
+        [[nodiscard]] std::shared_ptr<const FanoutTable> fanout() const;
+
+        // links get it too; a gateway leaves out the excluded user itself
+        void broadcast(const std::vector<uint8_t>& packet, std::string_view exclude_user = {});
+        bool send_to(std::string_view user_id, const std::vector<uint8_t>& packet);
+        bool username_exists(std::string_view username) const;
         std::vector<User> get_active_users() const;
-        std::string get_username_by_user_id(const std::string& user_id) const;
+        std::string get_username_by_user_id(std::string_view user_id) const;
     };
 } // namespace chat::server
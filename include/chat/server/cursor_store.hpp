@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "chat/common/flat_hash_map.hpp"
+
+namespace chat::server
+{
+    /**
+     * Durable per-user delivery cursors into the MessageLog
+     * One small record per user, appended on first use and then overwritten in
+     * place, so the file grows with the number of users and never with the
+     * number of messages.
+     *
+     * Record: u16 username_len | username | u64 seq
+     */
+    class CursorStore
+    {
+    public:
+        explicit CursorStore(std::string path);
+        ~CursorStore();
+
+        CursorStore(const CursorStore&)            = delete;
+        CursorStore& operator=(const CursorStore&) = delete;
+
+        // last sequence number delivered to the user; empty if the user never logged in
+        [[nodiscard]] std::optional<uint64_t> get(std::string_view username) const;
+
+        // throws std::runtime_error on I/O failure
+        void set(const std::string& username, uint64_t seq);
+
+        [[nodiscard]] size_t size() const;
+
+        void sync() const;
+
+    private:
+        const std::string path_;
+        int fd_{-1};
+
+        mutable std::mutex mutex_;
+        FlatHashMap<std::string, std::pair<uint64_t, uint64_t>> cursors_; // username -> (seq offset, seq)
+        uint64_t end_offset_{0};
+
+        void load();
+    };
+} // namespace chat::server
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "chat/common/flat_hash_map.hpp"
+
+namespace chat::server
+{
+    struct FanoutOptions
+    {
+        size_t workers         = 1;   // started up front; the floor when autoscaling
+        size_t quantum         = 256; // recipients a sender may be served per round
+        size_t max_queued_jobs = 64;  // per sender; beyond this submit() refuses
+
+        // autoscaling, enabled when max_workers > workers: a worker is added whenever the p99
+        // queue wait over the last scale_interval exceeds target_wait, and one idle for
+        // idle_timeout exits again
+        size_t max_workers                      = 0;
+        std::chrono::microseconds target_wait   = std::chrono::milliseconds(2);
+        std::chrono::milliseconds scale_interval = std::chrono::milliseconds(100);
+        std::chrono::milliseconds idle_timeout   = std::chrono::seconds(10);
+    };
+
+    /**
+     * Deficit-round-robin scheduler for broadcast fanout
+     * Each sender gets its own FIFO; active senders are served in rounds, each
+     * round crediting `quantum` to the sender's deficit and running jobs while
+     * their cost (recipient count) fits. A sender flooding the room therefore
+     * gets the same share of fanout capacity as everyone else, and its own
+     * messages stay in order because a flow is served by one worker at a time.
+     *
+     * The pool size follows queue sojourn time rather than depth: a deep queue
+     * of cheap jobs needs no more threads, a short one stuck behind slow jobs
+     * does.
+     */
+    class FanoutScheduler
+    {
+    public:
+        using Job = std::function<void()>;
+
+        explicit FanoutScheduler(FanoutOptions options = {});
+        ~FanoutScheduler();
+
+        FanoutScheduler(const FanoutScheduler&)            = delete;
+        FanoutScheduler& operator=(const FanoutScheduler&) = delete;
+
+        // false if the sender's queue is full or the scheduler is stopped
+        bool submit(std::string_view sender, size_t cost, Job job);
+
+        // drops pending jobs and joins the workers
+        void stop();
+
+        [[nodiscard]] size_t pending() const;
+        [[nodiscard]] size_t active_senders() const;
+
+        // jobs of this sender not yet started
+        [[nodiscard]] size_t queued(std::string_view sender) const;
+
+        // how long the job at the head of the run queue has been waiting, zero if none is
+        [[nodiscard]] std::chrono::microseconds oldest_wait() const;
+
+        struct PoolStats
+        {
+            size_t workers;                      // live worker threads
+            std::chrono::microseconds wait_p99;  // as of the last scaling decision
+            uint64_t started;                    // workers added by autoscaling
+            uint64_t retired;                    // workers that exited after idling
+        };
+        [[nodiscard]] PoolStats pool_stats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct PendingJob
+        {
+            size_t cost;
+            Job job;
+            Clock::time_point enqueued;
+        };
+
+        struct Flow
+        {
+            std::string sender;
+            std::deque<PendingJob> jobs;
+            size_t deficit = 0;
+            bool scheduled = false; // in active_ or being served by a worker
+        };
+
+        // queue waits in power-of-two microsecond buckets, reset every scale_interval
+        struct WaitHistogram
+        {
+            std::array<uint32_t, 32> buckets{};
+            uint32_t count = 0;
+
+            void record(Clock::duration wait);
+            [[nodiscard]] std::chrono::microseconds percentile(double p) const;
+        };
+
+        FanoutOptions options_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        FlatHashMap<std::string, std::unique_ptr<Flow>> flows_;
+        std::deque<Flow*> active_;
+        size_t pending_ = 0;
+        bool stopping_  = false;
+
+        std::vector<std::thread> workers_;
+        std::vector<std::thread::id> exited_; // idle workers that returned, not yet joined
+        size_t live_workers_ = 0;
+        size_t idle_workers_ = 0; // waiting for work
+
+        WaitHistogram waits_;
+        Clock::time_point next_scale_{};
+        std::chrono::microseconds wait_p99_{0};
+        uint64_t started_ = 0;
+        uint64_t retired_ = 0;
+
+        void worker_loop();
+
+        // caller holds mutex_
+        void maybe_scale(Clock::time_point now);
+        std::vector<std::thread> take_exited();
+    };
+} // namespace chat::server
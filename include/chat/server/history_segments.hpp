@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "chat/common/types.hpp"
+#include "chat/server/session.hpp"
+
+namespace chat::server
+{
+    /**
+     * Recent room history kept on disk in wire format
+     * Each message is appended as a complete HISTORY frame (header plus a
+     * one-message INIT_V2 payload) to the current segment file; a new segment
+     * starts every kSegmentMessages. A seq range maps to at most one byte range
+     * per segment, which Session::send_file streams with sendfile(), so the
+     * joiners of a storm share page-cache reads instead of each encoding the
+     * window again. Segments are a cache of the MessageLog: the directory is
+     * emptied on startup and refilled from the log tail, and a segment is
+     * unlinked once the retained window has moved past it. Spans still queued
+     * keep their file open until they are sent.
+     */
+    class HistorySegments
+    {
+    public:
+        static constexpr size_t kSegmentMessages = 64;
+
+        // retain: how many of the newest messages must stay addressable
+        HistorySegments(std::string dir, size_t retain);
+        ~HistorySegments();
+
+        HistorySegments(const HistorySegments&)            = delete;
+        HistorySegments& operator=(const HistorySegments&) = delete;
+
+        // message.seq must follow the previous append; throws std::runtime_error on I/O failure
+        void append(const Message& message);
+
+        // file spans holding the frames for seq in (after, through], oldest first;
+        // nullopt if part of that range is no longer retained
+        [[nodiscard]] std::optional<std::vector<FileSpan>> spans(uint64_t after, uint64_t through) const;
+
+        // oldest seq still addressable, 0 when empty
+        [[nodiscard]] uint64_t first_seq() const;
+        [[nodiscard]] uint64_t last_seq() const;
+
+        [[nodiscard]] size_t segment_count() const;
+
+        struct Segment; // one open file, defined in the .cpp
+
+    private:
+        const std::string dir_;
+        const size_t retain_;
+
+        mutable std::mutex mutex_;
+        std::deque<std::shared_ptr<Segment>> segments_;
+        uint64_t last_seq_{0};
+
+        void retire_old();
+    };
+} // namespace chat::server
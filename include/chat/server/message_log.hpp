@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "chat/common/types.hpp"
+
+namespace chat::server
+{
+    /**
+     * Append-only room history on disk
+     * Every message gets the next sequence number and one checksummed record at
+     * the end of the file. A record torn by a crash is cut off when the log is
+     * reopened. A sparse in-memory index (one entry per kIndexStride records)
+     * lets range reads seek close to their start and then stream sequentially.
+     *
+     * Record: u32 body_len | body | u32 fnv1a(body)
+     *   body: u64 seq | i64 timestamp_ms | u16 username_len | username | text
+     */
+    class MessageLog
+    {
+    public:
+        static constexpr size_t kIndexStride = 64;
+
+        explicit MessageLog(std::string path);
+        ~MessageLog();
+
+        MessageLog(const MessageLog&)            = delete;
+        MessageLog& operator=(const MessageLog&) = delete;
+
+        // assigns message.seq and writes the record; throws std::runtime_error on I/O failure
+        uint64_t append(Message& message);
+
+        // seq in (after, through], oldest first; stops at max_messages or once max_bytes of
+        // username + text have been read, but always returns at least one message if any match
+        [[nodiscard]] std::vector<Message> read(uint64_t after, uint64_t through,
+                                                size_t max_messages, size_t max_bytes) const;
+
+        // the newest count messages, oldest first
+        [[nodiscard]] std::vector<Message> tail(size_t count) const;
+
+        [[nodiscard]] uint64_t last_seq() const;
+        [[nodiscard]] uint64_t size_bytes() const;
+
+        // forces appended records to stable storage
+        void sync() const;
+
+    private:
+        struct IndexEntry
+        {
+            uint64_t seq;
+            uint64_t offset;
+        };
+
+        const std::string path_;
+        int fd_{-1};
+
+        mutable std::mutex mutex_;
+        std::vector<IndexEntry> index_;
+        uint64_t end_offset_{0}; // bytes below this are complete records and never change
+        uint64_t last_seq_{0};
+
+        void recover();
+    };
+} // namespace chat::server
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace chat::server
+{
+    struct OverloadOptions
+    {
+        // a queue is standing once every sojourn for a whole interval exceeds target (0 disables)
+        std::chrono::microseconds target{std::chrono::milliseconds(5)};
+        std::chrono::milliseconds interval{100};
+    };
+
+    // what the server sheds, cumulatively: each level also does everything below it
+    enum class OverloadLevel : uint8_t
+    {
+        Normal,
+        DeferEphemeral, // typing, cursor and presence updates are held back, latest per sender and kind
+        RefuseLogins,   // new SRP_INITs get RETRY_LATER before any SRP work is done
+        RefuseMessages, // messages from senders with fanout already queued get RETRY_LATER
+    };
+    inline constexpr uint8_t kOverloadLevels = 4;
+
+    const char* to_string(OverloadLevel level);
+
+    /**
+     * CoDel-style overload detector for one queue
+     * Depth says little about a queue whose jobs vary in cost, so this watches
+     * sojourn time instead. A single sojourn under target means the queue
+     * drained at some point and resets the clock; only when it stays above
+     * target for a whole interval does the level go up, and then again after
+     * interval/sqrt(level) while it still does, so shedding tightens the
+     * longer the queue stands. Once sojourns have stayed under target for an
+     * interval the level steps back down, one step per interval.
+     *
+     * Thread-safe; level() is a relaxed load for the per-frame checks.
+     */
+    class OverloadController
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit OverloadController(OverloadOptions options = {});
+
+        // the sojourn of a job as it left the queue, or the age of one still waiting
+        void observe(Clock::duration sojourn, Clock::time_point now = Clock::now());
+
+        // called about once per interval: a queue nothing has left for a whole interval counts as
+        // drained, otherwise a level whose traffic it refuses outright could never come down
+        void tick(Clock::time_point now = Clock::now());
+
+        [[nodiscard]] OverloadLevel level() const
+        {
+            return static_cast<OverloadLevel>(level_.load(std::memory_order_relaxed));
+        }
+
+        // hint sent with RETRY_LATER: an interval per level, zero when nothing is shed
+        [[nodiscard]] std::chrono::milliseconds retry_after() const;
+
+        [[nodiscard]] bool enabled() const { return options_.target.count() > 0; }
+
+        struct Stats
+        {
+            uint64_t escalations; // level raised
+            uint64_t recoveries;  // level lowered
+        };
+        [[nodiscard]] Stats stats() const;
+
+    private:
+        OverloadOptions options_;
+
+        mutable std::mutex mutex_;
+        std::atomic<uint8_t> level_{0};
+        Clock::time_point escalate_at_{}; // set while above target: when the level goes up next
+        Clock::time_point below_since_{}; // set while below target with a level to shed
+        Clock::time_point last_sample_{};
+        uint64_t escalations_ = 0;
+        uint64_t recoveries_  = 0;
+
+        // caller holds mutex_
+        void record(Clock::duration sojourn, Clock::time_point now);
+    };
+} // namespace chat::server
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+
+namespace chat::server
+{
+    /**
+     * Token bucket: refills at `rate` tokens per second up to `burst`
+     * Not synchronized; each bucket belongs to the one thread reading its
+     * client's socket. A default-constructed bucket never throttles.
+     */
+    class TokenBucket
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        TokenBucket() = default;
+        TokenBucket(double rate, double burst, Clock::time_point now = Clock::now());
+
+        // takes one token if available
+        bool try_acquire(Clock::time_point now = Clock::now());
+
+        // wait until the next token, zero if one is available now
+        [[nodiscard]] std::chrono::milliseconds retry_after(Clock::time_point now = Clock::now()) const;
+
+        [[nodiscard]] bool unlimited() const { return rate_ <= 0.0; }
+
+    private:
+        double rate_{0.0};
+        double burst_{0.0};
+        double tokens_{0.0};
+        Clock::time_point last_refill_{};
+
+        [[nodiscard]] double available(Clock::time_point now) const;
+    };
+} // namespace chat::server
@@ -1,50 +1,253 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <atomic>
 #include <vector>
+#include <optional>
+#include <chrono>
+#include <set>
+#include <string>
+#include <iosfwd>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <limits>
 #include <unordered_map>
 #include <boost/asio.hpp>
 
 #include "chat/auth/srp_server.hpp"
+#include "chat/common/object_pool.hpp"
 #include "chat/common/types.hpp"
+#include "chat/common/socket_tuning.hpp"
 #include "chat/server/connection_manager.hpp"
+#include "chat/server/cursor_store.hpp"
+#include "chat/server/fanout_scheduler.hpp"
+#include "chat/server/history_segments.hpp"
+#include "chat/server/message_log.hpp"
+#include "chat/server/overload_controller.hpp"
+#include "chat/server/server_stats.hpp"
+#include "chat/server/text_filter.hpp"
+#include "chat/server/usage_ledger.hpp"
+#include "chat/server/wire_latency.hpp"
 
 namespace chat::server
 {
+    struct ServerOptions
+    {
+        // low-latency mode: reactor and per-client I/O threads spin this long before blocking
+        std::chrono::microseconds busy_poll{0};
+
+        // applied to every accepted socket; the send timeout frees a thread writing to a stalled client
+        SocketTuning socket_tuning{.user_timeout_ms = 30'000};
+
+        // per-sender token bucket: sustained messages/s and burst size (rate 0 disables)
+        double rate_limit{20.0};
+        double rate_burst{40.0};
+
+        // separate budget for ephemeral frames (typing, presence); excess is dropped silently
+        double ephemeral_rate{10.0};
+        double ephemeral_burst{20.0};
+
+        // autoscaled between one worker and one per core by default
+        FanoutOptions fanout{.max_workers = std::max(1u, std::thread::hardware_concurrency())};
+
+        // stats are printed on SIGUSR1 and, if non-zero, at this interval
+        std::chrono::seconds stats_interval{0};
+        // heaviest users listed in the stats dump (0 hides the table)
+        size_t stats_top_users{5};
+
+        // durable room history and per-user delivery cursors into it
+        std::string history_path{"messages.log"};
+        std::string cursor_path{"cursors.db"};
+        // the recent window again as wire-format frames, streamed to joiners with sendfile()
+        std::string segment_dir{"history.segments"};
+
+        // banned-term file (see PatternSet::parse), polled for changes at this interval
+        std::string filter_path{};
+        std::chrono::seconds filter_reload_interval{2};
+
+        // pre-warmed pools, so join and reconnect storms reuse connections and SRP handshake state
+        size_t connection_pool{256};
+        size_t handshake_pool{256};
+
+        // INIT (history window and user list) as one AES-GCM envelope under the session key;
+        // off, the window goes out in plaintext HISTORY frames sent from the segment files
+        bool seal_init{true};
+
+        // accept clients' offers of a per-connection deflate stream with the built-in dictionary
+        bool compression{true};
+
+        // instrumentation: SO_TIMESTAMPING on client sockets, splitting message latency into kernel,
+        // server and network time in the stats (see WireLatency); costs an error-queue read per send
+        bool kernel_timestamps{false};
+
+        // if set, inbound frame types, sizes and timings are recorded here (see TrafficCapture)
+        std::string capture_path{};
+
+        // chat_gateway links (0 disables); a link is trusted with the identities it announces,
+        // so the listener only binds gateway_address
+        int gateway_port{0};
+        std::string gateway_address{"127.0.0.1"};
+
+        // CoDel-style admission control on top of the per-sender limits: sojourn in the fanout
+        // queues, and from SRP_INIT to SRP_CHALLENGE for handshakes, which includes the SRP math
+        OverloadOptions fanout_overload{};
+        OverloadOptions handshake_overload{.target = std::chrono::milliseconds(20)};
+
+        // clients that signalled away get what they missed as one digest at this cadence, and on
+        // coming back (0: only on coming back)
+        std::chrono::seconds away_digest_interval{60};
+    };
+
     class Server
     {
     public:
-        explicit Server(int port);
+        explicit Server(int port, ServerOptions options = {});
         ~Server();
 
+        // returns once stopped, by stop() or SIGINT/SIGTERM, with the fanout workers joined
         void run();
+        // only stops the reactor; safe from any thread, including a fanout worker
         void stop();
 
     private:
         boost::asio::io_context io_context_;
         boost::asio::ip::tcp::acceptor acceptor_;
+        std::optional<boost::asio::ip::tcp::acceptor> gateway_acceptor_;
 
         std::unique_ptr<auth::SRPServer> srp_server_;
         std::unique_ptr<ConnectionManager> connection_manager_;
 
+        std::unique_ptr<MessageLog> message_log_;
+        std::unique_ptr<CursorStore> cursors_;
+
+        // recent window of the log, sent ahead of INIT; segments_ holds the same window pre-encoded
         std::vector<Message> message_history_;
-        std::mutex message_mutex_;
-        std::unordered_map<std::string, std::vector<uint8_t>> user_keys_;
-        std::mutex user_keys_mutex_;
+        std::unique_ptr<HistorySegments> segments_;
+        bool segments_ok_{true};
+        // logged messages whose fanout has not finished yet
+        std::multiset<uint64_t> fanout_in_flight_;
+        std::mutex message_mutex_; // guards the five above and orders log appends
 
         std::atomic<int> next_user_id_;
         std::atomic<bool> running_;
 
         int port_;
+        ServerOptions options_;
+
+        ServerStats stats_;
+        UsageLedger usage_;
+        std::unique_ptr<FanoutScheduler> fanout_scheduler_;
+        TextFilter text_filter_;
+        ObjectPool<Connection> connection_pool_;
+        std::shared_ptr<TrafficCapture> capture_;
+        std::shared_ptr<WireLatency> wire_latency_; // with kernel_timestamps only
+        std::atomic<uint32_t> next_connection_id_{0};
+        std::once_flag tuning_warning_;
+
+        OverloadController fanout_overload_;
+        OverloadController handshake_overload_;
+        // ephemerals held back while overloaded, latest per sender and kind (see handle_ephemeral)
+        struct DeferredEphemeral
+        {
+            std::string user_id;
+            std::string username;
+            EphemeralKind kind;
+            std::string text;
+        };
+        std::unordered_map<uint64_t, DeferredEphemeral> deferred_ephemerals_;
+        std::mutex deferred_mutex_;
+
+        boost::asio::signal_set stats_signals_;
+        boost::asio::signal_set shutdown_signals_;
+        boost::asio::steady_timer stats_timer_;
+        boost::asio::steady_timer filter_timer_;
+        boost::asio::steady_timer overload_timer_;
+        boost::asio::steady_timer digest_timer_;
 
         void start_accept();
+        void start_gateway_accept();
+        // options_.socket_tuning on an accepted socket; a rejection is reported once, not per connection
+        void tune_socket(boost::asio::ip::tcp::socket& socket);
+        void run_reactor();
+        void wait_shutdown_signal();
+        // joins what stop() only signalled; on the thread that called run(), never a worker
+        void shutdown();
+
+        void start_stats_reporting();
+        void wait_stats_signal();
+        void wait_stats_timer();
+        void dump_stats(std::ostream& out) const;
+        void wait_filter_reload();
+        void wait_overload_tick();
+        void wait_digest_tick();
+
+        // the stricter of the two queues' levels, and its retry-after hint
+        [[nodiscard]] OverloadLevel overload_level() const;
+        [[nodiscard]] uint32_t overload_retry_after_ms() const;
+        // a message refused under RefuseMessages; senders with no fanout queued still get through
+        [[nodiscard]] bool refuse_message(const std::string& user_id) const;
+        void flush_deferred_ephemerals();
+        // granted in HELLO_ACK to clients that ask for them; follows the options
+        [[nodiscard]] uint32_t supported_capabilities() const;
 
-        std::optional<std::string> handle_srp_authentication(const std::shared_ptr<Connection>& conn);
+        std::shared_ptr<Session> handle_srp_authentication(const std::shared_ptr<Connection>& conn);
         void handle_srp_register(const std::shared_ptr<Connection>& conn, const std::vector<uint8_t>& payload);
 
-        void handle_disconnect(const std::string& user_id);
-        void handle_client(const std::shared_ptr<Connection>& conn, const std::string& user_id);
-        void handle_message(const std::string& username, const std::string& text);
+        // advance_cursor: the user saw everything fanned out so far, short of undelivered digests
+        // (false after an aborted catch-up)
+        void handle_disconnect(const Session& session, bool advance_cursor = true);
+        // ServerStats' eviction counters, for a session on its way out
+        void count_eviction(const Session& session);
+        void handle_client(const std::shared_ptr<Session>& session);
+        // decrypts, then decompresses with the sender's inbound stream
+        Result<std::string> inflate_text(InflateStream& inflate, const std::vector<uint8_t>& encrypted,
+                                         const std::vector<uint8_t>& key);
+        // text stage for every sender: the reason text is refused, or nullptr once it may go out
+        const char* screen_text(std::string& text, SessionStats& stats);
+        // false if the sender's fanout queue is full and the message was dropped
+        // received_ns: when the MESSAGE was read, for the processing stage of wire_latency_ (0: not measured)
+        bool handle_message(const std::string& user_id, const std::string& username, const std::string& text,
+                            int64_t received_ns = 0);
+        void fanout_message(const std::string& username, const std::string& text, int64_t timestamp_ms,
+                            uint64_t seq, int64_t received_ns);
+        // AWAY from a client; coming back sends the digest right away
+        void handle_away(const std::shared_ptr<Session>& session, bool away);
+        // skipped messages logged and fanned out by now, as one CATCH_UP digest; false if the session went away
+        bool send_digest(Session& session, uint64_t through);
+        // caller holds message_mutex_
+        void append_segment(const Message& message);
+
+        // volatile state bypasses the log and history and is shed first under load
+        void handle_ephemeral(const std::string& user_id, const std::string& username, EphemeralKind kind,
+                              std::string text);
+        void fanout_ephemeral(const std::string& sender_id, const std::string& username, EphemeralKind kind,
+                              const std::string& text, uint64_t collapse_key);
+
+        // one thread per gateway link, serving all of its streams; see StreamCodec
+        void handle_gateway(const std::shared_ptr<Connection>& conn);
+        // nullopt if the username is already logged in, else whether the catch-up went out in full
+        std::optional<bool> join_remote(Session& link, uint64_t stream, const std::string& user_id,
+                                        const std::string& username);
+        void leave_remote(const std::string& user_id, const std::string& username, bool advance_cursor);
+        // cursor and USER_LEFT, once a user is out of the connection manager; the cursor stops at cursor_cap
+        void leave_room(const std::string& username, bool advance_cursor,
+                        uint64_t cursor_cap = std::numeric_limits<uint64_t>::max());
+
+        // INIT_SEALED for a joining session, history and users under one AES-GCM operation
+        std::vector<uint8_t> seal_init(const std::vector<Message>& seen, const std::vector<User>& users,
+                                       const crypto::Sealer& sealer);
+        // streams log entries in (after, through] to a session that just joined or is owed a digest;
+        // false if it went away
+        bool send_catch_up(Session& session, uint64_t after, uint64_t through);
+        // the same batches as bare INIT_V2 payloads, one deliver call each; false once deliver fails
+        bool stream_catch_up(const std::string& username, uint64_t after, uint64_t through,
+                             const std::function<bool(std::vector<uint8_t> payload)>& deliver);
+        // where a joining user's history starts and ends: (cursor, last logged seq); caller holds message_mutex_
+        std::pair<uint64_t, uint64_t> join_range(const std::string& username);
+        // highest seq with every message up to it fanned out; caller holds message_mutex_
+        uint64_t delivered_seq() const;
+        void save_cursor(const std::string& username, uint64_t seq);
     };
 } // namespace chat::server
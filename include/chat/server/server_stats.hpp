@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace chat::server
+{
+    // server-wide counters; per-connection ones live in SessionStats
+    struct ServerStats
+    {
+        std::atomic<uint64_t> messages_throttled{0}; // dropped by a sender's token bucket
+        std::atomic<uint64_t> evicted_queue_full{0};   // sessions closed for outgrowing their outbound queue
+        std::atomic<uint64_t> evicted_send_timeout{0}; // sessions closed after a write stalled past the timeout
+        std::atomic<uint64_t> fanout_rejected{0};    // dropped because the sender's fanout queue was full
+        std::atomic<uint64_t> fanout_jobs{0};        // broadcasts run by the fanout scheduler
+        std::atomic<uint64_t> fanout_recipients{0};  // encrypt-and-send operations across all broadcasts
+        std::atomic<uint64_t> catch_up_frames{0};    // CATCH_UP frames sent on login and in away digests
+        std::atomic<uint64_t> catch_up_messages{0};  // messages replayed from the log in those frames
+        std::atomic<uint64_t> history_sendfile_bytes{0}; // pre-encoded HISTORY frames streamed from segments
+        std::atomic<uint64_t> history_encoded_joins{0};  // joins whose history was encoded instead
+        std::atomic<uint64_t> sealed_inits{0};           // INIT_SEALED frames, one AES-GCM operation each
+        std::atomic<uint64_t> sealed_init_bytes{0};      // INIT payload bytes they sealed
+        std::atomic<uint64_t> messages_invalid_utf8{0}; // decrypted text that was not valid UTF-8
+        std::atomic<uint64_t> messages_redacted{0};     // delivered with filtered terms masked
+        std::atomic<uint64_t> messages_blocked{0};      // rejected by a block term
+        std::atomic<uint64_t> ephemeral_relayed{0};     // ephemeral fanout jobs run
+        std::atomic<uint64_t> ephemeral_shed{0};        // ephemerals dropped at the sender (rate or fanout queue)
+        std::atomic<uint64_t> gateway_streams{0};       // client streams opened over gateway links
+        std::atomic<uint64_t> gateway_copies{0};        // plaintext broadcasts sent to links, one per gateway
+        std::atomic<uint64_t> compressed_sessions{0};   // logins that negotiated a deflate stream
+        std::atomic<uint64_t> compression_plain_bytes{0}; // message text on those streams, both directions
+        std::atomic<uint64_t> compression_wire_bytes{0};  // the same text deflated
+        std::atomic<uint64_t> overload_logins_refused{0};      // SRP_INITs answered with RETRY_LATER
+        std::atomic<uint64_t> overload_messages_refused{0};    // messages answered with RETRY_LATER
+        std::atomic<uint64_t> overload_ephemerals_deferred{0}; // held back until the level came down
+        std::atomic<uint64_t> overload_ephemerals_replaced{0}; // deferred, then superseded by a newer one
+        std::atomic<uint64_t> hello_sessions{0};  // logins that negotiated capabilities with HELLO
+        std::atomic<uint64_t> legacy_sessions{0}; // logins without it, served the v1 encodings
+        std::atomic<uint64_t> away_changes{0};    // AWAY frames that switched a session's state
+        std::atomic<uint64_t> away_skipped{0};    // per-recipient encryptions skipped for away sessions
+        std::atomic<uint64_t> digests_sent{0};    // digests delivered, on a timer or on coming back
+        std::atomic<uint64_t> digest_messages{0}; // messages they carried
+    };
+} // namespace chat::server
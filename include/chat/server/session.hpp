@@ -0,0 +1,204 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "chat/common/compression.hpp"
+#include "chat/crypto/session_keys.hpp"
+
+namespace chat::server
+{
+    class Connection;
+
+    using SharedPacket = std::shared_ptr<const std::vector<uint8_t>>;
+
+    // a byte range of an open file holding complete frames; owner keeps the descriptor open
+    struct FileSpan
+    {
+        std::shared_ptr<const void> owner;
+        int fd{-1};
+        uint64_t offset{0};
+        uint64_t length{0};
+    };
+
+    struct SessionStats
+    {
+        std::atomic<uint64_t> messages_received{0};
+        std::atomic<uint64_t> bytes_received{0};
+        std::atomic<uint64_t> packets_sent{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> send_errors{0};
+        std::atomic<uint64_t> malformed_frames{0}; // undecodable or failed AEAD authentication
+        std::atomic<uint64_t> messages_throttled{0}; // dropped by the rate limit or a full fanout queue
+        std::atomic<uint64_t> ephemeral_collapsed{0}; // outbound ephemerals replaced by a newer one
+        std::atomic<uint64_t> ephemeral_dropped{0};   // outbound ephemerals shed under queue pressure
+        std::atomic<uint64_t> queue_overflows{0};     // closed for outgrowing the outbound queue cap
+        std::atomic<uint64_t> send_timeouts{0};       // closed because a write stalled past the send timeout
+    };
+
+    /**
+     * Everything the hot path needs about one authenticated connection
+     * Identity and keys are immutable after construction, so the fanout loop
+     * reads them without locking; the sealer's nonce counter is atomic and
+     * only the outbound queue is synchronized.
+     */
+    class Session
+    {
+    private:
+        const std::string user_id_;
+        const std::string username_;
+        // AES-256-GCM, one key per direction: what the server seals for the client, what the client seals
+        const crypto::Sealer sealer_;
+        const std::vector<uint8_t> receive_key_;
+        const std::shared_ptr<Connection> conn_;
+
+        SessionStats stats_;
+
+        // outbound half of the negotiated compression; the lock also orders enqueueing, never writing
+        const std::unique_ptr<DeflateStream> deflate_;
+        std::mutex deflate_mutex_;
+
+        struct Outbound
+        {
+            SharedPacket packet;
+            uint64_t collapse_key{0}; // non-zero for ephemeral packets
+            FileSpan file{};          // sent with sendfile() when packet is null
+        };
+
+        // outbound queue: whichever thread finds it idle becomes the writer and drains it
+        mutable std::mutex queue_mutex_;
+        std::deque<Outbound> queue_;
+        size_t ephemeral_queued_{0};
+        size_t queued_bytes_{0}; // packets only; file spans live in the page cache
+        const size_t max_queued_bytes_;
+        bool flushing_{false};
+
+        // after start_writer: a thread of the session's own drains the queue and senders never write
+        std::condition_variable queue_cv_;
+        std::thread writer_;
+        bool own_writer_{false};
+        bool writer_stopping_{false};
+
+        // away state (see set_away); fanout reads it once per recipient per message
+        struct AwayWindow
+        {
+            bool away{false};
+            uint64_t skip_after{0};   // BROADCASTs in (skip_after, skip_through] are left out of fanout
+            uint64_t skip_through{0};
+            uint64_t digest_next{0};  // skipped messages claimed by a digest up to here
+            uint64_t digest_done{0};  // and delivered up to here
+        };
+        mutable std::mutex away_mutex_;
+        AwayWindow away_;
+
+        // push, then drain if this thread became the writer
+        bool enqueue(Outbound outbound);
+        // queue only; write is set if the caller must drain(). false once the connection is closed
+        bool push(Outbound outbound, bool& write);
+        void drain();
+
+        void flush(std::unique_lock<std::mutex>& lock);
+        void run_writer();
+
+    public:
+        // queue depth at which ephemeral packets are shed, queued ones first
+        static constexpr size_t kEphemeralDropDepth = 16;
+        // packet bytes a client may fall behind by before it is closed; one packet alone may exceed it
+        static constexpr size_t kMaxQueuedBytes = 8U << 20;
+
+        Session(std::string user_id, std::string username, std::shared_ptr<Connection> conn,
+                crypto::SessionKeys keys = {}, Compression compression = Compression::None,
+                size_t max_queued_bytes = kMaxQueuedBytes);
+
+        ~Session();
+
+        Session(const Session&)            = delete;
+        Session& operator=(const Session&) = delete;
+
+        [[nodiscard]] const std::string& user_id() const { return user_id_; }
+        [[nodiscard]] const std::string& username() const { return username_; }
+        [[nodiscard]] const crypto::Sealer& sealer() const { return sealer_; }
+        [[nodiscard]] const std::vector<uint8_t>& receive_key() const { return receive_key_; }
+        // false for gateway links, which carry plaintext
+        [[nodiscard]] bool keyed() const { return !receive_key_.empty(); }
+        [[nodiscard]] Connection& connection() const { return *conn_; }
+        [[nodiscard]] const std::shared_ptr<Connection>& connection_ptr() const { return conn_; }
+        [[nodiscard]] Compression compression() const { return deflate_ ? Compression::Deflate : Compression::None; }
+
+        SessionStats& stats() { return stats_; }
+        [[nodiscard]] const SessionStats& stats() const { return stats_; }
+
+        // enqueue and flush; returns false once the connection has failed or was closed for falling
+        // max_queued_bytes behind
+        bool send(std::vector<uint8_t> packet);
+        bool send(SharedPacket packet);
+
+        /**
+         * Enqueue a frame carrying text on the connection's outbound stream
+         * seal gets the text as it goes on the wire (deflated if the client
+         * negotiated compression) and returns the finished packet. Compression
+         * and enqueueing happen under one lock, so frames leave in the order
+         * the stream produced them whichever fanout worker built them; the
+         * socket write happens after the lock is released.
+         */
+        bool send_text(std::string_view text, const std::function<std::vector<uint8_t>(std::span<const uint8_t>)>& seal);
+
+        // enqueue frames stored in a file; they go out in order with packets, never through user space
+        bool send_file(FileSpan span);
+
+        /**
+         * Enqueue a volatile packet (typing, cursor, presence ping)
+         * A queued packet with the same non-zero collapse_key is replaced in
+         * place, since only the latest state matters. At kEphemeralDropDepth
+         * queued packets the packet is dropped instead. Returns false once the
+         * connection has failed.
+         */
+        bool send_ephemeral(SharedPacket packet, uint64_t collapse_key);
+
+        /**
+         * Away state, against the room log's sequence numbers
+         * Going away at last_seq opens a window: every later message is
+         * skipped by fanout and left for a digest. Coming back closes it at
+         * the then last_seq, so messages logged before the switch but still
+         * queued for fanout are skipped too, and each message takes exactly
+         * one of the two paths. Callers hold the log lock, so last_seq is
+         * exact. Returns false if the state did not change.
+         */
+        bool set_away(bool away, uint64_t last_seq);
+        [[nodiscard]] bool away() const;
+        [[nodiscard]] bool skips(uint64_t seq) const;
+
+        // skipped messages up to through not yet claimed by a digest, as (after, through]; empty if none
+        std::pair<uint64_t, uint64_t> claim_digest(uint64_t through);
+        void digest_delivered(uint64_t through);
+        // where skipped messages stop having reached the client, if any were missed
+        [[nodiscard]] std::optional<uint64_t> undelivered_from() const;
+
+        /**
+         * Hand the outbound queue to a dedicated writer thread
+         * From here on the send methods only queue, so a thread delivering
+         * to many sessions never blocks on one that stopped reading; the
+         * queue cap and send timeout bound how long that session lasts.
+         * stop_writer drains what is still queued, then joins the thread.
+         */
+        void start_writer();
+        void stop_writer();
+
+        [[nodiscard]] size_t queued() const;
+        // what counts against max_queued_bytes
+        [[nodiscard]] size_t queued_bytes() const;
+        [[nodiscard]] bool is_open() const;
+    };
+} // namespace chat::server
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace chat::server
+{
+    // ordered by precedence: when several terms match, the highest action wins
+    enum class FilterAction : uint8_t
+    {
+        Pass,
+        Redact, // matched bytes are replaced with '*'
+        Block,  // the message is rejected
+    };
+
+    struct FilterPattern
+    {
+        std::string term;
+        FilterAction action;
+    };
+
+    /**
+     * Compiled banned-term matcher (Aho-Corasick, ASCII case-insensitive)
+     * The automaton is a dense DFA over byte equivalence classes, so each input
+     * byte costs one table lookup. While it sits in the root state, a nibble
+     * lookup prefilter skips 32-byte blocks with no byte that can start a term
+     * (AVX2 when the CPU has it, a byte table otherwise).
+     */
+    class PatternSet
+    {
+    public:
+        // longest accepted term; also bounds the redaction span
+        static constexpr size_t kMaxTermLength = 255;
+
+        PatternSet() = default; // matches nothing
+        explicit PatternSet(const std::vector<FilterPattern>& patterns);
+
+        /**
+         * Parse a filter file
+         * One "block <term>" or "redact <term>" per line; blank lines and lines
+         * starting with '#' are skipped. Lines with an unknown action, an empty
+         * or over-long term, or a term that is not valid UTF-8 are counted in
+         * rejected and dropped.
+         */
+        static std::vector<FilterPattern> parse(std::istream& in, size_t* rejected = nullptr);
+
+        // strongest action over all matches; Redact rewrites text in place
+        FilterAction apply(std::string& text) const;
+
+        // match without rewriting
+        [[nodiscard]] FilterAction scan(std::string_view text) const;
+
+        [[nodiscard]] size_t size() const { return pattern_count_; }
+
+    private:
+        struct Output
+        {
+            uint16_t length{0}; // longest term ending in this state
+            FilterAction action{FilterAction::Pass};
+        };
+
+        std::array<uint8_t, 256> class_of_{};     // byte -> equivalence class, 0 = in no term
+        uint32_t classes_{1};
+        // row offset of the next state (state * classes_), kMatchFlag if it has an output
+        static constexpr uint32_t kMatchFlag = 1u << 31;
+        std::vector<uint32_t> transitions_;        // row + class -> next
+        std::vector<Output> outputs_;              // by state
+        std::array<bool, 256> starts_term_{};      // root transition leaves the root
+        alignas(16) std::array<uint8_t, 16> prefilter_low_{};
+        alignas(16) std::array<uint8_t, 16> prefilter_high_{};
+        size_t pattern_count_{0};
+
+        template <bool Rewrite>
+        FilterAction run(char* rewrite, std::string_view text) const;
+
+        // first position at or after i where a term could begin
+        [[nodiscard]] size_t skip(const uint8_t* p, size_t i, size_t n) const;
+    };
+
+    /**
+     * Hot-reloadable filter stage
+     * Holds the active PatternSet behind a generation counter. Each thread keeps
+     * its own reference and refreshes it only when the generation changes, so
+     * the per-message cost is one relaxed load and a reload never blocks senders.
+     */
+    class TextFilter
+    {
+    public:
+        // empty path: no patterns and nothing to reload
+        explicit TextFilter(std::string path = {});
+
+        // re-reads the file if its modification time changed; true if a new set was installed
+        bool reload_if_changed();
+
+        void install(std::shared_ptr<const PatternSet> patterns);
+
+        FilterAction apply(std::string& text) const;
+
+        [[nodiscard]] std::shared_ptr<const PatternSet> current() const;
+        [[nodiscard]] uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+        [[nodiscard]] const std::string& path() const { return path_; }
+
+    private:
+        const std::string path_;
+
+        std::mutex reload_mutex_;
+        std::filesystem::file_time_type mtime_{};
+
+        std::atomic<std::shared_ptr<const PatternSet>> patterns_;
+        std::atomic<uint64_t> generation_{0};
+    };
+} // namespace chat::server
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace chat::server
+{
+    // CPU time consumed so far by the calling thread (CLOCK_THREAD_CPUTIME_ID)
+    uint64_t thread_cpu_ns();
+
+    // what one user has cost the server; CPU times are thread CPU, not wall clock
+    struct UserUsage
+    {
+        uint64_t login_ns{0};          // SRP handshake, registration, INIT and catch-up
+        uint64_t ingress_ns{0};        // decode, decrypt and text filtering of their frames
+        uint64_t fanout_ns{0};         // re-encrypting and queueing their messages for everyone else
+        uint64_t bytes_in{0};          // frames received from them
+        uint64_t bytes_out{0};         // frames sent to them
+        uint64_t fanout_bytes{0};      // frames their messages caused to be sent to others
+        uint64_t messages{0};          // chat and ephemeral frames accepted from them
+        uint64_t fanout_recipients{0}; // per-recipient encryptions their messages triggered
+
+        [[nodiscard]] uint64_t cpu_ns() const { return login_ns + ingress_ns + fanout_ns; }
+
+        UserUsage& operator+=(const UserUsage& other);
+    };
+
+    /**
+     * Per-user cost ledger
+     * charge() adds to an accumulator owned by the calling thread, so the
+     * per-connection threads and fanout workers never contend on a shared
+     * counter; each accumulator has its own lock that only the stats reader
+     * ever competes for. When a thread exits its totals fold into the ledger.
+     */
+    class UsageLedger
+    {
+    public:
+        UsageLedger();
+        ~UsageLedger();
+
+        UsageLedger(const UsageLedger&)            = delete;
+        UsageLedger& operator=(const UsageLedger&) = delete;
+
+        void charge(std::string_view username, const UserUsage& delta);
+
+        // totals across all threads, heaviest CPU first; n = 0 returns everyone
+        [[nodiscard]] std::vector<std::pair<std::string, UserUsage>> top(size_t n) const;
+
+        struct Core; // shared with the per-thread accumulators, defined in the .cpp
+
+    private:
+        std::shared_ptr<Core> core_;
+    };
+} // namespace chat::server
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+namespace chat::server
+{
+    // CLOCK_REALTIME in nanoseconds, the clock the kernel's software timestamps are taken on
+    int64_t realtime_ns();
+
+    // latencies in power-of-two nanosecond buckets; lock-free, so any thread may record
+    class LatencyHistogram
+    {
+    public:
+        static constexpr size_t kBuckets = 40; // the last one holds everything from ~9 minutes up
+
+        void record(int64_t ns);
+
+        [[nodiscard]] uint64_t count() const;
+        // linear within the bucket that holds the rank; 0 with no samples
+        [[nodiscard]] std::chrono::nanoseconds percentile(double p) const;
+
+    private:
+        std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    };
+
+    /**
+     * Wire-to-application latency from kernel timestamps (SO_TIMESTAMPING)
+     * Splits one message's trip through the server into the time it waited
+     * in the kernel before the I/O thread read it, the time the server took
+     * until each BROADCAST it produced was handed to a recipient's socket,
+     * the time that BROADCAST then spent in the kernel until the driver took
+     * it, and the time until the client's TCP acknowledged it. A p99 that
+     * lives in the first or third stage is the host's, in the second ours,
+     * in the fourth the network's.
+     */
+    struct WireLatency
+    {
+        LatencyHistogram rx_queue;   // kernel receive -> frame read by the connection's I/O thread
+        LatencyHistogram processing; // MESSAGE read -> each BROADCAST it produced queued for the socket
+        LatencyHistogram tx_queue;   // BROADCAST written to the socket -> left through the driver
+        LatencyHistogram ack;        // left through the driver -> acknowledged by the client
+
+        // one line per stage: samples, p50, p99, p99.9
+        void dump(std::ostream& out) const;
+    };
+} // namespace chat::server
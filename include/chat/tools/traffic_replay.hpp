@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chat/auth/verifier_engine.hpp"
+#include "chat/common/traffic_capture.hpp"
+
+namespace chat::tools
+{
+    // what one captured connection did after it logged in
+    struct ReplayScript
+    {
+        uint32_t connection{0};
+        uint64_t login_ns{0};               // capture time of its first frame
+        std::vector<CapturedFrame> frames; // MESSAGE, EPHEMERAL and DISCONNECT only, in order
+    };
+
+    struct ReplayOptions
+    {
+        std::string host = "127.0.0.1";
+        int port         = 8888;
+        double speed     = 1.0; // 1x..100x the captured pace
+
+        // every captured connection becomes its own synthetic user "<prefix><connection>"
+        std::string username_prefix = "replay";
+        std::string password        = "replay-password";
+    };
+
+    struct ReplayReport
+    {
+        size_t logins         = 0;
+        size_t login_failures = 0;
+        size_t messages       = 0;
+        size_t ephemerals     = 0;
+        size_t late_frames    = 0; // sent more than a millisecond behind schedule
+        std::chrono::microseconds max_lag{0};
+        double seconds = 0.0;
+    };
+
+    // connections that completed an SRP login; everything before and during the handshake is dropped
+    [[nodiscard]] std::vector<ReplayScript> build_scripts(const std::vector<CapturedFrame>& frames);
+
+    [[nodiscard]] std::string username_for(const ReplayOptions& options, uint32_t connection);
+
+    // verifier records for every script's user, ready for SRPServer::add_user
+    [[nodiscard]] std::vector<auth::UserCredentials> make_credentials(const std::vector<ReplayScript>& scripts,
+                                                                      const ReplayOptions& options);
+
+    // plaintext length whose sealed, base64-encoded frame comes closest to the captured payload size
+    [[nodiscard]] size_t filler_length(const CapturedFrame& frame);
+
+    /**
+     * Time-scaled replay
+     * Each script logs in at its captured offset divided by speed and sends
+     * placeholder text of the captured sizes on the captured schedule, one
+     * client thread per script. Blocks until every script has finished.
+     */
+    ReplayReport replay(const std::vector<ReplayScript>& scripts, const ReplayOptions& options);
+} // namespace chat::tools
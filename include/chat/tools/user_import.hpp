@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <optional>
+#include <string>
+
+#include "chat/auth/srp_server.hpp"
+
+namespace chat::tools
+{
+    enum class ImportFormat
+    {
+        CSV,  // username,password per line; RFC 4180 quoting, optional header
+        JSON, // JSON Lines or a top-level array of {"username": ..., "password": ...}
+    };
+
+    struct ImportRecord
+    {
+        std::string username;
+        std::string password;
+    };
+
+    /**
+     * Streaming record reader
+     * Reads one record at a time from the stream so memory stays flat no matter
+     * how large the input is. Malformed entries are counted and skipped.
+     */
+    class RecordReader
+    {
+    public:
+        RecordReader(std::istream& in, ImportFormat format);
+
+        // nullopt at end of input
+        std::optional<ImportRecord> next();
+
+        [[nodiscard]] size_t malformed() const { return malformed_; }
+
+    private:
+        std::istream& in_;
+        ImportFormat format_;
+        size_t malformed_{0};
+        bool header_checked_{false};
+
+        std::optional<ImportRecord> next_csv();
+        std::optional<ImportRecord> next_json();
+    };
+
+    // usernames end up in the ':'-separated user database, one per line
+    [[nodiscard]] bool is_valid_username(const std::string& username);
+
+    struct ImportOptions
+    {
+        size_t threads    = 0;    // verifier workers, 0 = all cores
+        size_t batch_size = 1024; // records per work unit
+        std::function<void(size_t imported)> on_progress{}; // called from the importing thread
+    };
+
+    struct ImportReport
+    {
+        size_t read       = 0; // well-formed records
+        size_t imported   = 0;
+        size_t duplicates = 0; // already in the database or repeated in the input
+        size_t rejected   = 0; // malformed or invalid usernames
+        double seconds    = 0.0;
+    };
+
+    /**
+     * Parallel bulk import
+     * A reader feeds batches to one verifier worker per core; finished batches
+     * go into the server with a single lock per batch. The database is not
+     * written here, the caller saves once at the end.
+     */
+    ImportReport import_users(std::istream& in, ImportFormat format, auth::SRPServer& server,
+                              const ImportOptions& options = {});
+} // namespace chat::tools
@@ -1,5 +1,6 @@
 #include "chat/auth/srp_server.hpp"
 #include "chat/auth/srp_types.hpp"
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <random>
@@ -7,13 +8,26 @@
 
 namespace chat::auth
 {
-    SRPServer::SRPServer()
-        : SRPServer(SRPUtils::random_bytes(SRP_SALT_SIZE))
+    SRPServer::SRPServer(const size_t session_pool)
+        : SRPServer(SRPUtils::random_bytes(SRP_SALT_SIZE), session_pool)
     {
     }
 
-    SRPServer::SRPServer(const std::vector<uint8_t>& room_salt)
-        : room_salt_(room_salt)
+    SRPServer::SRPServer(const std::vector<uint8_t>& room_salt, const size_t session_pool)
+        : session_pool_(session_pool,
+                        []() { return std::make_unique<SRPSession>(); },
+                        [](SRPSession& session) {
+                            // keep the buffers' capacity for the next handshake
+                            session.user_id.clear();
+                            session.A.clear();
+                            session.b.clear();
+                            session.B.clear();
+                            session.salt.clear();
+                            session.verifier.clear();
+                            session.K.clear();
+                            session.authenticated = false;
+                        }),
+          room_salt_(room_salt)
     {
         // initialize SRP parameters
         N_ = std::make_unique<SRPUtils::BigNum>(SRP_N_HEX_2048);
@@ -25,21 +39,37 @@ namespace chat::auth
 
     bool SRPServer::register_user(const std::string& username, const UserCredentials& creds)
     {
-        // user already exists
-        if (user_exists(username)) return false;
+        // fails if the user already exists
+        std::lock_guard<std::mutex> lock(users_mutex_);
+        return users_.try_emplace(username, creds).second;
+    }
 
+    size_t SRPServer::register_users(std::vector<UserCredentials>&& batch)
+    {
         std::lock_guard<std::mutex> lock(users_mutex_);
-        users_[username] = creds;
-        return true;
+        users_.reserve(users_.size() + batch.size());
+
+        size_t added = 0;
+        for (auto& creds : batch) {
+            std::string username = creds.username;
+            added += users_.try_emplace(std::move(username), std::move(creds)).second;
+        }
+        return added;
     }
 
-    bool SRPServer::user_exists(const std::string& username)
+    size_t SRPServer::user_count()
     {
         std::lock_guard<std::mutex> lock(users_mutex_);
-        return users_.find(username) != users_.end();
+        return users_.size();
     }
 
-    void SRPServer::remove_user(const std::string& username)
+    bool SRPServer::user_exists(const std::string_view username)
+    {
+        std::lock_guard<std::mutex> lock(users_mutex_);
+        return users_.contains(username);
+    }
+
+    void SRPServer::remove_user(const std::string_view username)
     {
         std::lock_guard<std::mutex> lock(users_mutex_);
         users_.erase(username);
@@ -71,28 +101,56 @@ namespace chat::auth
                 creds.username   = username;
                 creds.salt       = SRPUtils::hex_to_bytes(salt_hex);
                 creds.verifier   = SRPUtils::hex_to_bytes(verifier_hex);
-                users_[username] = creds;
+                users_.insert_or_assign(username, std::move(creds));
             }
         }
     }
 
     void SRPServer::save_users(const std::string& filepath)
     {
-        std::ofstream file(filepath);
+        // written to a sibling file and renamed over the old one, so a crash
+        // mid-write never leaves a truncated database behind
+        const std::string tmp_path = filepath + ".tmp";
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
         if (!file.is_open())
             throw std::runtime_error("Failed to open user database for writing");
 
-        std::lock_guard<std::mutex> lock(users_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(users_mutex_);
 
-        file << "# SRP User Database\n";
-        file << "# Format: username:salt_hex:verifier_hex\n";
+            file << "# SRP User Database\n";
+            file << "# Format: username:salt_hex:verifier_hex\n";
 
-        for (const auto& [username, creds] : users_)
-        {
-            file << username << ":"
-                << SRPUtils::bytes_to_hex(creds.salt) << ":"
-                << SRPUtils::bytes_to_hex(creds.verifier) << "\n";
+            // one large write per chunk of users instead of one stream insertion per field
+            constexpr size_t kFlushThreshold = 1U << 20;
+            std::string chunk;
+            chunk.reserve(kFlushThreshold + 1024);
+
+            for (const auto& [username, creds] : users_)
+            {
+                chunk += username;
+                chunk += ':';
+                chunk += SRPUtils::bytes_to_hex(creds.salt);
+                chunk += ':';
+                chunk += SRPUtils::bytes_to_hex(creds.verifier);
+                chunk += '\n';
+
+                if (chunk.size() >= kFlushThreshold) {
+                    file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                    chunk.clear();
+                }
+            }
+            file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
         }
+
+        file.close();
+        if (!file)
+            throw std::runtime_error("Failed to write user database");
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, filepath, ec);
+        if (ec)
+            throw std::runtime_error("Failed to replace user database: " + ec.message());
     }
 
     SRPServer::ChallengeResponse SRPServer::init_authentication(
@@ -109,16 +167,16 @@ namespace chat::auth
             creds = it->second;
         }
 
-        // create SRP session
-        SRPSession session;
-        session.user_id  = generate_user_id();
-        session.A        = A;
-        session.salt     = creds.salt;
-        session.verifier = creds.verifier;
+        // create SRP session; assign() reuses the buffers of a recycled one
+        auto session     = session_pool_.acquire();
+        session->user_id = generate_user_id();
+        session->A.assign(A.begin(), A.end());
+        session->salt.assign(creds.salt.begin(), creds.salt.end());
+        session->verifier.assign(creds.verifier.begin(), creds.verifier.end());
 
         // generate random private ephemeral 'b'
-        auto b_bytes = SRPUtils::random_bytes(32); // 256-bit random
-        session.b    = b_bytes;
+        const auto b_bytes = SRPUtils::random_bytes(32); // 256-bit random
+        session->b.assign(b_bytes.begin(), b_bytes.end());
 
         // calculate v (verifier)
         SRPUtils::BigNum v(creds.verifier);
@@ -127,30 +185,31 @@ namespace chat::auth
         SRPUtils::BigNum b(b_bytes);
 
         // calculate B = kv + g^b mod N
-        auto B    = SRPUtils::calculate_B(*k_, v, *g_, b, *N_);
-        session.B = B.to_bytes();
+        const auto B = SRPUtils::calculate_B(*k_, v, *g_, b, *N_).to_bytes();
+        session->B.assign(B.begin(), B.end());
+
+        ChallengeResponse response{
+            .user_id = session->user_id,
+            .B = B,
+            .salt = creds.salt,
+            .room_salt = room_salt_
+        };
 
         // store session
-        std::string user_id = session.user_id;
         {
             std::lock_guard<std::mutex> lock(sessions_mutex_);
-            sessions_[session.user_id] = std::move(session);
+            sessions_.insert_or_assign(response.user_id, std::move(session));
         }
 
-        return ChallengeResponse{
-            .user_id = user_id,
-            .B = sessions_[user_id].B,
-            .salt = creds.salt,
-            .room_salt = room_salt_
-        };
+        return response;
     }
 
     SRPServer::VerifyResponse SRPServer::verify_authentication(
         const std::string& user_id,
         const std::vector<uint8_t>& M)
     {
-        // get session
-        SRPSession session;
+        // get session; only K and authenticated change after init, and those under the lock
+        std::shared_ptr<SRPSession> session;
         {
             std::lock_guard<std::mutex> lock(sessions_mutex_);
             auto it = sessions_.find(user_id);
@@ -160,10 +219,10 @@ namespace chat::auth
         }
 
         // convert to BigNum
-        SRPUtils::BigNum A(session.A);
-        SRPUtils::BigNum B(session.B);
-        SRPUtils::BigNum b(session.b);
-        SRPUtils::BigNum v(session.verifier);
+        SRPUtils::BigNum A(session->A);
+        SRPUtils::BigNum B(session->B);
+        SRPUtils::BigNum b(session->b);
+        SRPUtils::BigNum v(session->verifier);
 
         // calculate u = H(A, B)
         auto u = SRPUtils::calculate_u(A, B);
@@ -172,8 +231,7 @@ namespace chat::auth
         auto S = SRPUtils::calculate_S_server(A, v, u, b, *N_);
 
         // calculate K = H(S)
-        auto K    = SRPUtils::calculate_K(S);
-        session.K = K;
+        auto K = SRPUtils::calculate_K(S);
 
         // calculate expected M
         // note: We need username for M calculation, so we look it up
@@ -182,7 +240,7 @@ namespace chat::auth
             std::lock_guard<std::mutex> lock(users_mutex_);
             for (const auto& [uname, creds] : users_)
             {
-                if (creds.salt == session.salt)
+                if (creds.salt == session->salt)
                 {
                     username = uname;
                     break;
@@ -191,7 +249,7 @@ namespace chat::auth
         }
 
         auto expected_M = SRPUtils::calculate_M(
-            *N_, *g_, username, session.salt, A, B, K);
+            *N_, *g_, username, session->salt, A, B, K);
 
         // constant-time comparison
         if (M.size() != expected_M.size())
@@ -204,36 +262,30 @@ namespace chat::auth
         if (diff != 0)
             throw std::runtime_error("Authentication failed");
 
-        // authentication successful
-        session.authenticated = true;
-
         // calculate H_AMK = H(A, M, K)
         auto H_AMK = SRPUtils::calculate_H_AMK(A, M, K);
 
-        // generate Fernet-compatible session key (URL-safe base64 of 32 bytes)
-        auto session_key_bytes = SRPUtils::random_bytes(32);
-        auto session_key_b64   = SRPUtils::bytes_to_base64(session_key_bytes);
-
-        // update session
+        // authentication successful
         {
             std::lock_guard<std::mutex> lock(sessions_mutex_);
-            sessions_[user_id] = session;
+            session->K             = K;
+            session->authenticated = true;
         }
 
         return VerifyResponse{
-            .H_AMK = H_AMK,
-            .session_key = std::vector<uint8_t>(session_key_b64.begin(), session_key_b64.end())
+            .H_AMK = std::move(H_AMK),
+            .K = std::move(K)
         };
     }
 
-    bool SRPServer::is_session_valid(const std::string& user_id)
+    bool SRPServer::is_session_valid(const std::string_view user_id)
     {
         std::lock_guard<std::mutex> lock(sessions_mutex_);
         auto it = sessions_.find(user_id);
-        return it != sessions_.end() && it->second.authenticated;
+        return it != sessions_.end() && it->second->authenticated;
     }
 
-    void SRPServer::clear_session(const std::string& user_id)
+    void SRPServer::clear_session(const std::string_view user_id)
     {
         std::lock_guard<std::mutex> lock(sessions_mutex_);
         sessions_.erase(user_id);
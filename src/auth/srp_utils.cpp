@@ -6,12 +6,23 @@
 #include <openssl/evp.h>
 #include <openssl/buffer.h>
 #include <stdexcept>
-#include <sstream>
-#include <iomanip>
 #include <cstring>
+#include <memory>
 
 namespace chat::auth
 {
+    namespace
+    {
+        // one scratch context per thread instead of a BN_CTX_new/BN_CTX_free pair per calculation
+        BN_CTX* thread_ctx()
+        {
+            thread_local const std::unique_ptr<BN_CTX, decltype(&BN_CTX_free)> ctx(BN_CTX_new(), &BN_CTX_free);
+            if (!ctx)
+                throw std::runtime_error("Failed to create BN_CTX");
+            return ctx.get();
+        }
+    }
+
     // BigNum implementation
     SRPUtils::BigNum::BigNum() : bn_(BN_new())
     {
@@ -139,17 +150,12 @@ namespace chat::auth
         const BigNum& N)
     {
         // v = g^x mod N
-        BN_CTX* ctx = BN_CTX_new();
-        if (!ctx) throw std::runtime_error("Failed to create BN_CTX");
+        BN_CTX* ctx = thread_ctx();
 
         BigNum v;
         if (!BN_mod_exp(v.get(), g.get(), x.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate verifier");
-        }
 
-        BN_CTX_free(ctx);
         return v;
     }
 
@@ -161,33 +167,22 @@ namespace chat::auth
         const BigNum& N)
     {
         // B = kv + g^b mod N
-        BN_CTX* ctx = BN_CTX_new();
-        if (!ctx) throw std::runtime_error("Failed to create BN_CTX");
+        BN_CTX* ctx = thread_ctx();
 
         BigNum kv, gb, B;
 
         // kv = k * v mod N
         if (!BN_mod_mul(kv.get(), k.get(), v.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate kv");
-        }
 
         // gb = g^b mod N
         if (!BN_mod_exp(gb.get(), g.get(), b.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate g^b");
-        }
 
         // B = kv + gb mod N
         if (!BN_mod_add(B.get(), kv.get(), gb.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate B");
-        }
 
-        BN_CTX_free(ctx);
         return B;
     }
 
@@ -201,54 +196,34 @@ namespace chat::auth
         const BigNum& u)
     {
         // S = (B - kg^x)^(a + ux) mod N
-        BN_CTX* ctx = BN_CTX_new();
-        if (!ctx) throw std::runtime_error("Failed to create BN_CTX");
+        BN_CTX* ctx = thread_ctx();
 
         BigNum gx, kgx, base, ux, exp, S;
 
         // gx = g^x mod N
         if (!BN_mod_exp(gx.get(), g.get(), x.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate g^x");
-        }
 
         // kgx = k * gx mod N
         if (!BN_mod_mul(kgx.get(), k.get(), gx.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate k*g^x");
-        }
 
         // base = B - kgx mod N
         if (!BN_mod_sub(base.get(), B.get(), kgx.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate B - kg^x");
-        }
 
         // ux = u * x
         if (!BN_mul(ux.get(), u.get(), x.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate ux");
-        }
 
         // exp = a + ux
         if (!BN_add(exp.get(), a.get(), ux.get()))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate a + ux");
-        }
 
         // S = base^exp mod N
         if (!BN_mod_exp(S.get(), base.get(), exp.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate S");
-        }
 
-        BN_CTX_free(ctx);
         return S;
     }
 
@@ -260,33 +235,22 @@ namespace chat::auth
         const BigNum& N)
     {
         // S = (A * v^u)^b mod N
-        BN_CTX* ctx = BN_CTX_new();
-        if (!ctx) throw std::runtime_error("Failed to create BN_CTX");
+        BN_CTX* ctx = thread_ctx();
 
         BigNum vu, base, S;
 
         // vu = v^u mod N
         if (!BN_mod_exp(vu.get(), v.get(), u.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate v^u");
-        }
 
         // base = A * vu mod N
         if (!BN_mod_mul(base.get(), A.get(), vu.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate A * v^u");
-        }
 
         // S = base^b mod N
         if (!BN_mod_exp(S.get(), base.get(), b.get(), N.get(), ctx))
-        {
-            BN_CTX_free(ctx);
             throw std::runtime_error("Failed to calculate S");
-        }
 
-        BN_CTX_free(ctx);
         return S;
     }
 
@@ -344,23 +308,41 @@ namespace chat::auth
     }
 
     // Encoding functions
+    namespace
+    {
+        int hex_value(const char c)
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            throw std::invalid_argument("Invalid hex digit");
+        }
+    }
+
     std::string SRPUtils::bytes_to_hex(const std::vector<uint8_t>& bytes)
     {
-        std::ostringstream oss;
-        oss << std::hex << std::setfill('0');
-        for (uint8_t b : bytes)
-            oss << std::setw(2) << static_cast<int>(b);
-        return oss.str();
+        // table lookup: the user database is written with one call per salt and verifier
+        static constexpr char digits[] = "0123456789abcdef";
+
+        std::string hex(bytes.size() * 2, '\0');
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            hex[2 * i]     = digits[bytes[i] >> 4];
+            hex[2 * i + 1] = digits[bytes[i] & 0x0F];
+        }
+        return hex;
     }
 
     std::vector<uint8_t> SRPUtils::hex_to_bytes(const std::string& hex)
     {
         std::vector<uint8_t> bytes;
+        bytes.reserve((hex.length() + 1) / 2);
         for (size_t i = 0; i < hex.length(); i += 2)
         {
-            std::string byte_str = hex.substr(i, 2);
-            uint8_t byte         = static_cast<uint8_t>(std::stoi(byte_str, nullptr, 16));
-            bytes.push_back(byte);
+            // a trailing odd digit is read as a single nibble
+            const int value = i + 1 < hex.length()
+                                  ? (hex_value(hex[i]) << 4) | hex_value(hex[i + 1])
+                                  : hex_value(hex[i]);
+            bytes.push_back(static_cast<uint8_t>(value));
         }
         return bytes;
     }
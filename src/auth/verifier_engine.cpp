@@ -0,0 +1,47 @@
+#include "chat/auth/verifier_engine.hpp"
+
+#include <stdexcept>
+
+namespace chat::auth
+{
+    VerifierEngine::VerifierEngine()
+        : N_(std::string(SRP_N_HEX_2048)),
+          g_(std::string(SRP_G_HEX)),
+          ctx_(BN_CTX_new()),
+          mont_(BN_MONT_CTX_new())
+    {
+        if (!ctx_ || !mont_ || !BN_MONT_CTX_set(mont_, N_.get(), ctx_)) {
+            BN_MONT_CTX_free(mont_);
+            BN_CTX_free(ctx_);
+            throw std::runtime_error("Failed to create verifier context");
+        }
+    }
+
+    VerifierEngine::~VerifierEngine()
+    {
+        BN_MONT_CTX_free(mont_);
+        BN_CTX_free(ctx_);
+    }
+
+    UserCredentials VerifierEngine::make_credentials(const std::string& username, const std::string& password)
+    {
+        return make_credentials(username, password, SRPUtils::random_bytes(SRP_SALT_SIZE));
+    }
+
+    UserCredentials VerifierEngine::make_credentials(const std::string& username, const std::string& password,
+                                                     std::vector<uint8_t> salt)
+    {
+        // x = H(salt, H(username, ":", password)), v = g^x mod N
+        const auto x = SRPUtils::calculate_x(salt, username, password);
+
+        SRPUtils::BigNum v;
+        if (!BN_mod_exp_mont(v.get(), g_.get(), x.get(), N_.get(), ctx_, mont_))
+            throw std::runtime_error("Failed to calculate verifier");
+
+        return UserCredentials{
+            .username = username,
+            .salt = std::move(salt),
+            .verifier = v.to_bytes()
+        };
+    }
+} // namespace chat::auth
@@ -1,13 +1,18 @@
 #include "chat/client/client.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <tuple>
 #include <utility>
 #include <chrono>
+#include <future>
 
 #include "chat/crypto/aes_engine.hpp"
 #include "chat/common/messages.hpp"
 #include "chat/common/protocol.hpp"
+#include "chat/common/init_codec.hpp"
 
 namespace chat::client
 {
@@ -17,11 +22,12 @@ namespace chat::client
         constexpr size_t kRenderedMessageCount = 20;
     }
 
-    Client::Client(std::string host, const int port, std::string username)
+    Client::Client(std::string host, const int port, std::string username, ClientOptions options)
         : socket_(io_context_)
           , host_(std::move(host))
           , port_(port)
           , username_(std::move(username))
+          , options_(std::move(options))
           , running_(false)
           , connected_(false)
     {
@@ -32,19 +38,24 @@ namespace chat::client
         stop();
     }
 
+    void Client::connect()
+    {
+        // create SRP client
+        srp_client_ = std::make_unique<auth::SRPClient>(username_, &password_);
+
+        // try to authenticate, offer registration if user doesn't exist
+        srp_authenticate();
+
+        // start receive thread
+        running_        = true;
+        receive_thread_ = std::thread([this]() { receive_loop(); });
+    }
+
     void Client::run()
     {
         try
         {
-            // create SRP client
-            srp_client_ = std::make_unique<auth::SRPClient>(username_, &password_);
-
-            // try to authenticate, offer registration if user doesn't exist
-            srp_authenticate();
-
-            // start receive thread
-            running_        = true;
-            receive_thread_ = std::thread([this]() { receive_loop(); });
+            connect();
 
             // initial render
             render_ui();
@@ -69,12 +80,22 @@ namespace chat::client
 
                         render_ui();
                     }
+                    else if (line == "/away" || line == "/back")
+                    {
+                        set_away(line == "/away");
+
+                        std::lock_guard<std::mutex> lock(ui_mutex_);
+                        std::cout << (line == "/away" ? "Away: missed messages will arrive in digests\n"
+                                                      : "Back\n");
+                    }
                     else if (line == "/help")
                     {
                         std::lock_guard<std::mutex> lock(ui_mutex_);
                         std::cout << "\nCommands:\n";
                         std::cout << "  /quit, /q  - Quit the chat\n";
                         std::cout << "  /clear     - Clear message history\n";
+                        std::cout << "  /away      - Receive messages in periodic digests\n";
+                        std::cout << "  /back      - Back to real-time messages\n";
                         std::cout << "  /help      - Show this help\n\n";
                     }
                     else
@@ -126,7 +147,11 @@ namespace chat::client
 
         try
         {
-            const auto encrypted = crypto::AESEngine::encrypt_string(text, room_key_);
+            // the stream's order has to be the wire order
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            const auto encrypted = deflate_
+                                       ? sealer_->seal(deflate_->compress(text))
+                                       : sealer_->seal_string(text);
             send_packet(Protocol::encode(
                 MessageType::MESSAGE,
                 TextMsg{auth::SRPUtils::bytes_to_base64(encrypted)}
@@ -139,6 +164,43 @@ namespace chat::client
         }
     }
 
+    void Client::send_ephemeral(const EphemeralKind kind, const std::string& value)
+    {
+        if (!connected_)
+            return;
+
+        try
+        {
+            const auto encrypted = sealer_->seal_string(value);
+            send_packet(Protocol::encode(
+                MessageType::EPHEMERAL,
+                EphemeralMsg{static_cast<uint8_t>(kind), auth::SRPUtils::bytes_to_base64(encrypted)}
+            ));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error sending update: " << e.what() << std::endl;
+            connected_ = false;
+        }
+    }
+
+    void Client::set_away(const bool away)
+    {
+        // digests need Resume; without it the server would ignore the frame anyway
+        if (!connected_ || !server_features_.has(Capability::Resume))
+            return;
+
+        try
+        {
+            send_packet(Protocol::encode(MessageType::AWAY, AwayMsg{static_cast<uint8_t>(away ? 1 : 0)}));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error sending away state: " << e.what() << std::endl;
+            connected_ = false;
+        }
+    }
+
     void Client::send_packet(const std::vector<uint8_t>& packet)
     {
         ProtocolHelpers::send_packet(socket_, packet);
@@ -175,11 +237,23 @@ namespace chat::client
         std::unique_lock<std::mutex> lock;
         switch (type)
         {
-            case MessageType::INIT: {
-                auto msg = Protocol::decode<InitMsg>(payload);
-
+            case MessageType::INIT:
+            case MessageType::INIT_V2:
+            case MessageType::INIT_SEALED: {
+                // a bad tag throws like a malformed INIT: either way the join failed
+                const std::vector<uint8_t> aad(kInitAad.begin(), kInitAad.end());
+                auto msg = type == MessageType::INIT_SEALED
+                               ? InitCodec::decode(crypto::AESEngine::decrypt(payload, receive_key_, aad))
+                               : type == MessageType::INIT_V2
+                               ? InitCodec::decode(payload)
+                               : Protocol::decode<InitMsg>(payload);
+
+                // the history streamed ahead of INIT comes first
                 lock      = std::unique_lock<std::mutex>(messages_mutex_);
-                messages_ = std::move(msg.messages);
+                messages_ = std::move(pending_history_);
+                pending_history_.clear();
+                messages_.insert(messages_.end(), std::make_move_iterator(msg.messages.begin()),
+                                 std::make_move_iterator(msg.messages.end()));
                 lock.unlock();
 
                 lock   = std::unique_lock<std::mutex>(users_mutex_);
@@ -188,10 +262,28 @@ namespace chat::client
 
                 break;
             }
+            case MessageType::HISTORY: {
+                auto msg = InitCodec::decode(payload);
+
+                lock = std::unique_lock<std::mutex>(messages_mutex_);
+                pending_history_.insert(pending_history_.end(), std::make_move_iterator(msg.messages.begin()),
+                                        std::make_move_iterator(msg.messages.end()));
+                lock.unlock();
+
+                break;
+            }
             case MessageType::BROADCAST: {
                 handle_broadcast(payload);
                 break;
             }
+            case MessageType::CATCH_UP: {
+                handle_catch_up(payload);
+                break;
+            }
+            case MessageType::EPHEMERAL_BROADCAST: {
+                handle_ephemeral(payload);
+                break;
+            }
             case MessageType::USER_JOINED: {
                 auto msg = Protocol::decode<UserJoinedMsg>(payload);
 
@@ -228,6 +320,31 @@ namespace chat::client
                 connected_ = false;
                 break;
             }
+            case MessageType::SLOW_DOWN: {
+                auto msg = Protocol::decode<SlowDownMsg>(payload);
+
+                lock = std::unique_lock<std::mutex>(ui_mutex_);
+                std::cerr << "\nSlow down: " << msg.dropped << " message(s) dropped by the server's rate limit"
+                    << ", try again in " << msg.retry_after_ms << " ms" << std::endl;
+                break;
+            }
+            case MessageType::RETRY_LATER: {
+                auto msg = Protocol::decode<RetryLaterMsg>(payload);
+
+                lock = std::unique_lock<std::mutex>(ui_mutex_);
+                std::cerr << "\nServer busy: message not delivered, try again in " << msg.retry_after_ms << " ms"
+                    << std::endl;
+                std::cout << "> " << std::flush;
+                break;
+            }
+            case MessageType::MESSAGE_REJECTED: {
+                auto msg = Protocol::decode<RejectedMsg>(payload);
+
+                lock = std::unique_lock<std::mutex>(ui_mutex_);
+                std::cerr << "\nMessage not delivered: " << msg.reason << std::endl;
+                std::cout << "> " << std::flush;
+                break;
+            }
             default: {
                 lock = std::unique_lock<std::mutex>(ui_mutex_);
                 std::cerr << "Unknown message type" << std::endl;
@@ -239,19 +356,33 @@ namespace chat::client
     void Client::handle_broadcast(const std::vector<uint8_t>& payload)
     {
         auto [username, encrypted_text_b64, timestamp_ms] = Protocol::decode<BroadcastMsg>(payload);
-        std::string text;
-        try
-        {
-            const auto encrypted = auth::SRPUtils::base64_to_bytes(encrypted_text_b64);
-            text                 = crypto::AESEngine::decrypt_string(encrypted, room_key_);
-        }
-        catch (const std::exception& e)
+        const auto encrypted = auth::SRPUtils::base64_to_bytes(encrypted_text_b64);
+        auto decrypted       = [&]() -> Result<std::string> {
+            if (!inflate_)
+                return crypto::AESEngine::try_decrypt_string(encrypted, receive_key_);
+            const auto body = crypto::AESEngine::try_decrypt(encrypted, receive_key_);
+            if (!body)
+                return body.error();
+            return inflate_->decompress(*body, ProtocolHelpers::kMaxPayloadSize);
+        }();
+        if (!decrypted)
         {
             std::lock_guard<std::mutex> lock(ui_mutex_);
-            std::cerr << "\nFailed to decrypt message from " << username << ": " << e.what() << std::endl;
+            std::cerr << "\nFailed to decrypt message from " << username << ": " << to_string(decrypted.error()) << std::endl;
             std::cout << "> " << std::flush;
+
+            // a compressed stream cannot resync past a bad frame
+            if (decrypted.error() == Errc::decompression_failed)
+                connected_ = false;
             return;
         }
+        const std::string text = std::move(*decrypted);
+
+        {
+            // a message ends the sender's typing state
+            std::lock_guard<std::mutex> lock(users_mutex_);
+            typing_users_.erase(username);
+        }
 
         auto timestamp = std::chrono::system_clock::time_point(
             std::chrono::milliseconds(timestamp_ms));
@@ -281,22 +412,109 @@ namespace chat::client
         }
     }
 
+    void Client::connect_socket()
+    {
+        boost::asio::ip::tcp::resolver resolver(io_context_);
+        const auto endpoints = resolver.resolve(host_, std::to_string(port_));
+
+        // connect by hand rather than via asio::connect so TCP_FASTOPEN_CONNECT can be set in between
+        boost::system::error_code ec = boost::asio::error::host_not_found;
+        for (const auto& entry : endpoints)
+        {
+            boost::system::error_code ignored;
+            socket_.close(ignored);
+
+            socket_.open(entry.endpoint().protocol(), ec);
+            if (ec)
+                continue;
+            if (options_.tcp_fastopen)
+                SocketHelpers::enable_fastopen_connect(socket_);
+
+            socket_.connect(entry.endpoint(), ec);
+            if (!ec)
+                break;
+        }
+        if (ec)
+            throw boost::system::system_error(ec, "connect");
+
+        SocketHelpers::apply_tuning(socket_, options_.socket_tuning);
+    }
+
+    void Client::read_password()
+    {
+        if (options_.password_source)
+        {
+            password_ = options_.password_source();
+            return;
+        }
+
+        std::unique_lock<std::mutex> ui_lock(ui_mutex_);
+        std::cout << "Password for " << username_ << ": " << std::flush;
+        ui_lock.unlock();
+        std::getline(std::cin, password_);
+    }
+
     void Client::srp_authenticate()
     {
         std::unique_lock<std::mutex> ui_lock(ui_mutex_);
         std::cout << "Connecting to " << host_ << ":" << port_ << "..." << std::endl;
         ui_lock.unlock();
 
-        boost::asio::ip::tcp::resolver resolver(io_context_);
-        auto endpoints = resolver.resolve(host_, std::to_string(port_));
-        boost::asio::connect(socket_, endpoints);
+        // steps 0-2 need neither the password nor each other's results until SRP_INIT is sent:
+        // A = g^a mod N is computed while resolving/connecting, and the whole exchange up to the
+        // first server reply runs while the user types. Deferred launches give the old serial order.
+        const auto policy = options_.pipelined_setup ? std::launch::async : std::launch::deferred;
 
-        // step 1: generate A and send SRP_INIT
-        auto A = srp_client_->generate_A();
-        send_packet(Protocol::encode(MessageType::SRP_INIT, SrpInitMsg{username_, auth::SRPUtils::bytes_to_base64(A)}));
+        auto A_future     = std::async(policy, [this]() { return srp_client_->generate_A(); });
+        auto first_reply = std::async(policy, [this, &A_future]() {
+            connect_socket();
 
-        // step 2: receive response (could be SRP_CHALLENGE, SRP_USER_NOT_FOUND, or ERROR_MSG)
-        auto [type, payload] = receive_packet();
+            // step 1: send SRP_INIT (with TCP Fast Open this write goes out in the SYN), preceded
+            // by HELLO and the compression offer so negotiating costs no round trip
+            const auto A = A_future.get();
+            if (options_.hello)
+            {
+                // every encoding this client decodes; GroupKey is not implemented
+                uint32_t capabilities = Capability::BinaryFields | Capability::Batching | Capability::Resume;
+                if (options_.compression)
+                    capabilities = capabilities | Capability::Compression;
+                send_packet(Protocol::encode(MessageType::HELLO, HelloMsg{kProtocolVersion, capabilities}));
+            }
+            if (options_.compression)
+                send_packet(Protocol::encode(MessageType::COMPRESS_OFFER, CompressionMsg{
+                                                 static_cast<uint8_t>(Compression::Deflate),
+                                                 dictionary_id(chat_dictionary())
+                                             }));
+            send_packet(Protocol::encode(MessageType::SRP_INIT, SrpInitMsg{username_, auth::SRPUtils::bytes_to_base64(A)}));
+
+            // step 2: receive response (could be SRP_CHALLENGE, SRP_USER_NOT_FOUND, or ERROR_MSG)
+            auto reply = receive_packet();
+            if (reply.first == MessageType::HELLO_ACK)
+            {
+                const auto ack   = Protocol::decode<HelloMsg>(reply.second);
+                server_features_ = PeerFeatures{ack.version, ack.capabilities};
+                reply            = receive_packet();
+            }
+            if (reply.first == MessageType::COMPRESS_ACK)
+            {
+                const auto ack = Protocol::decode<CompressionMsg>(reply.second);
+                if (ack.algorithm == static_cast<uint8_t>(Compression::Deflate))
+                {
+                    deflate_ = std::make_unique<DeflateStream>();
+                    inflate_ = std::make_unique<InflateStream>();
+                }
+                reply = receive_packet();
+            }
+            return reply;
+        });
+
+        if (options_.pipelined_setup)
+            read_password();
+
+        auto [type, payload] = first_reply.get();
+
+        if (!options_.pipelined_setup && type == MessageType::SRP_CHALLENGE)
+            read_password();
 
         if (type == MessageType::SRP_USER_NOT_FOUND)
         {
@@ -334,6 +552,13 @@ namespace chat::client
             throw std::runtime_error("Authentication error: " + msg.error_msg);
         }
 
+        if (type == MessageType::RETRY_LATER)
+        {
+            auto msg = Protocol::decode<RetryLaterMsg>(payload);
+            throw std::runtime_error("Server is overloaded, try again in " + std::to_string(msg.retry_after_ms) +
+                                     " ms");
+        }
+
         if (type != MessageType::SRP_CHALLENGE)
             throw std::runtime_error(
                 "Expected SRP_CHALLENGE, got message type " + std::to_string(static_cast<int>(type)));
@@ -342,8 +567,6 @@ namespace chat::client
         ui_lock.lock();
         std::cout << "Authenticating..." << std::endl;
         ui_lock.unlock();
-        std::cout << "Enter password: ";
-        std::getline(std::cin, password_);
 
         auto srpChallengeMsg = Protocol::decode<SrpChallengeMsg>(payload);
         user_id_             = srpChallengeMsg.user_id;
@@ -380,14 +603,16 @@ namespace chat::client
         }
 
         (void)room_salt;
-        auto session_key_b64 = auth::SRPUtils::base64_to_bytes(srpSuccessMsg.session_key_b64);
-        room_key_            = auth::SRPUtils::base64_to_bytes(
-            std::string(session_key_b64.begin(), session_key_b64.end()));
-        if (room_key_.size() != crypto::AESEngine::KEY_SIZE)
-            throw std::runtime_error("Invalid AES room key size");
+        auto keys = crypto::derive_session_keys(srp_client_->get_session_key());
+        sealer_.emplace(std::move(keys.client_to_server));
+        receive_key_ = std::move(keys.server_to_client.key);
 
-        // step 5: receive INIT to get messages and users
+        // step 5: receive already-seen history, then INIT with the rest of the messages and the users
         auto [init_type, init_payload] = receive_packet();
+        while (init_type == MessageType::HISTORY) {
+            handle_packet(init_type, init_payload);
+            std::tie(init_type, init_payload) = receive_packet();
+        }
 
         if (init_type == MessageType::ERROR_MSG)
         {
@@ -395,7 +620,8 @@ namespace chat::client
             throw std::runtime_error("Init error: " + msg.error_msg);
         }
 
-        if (init_type != MessageType::INIT)
+        if (init_type != MessageType::INIT && init_type != MessageType::INIT_V2 &&
+            init_type != MessageType::INIT_SEALED)
             throw std::runtime_error("Expected INIT");
 
         handle_packet(init_type, init_payload);
@@ -413,11 +639,20 @@ namespace chat::client
         std::cout << "Registering new user '" << username_ << "'..." << std::endl;
         ui_lock.unlock();
 
-        // get password confirmation
-        ui_lock.lock();
-        std::cout << "Enter password: ";
-        ui_lock.unlock();
-        std::getline(std::cin, password_);
+        // get password confirmation; the pipelined path already asked for it once
+        if (password_.empty())
+            read_password();
+        else if (!options_.password_source)
+        {
+            ui_lock.lock();
+            std::cout << "Confirm password: " << std::flush;
+            ui_lock.unlock();
+
+            std::string confirmation;
+            std::getline(std::cin, confirmation);
+            if (confirmation != password_)
+                throw std::runtime_error("Passwords do not match");
+        }
 
         // generate credentials
         auto creds = auth::SRPClient::register_user(username_, password_);
@@ -450,6 +685,68 @@ namespace chat::client
         ui_lock.unlock();
     }
 
+    void Client::handle_ephemeral(const std::vector<uint8_t>& payload)
+    {
+        // volatile updates are best effort: anything undecodable is dropped quietly
+        const auto msg = Protocol::try_decode<EphemeralBroadcastMsg>(payload);
+        if (!msg)
+            return;
+        const auto value = crypto::AESEngine::try_decrypt_string(
+            auth::SRPUtils::base64_to_bytes(msg->ciphertext_b64), receive_key_);
+        if (!value || static_cast<EphemeralKind>(msg->kind) != EphemeralKind::Typing)
+            return;
+
+        bool started = false;
+        {
+            std::lock_guard<std::mutex> lock(users_mutex_);
+            if (*value == "1")
+                started = typing_users_.insert(msg->username).second;
+            else
+                typing_users_.erase(msg->username);
+        }
+
+        if (started)
+        {
+            std::lock_guard<std::mutex> lock(ui_mutex_);
+            std::cout << "\r" << std::string(80, ' ') << "\r";
+            std::cout << "\033[90m" << msg->username << " is typing...\033[0m" << std::endl;
+            std::cout << "> " << std::flush;
+        }
+    }
+
+    void Client::handle_catch_up(const std::vector<uint8_t>& payload)
+    {
+        const std::vector<uint8_t> aad(kCatchUpAad.begin(), kCatchUpAad.end());
+        const auto plaintext = crypto::AESEngine::try_decrypt(payload, receive_key_, aad);
+        auto history         = plaintext ? InitCodec::try_decode(*plaintext) : Result<InitMsg>(plaintext.error());
+        if (!history)
+        {
+            std::lock_guard<std::mutex> lock(ui_mutex_);
+            std::cerr << "\nFailed to read missed messages: " << to_string(history.error()) << std::endl;
+            std::cout << "> " << std::flush;
+            return;
+        }
+
+        const size_t missed = history->messages.size();
+        {
+            // live broadcasts may already have overtaken the catch-up frames
+            std::lock_guard<std::mutex> lock(messages_mutex_);
+            messages_.insert(messages_.end(), std::make_move_iterator(history->messages.begin()),
+                             std::make_move_iterator(history->messages.end()));
+            std::ranges::stable_sort(messages_, {}, &Message::timestamp);
+
+            if (messages_.size() > kMaxStoredMessages)
+                messages_.erase(messages_.begin(),
+                                messages_.end() - static_cast<std::ptrdiff_t>(kMaxStoredMessages));
+        }
+
+        render_ui();
+
+        std::lock_guard<std::mutex> lock(ui_mutex_);
+        std::cout << "\033[33m*** " << missed << " message(s) while you were away ***\033[0m" << std::endl;
+        std::cout << "> " << std::flush;
+    }
+
     void Client::render_ui()
     {
         std::unique_lock<std::mutex> ui_lock(ui_mutex_);
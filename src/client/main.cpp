@@ -1,13 +1,17 @@
 #include "chat/client/client.hpp"
 #include <iostream>
+#include <string>
 #include <cstdlib>
 
 int main(int argc, char* argv[]) {
-    if (argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " <host> <port> <username>" << std::endl;
+    const auto usage = [&]() {
+        std::cerr << "Usage: " << argv[0] << " <host> <port> <username> [--busy-poll <us>] [--no-compression] [--no-hello]"
+            << std::endl;
         std::cerr << "Example: " << argv[0] << " localhost 8888 alice" << std::endl;
         return EXIT_FAILURE;
-    }
+    };
+    if (argc < 4)
+        return usage();
 
     try {
         std::string host = argv[1];
@@ -24,7 +28,25 @@ int main(int argc, char* argv[]) {
             return EXIT_FAILURE;
         }
 
-        chat::client::Client client(host, port, username);
+        chat::client::ClientOptions options;
+        for (int i = 4; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--busy-poll" && i + 1 < argc) {
+                options.socket_tuning.busy_poll_us     = std::stoi(argv[++i]);
+                options.socket_tuning.prefer_busy_poll = options.socket_tuning.busy_poll_us > 0;
+            }
+            else if (arg == "--no-compression") {
+                options.compression = false;
+            }
+            else if (arg == "--no-hello") {
+                options.hello = false;
+            }
+            else {
+                return usage();
+            }
+        }
+
+        chat::client::Client client(host, port, username, options);
         client.run();
 
         return EXIT_SUCCESS;
@@ -19,31 +19,113 @@ namespace chat
         std::memcpy(data.data() + old_size, bytes.data(), bytes.size());
     }
 
+    void BufferWriter::write_bytes(const std::span<const uint8_t> bytes)
+    {
+        data.insert(data.end(), bytes.begin(), bytes.end());
+    }
+
+    void BufferWriter::write_varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            data.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back(static_cast<uint8_t>(value));
+    }
+
 
     // BufferReader
+    BufferReader::BufferReader(const std::span<const uint8_t> d)
+        : data(d)
+    {
+    }
+
     BufferReader::BufferReader(const std::vector<uint8_t>& d)
         : data(d)
     {
     }
 
-    std::string BufferReader::read_string()
+    Result<std::string_view> BufferReader::try_read_string_view()
     {
-        const auto length = read<uint32_t>();
+        const size_t start = pos;
+        const auto length  = try_read<uint32_t>();
+        if (!length)
+            return length.error();
 
-        if (pos + length > data.size())
-            throw std::runtime_error("Buffer underflow");
+        if (remaining() < *length) {
+            pos = start;
+            return Errc::buffer_underflow;
+        }
 
-        std::string str(reinterpret_cast<const char*>(data.data() + pos), length);
-        pos += length;
+        const std::string_view str(reinterpret_cast<const char*>(data.data() + pos), *length);
+        pos += *length;
         return str;
     }
 
-    void BufferReader::read_bytes(uint8_t* dest, const size_t count)
+    Result<std::string> BufferReader::try_read_string()
     {
-        if (pos + count > data.size())
-            throw std::runtime_error("Buffer underflow");
+        const auto view = try_read_string_view();
+        if (!view)
+            return view.error();
+        return std::string(*view);
+    }
+
+    Result<std::span<const uint8_t>> BufferReader::try_read_span(const size_t count)
+    {
+        if (remaining() < count)
+            return Errc::buffer_underflow;
+
+        const auto span = data.subspan(pos, count);
+        pos += count;
+        return span;
+    }
+
+    Result<uint64_t> BufferReader::try_read_varint()
+    {
+        uint64_t value = 0;
+        for (size_t i = 0, shift = 0; i < 10; ++i, shift += 7) {
+            if (pos + i >= data.size())
+                return Errc::buffer_underflow;
+
+            const uint8_t byte = data[pos + i];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                // the tenth byte may only carry the top bit of a 64-bit value
+                if (i == 9 && byte > 1)
+                    return Errc::invalid_encoding;
+                pos += i + 1;
+                return value;
+            }
+        }
+        return Errc::invalid_encoding;
+    }
+
+    Result<int64_t> BufferReader::try_read_zigzag()
+    {
+        const auto value = try_read_varint();
+        if (!value)
+            return value.error();
+        return zigzag_decode(*value);
+    }
+
+    bool BufferReader::try_read_bytes(uint8_t* dest, const size_t count)
+    {
+        if (remaining() < count)
+            return false;
 
         std::memcpy(dest, data.data() + pos, count);
         pos += count;
+        return true;
+    }
+
+    std::string BufferReader::read_string()
+    {
+        return try_read_string().value();
+    }
+
+    void BufferReader::read_bytes(uint8_t* dest, const size_t count)
+    {
+        if (!try_read_bytes(dest, count))
+            throw std::runtime_error(to_string(Errc::buffer_underflow));
     }
 } // namespace chat
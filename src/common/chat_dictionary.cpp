@@ -0,0 +1,47 @@
+#include "chat/common/compression.hpp"
+
+namespace chat
+{
+    namespace
+    {
+        // Common English chat words and phrasing, assembled by hand; train_dictionary() over
+        // anonymized room logs (names, links and numbers stripped) produces a replacement in the
+        // same layout. Peers only agree on its Adler-32, so any edit is a new dictionary and
+        // connections stay uncompressed until both ends ship it. Ordered least to most
+        // valuable, as deflate prefers.
+        constexpr char kDictionary[] =
+            "unfortunately apparently definitely probably basically actually especially "
+            "documentation deployment production staging release branch commit merge request "
+            "pull request review approved changes tests passing failing build broken fixed "
+            "issue ticket bug error crash logs server client database config update version "
+            "meeting calendar schedule tomorrow morning afternoon tonight weekend monday friday "
+            "minutes hours later earlier today yesterday last week next week this week "
+            "happy birthday congratulations welcome back good morning good night have a good "
+            "let me check let me know as soon as possible in a few minutes on my way "
+            "sounds good to me makes sense no worries no problem not sure i think so "
+            "i don't know i'm not sure what do you think does anyone know has anyone "
+            "can you help can someone take a look could you please would you mind "
+            "did you see did you get do you want do you have are you there are you still "
+            "is it possible is there any is that ok is everything ok what's up how's it going "
+            "how are you i'm good thanks for the thank you so much thanks a lot "
+            "haha lol lmao omg btw imo tbh idk brb afk ttyl np ty thx pls plz "
+            "yeah yes yep nope no ok okay sure cool nice great awesome perfect "
+            "i was going to i'm going to we need to you need to i need to we should "
+            "just wanted to let you know just a heads up for what it's worth "
+            "the same thing at the same time at the moment right now for now "
+            "one of the some of the all of the most of the a lot of the "
+            "in the on the at the to the for the with the from the of the and the "
+            "that is it is this is there is i have i am i will i can i would "
+            "you are you can you have we are we can they are it was that was "
+            "and the but the or the so the if you if we if it when you when we "
+            "what is what are where is who is why is how do how is "
+            "that's it's i'm don't can't won't didn't doesn't isn't there's let's "
+            "the and to of a in is it you that for on i this with be have are "
+            "not but was at we so can just do if my me your what all about ";
+    }
+
+    std::span<const uint8_t> chat_dictionary()
+    {
+        return {reinterpret_cast<const uint8_t*>(kDictionary), sizeof(kDictionary) - 1};
+    }
+} // namespace chat
@@ -0,0 +1,176 @@
+#include "chat/common/compression.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <zlib.h>
+
+namespace chat
+{
+    namespace
+    {
+        // 8 KiB window and memLevel 5: ~48 KiB per deflate stream instead of zlib's ~256 KiB
+        constexpr int kWindowBits = 13;
+        constexpr int kMemLevel   = 5;
+
+        // what a sync flush ends with; left off the wire and restored before inflating
+        constexpr uint8_t kFlushMarker[] = {0x00, 0x00, 0xff, 0xff};
+
+        constexpr size_t kMaxPhraseWords = 3;
+    }
+
+    uint32_t dictionary_id(const std::span<const uint8_t> dictionary)
+    {
+        return static_cast<uint32_t>(adler32(adler32(0L, Z_NULL, 0), dictionary.data(),
+                                             static_cast<uInt>(dictionary.size())));
+    }
+
+    std::string train_dictionary(const std::vector<std::string>& samples, const size_t max_size)
+    {
+        std::unordered_map<std::string, size_t> counts;
+        for (const auto& sample : samples) {
+            std::vector<std::string> words;
+            std::istringstream in(sample);
+            for (std::string word; in >> word;)
+                words.push_back(std::move(word));
+
+            // phrases keep a trailing space, as they appear in running text
+            for (size_t i = 0; i < words.size(); ++i) {
+                std::string phrase;
+                for (size_t n = 0; n < kMaxPhraseWords && i + n < words.size(); ++n) {
+                    phrase += words[i + n];
+                    phrase += ' ';
+                    ++counts[phrase];
+                }
+            }
+        }
+
+        struct Candidate
+        {
+            const std::string* phrase;
+            size_t score;
+        };
+        std::vector<Candidate> candidates;
+        for (const auto& [phrase, count] : counts) {
+            if (count >= 2)
+                candidates.push_back({&phrase, count * phrase.size()});
+        }
+        std::ranges::sort(candidates, [](const Candidate& a, const Candidate& b) {
+            return a.score != b.score ? a.score > b.score : *a.phrase < *b.phrase;
+        });
+
+        size_t size = 0, taken = 0;
+        while (taken < candidates.size() && size + candidates[taken].phrase->size() <= max_size)
+            size += candidates[taken++].phrase->size();
+
+        // best last: deflate finds the closest match first and short distances cost fewer bits
+        std::string dictionary;
+        dictionary.reserve(size);
+        for (size_t i = taken; i-- > 0;)
+            dictionary += *candidates[i].phrase;
+        return dictionary;
+    }
+
+    DeflateStream::DeflateStream(const std::span<const uint8_t> dictionary, const int level)
+        : stream_(std::make_unique<z_stream>())
+    {
+        if (deflateInit2(stream_.get(), level, Z_DEFLATED, -kWindowBits, kMemLevel, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("Failed to initialize deflate stream");
+
+        // a raw stream takes the dictionary up front; the peer loads the same one
+        if (!dictionary.empty())
+            deflateSetDictionary(stream_.get(), dictionary.data(), static_cast<uInt>(dictionary.size()));
+    }
+
+    DeflateStream::~DeflateStream()
+    {
+        deflateEnd(stream_.get());
+    }
+
+    std::vector<uint8_t> DeflateStream::compress(const std::string_view text)
+    {
+        // a flush with nothing new to flush emits no marker to strip, so empty text skips the stream
+        if (text.empty())
+            return {};
+
+        std::vector<uint8_t> out(deflateBound(stream_.get(), static_cast<uLong>(text.size())) + sizeof(kFlushMarker));
+
+        stream_->next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+        stream_->avail_in = static_cast<uInt>(text.size());
+        size_t produced   = 0;
+        while (true) {
+            stream_->next_out  = out.data() + produced;
+            stream_->avail_out = static_cast<uInt>(out.size() - produced);
+            deflate(stream_.get(), Z_SYNC_FLUSH);
+            produced = out.size() - stream_->avail_out;
+
+            // a full buffer may hide more pending output
+            if (stream_->avail_out != 0)
+                break;
+            out.resize(out.size() * 2);
+        }
+
+        out.resize(produced);
+        if (out.size() >= sizeof(kFlushMarker) &&
+            std::equal(std::begin(kFlushMarker), std::end(kFlushMarker), out.end() - sizeof(kFlushMarker)))
+            out.resize(out.size() - sizeof(kFlushMarker));
+        return out;
+    }
+
+    InflateStream::InflateStream(const std::span<const uint8_t> dictionary)
+        : stream_(std::make_unique<z_stream>())
+    {
+        if (inflateInit2(stream_.get(), -kWindowBits) != Z_OK)
+            throw std::runtime_error("Failed to initialize inflate stream");
+        if (!dictionary.empty())
+            inflateSetDictionary(stream_.get(), dictionary.data(), static_cast<uInt>(dictionary.size()));
+    }
+
+    InflateStream::~InflateStream()
+    {
+        inflateEnd(stream_.get());
+    }
+
+    Result<std::string> InflateStream::decompress(const std::span<const uint8_t> data, const size_t max_size)
+    {
+        if (failed_)
+            return Errc::decompression_failed;
+        if (data.empty())
+            return std::string();
+
+        std::string out;
+        const auto feed = [&](const std::span<const uint8_t> in) -> std::optional<Errc> {
+            stream_->next_in  = const_cast<Bytef*>(in.data());
+            stream_->avail_in = static_cast<uInt>(in.size());
+            while (true) {
+                const size_t before = out.size();
+                out.resize(before + std::max<size_t>(in.size() * 4, 256));
+                stream_->next_out  = reinterpret_cast<Bytef*>(out.data() + before);
+                stream_->avail_out = static_cast<uInt>(out.size() - before);
+
+                const int ret = inflate(stream_.get(), Z_SYNC_FLUSH);
+                const bool filled = stream_->avail_out == 0;
+                out.resize(out.size() - stream_->avail_out);
+
+                // Z_BUF_ERROR only means no progress was possible, which is fine once the input is used up
+                if (ret != Z_OK && !(ret == Z_BUF_ERROR && stream_->avail_in == 0))
+                    return Errc::decompression_failed;
+                if (out.size() > max_size)
+                    return Errc::payload_too_large;
+                if (stream_->avail_in == 0 && !filled)
+                    return std::nullopt;
+            }
+        };
+
+        auto error = feed(data);
+        if (!error)
+            error = feed(kFlushMarker);
+        if (error) {
+            failed_ = true;
+            return *error;
+        }
+        return out;
+    }
+} // namespace chat
@@ -0,0 +1,312 @@
+#include "chat/common/init_codec.hpp"
+
+#include <chrono>
+#include <string_view>
+
+#include "chat/common/buffer.hpp"
+#include "chat/common/flat_hash_map.hpp"
+
+namespace chat
+{
+    namespace
+    {
+        // keeps the conversion to system_clock's (nanosecond) duration from overflowing
+        constexpr int64_t kMaxMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::duration::max()).count();
+
+        int64_t to_millis(const std::chrono::system_clock::time_point tp)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+        }
+
+        std::span<const uint8_t> as_bytes(const std::string_view s)
+        {
+            return {reinterpret_cast<const uint8_t*>(s.data()), s.size()};
+        }
+
+        std::string_view as_string_view(const std::span<const uint8_t> bytes)
+        {
+            return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+        }
+
+        // a column never holds more entries than there are bytes left, as each takes at least one
+        Result<uint32_t> read_count(BufferReader& r, const uint32_t limit)
+        {
+            const auto count = r.try_read_varint();
+            if (!count)
+                return count.error();
+            if (*count > limit)
+                return Errc::limit_exceeded;
+            if (*count > r.remaining())
+                return Errc::buffer_underflow;
+            return static_cast<uint32_t>(*count);
+        }
+
+        // lengths column followed by the blob it slices; the views point into the payload
+        Result<std::vector<std::string_view>> read_blob_column(BufferReader& r, DecodeBudget& budget,
+                                                               const uint32_t count)
+        {
+            if (!budget.charge(static_cast<size_t>(count) * (sizeof(std::string_view) + sizeof(size_t))))
+                return Errc::budget_exceeded;
+
+            std::vector<std::string_view> views(count);
+            std::vector<size_t> lengths(count);
+
+            uint64_t total = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                const auto length = r.try_read_varint();
+                if (!length)
+                    return length.error();
+
+                total += *length;
+                if (*length > r.remaining() || total > r.remaining())
+                    return Errc::buffer_underflow;
+                lengths[i] = static_cast<size_t>(*length);
+            }
+
+            const auto blob = r.try_read_span(static_cast<size_t>(total));
+            if (!blob)
+                return blob.error();
+
+            size_t offset = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                views[i] = as_string_view(blob->subspan(offset, lengths[i]));
+                offset += lengths[i];
+            }
+            return views;
+        }
+
+        Result<std::string> copy_string(const std::string_view view, DecodeBudget& budget)
+        {
+            if (!budget.charge(view.size()))
+                return Errc::budget_exceeded;
+            return std::string(view);
+        }
+
+        // appends the payload to w, after whatever w already holds
+        void write_payload(BufferWriter& w, const std::vector<Message>& messages, const std::vector<User>& users)
+        {
+            // username dictionary shared by the user list and the history
+            FlatHashMap<std::string_view, uint32_t, StringHash> index;
+            std::vector<std::string_view> dict;
+            index.reserve(users.size() + messages.size());
+
+            const auto intern = [&](const std::string_view name) {
+                const auto [it, inserted] = index.try_emplace(name, static_cast<uint32_t>(dict.size()));
+                if (inserted)
+                    dict.push_back(name);
+                return it->second;
+            };
+
+            std::vector<uint32_t> user_refs;
+            user_refs.reserve(users.size());
+            for (const auto& user : users)
+                user_refs.push_back(intern(user.username));
+
+            std::vector<uint32_t> message_refs;
+            message_refs.reserve(messages.size());
+            for (const auto& message : messages)
+                message_refs.push_back(intern(message.username));
+
+            // size the buffer once: blobs plus a generous bound on the varint columns
+            size_t blob_bytes = 0;
+            for (const auto name : dict)
+                blob_bytes += name.size();
+            for (const auto& user : users)
+                blob_bytes += user.user_id.size();
+            for (const auto& message : messages)
+                blob_bytes += message.text.size();
+
+            w.data.reserve(w.data.size() + blob_bytes + 8 * dict.size() + 8 * users.size() + 24 * messages.size() + 32);
+
+            w.write_varint(dict.size());
+            for (const auto name : dict) {
+                w.write_varint(name.size());
+                w.write_bytes(as_bytes(name));
+            }
+
+            w.write_varint(users.size());
+            for (const auto ref : user_refs)
+                w.write_varint(ref);
+            for (const auto& user : users)
+                w.write_varint(user.user_id.size());
+            for (const auto& user : users)
+                w.write_bytes(as_bytes(user.user_id));
+
+            w.write_varint(messages.size());
+            for (const auto ref : message_refs)
+                w.write_varint(ref);
+
+            // deltas wrap on unsigned overflow, so out-of-order sequence numbers still round-trip
+            uint64_t prev_seq = 0;
+            for (const auto& message : messages) {
+                w.write_varint(message.seq - prev_seq);
+                prev_seq = message.seq;
+            }
+
+            int64_t prev_ms = 0;
+            for (const auto& message : messages) {
+                const int64_t ms = to_millis(message.timestamp);
+                w.write_zigzag(ms - prev_ms);
+                prev_ms = ms;
+            }
+
+            for (const auto& message : messages)
+                w.write_varint(message.text.size());
+            for (const auto& message : messages)
+                w.write_bytes(as_bytes(message.text));
+        }
+    }
+
+    std::vector<uint8_t> InitCodec::encode(const std::vector<Message>& messages, const std::vector<User>& users)
+    {
+        BufferWriter w;
+        w.data.resize(sizeof(MsgHeader)); // patched once the payload size is known
+        write_payload(w, messages, users);
+
+        const MsgHeader header{
+            .type = static_cast<uint16_t>(MessageType::INIT_V2),
+            .size = static_cast<uint32_t>(w.data.size() - sizeof(MsgHeader))
+        };
+        std::memcpy(w.data.data(), &header, sizeof(MsgHeader));
+
+        return std::move(w.data);
+    }
+
+    std::vector<uint8_t> InitCodec::encode(const PeerFeatures& peer, const std::vector<Message>& messages,
+                                           const std::vector<User>& users)
+    {
+        if (peer.has(Capability::BinaryFields))
+            return encode(messages, users);
+        return Protocol::encode(MessageType::INIT, InitMsg{messages, users});
+    }
+
+    std::vector<uint8_t> InitCodec::encode_payload(const std::vector<Message>& messages, const std::vector<User>& users)
+    {
+        BufferWriter w;
+        write_payload(w, messages, users);
+        return std::move(w.data);
+    }
+
+    Result<InitMsg> InitCodec::try_decode(const std::span<const uint8_t> payload, DecodeBudget& budget)
+    {
+        BufferReader r(payload);
+        InitMsg msg;
+
+        // dictionary: views into the payload, copied only when assigned to an entry
+        const auto dict_count = read_count(r, User::kMaxDecodeCount + Message::kMaxDecodeCount);
+        if (!dict_count)
+            return dict_count.error();
+        if (!budget.charge(static_cast<size_t>(*dict_count) * sizeof(std::string_view)))
+            return Errc::budget_exceeded;
+
+        std::vector<std::string_view> dict(*dict_count);
+        for (auto& name : dict) {
+            const auto length = r.try_read_varint();
+            if (!length)
+                return length.error();
+            if (*length > r.remaining())
+                return Errc::buffer_underflow;
+
+            name = as_string_view(*r.try_read_span(static_cast<size_t>(*length)));
+        }
+
+        const auto lookup = [&](BufferReader& reader) -> Result<std::string_view> {
+            const auto ref = reader.try_read_varint();
+            if (!ref)
+                return ref.error();
+            if (*ref >= dict.size())
+                return Errc::invalid_encoding;
+            return dict[static_cast<size_t>(*ref)];
+        };
+
+        // users
+        const auto user_count = read_count(r, User::kMaxDecodeCount);
+        if (!user_count)
+            return user_count.error();
+        if (!budget.charge(static_cast<size_t>(*user_count) * sizeof(User)))
+            return Errc::budget_exceeded;
+
+        msg.users.resize(*user_count);
+        for (auto& user : msg.users) {
+            const auto name = lookup(r);
+            if (!name)
+                return name.error();
+            auto username = copy_string(*name, budget);
+            if (!username)
+                return username.error();
+            user.username = std::move(*username);
+        }
+
+        const auto user_ids = read_blob_column(r, budget, *user_count);
+        if (!user_ids)
+            return user_ids.error();
+        for (uint32_t i = 0; i < *user_count; ++i) {
+            auto user_id = copy_string((*user_ids)[i], budget);
+            if (!user_id)
+                return user_id.error();
+            msg.users[i].user_id = std::move(*user_id);
+        }
+
+        // history, one linear pass per column
+        const auto message_count = read_count(r, Message::kMaxDecodeCount);
+        if (!message_count)
+            return message_count.error();
+        if (!budget.charge(static_cast<size_t>(*message_count) * sizeof(Message)))
+            return Errc::budget_exceeded;
+
+        msg.messages.resize(*message_count);
+        for (auto& message : msg.messages) {
+            const auto name = lookup(r);
+            if (!name)
+                return name.error();
+            auto username = copy_string(*name, budget);
+            if (!username)
+                return username.error();
+            message.username = std::move(*username);
+        }
+
+        uint64_t seq = 0;
+        for (auto& message : msg.messages) {
+            const auto delta = r.try_read_varint();
+            if (!delta)
+                return delta.error();
+            seq += *delta;
+            message.seq = seq;
+        }
+
+        int64_t ms = 0;
+        for (auto& message : msg.messages) {
+            const auto delta = r.try_read_zigzag();
+            if (!delta)
+                return delta.error();
+            ms = static_cast<int64_t>(static_cast<uint64_t>(ms) + static_cast<uint64_t>(*delta));
+            if (ms > kMaxMillis || ms < -kMaxMillis)
+                return Errc::invalid_encoding;
+            message.timestamp = std::chrono::system_clock::time_point(std::chrono::milliseconds(ms));
+        }
+
+        const auto texts = read_blob_column(r, budget, *message_count);
+        if (!texts)
+            return texts.error();
+        for (uint32_t i = 0; i < *message_count; ++i) {
+            auto text = copy_string((*texts)[i], budget);
+            if (!text)
+                return text.error();
+            msg.messages[i].text = std::move(*text);
+        }
+
+        return msg;
+    }
+
+    Result<InitMsg> InitCodec::try_decode(const std::span<const uint8_t> payload)
+    {
+        DecodeBudget budget;
+        return try_decode(payload, budget);
+    }
+
+    InitMsg InitCodec::decode(const std::span<const uint8_t> payload)
+    {
+        return try_decode(payload).value();
+    }
+} // namespace chat
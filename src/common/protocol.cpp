@@ -14,4 +14,26 @@ namespace chat::ProtocolHelpers
         std::memcpy(packet.data(), &header, sizeof(MsgHeader));
         return packet;
     }
+
+    std::vector<uint8_t> make_packet(const MessageType type, const std::span<const uint8_t> payload)
+    {
+        return make_packet(type, payload, 0, 0);
+    }
+
+    std::vector<uint8_t> make_packet(const MessageType type, const std::span<const uint8_t> payload,
+                                     const size_t head_room, const size_t tail_room)
+    {
+        const size_t size = head_room + payload.size() + tail_room;
+        std::vector<uint8_t> packet(sizeof(MsgHeader) + size);
+
+        const MsgHeader header{
+            .type = static_cast<uint16_t>(type),
+            .size = static_cast<uint32_t>(size)
+        };
+
+        std::memcpy(packet.data(), &header, sizeof(MsgHeader));
+        if (!payload.empty())
+            std::memcpy(packet.data() + sizeof(MsgHeader) + head_room, payload.data(), payload.size());
+        return packet;
+    }
 } // namespace chat::ProtocolHelpers
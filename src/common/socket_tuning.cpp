@@ -0,0 +1,92 @@
+#include "chat/common/socket_tuning.hpp"
+
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+namespace chat::SocketHelpers
+{
+    bool apply_tuning(boost::asio::ip::tcp::socket& socket, const SocketTuning& tuning)
+    {
+        bool ok = true;
+        boost::system::error_code ec;
+
+        if (tuning.tcp_nodelay) {
+            socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+            ok = ok && !ec;
+        }
+
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+        if (tuning.busy_poll_us > 0) {
+            // raising the budget above net.core.busy_read needs CAP_NET_ADMIN
+            using busy_poll = boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>;
+            socket.set_option(busy_poll(tuning.busy_poll_us), ec);
+            ok = ok && !ec;
+        }
+#endif
+
+#if defined(__linux__) && defined(SO_PREFER_BUSY_POLL)
+        if (tuning.prefer_busy_poll) {
+            using prefer_busy_poll = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_PREFER_BUSY_POLL>;
+            socket.set_option(prefer_busy_poll(true), ec);
+            ok = ok && !ec;
+        }
+#endif
+
+#if defined(__linux__) && defined(TCP_USER_TIMEOUT)
+        if (tuning.user_timeout_ms > 0) {
+            using user_timeout = boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_USER_TIMEOUT>;
+            socket.set_option(user_timeout(tuning.user_timeout_ms), ec);
+            ok = ok && !ec;
+        }
+#endif
+
+        return ok;
+    }
+
+    bool enable_fastopen_connect(boost::asio::ip::tcp::socket& socket)
+    {
+#if defined(__linux__) && defined(TCP_FASTOPEN_CONNECT)
+        using fastopen_connect = boost::asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_FASTOPEN_CONNECT>;
+        boost::system::error_code ec;
+        socket.set_option(fastopen_connect(true), ec);
+        return !ec;
+#else
+        (void)socket;
+        return false;
+#endif
+    }
+
+    bool enable_timestamping(boost::asio::ip::tcp::socket& socket)
+    {
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+        // TSONLY: the error queue returns just the timestamps, not a copy of the sent bytes
+        using timestamping = boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_TIMESTAMPING>;
+        constexpr int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE |
+                              SOF_TIMESTAMPING_TX_ACK | SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+                              SOF_TIMESTAMPING_OPT_TSONLY;
+        boost::system::error_code ec;
+        socket.set_option(timestamping(flags), ec);
+        return !ec;
+#else
+        (void)socket;
+        return false;
+#endif
+    }
+
+    bool enable_fastopen_listen(boost::asio::ip::tcp::acceptor& acceptor, const int queue_length)
+    {
+#if defined(__linux__) && defined(TCP_FASTOPEN)
+        using fastopen = boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_FASTOPEN>;
+        boost::system::error_code ec;
+        acceptor.set_option(fastopen(queue_length), ec);
+        return !ec;
+#else
+        (void)acceptor;
+        (void)queue_length;
+        return false;
+#endif
+    }
+} // namespace chat::SocketHelpers
@@ -0,0 +1,46 @@
+#include "chat/common/stream_codec.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+#include "chat/common/buffer.hpp"
+#include "chat/common/protocol.hpp"
+
+namespace chat
+{
+    std::vector<uint8_t> StreamCodec::wrap(const uint64_t stream, const MessageType type,
+                                           const std::span<const uint8_t> payload)
+    {
+        BufferWriter w;
+        w.data.reserve(sizeof(MsgHeader) + 10 + sizeof(uint16_t) + payload.size());
+        w.write(MsgHeader{static_cast<uint16_t>(MessageType::STREAM), 0});
+        w.write_varint(stream);
+        w.write(static_cast<uint16_t>(type));
+        w.write_bytes(payload);
+
+        // the header goes in first so the payload is never copied twice; its size is patched in
+        const auto size = static_cast<uint32_t>(w.data.size() - sizeof(MsgHeader));
+        std::memcpy(w.data.data() + offsetof(MsgHeader, size), &size, sizeof(size));
+        return std::move(w.data);
+    }
+
+    std::vector<uint8_t> StreamCodec::wrap_packet(const uint64_t stream, const std::span<const uint8_t> packet)
+    {
+        MsgHeader header{};
+        std::memcpy(&header, packet.data(), sizeof(header));
+        return wrap(stream, static_cast<MessageType>(header.type), packet.subspan(sizeof(header)));
+    }
+
+    Result<StreamFrame> StreamCodec::try_unwrap(const std::span<const uint8_t> payload)
+    {
+        BufferReader r(payload);
+        const auto stream = r.try_read_varint();
+        if (!stream)
+            return stream.error();
+        const auto type = r.try_read<uint16_t>();
+        if (!type)
+            return type.error();
+
+        return StreamFrame{*stream, static_cast<MessageType>(*type), payload.subspan(r.pos)};
+    }
+} // namespace chat
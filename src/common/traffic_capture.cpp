@@ -0,0 +1,125 @@
+#include "chat/common/traffic_capture.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace chat
+{
+    TrafficCapture::TrafficCapture(const std::string& path)
+        : path_(path), started_(std::chrono::steady_clock::now())
+    {
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd_ < 0)
+            throw std::system_error(errno, std::generic_category(), "open " + path_);
+
+        buffer_.data.reserve(kFlushBytes + 64);
+        buffer_.data.insert(buffer_.data.end(), kMagic.begin(), kMagic.end());
+    }
+
+    TrafficCapture::~TrafficCapture()
+    {
+        flush();
+        ::close(fd_);
+    }
+
+    void TrafficCapture::record(const uint32_t connection, const MessageType type, const size_t size)
+    {
+        if (failed())
+            return;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // read under the lock so deltas never go negative
+        const auto now = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started_).count());
+        buffer_.write_varint(now - last_ns_);
+        buffer_.write_varint(connection);
+        buffer_.write_varint(static_cast<uint16_t>(type));
+        buffer_.write_varint(size);
+        last_ns_ = now;
+        frames_.fetch_add(1, std::memory_order_relaxed);
+
+        if (buffer_.data.size() < kFlushBytes)
+            return;
+
+        std::vector<uint8_t> full;
+        full.reserve(kFlushBytes + 64);
+        full.swap(buffer_.data);
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        lock.unlock();
+        write_out(full);
+    }
+
+    void TrafficCapture::flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::vector<uint8_t> pending;
+        pending.swap(buffer_.data);
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        lock.unlock();
+        write_out(pending);
+    }
+
+    bool TrafficCapture::write_out(const std::vector<uint8_t>& bytes)
+    {
+        if (failed())
+            return false;
+
+        size_t written = 0;
+        while (written < bytes.size()) {
+            const auto n = ::write(fd_, bytes.data() + written, bytes.size() - written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0) {
+                std::cerr << "Traffic capture " << path_ << " stopped: " << std::strerror(errno) << std::endl;
+                failed_.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    std::vector<CapturedFrame> TrafficCapture::load(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error("Cannot open capture " + path);
+        const std::vector<uint8_t> bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+        if (bytes.size() < kMagic.size() || !std::equal(kMagic.begin(), kMagic.end(), bytes.begin()))
+            throw std::runtime_error(path + " is not a traffic capture");
+
+        BufferReader reader(bytes);
+        reader.pos = kMagic.size();
+
+        std::vector<CapturedFrame> frames;
+        uint64_t time_ns = 0;
+        while (reader.remaining() > 0) {
+            const auto delta      = reader.try_read_varint();
+            const auto connection = reader.try_read_varint();
+            const auto type       = reader.try_read_varint();
+            const auto size       = reader.try_read_varint();
+            if (!delta || !connection || !type || !size)
+                break;
+
+            time_ns += *delta;
+            frames.push_back({
+                .time_ns = time_ns,
+                .connection = static_cast<uint32_t>(*connection),
+                .type = static_cast<MessageType>(*type),
+                .size = static_cast<uint32_t>(*size),
+            });
+        }
+        return frames;
+    }
+} // namespace chat
@@ -0,0 +1,257 @@
+#include "chat/common/utf8.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHAT_UTF8_SSE2 1
+#endif
+
+// the AVX2 path is compiled with a target attribute and picked at run time,
+// so the rest of the build keeps its baseline instruction set
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CHAT_UTF8_AVX2 1
+#define CHAT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace chat
+{
+    namespace detail
+    {
+        bool is_valid_utf8_scalar(const std::string_view text)
+        {
+            const auto* p = reinterpret_cast<const uint8_t*>(text.data());
+            const size_t n = text.size();
+
+            size_t i = 0;
+            while (i < n) {
+#ifdef CHAT_UTF8_SSE2
+                // ASCII runs, 16 bytes at a time
+                while (i + 16 <= n && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i))) == 0)
+                    i += 16;
+                if (i >= n)
+                    break;
+#endif
+                const uint8_t lead = p[i];
+                if (lead < 0x80) {
+                    ++i;
+                    continue;
+                }
+
+                // the second byte's range carries the overlong, surrogate and > U+10FFFF checks
+                size_t length = 0;
+                uint8_t lo = 0x80, hi = 0xBF;
+                if (lead >= 0xC2 && lead <= 0xDF)
+                    length = 2;
+                else if (lead >= 0xE0 && lead <= 0xEF) {
+                    length = 3;
+                    if (lead == 0xE0)
+                        lo = 0xA0;
+                    else if (lead == 0xED)
+                        hi = 0x9F;
+                }
+                else if (lead >= 0xF0 && lead <= 0xF4) {
+                    length = 4;
+                    if (lead == 0xF0)
+                        lo = 0x90;
+                    else if (lead == 0xF4)
+                        hi = 0x8F;
+                }
+                else
+                    return false;
+
+                if (n - i < length || p[i + 1] < lo || p[i + 1] > hi)
+                    return false;
+                for (size_t k = 2; k < length; ++k)
+                    if ((p[i + k] & 0xC0) != 0x80)
+                        return false;
+                i += length;
+            }
+            return true;
+        }
+
+#ifdef CHAT_UTF8_AVX2
+        namespace
+        {
+            // error classes for a (previous byte, current byte) pair; a pair is invalid
+            // when all three nibble lookups agree on at least one bit
+            constexpr uint8_t kTooShort     = 1 << 0; // lead byte followed by a non-continuation
+            constexpr uint8_t kTooLong      = 1 << 1; // ASCII followed by a continuation
+            constexpr uint8_t kOverlong3    = 1 << 2; // E0 80..9F
+            constexpr uint8_t kTooLarge     = 1 << 3; // F4 90..BF, F5..FF
+            constexpr uint8_t kSurrogate    = 1 << 4; // ED A0..BF
+            constexpr uint8_t kOverlong2    = 1 << 5; // C0..C1
+            constexpr uint8_t kTooLarge1000 = 1 << 6; // F5..FF 80..8F
+            constexpr uint8_t kOverlong4    = 1 << 6; // F0 80..8F
+            constexpr uint8_t kTwoConts     = 1 << 7; // continuation after continuation, unless expected
+            constexpr uint8_t kCarry        = kTooShort | kTooLong | kTwoConts;
+
+            constexpr uint8_t kByte1High[16] = {
+                // 0_______: ASCII
+                kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+                // 10______: continuation
+                kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+                // 1100____, 1101____: two-byte lead
+                kTooShort | kOverlong2, kTooShort,
+                // 1110____: three-byte lead
+                kTooShort | kOverlong3 | kSurrogate,
+                // 1111____: four-byte lead
+                kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+            };
+
+            constexpr uint8_t kByte1Low[16] = {
+                kCarry | kOverlong3 | kOverlong2 | kOverlong4, // ____0000
+                kCarry | kOverlong2,                           // ____0001
+                kCarry,
+                kCarry,
+                kCarry | kTooLarge,                            // ____0100
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000 | kSurrogate, // ____1101
+                kCarry | kTooLarge | kTooLarge1000,
+                kCarry | kTooLarge | kTooLarge1000,
+            };
+
+            constexpr uint8_t kByte2High[16] = {
+                // ________ 0_______: ASCII
+                kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+                // ________ 1000____
+                kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+                // ________ 1001____
+                kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+                // ________ 101_____
+                kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+                kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+                // ________ 11______: lead byte
+                kTooShort, kTooShort, kTooShort, kTooShort,
+            };
+
+            CHAT_TARGET_AVX2 inline __m256i broadcast_table(const uint8_t (&table)[16])
+            {
+                return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+            }
+
+            CHAT_TARGET_AVX2 inline __m256i high_nibbles(const __m256i v)
+            {
+                return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+            }
+
+            // the 32 bytes ending N bytes before the end of input, spanning into the previous block
+            template <int N>
+            CHAT_TARGET_AVX2 inline __m256i prev(const __m256i input, const __m256i prev_input)
+            {
+                return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - N);
+            }
+
+            struct Avx2Checker
+            {
+                __m256i error;
+                __m256i prev_input;
+                __m256i prev_incomplete;
+                __m256i byte_1_high;
+                __m256i byte_1_low;
+                __m256i byte_2_high;
+
+                CHAT_TARGET_AVX2 Avx2Checker()
+                    : error(_mm256_setzero_si256())
+                      , prev_input(_mm256_setzero_si256())
+                      , prev_incomplete(_mm256_setzero_si256())
+                      , byte_1_high(broadcast_table(kByte1High))
+                      , byte_1_low(broadcast_table(kByte1Low))
+                      , byte_2_high(broadcast_table(kByte2High))
+                {
+                }
+
+                CHAT_TARGET_AVX2 void check_block(const __m256i input)
+                {
+                    if (_mm256_movemask_epi8(input) == 0) {
+                        // all ASCII: only a sequence left open by the previous block can be wrong
+                        error = _mm256_or_si256(error, prev_incomplete);
+                        prev_input = input;
+                        return;
+                    }
+
+                    const __m256i prev1 = prev<1>(input, prev_input);
+                    const __m256i special = _mm256_and_si256(
+                        _mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, high_nibbles(prev1)),
+                                         _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+                        _mm256_shuffle_epi8(byte_2_high, high_nibbles(input)));
+
+                    // continuations two or three bytes after a 3- or 4-byte lead are expected, and
+                    // are exactly where kTwoConts must be cleared
+                    const __m256i third  = _mm256_subs_epu8(prev<2>(input, prev_input), _mm256_set1_epi8(0xE0 - 0x80));
+                    const __m256i fourth = _mm256_subs_epu8(prev<3>(input, prev_input), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+                    const __m256i expected = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                                              _mm256_set1_epi8(static_cast<char>(0x80)));
+                    error = _mm256_or_si256(error, _mm256_xor_si256(expected, special));
+
+                    // a lead byte in the last three positions that needs more bytes than remain
+                    const __m256i max_complete = _mm256_setr_epi8(
+                        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+                    prev_incomplete = _mm256_subs_epu8(input, max_complete);
+                    prev_input      = input;
+                }
+
+                CHAT_TARGET_AVX2 bool finish()
+                {
+                    error = _mm256_or_si256(error, prev_incomplete);
+                    return _mm256_testz_si256(error, error) != 0;
+                }
+            };
+        }
+
+        bool utf8_avx2_available()
+        {
+            static const bool available = __builtin_cpu_supports("avx2");
+            return available;
+        }
+
+        CHAT_TARGET_AVX2 bool is_valid_utf8_avx2(const std::string_view text)
+        {
+            const auto* p = reinterpret_cast<const uint8_t*>(text.data());
+            const size_t n = text.size();
+
+            Avx2Checker checker;
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32)
+                checker.check_block(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+
+            if (i < n) {
+                // zero padding is ASCII, so a sequence cut off by the end still fails
+                alignas(32) uint8_t tail[32] = {};
+                std::memcpy(tail, p + i, n - i);
+                checker.check_block(_mm256_load_si256(reinterpret_cast<const __m256i*>(tail)));
+            }
+            return checker.finish();
+        }
+#else
+        bool utf8_avx2_available()
+        {
+            return false;
+        }
+
+        bool is_valid_utf8_avx2(const std::string_view text)
+        {
+            return is_valid_utf8_scalar(text);
+        }
+#endif
+    } // namespace detail
+
+    bool is_valid_utf8(const std::string_view text)
+    {
+        // below one block the byte loop wins over padding a vector
+        if (text.size() >= 32 && detail::utf8_avx2_available())
+            return detail::is_valid_utf8_avx2(text);
+        return detail::is_valid_utf8_scalar(text);
+    }
+} // namespace chat
@@ -5,6 +5,7 @@
 #include <openssl/params.h>
 #include <stdexcept>
 #include <cstring>
+#include <memory>
 
 namespace chat::crypto
 {
@@ -25,19 +26,42 @@ namespace chat::crypto
         const std::vector<uint8_t>& plaintext,
         const std::vector<uint8_t>& key,
         const std::vector<uint8_t>& aad)
+    {
+        // IV || plaintext || tag in one buffer, then sealed where it lies
+        std::vector<uint8_t> result(IV_SIZE + plaintext.size() + TAG_SIZE);
+        if (!plaintext.empty())
+            std::memcpy(result.data() + IV_SIZE, plaintext.data(), plaintext.size());
+
+        encrypt_in_place(result, key, aad);
+        return result;
+    }
+
+    void AESEngine::encrypt_in_place(
+        const std::span<uint8_t> sealed,
+        const std::vector<uint8_t>& key,
+        const std::vector<uint8_t>& aad,
+        const std::span<const uint8_t> given_iv)
     {
         if (key.size() != KEY_SIZE)
             throw std::runtime_error("Invalid key size");
-
-        std::vector<uint8_t> iv(IV_SIZE);
-        if (RAND_bytes(iv.data(), IV_SIZE) != 1)
+        if (sealed.size() < IV_SIZE + TAG_SIZE)
+            throw std::runtime_error("No room for IV and tag");
+        if (!given_iv.empty() && given_iv.size() != IV_SIZE)
+            throw std::runtime_error("Invalid IV size");
+
+        uint8_t* const iv      = sealed.data();
+        uint8_t* const text    = iv + IV_SIZE;
+        const size_t text_size = sealed.size() - IV_SIZE - TAG_SIZE;
+        if (!given_iv.empty())
+            std::memcpy(iv, given_iv.data(), IV_SIZE);
+        else if (RAND_bytes(iv, IV_SIZE) != 1)
             throw std::runtime_error("Failed to generate IV");
 
         CipherContext ctx;
 
         // initialize encryption
         if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_gcm(), nullptr,
-                              key.data(), iv.data()) != 1)
+                              key.data(), iv) != 1)
             throw std::runtime_error("Failed to initialize encryption");
 
         // set AAD if provided
@@ -49,93 +73,70 @@ namespace chat::crypto
                 throw std::runtime_error("Failed to set AAD");
         }
 
-        // encrypt plaintext
-        std::vector<uint8_t> ciphertext(plaintext.size());
-        if (EVP_EncryptUpdate(ctx.get(), ciphertext.data(), &len,
-                             plaintext.data(), static_cast<int>(plaintext.size())) != 1)
+        // GCM is a stream mode: ciphertext overwrites plaintext byte for byte
+        if (EVP_EncryptUpdate(ctx.get(), text, &len, text, static_cast<int>(text_size)) != 1)
             throw std::runtime_error("Failed to encrypt");
 
-        int ciphertext_len = len;
-
-        // finalize encryption
-        if (EVP_EncryptFinal_ex(ctx.get(), ciphertext.data() + len, &len) != 1)
+        // finalize encryption; GCM has nothing buffered to emit
+        if (EVP_EncryptFinal_ex(ctx.get(), text + len, &len) != 1)
             throw std::runtime_error("Failed to finalize encryption");
 
-        ciphertext_len += len;
-        ciphertext.resize(ciphertext_len);
-
-        // get authentication tag
-        std::vector<uint8_t> tag(TAG_SIZE);
-        if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, TAG_SIZE, tag.data()) != 1)
+        // the tag fills the room left after the ciphertext
+        if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, TAG_SIZE, text + text_size) != 1)
             throw std::runtime_error("Failed to get authentication tag");
-
-        // return IV || ciphertext || tag
-        std::vector<uint8_t> result;
-        result.reserve(IV_SIZE + ciphertext.size() + TAG_SIZE);
-        result.insert(result.end(), iv.begin(), iv.end());
-        result.insert(result.end(), ciphertext.begin(), ciphertext.end());
-        result.insert(result.end(), tag.begin(), tag.end());
-
-        return result;
     }
 
     // decryption
-    std::vector<uint8_t> AESEngine::decrypt(
+    Result<std::vector<uint8_t>> AESEngine::try_decrypt(
         const std::vector<uint8_t>& encrypted_data,
         const std::vector<uint8_t>& key,
         const std::vector<uint8_t>& aad)
     {
         if (key.size() != KEY_SIZE)
-            throw std::runtime_error("Invalid key size");
+            return Errc::invalid_key_size;
 
         if (encrypted_data.size() < IV_SIZE + TAG_SIZE)
-            throw std::runtime_error("Invalid encrypted data size");
+            return Errc::invalid_ciphertext;
 
-        // extract IV, ciphertext, and tag
-        std::vector<uint8_t> iv(encrypted_data.begin(),
-                               encrypted_data.begin() + IV_SIZE);
+        // IV || ciphertext || tag, used in place
+        const size_t ciphertext_len = encrypted_data.size() - IV_SIZE - TAG_SIZE;
+        const uint8_t* iv           = encrypted_data.data();
+        const uint8_t* ciphertext   = encrypted_data.data() + IV_SIZE;
+        const uint8_t* tag          = ciphertext + ciphertext_len;
 
-        size_t ciphertext_len = encrypted_data.size() - IV_SIZE - TAG_SIZE;
-        std::vector<uint8_t> ciphertext(
-            encrypted_data.begin() + IV_SIZE,
-            encrypted_data.begin() + IV_SIZE + ciphertext_len);
+        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        if (!ctx)
+            return Errc::crypto_failure;
 
-        std::vector<uint8_t> tag(
-            encrypted_data.end() - TAG_SIZE,
-            encrypted_data.end());
-
-        CipherContext ctx;
+        // releases the context on every return path without exceptions
+        const std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> guard(ctx, &EVP_CIPHER_CTX_free);
 
         // initialize decryption
-        if (EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_gcm(), nullptr,
-                              key.data(), iv.data()) != 1)
-            throw std::runtime_error("Failed to initialize decryption");
+        if (EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, key.data(), iv) != 1)
+            return Errc::crypto_failure;
 
         // set AAD if provided
         int len = 0;
         if (!aad.empty())
         {
-            if (EVP_DecryptUpdate(ctx.get(), nullptr, &len,
-                                 aad.data(), static_cast<int>(aad.size())) != 1)
-                throw std::runtime_error("Failed to set AAD");
+            if (EVP_DecryptUpdate(ctx, nullptr, &len, aad.data(), static_cast<int>(aad.size())) != 1)
+                return Errc::crypto_failure;
         }
 
         // decrypt ciphertext
-        std::vector<uint8_t> plaintext(ciphertext.size());
-        if (EVP_DecryptUpdate(ctx.get(), plaintext.data(), &len,
-                             ciphertext.data(), static_cast<int>(ciphertext.size())) != 1)
-            throw std::runtime_error("Failed to decrypt");
+        std::vector<uint8_t> plaintext(ciphertext_len);
+        if (EVP_DecryptUpdate(ctx, plaintext.data(), &len, ciphertext, static_cast<int>(ciphertext_len)) != 1)
+            return Errc::crypto_failure;
 
         int plaintext_len = len;
 
         // set expected tag
-        if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, TAG_SIZE,
-                               const_cast<uint8_t*>(tag.data())) != 1)
-            throw std::runtime_error("Failed to set authentication tag");
+        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_SIZE, const_cast<uint8_t*>(tag)) != 1)
+            return Errc::crypto_failure;
 
         // finalize decryption (verifies tag)
-        if (EVP_DecryptFinal_ex(ctx.get(), plaintext.data() + len, &len) != 1)
-            throw std::runtime_error("Authentication failed - message tampered or corrupted");
+        if (EVP_DecryptFinal_ex(ctx, plaintext.data() + len, &len) != 1)
+            return Errc::authentication_failed;
 
         plaintext_len += len;
         plaintext.resize(plaintext_len);
@@ -143,6 +144,25 @@ namespace chat::crypto
         return plaintext;
     }
 
+    std::vector<uint8_t> AESEngine::decrypt(
+        const std::vector<uint8_t>& encrypted_data,
+        const std::vector<uint8_t>& key,
+        const std::vector<uint8_t>& aad)
+    {
+        return try_decrypt(encrypted_data, key, aad).value();
+    }
+
+    Result<std::string> AESEngine::try_decrypt_string(
+        const std::vector<uint8_t>& encrypted_data,
+        const std::vector<uint8_t>& key,
+        const std::vector<uint8_t>& aad)
+    {
+        auto plaintext_bytes = try_decrypt(encrypted_data, key, aad);
+        if (!plaintext_bytes)
+            return plaintext_bytes.error();
+        return std::string(plaintext_bytes->begin(), plaintext_bytes->end());
+    }
+
     // string encryption
     std::vector<uint8_t> AESEngine::encrypt_string(
         const std::string& plaintext,
@@ -159,8 +179,7 @@ namespace chat::crypto
         const std::vector<uint8_t>& key,
         const std::vector<uint8_t>& aad)
     {
-        auto plaintext_bytes = decrypt(encrypted_data, key, aad);
-        return std::string(plaintext_bytes.begin(), plaintext_bytes.end());
+        return try_decrypt_string(encrypted_data, key, aad).value();
     }
 
     // key derivation using HKDF
@@ -0,0 +1,65 @@
+#include "chat/crypto/session_keys.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "chat/crypto/aes_engine.hpp"
+
+namespace chat::crypto
+{
+    namespace
+    {
+        // HKDF salt; K is already uniformly random, the salt only separates this protocol's keys
+        constexpr std::string_view kKeySalt = "srp-chat session keys v1";
+
+        DirectionKey derive_direction(const std::vector<uint8_t>& shared_secret, const std::string& label)
+        {
+            const std::vector<uint8_t> salt(kKeySalt.begin(), kKeySalt.end());
+
+            DirectionKey direction;
+            direction.key    = AESEngine::derive_key(shared_secret, salt, label + " key");
+            const auto nonce = AESEngine::derive_key(shared_secret, salt, label + " nonce");
+            std::copy_n(nonce.begin(), kNonceSaltSize, direction.nonce_salt.begin());
+            return direction;
+        }
+    }
+
+    SessionKeys derive_session_keys(const std::vector<uint8_t>& shared_secret)
+    {
+        if (shared_secret.empty())
+            throw std::runtime_error("No shared secret to derive session keys from");
+
+        return SessionKeys{
+            .client_to_server = derive_direction(shared_secret, "client to server"),
+            .server_to_client = derive_direction(shared_secret, "server to client"),
+        };
+    }
+
+    std::vector<uint8_t> Sealer::seal(const std::span<const uint8_t> plaintext, const std::vector<uint8_t>& aad) const
+    {
+        std::vector<uint8_t> sealed(AESEngine::IV_SIZE + plaintext.size() + AESEngine::TAG_SIZE);
+        if (!plaintext.empty())
+            std::memcpy(sealed.data() + AESEngine::IV_SIZE, plaintext.data(), plaintext.size());
+        seal_in_place(sealed, aad);
+        return sealed;
+    }
+
+    std::vector<uint8_t> Sealer::seal_string(const std::string_view text, const std::vector<uint8_t>& aad) const
+    {
+        return seal({reinterpret_cast<const uint8_t*>(text.data()), text.size()}, aad);
+    }
+
+    void Sealer::seal_in_place(const std::span<uint8_t> sealed, const std::vector<uint8_t>& aad) const
+    {
+        static_assert(kNonceSaltSize + sizeof(uint64_t) == AESEngine::IV_SIZE);
+
+        std::array<uint8_t, AESEngine::IV_SIZE> iv{};
+        std::copy(key_.nonce_salt.begin(), key_.nonce_salt.end(), iv.begin());
+        const uint64_t counter = counter_.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = 0; i < sizeof(counter); ++i)
+            iv[kNonceSaltSize + i] = static_cast<uint8_t>(counter >> (8 * (sizeof(counter) - 1 - i)));
+
+        AESEngine::encrypt_in_place(sealed, key_.key, aad, iv);
+    }
+} // namespace chat::crypto
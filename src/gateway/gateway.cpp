@@ -0,0 +1,538 @@
+#include "chat/gateway/gateway.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+#include "chat/common/init_codec.hpp"
+#include "chat/common/messages.hpp"
+#include "chat/common/protocol.hpp"
+#include "chat/common/stream_codec.hpp"
+#include "chat/crypto/aes_engine.hpp"
+#include "chat/server/session.hpp"
+
+namespace chat::gateway
+{
+    using boost::asio::ip::tcp;
+    using server::Session;
+
+    // everything but GroupKey, which the server does not implement either
+    constexpr uint32_t kCapabilities = Capability::BinaryFields | Capability::Compression | Capability::Batching |
+                                       Capability::Resume;
+
+    /**
+     * One upstream link
+     * Client threads write their streams' frames under one lock; a reader
+     * thread routes addressed frames to their stream and seals each unwrapped
+     * broadcast for every joined stream on the link. It only queues: each
+     * client's writer thread does the socket writes (see start_writer), so a
+     * slow client holds neither the link nor the other clients on it.
+     */
+    class Gateway::Link
+    {
+    public:
+        Link(boost::asio::io_context& io_context, const std::string& host, const int port)
+            : socket_(io_context)
+        {
+            tcp::resolver resolver(io_context);
+            boost::asio::connect(socket_, resolver.resolve(host, std::to_string(port)));
+            socket_.set_option(tcp::no_delay(true));
+            reader_ = std::thread([this]() { read_loop(); });
+        }
+
+        ~Link()
+        {
+            close();
+            if (reader_.joinable())
+                reader_.join();
+        }
+
+        Link(const Link&)            = delete;
+        Link& operator=(const Link&) = delete;
+
+        [[nodiscard]] bool is_open() const { return open_.load(std::memory_order_relaxed); }
+
+        void close()
+        {
+            boost::system::error_code ec;
+            socket_.shutdown(tcp::socket::shutdown_both, ec);
+        }
+
+        // packet (header included) re-addressed to stream; false once the link is down
+        bool send(const uint64_t stream, const std::vector<uint8_t>& packet)
+        {
+            const auto frame = StreamCodec::wrap_packet(stream, packet);
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            if (!is_open())
+                return false;
+            boost::system::error_code ec;
+            boost::asio::write(socket_, boost::asio::buffer(frame), ec);
+            return !ec;
+        }
+
+        // the stream only receives broadcasts once the server's INIT for it has gone out
+        void attach(const uint64_t stream, std::shared_ptr<Session> session)
+        {
+            std::lock_guard<std::mutex> lock(streams_mutex_);
+            streams_[stream] = {std::move(session), false};
+        }
+
+        void detach(const uint64_t stream)
+        {
+            std::lock_guard<std::mutex> lock(streams_mutex_);
+            if (streams_.erase(stream) > 0)
+                rebuild_joined();
+        }
+
+    private:
+        struct Stream
+        {
+            std::shared_ptr<Session> session;
+            bool joined{false};
+        };
+
+        tcp::socket socket_;
+        std::atomic<bool> open_{true};
+        std::mutex write_mutex_;
+
+        mutable std::mutex streams_mutex_; // guards streams_ and joined_
+        std::unordered_map<uint64_t, Stream> streams_;
+        // snapshot for local fanout, rebuilt on join/leave like the server's fanout table
+        std::shared_ptr<const server::FanoutTable> joined_{std::make_shared<const server::FanoutTable>()};
+
+        std::thread reader_;
+
+        void rebuild_joined()
+        {
+            auto table = std::make_shared<server::FanoutTable>();
+            for (const auto& [id, stream] : streams_)
+                if (stream.joined)
+                    table->push_back(stream.session);
+            joined_ = std::move(table);
+        }
+
+        [[nodiscard]] std::shared_ptr<const server::FanoutTable> joined() const
+        {
+            std::lock_guard<std::mutex> lock(streams_mutex_);
+            return joined_;
+        }
+
+        void read_loop()
+        {
+            while (true) {
+                auto packet = ProtocolHelpers::try_receive_packet(socket_);
+                if (!packet)
+                    break;
+
+                if (auto& [type, payload] = *packet; type == MessageType::STREAM) {
+                    if (const auto frame = StreamCodec::try_unwrap(payload))
+                        deliver(*frame);
+                }
+                else
+                    fan_out(type, payload);
+            }
+
+            // without the server there is no room: every client on this link is dropped
+            std::cerr << "Upstream link lost" << std::endl;
+            {
+                std::lock_guard<std::mutex> lock(write_mutex_);
+                open_.store(false, std::memory_order_relaxed);
+            }
+            std::lock_guard<std::mutex> lock(streams_mutex_);
+            for (const auto& [id, stream] : streams_)
+                stream.session->connection().close();
+        }
+
+        // payload sealed with the client's key inside the frame's own buffer
+        static void send_sealed(Session& session, const MessageType type, const std::span<const uint8_t> payload,
+                                const std::string_view aad_text)
+        {
+            const std::vector<uint8_t> aad(aad_text.begin(), aad_text.end());
+            auto packet = ProtocolHelpers::make_packet(type, payload, crypto::AESEngine::IV_SIZE,
+                                                       crypto::AESEngine::TAG_SIZE);
+            session.sealer().seal_in_place(std::span(packet).subspan(sizeof(MsgHeader)), aad);
+            session.send(std::move(packet));
+        }
+
+        // a frame for one client
+        void deliver(const StreamFrame& frame)
+        {
+            std::shared_ptr<Session> session;
+            {
+                std::lock_guard<std::mutex> lock(streams_mutex_);
+                const auto it = streams_.find(frame.stream);
+                if (it == streams_.end())
+                    return;
+                session = it->second.session;
+                if (frame.type == MessageType::INIT_V2 && !it->second.joined) {
+                    it->second.joined = true;
+                    rebuild_joined();
+                }
+            }
+
+            const auto& peer = session->connection().features();
+            switch (frame.type) {
+                case MessageType::INIT_V2: {
+                    // the server sends INIT unsealed on the link; the client gets it as a direct join would
+                    if (peer.has(Capability::Batching)) {
+                        send_sealed(*session, MessageType::INIT_SEALED, frame.payload, kInitAad);
+                        break;
+                    }
+                    if (peer.has(Capability::BinaryFields)) {
+                        session->send(ProtocolHelpers::make_packet(MessageType::INIT_V2, frame.payload));
+                        break;
+                    }
+                    if (const auto msg = InitCodec::try_decode(frame.payload))
+                        session->send(InitCodec::encode(peer, msg->messages, msg->users));
+                    break;
+                }
+                case MessageType::CATCH_UP:
+                    // a client that cannot resume sees the room from its join on, as before HELLO
+                    if (peer.has(Capability::Resume))
+                        send_sealed(*session, MessageType::CATCH_UP, frame.payload, kCatchUpAad);
+                    break;
+                case MessageType::STREAM_CLOSE: {
+                    // refused by the server; its ERROR_MSG is queued just before. Ending the client's
+                    // read side lets its thread drain the queue before closing the connection
+                    boost::system::error_code ec;
+                    session->connection().socket().shutdown(tcp::socket::shutdown_receive, ec);
+                    break;
+                }
+                default:
+                    // ERROR_MSG, SLOW_DOWN, MESSAGE_REJECTED, RETRY_LATER carry nothing sealed
+                    session->send(ProtocolHelpers::make_packet(frame.type, frame.payload));
+                    break;
+            }
+        }
+
+        // a frame for every client on the link, received once and sealed per client here
+        void fan_out(const MessageType type, const std::vector<uint8_t>& payload)
+        {
+            const auto recipients = joined();
+            switch (type) {
+                case MessageType::BROADCAST: {
+                    const auto msg = Protocol::try_decode<BroadcastMsg>(payload);
+                    if (!msg)
+                        return;
+                    for (const auto& session : *recipients) {
+                        if (!session->is_open())
+                            continue;
+                        session->send_text(msg->ciphertext_b64, [&](const std::span<const uint8_t> body) {
+                            const auto sealed = session->sealer().seal(body);
+                            return Protocol::encode(
+                                MessageType::BROADCAST,
+                                BroadcastMsg{msg->username, auth::SRPUtils::bytes_to_base64(sealed),
+                                             msg->timestamp_ms});
+                        });
+                    }
+                    break;
+                }
+                case MessageType::EPHEMERAL_BROADCAST: {
+                    const auto msg = Protocol::try_decode<EphemeralBroadcastMsg>(payload);
+                    if (!msg)
+                        return;
+
+                    // same collapse slot per (sender, kind) as the server uses
+                    const uint64_t collapse_key =
+                        (std::hash<std::string>{}(msg->username) << 2 | msg->kind) | uint64_t{1} << 63;
+                    for (const auto& session : *recipients) {
+                        if (session->username() == msg->username || !session->is_open() ||
+                            session->queued() >= Session::kEphemeralDropDepth)
+                            continue;
+                        const auto sealed = session->sealer().seal_string(msg->ciphertext_b64);
+                        session->send_ephemeral(
+                            std::make_shared<const std::vector<uint8_t>>(Protocol::encode(
+                                MessageType::EPHEMERAL_BROADCAST,
+                                EphemeralBroadcastMsg{msg->username, msg->kind,
+                                                      auth::SRPUtils::bytes_to_base64(sealed)})),
+                            collapse_key);
+                    }
+                    break;
+                }
+                default: {
+                    // USER_JOINED and USER_LEFT go out as they are; a joining user is not told about itself
+                    std::string skip_user_id;
+                    if (type == MessageType::USER_JOINED)
+                        if (const auto msg = Protocol::try_decode<UserJoinedMsg>(payload))
+                            skip_user_id = msg->user_id;
+
+                    const auto packet =
+                        std::make_shared<const std::vector<uint8_t>>(ProtocolHelpers::make_packet(type, payload));
+                    for (const auto& session : *recipients)
+                        if (session->user_id() != skip_user_id && session->is_open())
+                            session->send(packet);
+                    break;
+                }
+            }
+        }
+    };
+
+    Gateway::Gateway(const int port, GatewayOptions options)
+        : acceptor_(io_context_, tcp::endpoint(tcp::v4(), static_cast<boost::asio::ip::port_type>(port))),
+          port_(port),
+          options_(std::move(options))
+    {
+        SocketHelpers::enable_fastopen_listen(acceptor_);
+        srp_server_.load_users(options_.users_path);
+
+        for (size_t i = 0; i < std::max<size_t>(options_.links, 1); ++i)
+            links_.push_back(std::make_unique<Link>(io_context_, options_.upstream_host, options_.upstream_port));
+    }
+
+    Gateway::~Gateway()
+    {
+        stop();
+        for (const auto& link : links_)
+            link->close();
+    }
+
+    void Gateway::run()
+    {
+        running_ = true;
+        start_accept();
+
+        std::cout << "Gateway listening on port " << port_ << ", " << links_.size() << " links to "
+            << options_.upstream_host << ":" << options_.upstream_port << std::endl;
+
+        io_context_.run();
+    }
+
+    void Gateway::stop()
+    {
+        if (running_.exchange(false))
+            io_context_.stop();
+    }
+
+    void Gateway::start_accept()
+    {
+        auto conn = std::make_shared<server::Connection>(io_context_);
+        acceptor_.async_accept(conn->socket(), [this, conn](const boost::system::error_code& error) {
+            if (!error) {
+                if (!SocketHelpers::apply_tuning(conn->socket(), options_.socket_tuning))
+                    std::call_once(tuning_warning_, []() {
+                        std::cerr << "Warning: some socket options were rejected by the kernel; not repeated"
+                            << std::endl;
+                    });
+                std::thread([this, conn]() { this->handle_client(conn); }).detach();
+            }
+            else
+                std::cerr << "Accept error: " << error.message() << std::endl;
+
+            if (running_)
+                this->start_accept();
+        });
+    }
+
+    Gateway::Link* Gateway::pick_link()
+    {
+        for (size_t attempt = 0; attempt < links_.size(); ++attempt) {
+            auto& link = links_[next_link_.fetch_add(1, std::memory_order_relaxed) % links_.size()];
+            if (link->is_open())
+                return link.get();
+        }
+        return nullptr;
+    }
+
+    void Gateway::handle_client(const std::shared_ptr<server::Connection>& conn)
+    {
+        const auto session = authenticate(conn);
+        if (!session) {
+            conn->close();
+            return;
+        }
+        session->start_writer();
+
+        Link* link = pick_link();
+        if (!link) {
+            session->send(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Chat server unavailable"}));
+            session->stop_writer();
+            conn->close();
+            return;
+        }
+
+        const uint64_t stream = next_stream_.fetch_add(1, std::memory_order_relaxed);
+        link->attach(stream, session);
+        link->send(stream, Protocol::encode(MessageType::STREAM_OPEN,
+                                            StreamOpenMsg{session->username(), session->user_id()}));
+
+        // decrypt here and forward plaintext; the server applies rate limits and the text filter per stream
+        auto& stats = session->stats();
+        std::optional<InflateStream> inflate;
+        if (session->compression() == Compression::Deflate)
+            inflate.emplace();
+
+        while (conn->is_open() && link->is_open()) {
+            auto packet = conn->try_receive_packet();
+            if (!packet)
+                break;
+
+            stats.bytes_received.fetch_add(sizeof(MsgHeader) + packet->second.size(), std::memory_order_relaxed);
+            switch (auto& [type, payload] = *packet; type) {
+                case MessageType::MESSAGE: {
+                    stats.messages_received.fetch_add(1, std::memory_order_relaxed);
+                    const auto msg  = Protocol::try_decode<TextMsg>(payload);
+                    const auto body = msg ? crypto::AESEngine::try_decrypt(
+                                                auth::SRPUtils::base64_to_bytes(msg->ciphertext_b64), session->receive_key())
+                                          : Result<std::vector<uint8_t>>(msg.error());
+                    const auto text = !body    ? Result<std::string>(body.error())
+                                      : inflate ? inflate->decompress(*body, ProtocolHelpers::kMaxPayloadSize)
+                                                : Result<std::string>(std::string(body->begin(), body->end()));
+                    if (!text) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                        // one bad frame leaves the rest of the stream undecodable
+                        if (text.error() == Errc::decompression_failed || text.error() == Errc::payload_too_large)
+                            conn->close();
+                        break;
+                    }
+                    link->send(stream, Protocol::encode(MessageType::MESSAGE, TextMsg{*text}));
+                    break;
+                }
+                case MessageType::EPHEMERAL: {
+                    const auto msg = Protocol::try_decode<EphemeralMsg>(payload);
+                    const auto text = msg ? crypto::AESEngine::try_decrypt_string(
+                                                auth::SRPUtils::base64_to_bytes(msg->ciphertext_b64), session->receive_key())
+                                          : Result<std::string>(msg.error());
+                    if (!text) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+                    link->send(stream, Protocol::encode(MessageType::EPHEMERAL, EphemeralMsg{msg->kind, *text}));
+                    break;
+                }
+                case MessageType::AWAY:
+                    // clients behind a gateway stay real-time: the server seals each message once per
+                    // gateway, not per client, so skipping one of them here would save nothing upstream
+                    break;
+                case MessageType::DISCONNECT:
+                    conn->close();
+                    break;
+                default:
+                    stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                    break;
+            }
+        }
+
+        link->send(stream, ProtocolHelpers::make_empty_packet(MessageType::STREAM_CLOSE));
+        link->detach(stream);
+        session->stop_writer();
+        conn->close();
+    }
+
+    std::shared_ptr<Session> Gateway::authenticate(const std::shared_ptr<server::Connection>& conn)
+    {
+        try {
+            auth::SRPServer::ChallengeResponse challenge;
+            std::string username;
+            auto compression = Compression::None;
+
+            while (true) {
+                auto [type, msg] = conn->receive_packet();
+
+                // the link is always INIT_V2 with CATCH_UP; anything a client lacks is converted or dropped here
+                if (type == MessageType::HELLO) {
+                    const auto hello    = Protocol::try_decode<HelloMsg>(msg);
+                    const auto features = hello ? PeerFeatures::negotiate(hello->version, hello->capabilities,
+                                                                          kProtocolVersion, kCapabilities)
+                                                : PeerFeatures{};
+                    conn->set_features(features);
+                    conn->send_packet(Protocol::encode(MessageType::HELLO_ACK,
+                                                       HelloMsg{features.version, features.capabilities}));
+                    continue;
+                }
+
+                // compression ends here with the encryption; links carry plain text. Only for peers
+                // that negotiated it: without HELLO a client gets no optional features
+                if (type == MessageType::COMPRESS_OFFER) {
+                    const auto offer = Protocol::try_decode<CompressionMsg>(msg);
+                    compression      = conn->features().has(Capability::Compression) && offer &&
+                                  offer->algorithm == static_cast<uint8_t>(Compression::Deflate) &&
+                                  offer->dictionary_id == dictionary_id(chat_dictionary())
+                                           ? Compression::Deflate
+                                           : Compression::None;
+                    conn->send_packet(Protocol::encode(MessageType::COMPRESS_ACK, CompressionMsg{
+                                                           static_cast<uint8_t>(compression),
+                                                           dictionary_id(chat_dictionary())
+                                                       }));
+                    continue;
+                }
+
+                // accounts are created on the server, which owns the verifier database
+                if (type == MessageType::SRP_REGISTER) {
+                    conn->send_packet(Protocol::encode(MessageType::ERROR_MSG,
+                                                       ErrorMsg{"Registration is not available through a gateway"}));
+                    return nullptr;
+                }
+                if (type != MessageType::SRP_INIT) {
+                    conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Expected SRP_INIT"}));
+                    return nullptr;
+                }
+
+                auto [init_username, A_b64] = Protocol::decode<SrpInitMsg>(msg);
+                if (init_username.empty() || A_b64.empty()) {
+                    conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Invalid SRP_INIT"}));
+                    return nullptr;
+                }
+
+                try {
+                    challenge = srp_server_.init_authentication(init_username, auth::SRPUtils::base64_to_bytes(A_b64));
+                    username  = std::move(init_username);
+                    break;
+                }
+                catch (const std::exception&) {
+                    conn->send_packet(Protocol::encode(MessageType::SRP_USER_NOT_FOUND));
+                }
+            }
+
+            struct ReleaseHandshake
+            {
+                auth::SRPServer& srp;
+                const std::string& user_id;
+                ~ReleaseHandshake() { srp.clear_session(user_id); }
+            } release_handshake{srp_server_, challenge.user_id};
+
+            conn->send_packet(Protocol::encode(MessageType::SRP_CHALLENGE, SrpChallengeMsg{
+                                                   challenge.user_id,
+                                                   auth::SRPUtils::bytes_to_base64(challenge.B),
+                                                   auth::SRPUtils::bytes_to_base64(challenge.salt),
+                                                   auth::SRPUtils::bytes_to_base64(challenge.room_salt)
+                                               }));
+
+            auto [response_type, response_payload] = conn->receive_packet();
+            if (response_type != MessageType::SRP_RESPONSE) {
+                conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Expected SRP_RESPONSE"}));
+                return nullptr;
+            }
+
+            auto [response_user_id, response_M_b64] = Protocol::decode<SrpResponseMsg>(response_payload);
+            if (response_user_id != challenge.user_id) {
+                conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Invalid user_id"}));
+                return nullptr;
+            }
+
+            auth::SRPServer::VerifyResponse verify;
+            try {
+                verify = srp_server_.verify_authentication(response_user_id, auth::SRPUtils::base64_to_bytes(response_M_b64));
+            }
+            catch (const std::exception& e) {
+                conn->send_packet(Protocol::encode(
+                    MessageType::ERROR_MSG, ErrorMsg{"Authentication failed: " + std::string(e.what())}));
+                return nullptr;
+            }
+
+            conn->send_packet(Protocol::encode(
+                MessageType::SRP_SUCCESS,
+                SrpSuccessMsg{auth::SRPUtils::bytes_to_base64(verify.H_AMK)}));
+
+            auto session = std::make_shared<Session>(response_user_id, username, conn,
+                                                     crypto::derive_session_keys(verify.K), compression);
+            conn->attach_session(session);
+            return session;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "SRP authentication error: " << e.what() << std::endl;
+            return nullptr;
+        }
+    }
+} // namespace chat::gateway
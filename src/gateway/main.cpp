@@ -0,0 +1,80 @@
+#include "chat/gateway/gateway.hpp"
+#include <iostream>
+#include <string>
+#include <csignal>
+#include <cstdlib>
+
+std::unique_ptr<chat::gateway::Gateway> g_gateway;
+
+void signal_handler(const int signal) {
+    if (signal == SIGINT || signal == SIGTERM) {
+        std::cout << "\nShutting down gateway..." << std::endl;
+        if (g_gateway) {
+            g_gateway->stop();
+        }
+        exit(0);
+    }
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <port> [options]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --upstream <host:port>   chat_server gateway port (default 127.0.0.1:9888)" << std::endl;
+    std::cerr << "  --links <n>              upstream links to multiplex clients over (default 2)" << std::endl;
+    std::cerr << "  --users <path>           verifier database shared with the server (default users.db)"
+        << std::endl;
+    std::cerr << "Example: " << program << " 8889 --upstream 127.0.0.1:9888" << std::endl;
+}
+
+int main(const int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const int port = std::stoi(argv[1]);
+
+        if (port < 1024 || port > 65535) {
+            std::cerr << "Port must be between 1024 and 65535" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        chat::gateway::GatewayOptions options;
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--upstream" && i + 1 < argc) {
+                const std::string upstream = argv[++i];
+                const auto colon           = upstream.rfind(':');
+                if (colon == std::string::npos) {
+                    std::cerr << "Upstream must be host:port" << std::endl;
+                    return EXIT_FAILURE;
+                }
+                options.upstream_host = upstream.substr(0, colon);
+                options.upstream_port = std::stoi(upstream.substr(colon + 1));
+            }
+            else if (arg == "--links" && i + 1 < argc) {
+                options.links = std::stoul(argv[++i]);
+            }
+            else if (arg == "--users" && i + 1 < argc) {
+                options.users_path = argv[++i];
+            }
+            else {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::signal(SIGINT, signal_handler);
+        std::signal(SIGTERM, signal_handler);
+
+        g_gateway = std::make_unique<chat::gateway::Gateway>(port, options);
+        g_gateway->run();
+
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
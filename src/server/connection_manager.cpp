@@ -1,12 +1,62 @@
 #include "chat/server/connection_manager.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <system_error>
 #include <utility>
+#include <thread>
+
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define CHAT_CPU_RELAX() _mm_pause()
+#else
+#define CHAT_CPU_RELAX() std::this_thread::yield()
+#endif
 
 #include "chat/common/protocol.hpp"
+#include "chat/common/socket_tuning.hpp"
 
 namespace chat::server
 {
+    namespace
+    {
+        // BROADCASTs tracked per connection; past this the oldest is given up on
+        constexpr size_t kMaxPendingStamps = 256;
+
+        // a link carries every broadcast for all of a gateway's clients
+        constexpr size_t kLinkQueuedBytes = 256U << 20;
+
+        // the software timestamp a received or error-queue message carries, 0 if none
+        int64_t software_stamp(msghdr& msg)
+        {
+            for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+                    continue;
+                scm_timestamping stamps{};
+                std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                return static_cast<int64_t>(stamps.ts[0].tv_sec) * 1'000'000'000 + stamps.ts[0].tv_nsec;
+            }
+            return 0;
+        }
+
+        // what an error-queue message reports: origin, SCM_TSTAMP_* kind and timestamp id
+        const sock_extended_err* extended_error(msghdr& msg)
+        {
+            for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+                if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                    (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+                    return reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+            return nullptr;
+        }
+    }
+
     Connection::Connection(boost::asio::io_context& io_context)
         : socket_(io_context)
     {
@@ -17,10 +67,30 @@ namespace chat::server
         return socket_;
     }
 
+    void Connection::set_busy_poll(const std::chrono::microseconds interval)
+    {
+        busy_poll_ = interval;
+    }
+
+    void Connection::spin_until_readable()
+    {
+        const auto deadline = std::chrono::steady_clock::now() + busy_poll_;
+        boost::system::error_code ec;
+
+        // FIONREAD never blocks; errors fall through to the blocking read which reports them
+        while (socket_.available(ec) == 0 && !ec) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return;
+            CHAT_CPU_RELAX();
+        }
+    }
+
     void Connection::send_packet(const std::vector<uint8_t>& packet)
     {
         try {
             ProtocolHelpers::send_packet(socket_, packet);
+            if (latency_)
+                note_sent(packet);
         }
         catch (const std::exception& e) {
             std::cerr << "Error sending packet: " << e.what() << std::endl;
@@ -28,19 +98,174 @@ namespace chat::server
         }
     }
 
-    std::pair<MessageType, std::vector<uint8_t>> Connection::receive_packet()
+    void Connection::send_file(const int fd, const uint64_t offset, uint64_t length)
     {
-        try {
-            return ProtocolHelpers::receive_packet(socket_);
+        // these bytes count towards the kernel's timestamp ids too
+        tx_bytes_ += static_cast<uint32_t>(length);
+
+        // page-cache pages go straight to the socket buffer; a short count just means it filled up
+        auto position = static_cast<off_t>(offset);
+        while (length > 0) {
+            const auto n = ::sendfile(socket_.native_handle(), fd, &position, length);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                socket_.wait(socket_type::wait_write);
+                continue;
+            }
+            if (n <= 0) {
+                const std::system_error error(n < 0 ? errno : EIO, std::generic_category(), "sendfile");
+                std::cerr << "Error sending file range: " << error.what() << std::endl;
+                throw error;
+            }
+            length -= static_cast<uint64_t>(n);
         }
-        catch (const std::exception&) {
-            throw std::runtime_error("Connection closed");
+    }
+
+    void Connection::set_capture(std::shared_ptr<TrafficCapture> capture, const uint32_t id)
+    {
+        capture_    = std::move(capture);
+        capture_id_ = id;
+    }
+
+    bool Connection::set_timestamping(std::shared_ptr<WireLatency> latency)
+    {
+        if (!SocketHelpers::enable_timestamping(socket_))
+            return false;
+        latency_ = std::move(latency);
+        return true;
+    }
+
+    bool Connection::read_stamped(const std::span<uint8_t> out, int64_t& stamp_ns)
+    {
+        size_t got = 0;
+        while (got < out.size()) {
+            iovec iov{out.data() + got, out.size() - got};
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+            msghdr msg{};
+            msg.msg_iov        = &iov;
+            msg.msg_iovlen     = 1;
+            msg.msg_control    = control;
+            msg.msg_controllen = sizeof(control);
+
+            const auto n = ::recvmsg(socket_.native_handle(), &msg, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                boost::system::error_code ec;
+                socket_.wait(socket_type::wait_read, ec);
+                if (ec)
+                    return false;
+                continue;
+            }
+            if (n <= 0)
+                return false;
+
+            // a read spanning segments carries the newest one's time
+            if (const auto stamp = software_stamp(msg); stamp != 0)
+                stamp_ns = stamp;
+            got += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    Result<std::pair<MessageType, std::vector<uint8_t>>> Connection::receive_stamped()
+    {
+        MsgHeader header{};
+        int64_t rx_ns = 0;
+        if (!read_stamped({reinterpret_cast<uint8_t*>(&header), sizeof(MsgHeader)}, rx_ns))
+            return Errc::connection_closed;
+        if (header.size > ProtocolHelpers::kMaxPayloadSize)
+            return Errc::payload_too_large;
+
+        std::vector<uint8_t> payload(header.size);
+        if (!read_stamped(payload, rx_ns))
+            return Errc::connection_closed;
+
+        // from the frame's last segment arriving to the frame being in hand
+        read_ns_ = realtime_ns();
+        if (rx_ns != 0)
+            latency_->rx_queue.record(read_ns_ - rx_ns);
+        return std::pair{static_cast<MessageType>(header.type), std::move(payload)};
+    }
+
+    void Connection::note_sent(const std::vector<uint8_t>& packet)
+    {
+        tx_bytes_ += static_cast<uint32_t>(packet.size());
+
+        MsgHeader header{};
+        std::memcpy(&header, packet.data(), sizeof(MsgHeader));
+        if (header.type == static_cast<uint16_t>(MessageType::BROADCAST)) {
+            if (tx_pending_.size() >= kMaxPendingStamps)
+                tx_pending_.pop_front();
+            // the kernel keys a write's timestamps by its last byte
+            tx_pending_.push_back({tx_bytes_ - 1, realtime_ns(), 0});
         }
+
+        drain_tx_stamps();
+    }
+
+    void Connection::drain_tx_stamps()
+    {
+        while (true) {
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping)) +
+                                          CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+            msghdr msg{};
+            msg.msg_control    = control;
+            msg.msg_controllen = sizeof(control);
+
+            // with OPT_TSONLY the message has no payload, only the two control messages
+            if (::recvmsg(socket_.native_handle(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+
+            const int64_t stamp = software_stamp(msg);
+            const auto* error   = extended_error(msg);
+            if (stamp == 0 || error == nullptr || error->ee_origin != SO_EE_ORIGIN_TIMESTAMPING)
+                continue;
+
+            const uint32_t id = error->ee_data;
+            const auto it     = std::ranges::find(tx_pending_, id, &PendingStamp::id);
+            if (error->ee_info == SCM_TSTAMP_SND && it != tx_pending_.end()) {
+                latency_->tx_queue.record(stamp - it->written_ns);
+                it->sent_ns = stamp;
+            }
+            else if (error->ee_info == SCM_TSTAMP_ACK) {
+                if (it != tx_pending_.end())
+                    latency_->ack.record(stamp - (it->sent_ns != 0 ? it->sent_ns : it->written_ns));
+                // TCP acknowledges in order: this write and everything before it are done
+                while (!tx_pending_.empty() && static_cast<int32_t>(tx_pending_.front().id - id) <= 0)
+                    tx_pending_.pop_front();
+            }
+        }
+    }
+
+    Result<std::pair<MessageType, std::vector<uint8_t>>> Connection::try_receive_packet()
+    {
+        if (busy_poll_.count() > 0)
+            spin_until_readable();
+        auto packet = latency_ ? receive_stamped() : ProtocolHelpers::try_receive_packet(socket_);
+        if (capture_ && packet)
+            capture_->record(capture_id_, packet->first, packet->second.size());
+        return packet;
+    }
+
+    std::pair<MessageType, std::vector<uint8_t>> Connection::receive_packet()
+    {
+        auto packet = try_receive_packet();
+        if (!packet)
+            throw std::runtime_error("Connection closed");
+        return std::move(*packet);
     }
 
     void Connection::close()
     {
         try {
+            // wakes a reader or writer still blocked on the socket, which close alone would not
+            boost::system::error_code ec;
+            socket_.shutdown(socket_type::shutdown_both, ec);
             socket_.close();
         }
         catch (...) {
@@ -53,56 +278,164 @@ namespace chat::server
         return socket_.is_open();
     }
 
-    void ConnectionManager::add(const std::string& user_id, const std::string& username,
-                                std::shared_ptr<Connection> conn)
+    void Connection::reset()
+    {
+        close();
+        busy_poll_ = std::chrono::microseconds{0};
+        session_.reset();
+        capture_.reset();
+        features_ = {};
+        latency_.reset();
+        read_ns_  = 0;
+        tx_bytes_ = 0;
+        tx_pending_.clear();
+    }
+
+    void Connection::set_features(const PeerFeatures features)
+    {
+        features_ = features;
+    }
+
+    void Connection::attach_session(const std::shared_ptr<Session>& session)
+    {
+        session_ = session;
+    }
+
+    std::shared_ptr<Session> Connection::session() const
+    {
+        return session_.lock();
+    }
+
+    std::shared_ptr<Session> ConnectionManager::add(const std::string& user_id, const std::string& username,
+                                                    std::shared_ptr<Connection> conn, crypto::SessionKeys keys,
+                                                    const Compression compression)
+    {
+        auto session = std::make_shared<Session>(user_id, username, conn, std::move(keys), compression);
+        conn->attach_session(session);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const auto it = sessions_.find(user_id); it != sessions_.end()) {
+            release_username(it->second->username());
+            it->second = session;
+        }
+        else
+            sessions_.try_emplace(user_id, session);
+
+        ++username_refs_[username];
+        rebuild_fanout();
+        return session;
+    }
+
+    void ConnectionManager::remove(const std::string_view user_id)
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        connections_[user_id]         = std::move(conn);
-        user_id_to_username_[user_id] = username;
+
+        if (const auto it = sessions_.find(user_id); it != sessions_.end()) {
+            it->second->connection().close();
+            release_username(it->second->username());
+            sessions_.erase(it);
+            rebuild_fanout();
+        }
     }
 
-    void ConnectionManager::remove(const std::string& user_id)
+    std::shared_ptr<Session> ConnectionManager::add_link(const std::string& link_id, std::shared_ptr<Connection> conn)
     {
+        auto link = std::make_shared<Session>(link_id, "", conn, crypto::SessionKeys{}, Compression::None,
+                                              kLinkQueuedBytes);
+        conn->attach_session(link);
+
         std::lock_guard<std::mutex> lock(mutex_);
+        auto table = std::make_shared<FanoutTable>(*links_);
+        table->push_back(link);
+        links_ = std::move(table);
+        return link;
+    }
 
-        if (const auto it = user_id_to_username_.find(user_id); it != user_id_to_username_.end())
-            user_id_to_username_.erase(it);
+    void ConnectionManager::remove_link(const Session& link)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto table = std::make_shared<FanoutTable>(*links_);
+        std::erase_if(*table, [&link](const std::shared_ptr<Session>& entry) { return entry.get() == &link; });
+        links_ = std::move(table);
+    }
 
-        if (const auto conn_it = connections_.find(user_id); conn_it != connections_.end()) {
-            conn_it->second->close();
-            connections_.erase(conn_it);
+    std::shared_ptr<const FanoutTable> ConnectionManager::links() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return links_;
+    }
+
+    bool ConnectionManager::add_remote(const std::string& user_id, const std::string& username)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (username_refs_.contains(username) || sessions_.contains(user_id) || remote_users_.contains(user_id))
+            return false;
+
+        remote_users_.try_emplace(user_id, username);
+        ++username_refs_[username];
+        return true;
+    }
+
+    void ConnectionManager::remove_remote(const std::string_view user_id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const auto it = remote_users_.find(user_id); it != remote_users_.end()) {
+            release_username(it->second);
+            remote_users_.erase(it);
         }
     }
 
-    void ConnectionManager::broadcast(const std::vector<uint8_t>& packet, const std::string& exclude_user)
+    size_t ConnectionManager::remote_count() const
     {
         std::lock_guard<std::mutex> lock(mutex_);
+        return remote_users_.size();
+    }
 
-        for (auto& [user_id, conn] : connections_)
-            if (user_id != exclude_user && conn->is_open())
-                try {
-                    conn->send_packet(packet);
-                }
-                catch (const std::exception& e) {
-                    std::cerr << "Error broadcasting to " << user_id << ": " << e.what() << std::endl;
-                }
+    std::shared_ptr<Session> ConnectionManager::find(const std::string_view user_id) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const auto it = sessions_.find(user_id); it != sessions_.end())
+            return it->second;
+        return nullptr;
     }
 
-    bool ConnectionManager::send_to(const std::string& user_id, const std::vector<uint8_t>& packet)
+    std::shared_ptr<const FanoutTable> ConnectionManager::fanout() const
     {
         std::lock_guard<std::mutex> lock(mutex_);
+        return fanout_;
+    }
 
-        auto it = connections_.find(user_id);
-        if (it != connections_.end() && it->second->is_open())
-            try {
-                it->second->send_packet(packet);
-                return true;
-            }
-            catch (const std::exception& e) {
-                std::cerr << "Error sending to " << user_id << ": " << e.what() << std::endl;
-                return false;
-            }
-        return false;
+    void ConnectionManager::rebuild_fanout()
+    {
+        auto table = std::make_shared<FanoutTable>();
+        table->reserve(sessions_.size());
+        for (const auto& [user_id, session] : sessions_)
+            table->push_back(session);
+        fanout_ = std::move(table);
+    }
+
+    void ConnectionManager::release_username(const std::string& username)
+    {
+        if (const auto it = username_refs_.find(username); it != username_refs_.end() && --it->second == 0)
+            username_refs_.erase(it);
+    }
+
+    void ConnectionManager::broadcast(const std::vector<uint8_t>& packet, const std::string_view exclude_user)
+    {
+        const auto shared = std::make_shared<const std::vector<uint8_t>>(packet);
+
+        for (const auto& session : *fanout())
+            if (session->user_id() != exclude_user && session->is_open())
+                session->send(shared);
+        for (const auto& link : *links())
+            if (link->is_open())
+                link->send(shared);
+    }
+
+    bool ConnectionManager::send_to(const std::string_view user_id, const std::vector<uint8_t>& packet)
+    {
+        const auto session = find(user_id);
+        return session && session->send(packet);
     }
 
     std::vector<User> ConnectionManager::get_active_users() const
@@ -110,27 +443,23 @@ namespace chat::server
         std::lock_guard<std::mutex> lock(mutex_);
 
         std::vector<User> users;
-        for (const auto& [user_id, username] : user_id_to_username_)
+        users.reserve(fanout_->size() + remote_users_.size());
+        for (const auto& session : *fanout_)
+            users.emplace_back(session->username(), session->user_id());
+        for (const auto& [user_id, username] : remote_users_)
             users.emplace_back(username, user_id);
         return users;
     }
 
-    bool ConnectionManager::username_exists(const std::string& username) const
+    bool ConnectionManager::username_exists(const std::string_view username) const
     {
         std::lock_guard<std::mutex> lock(mutex_);
-
-        return std::ranges::any_of(
-            user_id_to_username_,
-            [&](const auto& pair) {
-                return pair.second == username;
-            });
+        return username_refs_.contains(username);
     }
 
-    std::string ConnectionManager::get_username_by_user_id(const std::string& user_id) const
+    std::string ConnectionManager::get_username_by_user_id(const std::string_view user_id) const
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (const auto it = user_id_to_username_.find(user_id); it != user_id_to_username_.end())
-            return it->second;
-        return "";
+        const auto session = find(user_id);
+        return session ? session->username() : "";
     }
 } // namespace chat::server
@@ -0,0 +1,143 @@
+#include "chat/server/cursor_store.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chat::server
+{
+    namespace
+    {
+        [[noreturn]] void throw_errno(const std::string& what)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        void write_all(const int fd, const uint8_t* data, const size_t size, const uint64_t offset)
+        {
+            size_t written = 0;
+            while (written < size) {
+                const auto n = ::pwrite(fd, data + written, size - written, static_cast<off_t>(offset + written));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    throw_errno("cursor store write");
+                written += static_cast<size_t>(n);
+            }
+        }
+    }
+
+    CursorStore::CursorStore(std::string path)
+        : path_(std::move(path))
+    {
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ < 0)
+            throw_errno("open " + path_);
+        load();
+    }
+
+    CursorStore::~CursorStore()
+    {
+        if (fd_ >= 0) {
+            ::fdatasync(fd_);
+            ::close(fd_);
+        }
+    }
+
+    void CursorStore::load()
+    {
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0)
+            throw_errno("stat " + path_);
+
+        // the file is O(users), so it is read in one go
+        std::vector<uint8_t> data(static_cast<size_t>(st.st_size));
+        size_t filled = 0;
+        while (filled < data.size()) {
+            const auto n = ::pread(fd_, data.data() + filled, data.size() - filled, static_cast<off_t>(filled));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw_errno("read " + path_);
+            filled += static_cast<size_t>(n);
+        }
+
+        size_t pos = 0;
+        while (data.size() - pos >= sizeof(uint16_t)) {
+            uint16_t name_len = 0;
+            std::memcpy(&name_len, data.data() + pos, sizeof(name_len));
+            if (name_len == 0 || data.size() - pos - sizeof(uint16_t) < name_len + sizeof(uint64_t))
+                break;
+
+            std::string username(reinterpret_cast<const char*>(data.data() + pos + sizeof(uint16_t)), name_len);
+            const uint64_t seq_offset = pos + sizeof(uint16_t) + name_len;
+            uint64_t seq = 0;
+            std::memcpy(&seq, data.data() + seq_offset, sizeof(seq));
+
+            cursors_.insert_or_assign(std::move(username), std::pair{seq_offset, seq});
+            pos = seq_offset + sizeof(uint64_t);
+        }
+
+        end_offset_ = pos;
+        if (end_offset_ < data.size()) {
+            // a new user's record torn by a crash; that user starts over as never seen
+            std::cerr << "Cursor store " << path_ << ": discarding " << data.size() - end_offset_
+                << " trailing bytes" << std::endl;
+            if (::ftruncate(fd_, static_cast<off_t>(end_offset_)) != 0)
+                throw_errno("truncate " + path_);
+        }
+    }
+
+    std::optional<uint64_t> CursorStore::get(const std::string_view username) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = cursors_.find(username);
+        if (it == cursors_.end())
+            return std::nullopt;
+        return it->second.second;
+    }
+
+    void CursorStore::set(const std::string& username, const uint64_t seq)
+    {
+        if (username.empty() || username.size() > std::numeric_limits<uint16_t>::max())
+            throw std::invalid_argument("username cannot be stored in the cursor store");
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const auto it = cursors_.find(username); it != cursors_.end()) {
+            // known user: overwrite the seq field in place
+            write_all(fd_, reinterpret_cast<const uint8_t*>(&seq), sizeof(seq), it->second.first);
+            it->second.second = seq;
+            return;
+        }
+
+        std::vector<uint8_t> record(sizeof(uint16_t) + username.size() + sizeof(uint64_t));
+        const auto name_len = static_cast<uint16_t>(username.size());
+        std::memcpy(record.data(), &name_len, sizeof(name_len));
+        std::memcpy(record.data() + sizeof(uint16_t), username.data(), username.size());
+        std::memcpy(record.data() + sizeof(uint16_t) + username.size(), &seq, sizeof(seq));
+        write_all(fd_, record.data(), record.size(), end_offset_);
+
+        cursors_.insert_or_assign(username, std::pair{end_offset_ + sizeof(uint16_t) + username.size(), seq});
+        end_offset_ += record.size();
+    }
+
+    size_t CursorStore::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cursors_.size();
+    }
+
+    void CursorStore::sync() const
+    {
+        if (::fdatasync(fd_) != 0)
+            throw_errno("cursor store sync");
+    }
+} // namespace chat::server
@@ -0,0 +1,250 @@
+#include "chat/server/fanout_scheduler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iostream>
+
+namespace chat::server
+{
+    FanoutScheduler::FanoutScheduler(FanoutOptions options)
+        : options_(options)
+    {
+        options_.workers     = std::max<size_t>(options_.workers, 1);
+        options_.quantum     = std::max<size_t>(options_.quantum, 1);
+        options_.max_workers = std::max(options_.max_workers, options_.workers);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_workers_ = options_.workers;
+        workers_.reserve(options_.workers);
+        for (size_t i = 0; i < options_.workers; ++i)
+            workers_.emplace_back([this]() { worker_loop(); });
+    }
+
+    FanoutScheduler::~FanoutScheduler()
+    {
+        stop();
+    }
+
+    bool FanoutScheduler::submit(const std::string_view sender, const size_t cost, Job job)
+    {
+        bool wake = false;
+        std::vector<std::thread> exited;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_)
+                return false;
+
+            auto [it, inserted] = flows_.try_emplace(sender);
+            if (inserted) {
+                it->second         = std::make_unique<Flow>();
+                it->second->sender = std::string(sender);
+            }
+
+            Flow& flow = *it->second;
+            if (flow.jobs.size() >= options_.max_queued_jobs)
+                return false;
+
+            const auto now = Clock::now();
+            flow.jobs.push_back({std::max<size_t>(cost, 1), std::move(job), now});
+            ++pending_;
+
+            if (!flow.scheduled) {
+                flow.scheduled = true;
+                active_.push_back(&flow);
+                wake = true;
+            }
+
+            maybe_scale(now);
+            exited = take_exited();
+        }
+
+        // workers that retired have already returned, so these joins do not wait
+        for (auto& worker : exited)
+            worker.join();
+        if (wake)
+            cv_.notify_one();
+        return true;
+    }
+
+    void FanoutScheduler::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_)
+                return;
+            stopping_ = true;
+        }
+
+        cv_.notify_all();
+        for (auto& worker : workers_)
+            if (worker.joinable())
+                worker.join();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_.clear();
+        flows_.clear();
+        pending_ = 0;
+    }
+
+    size_t FanoutScheduler::pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_;
+    }
+
+    size_t FanoutScheduler::active_senders() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return flows_.size();
+    }
+
+    size_t FanoutScheduler::queued(const std::string_view sender) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = flows_.find(sender);
+        return it == flows_.end() ? 0 : it->second->jobs.size();
+    }
+
+    std::chrono::microseconds FanoutScheduler::oldest_wait() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (active_.empty())
+            return std::chrono::microseconds(0);
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - active_.front()->jobs.front().enqueued);
+    }
+
+    FanoutScheduler::PoolStats FanoutScheduler::pool_stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {live_workers_, wait_p99_, started_, retired_};
+    }
+
+    void FanoutScheduler::WaitHistogram::record(const Clock::duration wait)
+    {
+        const auto us = static_cast<uint64_t>(std::max<int64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(wait).count(), 0));
+        const size_t bucket = us == 0 ? 0 : std::min<size_t>(std::bit_width(us) - 1, buckets.size() - 1);
+        ++buckets[bucket];
+        ++count;
+    }
+
+    std::chrono::microseconds FanoutScheduler::WaitHistogram::percentile(const double p) const
+    {
+        if (count == 0)
+            return std::chrono::microseconds(0);
+
+        // linear within the bucket that holds the rank
+        const double rank = std::ceil(p * count);
+        double below      = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            if (below + buckets[i] >= rank) {
+                const double low = i == 0 ? 0.0 : static_cast<double>(uint64_t{1} << i);
+                const double width = static_cast<double>(uint64_t{1} << i);
+                return std::chrono::microseconds(static_cast<int64_t>(low + width * (rank - below) / buckets[i]));
+            }
+            below += buckets[i];
+        }
+        return std::chrono::microseconds(int64_t{1} << buckets.size());
+    }
+
+    void FanoutScheduler::maybe_scale(const Clock::time_point now)
+    {
+        if (options_.max_workers <= options_.workers || stopping_ || now < next_scale_)
+            return;
+        next_scale_ = now + options_.scale_interval;
+
+        auto p99 = waits_.percentile(0.99);
+        waits_   = {};
+
+        // workers stuck in slow jobs record no waits at all, so the oldest queued job counts too
+        if (!active_.empty())
+            p99 = std::max(p99, std::chrono::duration_cast<std::chrono::microseconds>(
+                                    now - active_.front()->jobs.front().enqueued));
+        wait_p99_ = p99;
+
+        // an idle worker will take the backlog without help
+        if (p99 <= options_.target_wait || pending_ == 0 || idle_workers_ > 0 ||
+            live_workers_ >= options_.max_workers)
+            return;
+
+        ++live_workers_;
+        ++started_;
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+
+    std::vector<std::thread> FanoutScheduler::take_exited()
+    {
+        std::vector<std::thread> exited;
+        for (const auto id : exited_) {
+            const auto it = std::ranges::find(workers_, id, &std::thread::get_id);
+            exited.push_back(std::move(*it));
+            workers_.erase(it);
+        }
+        exited_.clear();
+        return exited;
+    }
+
+    void FanoutScheduler::worker_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            ++idle_workers_;
+            const bool woken = cv_.wait_for(lock, options_.idle_timeout, [this]() {
+                return stopping_ || !active_.empty();
+            });
+            --idle_workers_;
+
+            if (!woken) {
+                // idle for a whole timeout: give the thread back, down to the configured floor
+                if (live_workers_ > options_.workers) {
+                    --live_workers_;
+                    ++retired_;
+                    exited_.push_back(std::this_thread::get_id());
+                    return;
+                }
+                continue;
+            }
+            if (stopping_)
+                return;
+
+            Flow* flow = active_.front();
+            active_.pop_front();
+            flow->deficit += options_.quantum;
+
+            // a job costing more than the quantum waits for credit from later rounds
+            while (!flow->jobs.empty() && flow->jobs.front().cost <= flow->deficit && !stopping_) {
+                auto [cost, job, enqueued] = std::move(flow->jobs.front());
+                flow->jobs.pop_front();
+                flow->deficit -= cost;
+                --pending_;
+
+                const auto now = Clock::now();
+                waits_.record(now - enqueued);
+                maybe_scale(now);
+
+                lock.unlock();
+                try {
+                    job();
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "Fanout job failed: " << e.what() << std::endl;
+                }
+                lock.lock();
+            }
+
+            if (stopping_)
+                return;
+
+            if (flow->jobs.empty()) {
+                // idle senders keep no credit and no state
+                flows_.erase(flows_.find(flow->sender));
+                continue;
+            }
+
+            active_.push_back(flow);
+            cv_.notify_one();
+        }
+    }
+} // namespace chat::server
@@ -0,0 +1,156 @@
+#include "chat/server/history_segments.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "chat/common/init_codec.hpp"
+#include "chat/common/protocol.hpp"
+
+namespace chat::server
+{
+    namespace
+    {
+        constexpr std::string_view kSegmentExtension = ".seg";
+
+        [[noreturn]] void throw_errno(const std::string& what)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+    }
+
+    struct HistorySegments::Segment
+    {
+        std::string path;
+        int fd{-1};
+        uint64_t first_seq{0};
+        std::vector<uint64_t> ends; // end offset of each frame; frame i starts where frame i - 1 ends
+
+        Segment(std::string file, const uint64_t first)
+            : path(std::move(file)), first_seq(first)
+        {
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            if (fd < 0)
+                throw_errno("open " + path);
+            ends.reserve(kSegmentMessages);
+        }
+
+        ~Segment()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+
+        Segment(const Segment&)            = delete;
+        Segment& operator=(const Segment&) = delete;
+
+        [[nodiscard]] uint64_t last_seq() const { return first_seq + ends.size() - 1; }
+
+        [[nodiscard]] uint64_t start_of(const uint64_t seq) const
+        {
+            return seq == first_seq ? 0 : ends[seq - first_seq - 1];
+        }
+
+        [[nodiscard]] uint64_t end_of(const uint64_t seq) const { return ends[seq - first_seq]; }
+    };
+
+    HistorySegments::HistorySegments(std::string dir, const size_t retain)
+        : dir_(std::move(dir)), retain_(std::max<size_t>(retain, 1))
+    {
+        // whatever a previous run left behind is rebuilt from the log by the caller
+        std::filesystem::create_directories(dir_);
+        for (const auto& entry : std::filesystem::directory_iterator(dir_))
+            if (entry.is_regular_file() && entry.path().extension() == kSegmentExtension)
+                std::filesystem::remove(entry.path());
+    }
+
+    HistorySegments::~HistorySegments() = default;
+
+    void HistorySegments::append(const Message& message)
+    {
+        const auto frame = ProtocolHelpers::make_packet(MessageType::HISTORY, InitCodec::encode_payload({message}));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!segments_.empty() && message.seq != last_seq_ + 1)
+            throw std::invalid_argument("history segments: seq " + std::to_string(message.seq) + " does not follow "
+                                        + std::to_string(last_seq_));
+
+        if (segments_.empty() || segments_.back()->ends.size() == kSegmentMessages) {
+            const auto name = std::to_string(message.seq) + std::string(kSegmentExtension);
+            segments_.push_back(std::make_shared<Segment>((std::filesystem::path(dir_) / name).string(), message.seq));
+        }
+
+        auto& segment        = *segments_.back();
+        const uint64_t start = segment.ends.empty() ? 0 : segment.ends.back();
+        size_t written       = 0;
+        while (written < frame.size()) {
+            const auto n = ::pwrite(segment.fd, frame.data() + written, frame.size() - written,
+                                    static_cast<off_t>(start + written));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                throw_errno("write " + segment.path);
+            written += static_cast<size_t>(n);
+        }
+
+        segment.ends.push_back(start + frame.size());
+        last_seq_ = message.seq;
+        retire_old();
+    }
+
+    void HistorySegments::retire_old()
+    {
+        // the oldest segment goes once the ones after it cover the retained window on their own
+        while (segments_.size() > 1 && last_seq_ - segments_[1]->first_seq + 1 >= retain_) {
+            ::unlink(segments_.front()->path.c_str());
+            segments_.pop_front();
+        }
+    }
+
+    std::optional<std::vector<FileSpan>> HistorySegments::spans(const uint64_t after, const uint64_t through) const
+    {
+        std::vector<FileSpan> result;
+        if (through <= after)
+            return result;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (segments_.empty() || after + 1 < segments_.front()->first_seq || through > last_seq_)
+            return std::nullopt;
+
+        for (const auto& segment : segments_) {
+            if (segment->last_seq() <= after)
+                continue;
+            if (segment->first_seq > through)
+                break;
+
+            const uint64_t lo    = std::max(after + 1, segment->first_seq);
+            const uint64_t hi    = std::min(through, segment->last_seq());
+            const uint64_t begin = segment->start_of(lo);
+            result.push_back({segment, segment->fd, begin, segment->end_of(hi) - begin});
+        }
+        return result;
+    }
+
+    uint64_t HistorySegments::first_seq() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return segments_.empty() ? 0 : segments_.front()->first_seq;
+    }
+
+    uint64_t HistorySegments::last_seq() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_seq_;
+    }
+
+    size_t HistorySegments::segment_count() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return segments_.size();
+    }
+} // namespace chat::server
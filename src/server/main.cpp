@@ -1,24 +1,45 @@
 #include "chat/server/server.hpp"
 #include <iostream>
-#include <csignal>
+#include <string>
 #include <cstdlib>
 
-std::unique_ptr<chat::server::Server> g_server;
-
-void signal_handler(const int signal) {
-    if (signal == SIGINT || signal == SIGTERM) {
-        std::cout << "\nShutting down server..." << std::endl;
-        if (g_server) {
-            g_server->stop();
-        }
-        exit(0);
-    }
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <port> [options]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --busy-poll <us>         spin I/O threads for <us> microseconds before blocking" << std::endl;
+    std::cerr << "  --send-timeout <ms>      close clients whose writes stall this long, 0 disables (default 30000)"
+        << std::endl;
+    std::cerr << "  --rate-limit <msgs/s>    per-user sustained message rate, 0 disables (default 20)" << std::endl;
+    std::cerr << "  --rate-burst <n>         per-user burst allowance (default 40)" << std::endl;
+    std::cerr << "  --fanout-workers <n>     broadcast fanout threads kept running (default 1)" << std::endl;
+    std::cerr << "  --fanout-max-workers <n> upper bound when autoscaling on queue wait (default: cores)" << std::endl;
+    std::cerr << "  --fanout-target-wait <us> p99 queue wait that adds a fanout thread (default 2000)" << std::endl;
+    std::cerr << "  --stats-interval <s>     print stats every <s> seconds (always on SIGUSR1)" << std::endl;
+    std::cerr << "  --stats-top <n>          heaviest users listed in stats, 0 hides them (default 5)" << std::endl;
+    std::cerr << "  --filter <path>          banned-term file, reloaded when it changes" << std::endl;
+    std::cerr << "  --pool <n>               pre-warmed connections and SRP handshakes (default 256)" << std::endl;
+    std::cerr << "  --no-compression         refuse clients' per-connection deflate offers" << std::endl;
+    std::cerr << "  --plaintext-history      send seen history unsealed, with sendfile() from segment files"
+        << std::endl;
+    std::cerr << "  --capture <path>         record inbound frame sizes and timings for chat_replay" << std::endl;
+    std::cerr << "  --kernel-timestamps      split message latency into kernel, server and network time in stats"
+        << std::endl;
+    std::cerr << "  --gateway-port <port>    accept chat_gateway links on this port (default off)" << std::endl;
+    std::cerr << "  --gateway-address <ip>   address the gateway port binds (default 127.0.0.1)" << std::endl;
+    std::cerr << "  --overload-target <us>   fanout queue wait that starts shedding load, 0 disables (default 5000)"
+        << std::endl;
+    std::cerr << "  --handshake-target <us>  SRP_INIT to challenge time that does the same, 0 disables (default 20000)"
+        << std::endl;
+    std::cerr << "  --overload-interval <ms> how long a target must be exceeded before each step (default 100)"
+        << std::endl;
+    std::cerr << "  --away-digest <s>        how often away clients get a digest, 0 only on return (default 60)"
+        << std::endl;
+    std::cerr << "Example: " << program << " 8888" << std::endl;
 }
 
 int main(const int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <port>" << std::endl;
-        std::cerr << "Example: " << argv[0] << " 8888" << std::endl;
+    if (argc < 2) {
+        print_usage(argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -30,12 +51,98 @@ int main(const int argc, char* argv[]) {
             return EXIT_FAILURE;
         }
 
-        // set up signal handlers
-        std::signal(SIGINT, signal_handler);
-        std::signal(SIGTERM, signal_handler);
+        chat::server::ServerOptions options;
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--busy-poll" && i + 1 < argc) {
+                const int busy_poll_us = std::stoi(argv[++i]);
+                if (busy_poll_us < 0) {
+                    std::cerr << "Busy-poll interval must not be negative" << std::endl;
+                    return EXIT_FAILURE;
+                }
+                options.busy_poll                      = std::chrono::microseconds(busy_poll_us);
+                options.socket_tuning.busy_poll_us     = busy_poll_us;
+                options.socket_tuning.prefer_busy_poll = busy_poll_us > 0;
+            }
+            else if (arg == "--send-timeout" && i + 1 < argc) {
+                options.socket_tuning.user_timeout_ms = std::stoi(argv[++i]);
+            }
+            else if (arg == "--rate-limit" && i + 1 < argc) {
+                options.rate_limit = std::stod(argv[++i]);
+            }
+            else if (arg == "--rate-burst" && i + 1 < argc) {
+                options.rate_burst = std::stod(argv[++i]);
+            }
+            else if (arg == "--fanout-workers" && i + 1 < argc) {
+                const int workers = std::stoi(argv[++i]);
+                if (workers < 1) {
+                    std::cerr << "Fanout workers must be at least 1" << std::endl;
+                    return EXIT_FAILURE;
+                }
+                options.fanout.workers = static_cast<size_t>(workers);
+            }
+            else if (arg == "--fanout-max-workers" && i + 1 < argc) {
+                options.fanout.max_workers = std::stoul(argv[++i]);
+            }
+            else if (arg == "--fanout-target-wait" && i + 1 < argc) {
+                options.fanout.target_wait = std::chrono::microseconds(std::stol(argv[++i]));
+            }
+            else if (arg == "--stats-interval" && i + 1 < argc) {
+                options.stats_interval = std::chrono::seconds(std::stoi(argv[++i]));
+            }
+            else if (arg == "--stats-top" && i + 1 < argc) {
+                options.stats_top_users = std::stoul(argv[++i]);
+            }
+            else if (arg == "--filter" && i + 1 < argc) {
+                options.filter_path = argv[++i];
+            }
+            else if (arg == "--pool" && i + 1 < argc) {
+                options.connection_pool = options.handshake_pool = std::stoul(argv[++i]);
+            }
+            else if (arg == "--no-compression") {
+                options.compression = false;
+            }
+            else if (arg == "--plaintext-history") {
+                options.seal_init = false;
+            }
+            else if (arg == "--capture" && i + 1 < argc) {
+                options.capture_path = argv[++i];
+            }
+            else if (arg == "--kernel-timestamps") {
+                options.kernel_timestamps = true;
+            }
+            else if (arg == "--gateway-port" && i + 1 < argc) {
+                options.gateway_port = std::stoi(argv[++i]);
+            }
+            else if (arg == "--gateway-address" && i + 1 < argc) {
+                options.gateway_address = argv[++i];
+            }
+            else if (arg == "--overload-target" && i + 1 < argc) {
+                options.fanout_overload.target = std::chrono::microseconds(std::stol(argv[++i]));
+            }
+            else if (arg == "--handshake-target" && i + 1 < argc) {
+                options.handshake_overload.target = std::chrono::microseconds(std::stol(argv[++i]));
+            }
+            else if (arg == "--away-digest" && i + 1 < argc) {
+                options.away_digest_interval = std::chrono::seconds(std::stol(argv[++i]));
+            }
+            else if (arg == "--overload-interval" && i + 1 < argc) {
+                const auto interval = std::chrono::milliseconds(std::stol(argv[++i]));
+                if (interval.count() <= 0) {
+                    std::cerr << "Overload interval must be positive" << std::endl;
+                    return EXIT_FAILURE;
+                }
+                options.fanout_overload.interval = options.handshake_overload.interval = interval;
+            }
+            else {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
 
-        g_server = std::make_unique<chat::server::Server>(port);
-        g_server->run();
+        // SIGINT and SIGTERM stop run(); the server handles them on its reactor
+        chat::server::Server server(port, options);
+        server.run();
 
         return EXIT_SUCCESS;
 
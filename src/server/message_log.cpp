@@ -0,0 +1,312 @@
+#include "chat/server/message_log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chat::server
+{
+    namespace
+    {
+        // body_len prefix and trailing checksum
+        constexpr size_t kFraming = 2 * sizeof(uint32_t);
+
+        // seq, timestamp and username length ahead of the strings
+        constexpr size_t kBodyHeader = sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint16_t);
+
+        constexpr size_t kReadChunk = 256 * 1024;
+
+        uint32_t fnv1a(const uint8_t* data, const size_t size)
+        {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= data[i];
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        template <class T>
+        T load(const uint8_t* p)
+        {
+            T value;
+            std::memcpy(&value, p, sizeof(T));
+            return value;
+        }
+
+        template <class T>
+        void store(std::vector<uint8_t>& out, const T value)
+        {
+            const auto* p = reinterpret_cast<const uint8_t*>(&value);
+            out.insert(out.end(), p, p + sizeof(T));
+        }
+
+        [[noreturn]] void throw_errno(const std::string& what)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        /**
+         * Sequential record reader over [offset, end) with one large pread per chunk
+         */
+        class RecordCursor
+        {
+        public:
+            RecordCursor(const int fd, const uint64_t offset, const uint64_t end)
+                : fd_(fd), file_pos_(offset), end_(end)
+            {
+            }
+
+            // offset of the record next() would return
+            [[nodiscard]] uint64_t offset() const { return file_pos_ - (buffer_.size() - pos_); }
+
+            // body of the next complete record, or nullptr at the end or on a torn record;
+            // valid until the next call
+            const uint8_t* next(uint32_t& body_len, const bool verify)
+            {
+                if (!ensure(sizeof(uint32_t)))
+                    return nullptr;
+                body_len = load<uint32_t>(buffer_.data() + pos_);
+                if (body_len < kBodyHeader || !ensure(kFraming + body_len))
+                    return nullptr;
+
+                const uint8_t* body = buffer_.data() + pos_ + sizeof(uint32_t);
+                if (verify && load<uint32_t>(body + body_len) != fnv1a(body, body_len))
+                    return nullptr;
+
+                pos_ += kFraming + body_len;
+                return body;
+            }
+
+        private:
+            int fd_;
+            uint64_t file_pos_;
+            uint64_t end_;
+            std::vector<uint8_t> buffer_;
+            size_t pos_{0};
+
+            bool ensure(const size_t count)
+            {
+                const size_t available = buffer_.size() - pos_;
+                if (available >= count)
+                    return true;
+                if (count - available > end_ - file_pos_)
+                    return false;
+
+                buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(pos_));
+                pos_ = 0;
+
+                const auto want = static_cast<size_t>(
+                    std::min<uint64_t>(std::max(count - available, kReadChunk), end_ - file_pos_));
+                buffer_.resize(available + want);
+
+                size_t filled = 0;
+                while (filled < want) {
+                    const auto n = ::pread(fd_, buffer_.data() + available + filled, want - filled,
+                                           static_cast<off_t>(file_pos_ + filled));
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n <= 0)
+                        throw_errno("message log read");
+                    filled += static_cast<size_t>(n);
+                }
+                file_pos_ += want;
+                return true;
+            }
+        };
+
+        Message decode_body(const uint8_t* body, const uint32_t body_len)
+        {
+            const auto seq          = load<uint64_t>(body);
+            const auto timestamp_ms = load<int64_t>(body + sizeof(uint64_t));
+            const auto name_len     = load<uint16_t>(body + sizeof(uint64_t) + sizeof(int64_t));
+
+            // name_len was checked against body_len when the record was recovered or written
+            const auto* name = reinterpret_cast<const char*>(body + kBodyHeader);
+
+            Message message;
+            message.username  = std::string(name, name_len);
+            message.text      = std::string(name + name_len, body_len - kBodyHeader - name_len);
+            message.timestamp = std::chrono::system_clock::time_point(std::chrono::milliseconds(timestamp_ms));
+            message.seq       = seq;
+            return message;
+        }
+    }
+
+    MessageLog::MessageLog(std::string path)
+        : path_(std::move(path))
+    {
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ < 0)
+            throw_errno("open " + path_);
+        recover();
+    }
+
+    MessageLog::~MessageLog()
+    {
+        if (fd_ >= 0) {
+            ::fdatasync(fd_);
+            ::close(fd_);
+        }
+    }
+
+    void MessageLog::recover()
+    {
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0)
+            throw_errno("stat " + path_);
+        const auto file_size = static_cast<uint64_t>(st.st_size);
+
+        // replay every record; the first one that is short, corrupt or out of sequence ends the log
+        RecordCursor cursor(fd_, 0, file_size);
+        uint64_t records = 0;
+        uint32_t body_len = 0;
+        while (true) {
+            const auto offset = cursor.offset();
+            const uint8_t* body = cursor.next(body_len, true);
+            if (!body)
+                break;
+
+            const auto seq      = load<uint64_t>(body);
+            const auto name_len = load<uint16_t>(body + sizeof(uint64_t) + sizeof(int64_t));
+            if (seq != last_seq_ + 1 || name_len > body_len - kBodyHeader)
+                break;
+
+            if (records % kIndexStride == 0)
+                index_.push_back({seq, offset});
+            last_seq_   = seq;
+            end_offset_ = cursor.offset();
+            ++records;
+        }
+
+        if (end_offset_ < file_size) {
+            std::cerr << "Message log " << path_ << ": discarding " << file_size - end_offset_
+                << " bytes after seq " << last_seq_ << std::endl;
+            if (::ftruncate(fd_, static_cast<off_t>(end_offset_)) != 0)
+                throw_errno("truncate " + path_);
+        }
+    }
+
+    uint64_t MessageLog::append(Message& message)
+    {
+        if (message.username.size() > std::numeric_limits<uint16_t>::max())
+            throw std::invalid_argument("username too long for the message log");
+
+        const auto timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            message.timestamp.time_since_epoch()).count();
+        const size_t body_len = kBodyHeader + message.username.size() + message.text.size();
+        if (body_len > std::numeric_limits<uint32_t>::max())
+            throw std::invalid_argument("message too large for the message log");
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t seq = last_seq_ + 1;
+
+        std::vector<uint8_t> record;
+        record.reserve(kFraming + body_len);
+        store(record, static_cast<uint32_t>(body_len));
+        store(record, seq);
+        store(record, static_cast<int64_t>(timestamp_ms));
+        store(record, static_cast<uint16_t>(message.username.size()));
+        record.insert(record.end(), message.username.begin(), message.username.end());
+        record.insert(record.end(), message.text.begin(), message.text.end());
+        store(record, fnv1a(record.data() + sizeof(uint32_t), body_len));
+
+        size_t written = 0;
+        while (written < record.size()) {
+            const auto n = ::pwrite(fd_, record.data() + written, record.size() - written,
+                                    static_cast<off_t>(end_offset_ + written));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                // leave no partial record behind for the next append to follow
+                const int saved = errno;
+                [[maybe_unused]] const auto ignored = ::ftruncate(fd_, static_cast<off_t>(end_offset_));
+                errno = saved;
+                throw_errno("message log write");
+            }
+            written += static_cast<size_t>(n);
+        }
+
+        if ((seq - 1) % kIndexStride == 0)
+            index_.push_back({seq, end_offset_});
+        end_offset_ += record.size();
+        last_seq_     = seq;
+        message.seq   = seq;
+        return seq;
+    }
+
+    std::vector<Message> MessageLog::read(const uint64_t after, uint64_t through,
+                                          const size_t max_messages, const size_t max_bytes) const
+    {
+        uint64_t start = 0, end = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            through = std::min(through, last_seq_);
+            if (after >= through || max_messages == 0)
+                return {};
+
+            // last index entry at or before the first wanted record
+            const auto it = std::upper_bound(index_.begin(), index_.end(), after + 1,
+                                             [](const uint64_t seq, const IndexEntry& e) { return seq < e.seq; });
+            start = it == index_.begin() ? 0 : std::prev(it)->offset;
+            end   = end_offset_;
+        }
+
+        // records below end are immutable, so the scan runs without the lock;
+        // they were checksummed on recovery or written by this process, so no re-verify
+        std::vector<Message> result;
+        result.reserve(static_cast<size_t>(std::min<uint64_t>(max_messages, through - after)));
+
+        RecordCursor cursor(fd_, start, end);
+        size_t bytes = 0;
+        uint32_t body_len = 0;
+        while (result.size() < max_messages && (result.empty() || bytes < max_bytes)) {
+            const uint8_t* body = cursor.next(body_len, false);
+            if (!body)
+                break;
+
+            const auto seq = load<uint64_t>(body);
+            if (seq <= after)
+                continue;
+            if (seq > through)
+                break;
+
+            result.push_back(decode_body(body, body_len));
+            bytes += body_len - kBodyHeader;
+        }
+        return result;
+    }
+
+    std::vector<Message> MessageLog::tail(const size_t count) const
+    {
+        const auto through = last_seq();
+        const auto after   = through > count ? through - count : 0;
+        return read(after, through, count, std::numeric_limits<size_t>::max());
+    }
+
+    uint64_t MessageLog::last_seq() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_seq_;
+    }
+
+    uint64_t MessageLog::size_bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return end_offset_;
+    }
+
+    void MessageLog::sync() const
+    {
+        if (::fdatasync(fd_) != 0)
+            throw_errno("message log sync");
+    }
+} // namespace chat::server
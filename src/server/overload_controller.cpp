@@ -0,0 +1,94 @@
+#include "chat/server/overload_controller.hpp"
+
+#include <cmath>
+
+namespace chat::server
+{
+    const char* to_string(const OverloadLevel level)
+    {
+        switch (level) {
+            case OverloadLevel::Normal:
+                return "normal";
+            case OverloadLevel::DeferEphemeral:
+                return "deferring ephemerals";
+            case OverloadLevel::RefuseLogins:
+                return "refusing logins";
+            case OverloadLevel::RefuseMessages:
+                return "refusing messages";
+        }
+        return "unknown";
+    }
+
+    OverloadController::OverloadController(const OverloadOptions options)
+        : options_(options)
+    {
+    }
+
+    void OverloadController::observe(const Clock::duration sojourn, const Clock::time_point now)
+    {
+        if (!enabled())
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        record(sojourn, now);
+    }
+
+    void OverloadController::tick(const Clock::time_point now)
+    {
+        if (!enabled())
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (now - last_sample_ >= options_.interval)
+            record(Clock::duration::zero(), now);
+    }
+
+    void OverloadController::record(const Clock::duration sojourn, const Clock::time_point now)
+    {
+        last_sample_ = now;
+        const uint8_t level = level_.load(std::memory_order_relaxed);
+
+        if (sojourn < options_.target) {
+            escalate_at_ = {};
+            if (level == 0)
+                return;
+
+            if (below_since_ == Clock::time_point{}) {
+                below_since_ = now;
+            }
+            else if (now - below_since_ >= options_.interval) {
+                level_.store(level - 1, std::memory_order_relaxed);
+                ++recoveries_;
+                below_since_ = level > 1 ? now : Clock::time_point{};
+            }
+            return;
+        }
+
+        below_since_ = {};
+        if (escalate_at_ == Clock::time_point{}) {
+            escalate_at_ = now + options_.interval;
+            return;
+        }
+        if (now < escalate_at_ || level + 1 >= kOverloadLevels)
+            return;
+
+        level_.store(level + 1, std::memory_order_relaxed);
+        ++escalations_;
+
+        // CoDel's control law: the longer the queue stands, the sooner the next step
+        const auto next = std::chrono::duration_cast<Clock::duration>(
+            options_.interval / std::sqrt(static_cast<double>(level + 2)));
+        escalate_at_ = now + next;
+    }
+
+    std::chrono::milliseconds OverloadController::retry_after() const
+    {
+        return options_.interval * level_.load(std::memory_order_relaxed);
+    }
+
+    OverloadController::Stats OverloadController::stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {escalations_, recoveries_};
+    }
+} // namespace chat::server
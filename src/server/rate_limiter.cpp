@@ -0,0 +1,47 @@
+#include "chat/server/rate_limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace chat::server
+{
+    TokenBucket::TokenBucket(const double rate, const double burst, const Clock::time_point now)
+        : rate_(rate),
+          burst_(std::max(burst, 1.0)),
+          tokens_(burst_),
+          last_refill_(now)
+    {
+    }
+
+    double TokenBucket::available(const Clock::time_point now) const
+    {
+        const double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+        return std::min(burst_, tokens_ + std::max(elapsed, 0.0) * rate_);
+    }
+
+    bool TokenBucket::try_acquire(const Clock::time_point now)
+    {
+        if (unlimited())
+            return true;
+
+        tokens_      = available(now);
+        last_refill_ = now;
+        if (tokens_ < 1.0)
+            return false;
+
+        tokens_ -= 1.0;
+        return true;
+    }
+
+    std::chrono::milliseconds TokenBucket::retry_after(const Clock::time_point now) const
+    {
+        if (unlimited())
+            return std::chrono::milliseconds{0};
+
+        const double missing = 1.0 - available(now);
+        if (missing <= 0.0)
+            return std::chrono::milliseconds{0};
+
+        return std::chrono::milliseconds(static_cast<int64_t>(std::ceil(missing / rate_ * 1000.0)));
+    }
+} // namespace chat::server
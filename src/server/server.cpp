@@ -1,22 +1,36 @@
 #include "chat/server/server.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <thread>
+#include <unordered_map>
 #include <iomanip>
 #include <sstream>
+#include <csignal>
 
 #include "chat/crypto/aes_engine.hpp"
 #include "chat/common/messages.hpp"
 #include "chat/common/protocol.hpp"
+#include "chat/common/stream_codec.hpp"
+#include "chat/common/init_codec.hpp"
+#include "chat/common/utf8.hpp"
+#include "chat/server/rate_limiter.hpp"
 
 namespace chat::server
 {
     namespace
     {
         constexpr size_t kMaxMessageHistory = 100;
+
+        // catch-up frames: one AES-GCM seal per batch, well under the 1 MiB frame limit
+        constexpr size_t kCatchUpBatchMessages = 1024;
+        constexpr size_t kCatchUpBatchBytes    = 256 * 1024;
+
+        // while a client stays throttled it hears about it at most this often
+        constexpr auto kSlowDownNoticeInterval = std::chrono::seconds(1);
     }
 
-    Server::Server(const int port)
+    Server::Server(const int port, ServerOptions options)
         : acceptor_(
               io_context_,
               boost::asio::ip::tcp::endpoint(
@@ -24,13 +38,49 @@ namespace chat::server
                   static_cast<boost::asio::ip::port_type>(port)
               )
           ),
-          srp_server_(std::make_unique<auth::SRPServer>()),
+          srp_server_(std::make_unique<auth::SRPServer>(options.handshake_pool)),
           connection_manager_(std::make_unique<ConnectionManager>()),
           next_user_id_(1),
           running_(false),
-          port_(port)
+          port_(port),
+          options_(std::move(options)),
+          fanout_scheduler_(std::make_unique<FanoutScheduler>(options_.fanout)),
+          text_filter_(options_.filter_path),
+          connection_pool_(options_.connection_pool,
+                           [this]() { return std::make_unique<Connection>(io_context_); },
+                           [](Connection& conn) { conn.reset(); }),
+          fanout_overload_(options_.fanout_overload),
+          handshake_overload_(options_.handshake_overload),
+          stats_signals_(io_context_, SIGUSR1),
+          shutdown_signals_(io_context_, SIGINT, SIGTERM),
+          stats_timer_(io_context_),
+          filter_timer_(io_context_),
+          overload_timer_(io_context_),
+          digest_timer_(io_context_)
     {
+        // lets pipelining clients put SRP_INIT in the SYN
+        SocketHelpers::enable_fastopen_listen(acceptor_);
+
         srp_server_->load_users("users.db");
+
+        message_log_     = std::make_unique<MessageLog>(options_.history_path);
+        cursors_         = std::make_unique<CursorStore>(options_.cursor_path);
+        message_history_ = message_log_->tail(kMaxMessageHistory);
+
+        if (!options_.capture_path.empty())
+            capture_ = std::make_shared<TrafficCapture>(options_.capture_path);
+        if (options_.kernel_timestamps)
+            wire_latency_ = std::make_shared<WireLatency>();
+
+        if (options_.gateway_port != 0)
+            gateway_acceptor_.emplace(io_context_,
+                                      boost::asio::ip::tcp::endpoint(
+                                          boost::asio::ip::make_address(options_.gateway_address),
+                                          static_cast<boost::asio::ip::port_type>(options_.gateway_port)));
+
+        segments_ = std::make_unique<HistorySegments>(options_.segment_dir, kMaxMessageHistory);
+        for (const auto& message : message_history_)
+            append_segment(message);
     }
 
     Server::~Server()
@@ -38,33 +88,79 @@ namespace chat::server
         if (srp_server_)
             srp_server_->save_users("users.db");
         stop();
+        shutdown();
     }
 
-    std::optional<std::string> Server::handle_srp_authentication(const std::shared_ptr<Connection>& conn)
+    std::shared_ptr<Session> Server::handle_srp_authentication(const std::shared_ptr<Connection>& conn)
     {
+        // thread CPU time excludes waiting on the client, so the whole exchange can be timed;
+        // only existing users are charged, which keeps made-up names out of the ledger
+        uint64_t cpu_started = thread_cpu_ns();
+
         try {
             auth::SRPServer::ChallengeResponse challenge;
             std::string username;
+            auto compression = Compression::None;
 
             while (true) {
                 // wait for SRP_INIT or SRP_REGISTER
                 auto [type, msg] = conn->receive_packet();
 
+                // HELLO comes first; both ends go by the intersection the ack carries
+                if (type == MessageType::HELLO) {
+                    const auto hello    = Protocol::try_decode<HelloMsg>(msg);
+                    const auto features = hello ? PeerFeatures::negotiate(hello->version, hello->capabilities,
+                                                                          kProtocolVersion, supported_capabilities())
+                                                : PeerFeatures{};
+                    conn->set_features(features);
+                    conn->send_packet(Protocol::encode(MessageType::HELLO_ACK,
+                                                       HelloMsg{features.version, features.capabilities}));
+                    continue;
+                }
+
+                // the offer is pipelined ahead of SRP_INIT; anything but an exact match stays uncompressed,
+                // as does a peer whose HELLO did not settle on Compression (which needs options_.compression)
+                if (type == MessageType::COMPRESS_OFFER) {
+                    const auto offer = Protocol::try_decode<CompressionMsg>(msg);
+                    compression      = conn->features().has(Capability::Compression) && offer &&
+                                  offer->algorithm == static_cast<uint8_t>(Compression::Deflate) &&
+                                  offer->dictionary_id == dictionary_id(chat_dictionary())
+                                           ? Compression::Deflate
+                                           : Compression::None;
+                    conn->send_packet(Protocol::encode(MessageType::COMPRESS_ACK, CompressionMsg{
+                                                           static_cast<uint8_t>(compression),
+                                                           dictionary_id(chat_dictionary())
+                                                       }));
+                    continue;
+                }
+
                 if (type == MessageType::SRP_REGISTER) {
-                    handle_srp_register(conn, msg);
+                    handle_srp_register(conn, msg); // charges itself
+                    cpu_started = thread_cpu_ns();
                     continue;
                 }
 
                 if (type != MessageType::SRP_INIT) {
                     conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Expected SRP_INIT"}));
-                    return std::nullopt;
+                    return nullptr;
+                }
+
+                // overloaded: turn the login away before paying for any of the SRP math
+                if (overload_level() >= OverloadLevel::RefuseLogins) {
+                    stats_.overload_logins_refused.fetch_add(1, std::memory_order_relaxed);
+                    conn->send_packet(Protocol::encode(MessageType::RETRY_LATER, RetryLaterMsg{
+                                                           static_cast<uint16_t>(MessageType::SRP_INIT),
+                                                           overload_retry_after_ms()
+                                                       }));
+                    return nullptr;
                 }
+                const auto init_received = OverloadController::Clock::now();
 
                 // parse SRP_INIT
                 auto [init_username, A_b64] = Protocol::decode<SrpInitMsg>(msg);
                 if (init_username.empty() || A_b64.empty()) {
                     conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Invalid SRP_INIT"}));
-                    return std::nullopt;
+                    return nullptr;
                 }
 
                 // decode A
@@ -74,6 +170,7 @@ namespace chat::server
                 try {
                     challenge = srp_server_->init_authentication(init_username, A);
                     username  = std::move(init_username);
+                    handshake_overload_.observe(OverloadController::Clock::now() - init_received);
                     break;
                 }
                 catch (const std::exception&) {
@@ -81,6 +178,14 @@ namespace chat::server
                 }
             }
 
+            // handshake state goes back to the pool once the proof is checked, or on any early exit
+            struct ReleaseHandshake
+            {
+                auth::SRPServer& srp;
+                const std::string& user_id;
+                ~ReleaseHandshake() { srp.clear_session(user_id); }
+            } release_handshake{*srp_server_, challenge.user_id};
+
             // send SRP_CHALLENGE
             conn->send_packet(Protocol::encode(MessageType::SRP_CHALLENGE, SrpChallengeMsg{
                                                    challenge.user_id,
@@ -93,19 +198,19 @@ namespace chat::server
             auto [response_type, response_payload] = conn->receive_packet();
             if (response_type != MessageType::SRP_RESPONSE) {
                 conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Expected SRP_RESPONSE"}));
-                return std::nullopt;
+                return nullptr;
             }
 
             // parse SRP_RESPONSE
             auto [response_user_id, response_M_b64] = Protocol::decode<SrpResponseMsg>(response_payload);
             if (response_user_id != challenge.user_id) {
                 conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Invalid user_id"}));
-                return std::nullopt;
+                return nullptr;
             }
 
             if (connection_manager_->username_exists(username)) {
                 conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"User already logged in"}));
-                return std::nullopt;
+                return nullptr;
             }
 
             // decode M and verify
@@ -113,48 +218,81 @@ namespace chat::server
             auth::SRPServer::VerifyResponse verify;
             try {
                 verify = srp_server_->verify_authentication(response_user_id, M);
+                srp_server_->clear_session(response_user_id);
             }
             catch (const std::exception& e) {
+                usage_.charge(username, {.login_ns = thread_cpu_ns() - cpu_started});
                 conn->send_packet(
                     Protocol::encode(
                         MessageType::ERROR_MSG, ErrorMsg{"Authentication failed: " + std::string(e.what())}
                     )
                 );
-                return std::nullopt;
+                return nullptr;
             }
 
             // send SRP_SUCCESS
             conn->send_packet(
                 Protocol::encode(
                     MessageType::SRP_SUCCESS,
-                    SrpSuccessMsg{
-                        auth::SRPUtils::bytes_to_base64(verify.H_AMK),
-                        auth::SRPUtils::bytes_to_base64(verify.session_key)
-                    }
+                    SrpSuccessMsg{auth::SRPUtils::bytes_to_base64(verify.H_AMK)}
                 ));
 
             std::string user_id = response_user_id;
-            auto session_key    = auth::SRPUtils::base64_to_bytes(
-                std::string(verify.session_key.begin(), verify.session_key.end()));
-            if (session_key.size() != crypto::AESEngine::KEY_SIZE) {
-                conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Invalid session key size"}));
-                return std::nullopt;
-            }
-
-            connection_manager_->add(user_id, username, conn);
-            {
-                std::lock_guard<std::mutex> lock(user_keys_mutex_);
-                user_keys_[user_id] = std::move(session_key);
-            }
+            auto session = connection_manager_->add(user_id, username, conn,
+                                                    crypto::derive_session_keys(verify.K), compression);
+            if (compression != Compression::None)
+                stats_.compressed_sessions.fetch_add(1, std::memory_order_relaxed);
+            const auto& peer = conn->features();
+            (peer.version > 0 ? stats_.hello_sessions : stats_.legacy_sessions).fetch_add(1, std::memory_order_relaxed);
 
             std::cout << "User '" << username << "' (ID: " << user_id << ") authenticated successfully" << std::endl;
 
+            // INIT carries the part of the recent window the user has already seen and the user
+            // list, sealed as one INIT_SEALED frame; with sealing off the window goes ahead of it
+            // as HISTORY frames streamed from the segment files. Everything past their cursor
+            // follows as CATCH_UP, read straight from the log. A first login starts the cursor at
+            // the end of the log. Each step falls back to what the client negotiated: without
+            // Batching nothing is sealed, without BinaryFields the window goes into a v1 INIT, and
+            // without Resume that INIT takes the whole window and there is no CATCH_UP.
+            const bool sealed = options_.seal_init && peer.has(Capability::Batching);
+            const bool resume = peer.has(Capability::Resume);
+            uint64_t cursor = 0, through = 0;
             {
                 std::lock_guard<std::mutex> lock(message_mutex_);
-                auto users = connection_manager_->get_active_users();
-                conn->send_packet(Protocol::encode(
-                    MessageType::INIT,
-                    InitMsg{message_history_, std::move(users)}));
+                std::tie(cursor, through) = join_range(username);
+                const uint64_t seen_through = resume ? cursor : through;
+
+                // the segment files are shared by every joiner, so they cannot be sealed per session
+                const auto seen_end = std::ranges::upper_bound(message_history_, seen_through, {}, &Message::seq);
+                const bool streamed = !sealed && peer.has(Capability::BinaryFields);
+                std::optional<std::vector<FileSpan>> spans;
+                if (streamed)
+                    spans = std::vector<FileSpan>{};
+                if (streamed && seen_end != message_history_.begin())
+                    spans = segments_->spans(message_history_.front().seq - 1, seen_through);
+
+                std::vector<Message> seen;
+                if (spans) {
+                    uint64_t span_bytes = 0;
+                    for (const auto& span : *spans) {
+                        span_bytes += span.length;
+                        session->send_file(span);
+                    }
+                    stats_.history_sendfile_bytes.fetch_add(span_bytes, std::memory_order_relaxed);
+                    usage_.charge(username, {.bytes_out = span_bytes});
+                }
+                else {
+                    // sealed, v1, or the segments could not be written: the window is encoded into INIT
+                    seen.assign(message_history_.begin(), seen_end);
+                    if (!sealed)
+                        stats_.history_encoded_joins.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                const auto users = connection_manager_->get_active_users();
+                auto init        = sealed ? seal_init(seen, users, session->sealer())
+                                          : InitCodec::encode(peer, seen, users);
+                usage_.charge(username, {.bytes_out = init.size()});
+                session->send(std::move(init));
             }
 
             connection_manager_->broadcast(
@@ -163,13 +301,22 @@ namespace chat::server
                     UserJoinedMsg{username, user_id}
                 ), user_id); // exclude the new user from broadcast
 
-            return user_id;
+            if (!resume)
+                save_cursor(username, through);
+            const bool caught_up = !resume || send_catch_up(*session, cursor, through);
+            usage_.charge(username, {.login_ns = thread_cpu_ns() - cpu_started});
+            if (!caught_up) {
+                handle_disconnect(*session, false);
+                return nullptr;
+            }
+
+            return session;
         }
         catch (const std::exception& e) {
             std::cerr << "SRP authentication error: " << e.what() << std::endl;
             conn->send_packet(Protocol::encode(MessageType::ERROR_MSG,
                                                ErrorMsg{"Authentication error: " + std::string(e.what())}));
-            return std::nullopt;
+            return nullptr;
         }
     }
 
@@ -177,6 +324,8 @@ namespace chat::server
         const std::shared_ptr<Connection>& conn,
         const std::vector<uint8_t>& payload)
     {
+        const uint64_t cpu_started = thread_cpu_ns();
+
         auto [username, salt_b64, verifier_b64] = Protocol::decode<SrpRegisterMsg>(payload);
         if (username.empty() || salt_b64.empty() || verifier_b64.empty()) {
             conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Invalid registration data"}));
@@ -202,6 +351,7 @@ namespace chat::server
 
             // save the database immediately
             srp_server_->save_users("users.db");
+            usage_.charge(username, {.login_ns = thread_cpu_ns() - cpu_started});
         }
         else {
             conn->send_packet(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Registration failed"}));
@@ -214,11 +364,49 @@ namespace chat::server
         running_ = true;
 
         start_accept();
+        if (gateway_acceptor_)
+            start_gateway_accept();
+        wait_shutdown_signal();
+        start_stats_reporting();
+        if (!options_.filter_path.empty() && options_.filter_reload_interval.count() > 0)
+            wait_filter_reload();
+        if (fanout_overload_.enabled() || handshake_overload_.enabled())
+            wait_overload_tick();
+        if (options_.away_digest_interval.count() > 0)
+            wait_digest_tick();
 
         std::cout << "Server listening on port " << port_ << std::endl;
+        if (gateway_acceptor_)
+            std::cout << "Gateway links on " << gateway_acceptor_->local_endpoint() << std::endl;
         std::cout << "Waiting for connections..." << std::endl;
 
-        io_context_.run();
+        run_reactor();
+        shutdown();
+    }
+
+    void Server::run_reactor()
+    {
+        if (options_.busy_poll.count() == 0) {
+            io_context_.run();
+            return;
+        }
+
+        std::cout << "Busy-poll mode: spinning " << options_.busy_poll.count() << "us before blocking" << std::endl;
+
+        // poll without sleeping while events keep arriving, block once the reactor stays idle
+        auto idle_since = std::chrono::steady_clock::now();
+        while (running_ && !io_context_.stopped()) {
+            if (io_context_.poll() > 0) {
+                idle_since = std::chrono::steady_clock::now();
+                continue;
+            }
+
+            if (std::chrono::steady_clock::now() - idle_since < options_.busy_poll)
+                continue;
+
+            io_context_.run_one();
+            idle_since = std::chrono::steady_clock::now();
+        }
     }
 
     void Server::stop()
@@ -228,18 +416,303 @@ namespace chat::server
         }
     }
 
+    void Server::wait_shutdown_signal()
+    {
+        // delivered on the reactor, so the teardown in run() happens on its thread, not in a handler
+        shutdown_signals_.async_wait([this](const boost::system::error_code& error, int) {
+            if (error)
+                return;
+            std::cout << "\nShutting down server..." << std::endl;
+            stop();
+        });
+    }
+
+    void Server::shutdown()
+    {
+        if (fanout_scheduler_)
+            fanout_scheduler_->stop();
+
+        // connection threads may still hold the capture when the process exits
+        if (capture_)
+            capture_->flush();
+    }
+
+    void Server::start_stats_reporting()
+    {
+        wait_stats_signal();
+        if (options_.stats_interval.count() > 0)
+            wait_stats_timer();
+    }
+
+    void Server::wait_stats_signal()
+    {
+        stats_signals_.async_wait([this](const boost::system::error_code& error, int) {
+            if (error)
+                return;
+            dump_stats(std::cout);
+            wait_stats_signal();
+        });
+    }
+
+    void Server::wait_stats_timer()
+    {
+        stats_timer_.expires_after(options_.stats_interval);
+        stats_timer_.async_wait([this](const boost::system::error_code& error) {
+            if (error)
+                return;
+            dump_stats(std::cout);
+            wait_stats_timer();
+        });
+    }
+
+    void Server::wait_filter_reload()
+    {
+        filter_timer_.expires_after(options_.filter_reload_interval);
+        filter_timer_.async_wait([this](const boost::system::error_code& error) {
+            if (error)
+                return;
+            text_filter_.reload_if_changed();
+            wait_filter_reload();
+        });
+    }
+
+    void Server::wait_overload_tick()
+    {
+        auto period = std::chrono::milliseconds::max();
+        if (fanout_overload_.enabled())
+            period = std::min(period, options_.fanout_overload.interval);
+        if (handshake_overload_.enabled())
+            period = std::min(period, options_.handshake_overload.interval);
+
+        overload_timer_.expires_after(period);
+        overload_timer_.async_wait([this](const boost::system::error_code& error) {
+            if (error)
+                return;
+
+            // a worker stuck in a slow job dequeues nothing, so the head of the queue speaks for it
+            if (fanout_scheduler_->pending() > 0)
+                fanout_overload_.observe(fanout_scheduler_->oldest_wait());
+            fanout_overload_.tick();
+            handshake_overload_.tick();
+
+            if (overload_level() < OverloadLevel::DeferEphemeral)
+                flush_deferred_ephemerals();
+            wait_overload_tick();
+        });
+    }
+
+    void Server::wait_digest_tick()
+    {
+        digest_timer_.expires_after(options_.away_digest_interval);
+        digest_timer_.async_wait([this](const boost::system::error_code& error) {
+            if (error)
+                return;
+
+            // sealing and sending run on the fanout workers, queued under the recipient;
+            // a digest turned away by a full queue goes out on the next tick
+            const auto sessions = connection_manager_->fanout();
+            for (const auto& session : *sessions) {
+                if (!session->away() || !session->is_open())
+                    continue;
+                fanout_scheduler_->submit(session->user_id(), 1, [this, session]() {
+                    uint64_t through = 0;
+                    {
+                        std::lock_guard<std::mutex> lock(message_mutex_);
+                        through = delivered_seq();
+                    }
+                    send_digest(*session, through);
+                });
+            }
+            wait_digest_tick();
+        });
+    }
+
+    OverloadLevel Server::overload_level() const
+    {
+        return std::max(fanout_overload_.level(), handshake_overload_.level());
+    }
+
+    uint32_t Server::overload_retry_after_ms() const
+    {
+        return static_cast<uint32_t>(
+            std::max(fanout_overload_.retry_after(), handshake_overload_.retry_after()).count());
+    }
+
+    bool Server::refuse_message(const std::string& user_id) const
+    {
+        return overload_level() >= OverloadLevel::RefuseMessages && fanout_scheduler_->queued(user_id) > 0;
+    }
+
+    uint32_t Server::supported_capabilities() const
+    {
+        // GroupKey is not implemented; sessions keep their own keys
+        uint32_t supported = Capability::BinaryFields | Capability::Resume;
+        if (options_.seal_init)
+            supported = supported | Capability::Batching;
+        if (options_.compression)
+            supported = supported | Capability::Compression;
+        return supported;
+    }
+
+    void Server::flush_deferred_ephemerals()
+    {
+        std::unordered_map<uint64_t, DeferredEphemeral> deferred;
+        {
+            std::lock_guard<std::mutex> lock(deferred_mutex_);
+            if (deferred_ephemerals_.empty())
+                return;
+            deferred.swap(deferred_ephemerals_);
+        }
+
+        // only the latest state of senders still in the room is worth sending
+        for (auto& [key, ephemeral] : deferred) {
+            if (connection_manager_->username_exists(ephemeral.username))
+                handle_ephemeral(ephemeral.user_id, ephemeral.username, ephemeral.kind, std::move(ephemeral.text));
+        }
+    }
+
+    void Server::dump_stats(std::ostream& out) const
+    {
+        uint64_t messages_received = 0, bytes_received = 0, packets_sent = 0, bytes_sent = 0;
+        uint64_t send_errors = 0, malformed_frames = 0, queued = 0;
+        uint64_t ephemeral_collapsed = 0, ephemeral_dropped = 0, away = 0;
+        const auto pool = fanout_scheduler_->pool_stats();
+
+        const auto sessions = connection_manager_->fanout();
+        for (const auto& session : *sessions) {
+            const auto& s = session->stats();
+            messages_received += s.messages_received.load(std::memory_order_relaxed);
+            bytes_received += s.bytes_received.load(std::memory_order_relaxed);
+            packets_sent += s.packets_sent.load(std::memory_order_relaxed);
+            bytes_sent += s.bytes_sent.load(std::memory_order_relaxed);
+            send_errors += s.send_errors.load(std::memory_order_relaxed);
+            malformed_frames += s.malformed_frames.load(std::memory_order_relaxed);
+            ephemeral_collapsed += s.ephemeral_collapsed.load(std::memory_order_relaxed);
+            ephemeral_dropped += s.ephemeral_dropped.load(std::memory_order_relaxed);
+            queued += session->queued();
+            away += session->away() ? 1 : 0;
+        }
+
+        out << "=== server stats ===\n"
+            << "sessions:          " << sessions->size() << "\n"
+            << "received:          " << messages_received << " msgs, " << bytes_received << " bytes\n"
+            << "sent:              " << packets_sent << " packets, " << bytes_sent << " bytes, "
+            << queued << " queued\n"
+            << "errors:            " << send_errors << " send, " << malformed_frames << " malformed\n"
+            << "evicted:           " << stats_.evicted_queue_full.load(std::memory_order_relaxed)
+            << " queue full, " << stats_.evicted_send_timeout.load(std::memory_order_relaxed) << " send timeout\n"
+            << "throttled:         " << stats_.messages_throttled.load(std::memory_order_relaxed)
+            << " rate limit, " << stats_.fanout_rejected.load(std::memory_order_relaxed) << " fanout queue full\n"
+            << "fanout:            " << stats_.fanout_jobs.load(std::memory_order_relaxed) << " jobs, "
+            << stats_.fanout_recipients.load(std::memory_order_relaxed) << " recipients, "
+            << fanout_scheduler_->pending() << " pending, " << fanout_scheduler_->active_senders()
+            << " active senders\n"
+            << "fanout pool:       " << pool.workers << " workers, p99 wait " << pool.wait_p99.count() << " us, "
+            << pool.started << " started, " << pool.retired << " retired\n"
+            << "history:           " << message_log_->last_seq() << " messages, " << message_log_->size_bytes()
+            << " bytes on disk, " << cursors_->size() << " cursors\n"
+            << "catch-up:          " << stats_.catch_up_frames.load(std::memory_order_relaxed) << " frames, "
+            << stats_.catch_up_messages.load(std::memory_order_relaxed) << " messages\n"
+            << "history segments:  " << segments_->segment_count() << " files, "
+            << stats_.history_sendfile_bytes.load(std::memory_order_relaxed) << " bytes sent with sendfile, "
+            << stats_.history_encoded_joins.load(std::memory_order_relaxed) << " joins encoded\n"
+            << "sealed INIT:       " << stats_.sealed_inits.load(std::memory_order_relaxed) << " frames, "
+            << stats_.sealed_init_bytes.load(std::memory_order_relaxed) << " bytes\n"
+            << "text filter:       " << text_filter_.current()->size() << " terms, "
+            << stats_.messages_invalid_utf8.load(std::memory_order_relaxed) << " invalid UTF-8, "
+            << stats_.messages_redacted.load(std::memory_order_relaxed) << " redacted, "
+            << stats_.messages_blocked.load(std::memory_order_relaxed) << " blocked\n"
+            << "ephemeral:         " << stats_.ephemeral_relayed.load(std::memory_order_relaxed) << " relayed, "
+            << stats_.ephemeral_shed.load(std::memory_order_relaxed) << " shed at sender, " << ephemeral_collapsed
+            << " collapsed, " << ephemeral_dropped << " dropped in queues\n"
+            << "compression:       " << stats_.compressed_sessions.load(std::memory_order_relaxed) << " sessions, "
+            << stats_.compression_plain_bytes.load(std::memory_order_relaxed) << " text bytes as "
+            << stats_.compression_wire_bytes.load(std::memory_order_relaxed) << " deflated\n"
+            << "capabilities:      " << stats_.hello_sessions.load(std::memory_order_relaxed) << " negotiated, "
+            << stats_.legacy_sessions.load(std::memory_order_relaxed) << " legacy sessions\n"
+            << "away:              " << away << " sessions, " << stats_.away_changes.load(std::memory_order_relaxed)
+            << " switches, " << stats_.away_skipped.load(std::memory_order_relaxed) << " sends skipped, "
+            << stats_.digests_sent.load(std::memory_order_relaxed) << " digests ("
+            << stats_.digest_messages.load(std::memory_order_relaxed) << " messages)\n";
+
+        if (fanout_overload_.enabled() || handshake_overload_.enabled()) {
+            const auto fanout = fanout_overload_.stats(), handshake = handshake_overload_.stats();
+            out << "overload:          " << to_string(overload_level()) << " (fanout "
+                << to_string(fanout_overload_.level()) << ", handshake " << to_string(handshake_overload_.level())
+                << "), " << fanout.escalations + handshake.escalations << " escalations, "
+                << fanout.recoveries + handshake.recoveries << " recoveries\n"
+                << "overload shed:     " << stats_.overload_logins_refused.load(std::memory_order_relaxed)
+                << " logins refused, " << stats_.overload_messages_refused.load(std::memory_order_relaxed)
+                << " messages refused, " << stats_.overload_ephemerals_deferred.load(std::memory_order_relaxed)
+                << " ephemerals deferred (" << stats_.overload_ephemerals_replaced.load(std::memory_order_relaxed)
+                << " superseded)\n";
+        }
+
+        const auto print_pool = [&out](const char* label, const PoolStats& p) {
+            out << label << p.in_use << " in use, " << p.idle << "/" << p.capacity << " idle, " << p.reused
+                << " reused, " << p.created << " created\n";
+        };
+        print_pool("connection pool:   ", connection_pool_.stats());
+        print_pool("handshake pool:    ", srp_server_->session_pool_stats());
+        if (gateway_acceptor_) {
+            out << "gateways:          " << connection_manager_->links()->size() << " links, "
+                << connection_manager_->remote_count() << " users, "
+                << stats_.gateway_streams.load(std::memory_order_relaxed) << " streams opened, "
+                << stats_.gateway_copies.load(std::memory_order_relaxed) << " broadcast copies\n";
+        }
+        if (wire_latency_)
+            wire_latency_->dump(out);
+        if (capture_) {
+            out << "capture:           " << capture_->frames() << " frames to " << options_.capture_path
+                << (capture_->failed() ? " (stopped on a write error)" : "") << "\n";
+        }
+
+        if (options_.stats_top_users > 0) {
+            out << "top users by CPU:  user  cpu ms (login/ingress/fanout)  msgs  in/out/fanout bytes  recipients\n";
+            const auto ms    = [](const uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+            const auto flags = out.flags();
+            const auto precision = out.precision();
+            for (const auto& [username, usage] : usage_.top(options_.stats_top_users)) {
+                out << "  " << std::left << std::setw(16) << username << std::right << std::fixed
+                    << std::setprecision(1) << ms(usage.cpu_ns()) << " (" << ms(usage.login_ns) << "/"
+                    << ms(usage.ingress_ns) << "/" << ms(usage.fanout_ns) << ")  " << usage.messages << "  "
+                    << usage.bytes_in << "/" << usage.bytes_out << "/" << usage.fanout_bytes << "  "
+                    << usage.fanout_recipients << "\n";
+            }
+            out.flags(flags);
+            out.precision(precision);
+        }
+        out << std::flush;
+    }
+
+    void Server::tune_socket(boost::asio::ip::tcp::socket& socket)
+    {
+        // the same options fail the same way on every socket, e.g. SO_BUSY_POLL without CAP_NET_ADMIN
+        if (!SocketHelpers::apply_tuning(socket, options_.socket_tuning))
+            std::call_once(tuning_warning_, []() {
+                std::cerr << "Warning: some socket options were rejected by the kernel"
+                    << " (busy-poll above net.core.busy_read needs CAP_NET_ADMIN); not repeated" << std::endl;
+            });
+    }
+
     void Server::start_accept()
     {
-        auto conn   = std::make_shared<Connection>(io_context_);
+        auto conn   = connection_pool_.acquire();
         auto lambda = [this, conn](const boost::system::error_code& error) {
             if (!error) {
                 std::cout << "New connection from " << conn->socket().remote_endpoint() << std::endl;
 
+                tune_socket(conn->socket());
+                conn->set_busy_poll(options_.busy_poll);
+                if (wire_latency_ && !conn->set_timestamping(wire_latency_))
+                    std::cerr << "Warning: kernel timestamping was rejected by the kernel" << std::endl;
+                if (capture_)
+                    conn->set_capture(capture_, next_connection_id_.fetch_add(1, std::memory_order_relaxed) + 1);
+
                 // handle client in a separate thread
                 std::thread([this, conn]() {
-                    const auto user_id = this->handle_srp_authentication(conn);
-                    if (user_id.has_value())
-                        this->handle_client(conn, user_id.value());
+                    if (const auto session = this->handle_srp_authentication(conn))
+                        this->handle_client(session);
                 }).detach();
             }
             else
@@ -252,59 +725,221 @@ namespace chat::server
         acceptor_.async_accept(conn->socket(), lambda);
     }
 
-    void Server::handle_client(const std::shared_ptr<Connection>& conn, const std::string& user_id)
+    void Server::start_gateway_accept()
     {
-        const std::string username = connection_manager_->get_username_by_user_id(user_id);
-        try {
-            // message loop
-            while (conn->is_open() && running_) {
-                switch (auto [type, payload] = conn->receive_packet(); type) {
-                    case MessageType::MESSAGE: {
-                        const auto& [ciphertext_b64] = Protocol::decode<TextMsg>(payload);
-
-                        std::vector<uint8_t> key;
-                        {
-                            std::lock_guard<std::mutex> lock(user_keys_mutex_);
-                            if (const auto it = user_keys_.find(user_id); it != user_keys_.end())
-                                key = it->second;
-                        }
+        auto conn = std::make_shared<Connection>(io_context_);
+        gateway_acceptor_->async_accept(conn->socket(), [this, conn](const boost::system::error_code& error) {
+            if (!error) {
+                std::cout << "Gateway link from " << conn->socket().remote_endpoint() << std::endl;
 
-                        if (key.empty()) {
-                            conn->send_packet(
-                                Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Missing session key"}));
-                            break;
-                        }
+                tune_socket(conn->socket());
+
+                std::thread([this, conn]() { this->handle_gateway(conn); }).detach();
+            }
+            else
+                std::cerr << "Gateway accept error: " << error.message() << std::endl;
+
+            if (running_)
+                this->start_gateway_accept();
+        });
+    }
+
+    void Server::handle_client(const std::shared_ptr<Session>& session)
+    {
+        Connection& conn = session->connection();
+        auto& stats      = session->stats();
+
+        // the bucket is only touched by this thread, so it lives here rather than on the session
+        TokenBucket bucket = options_.rate_limit > 0
+                                 ? TokenBucket(options_.rate_limit, options_.rate_burst)
+                                 : TokenBucket();
+        TokenBucket ephemeral_bucket = options_.ephemeral_rate > 0
+                                           ? TokenBucket(options_.ephemeral_rate, options_.ephemeral_burst)
+                                           : TokenBucket();
+        uint32_t dropped_since_notice = 0;
+        auto next_notice              = TokenBucket::Clock::time_point{};
+
+        // inbound half of the negotiated compression, read by this thread only
+        std::optional<InflateStream> inflate;
+        if (session->compression() == Compression::Deflate)
+            inflate.emplace();
+
+        const auto throttle = [&](std::atomic<uint64_t>& counter) {
+            counter.fetch_add(1, std::memory_order_relaxed);
+            stats.messages_throttled.fetch_add(1, std::memory_order_relaxed);
+            ++dropped_since_notice;
+
+            const auto now = TokenBucket::Clock::now();
+            if (now < next_notice)
+                return;
+
+            const auto retry_after = static_cast<uint32_t>(bucket.retry_after(now).count());
+            session->send(Protocol::encode(MessageType::SLOW_DOWN, SlowDownMsg{dropped_since_notice, retry_after}));
+            dropped_since_notice = 0;
+            next_notice          = now + kSlowDownNoticeInterval;
+        };
+
+        // message loop: disconnects and malformed frames are error codes, nothing here throws per frame
+        while (conn.is_open() && running_) {
+            // everything this thread does for the frame is the sender's cost, from the read on
+            const uint64_t cpu_started = thread_cpu_ns();
+            auto packet = conn.try_receive_packet();
+            if (!packet)
+                break;
+
+            UserUsage frame{.bytes_in = sizeof(MsgHeader) + packet->second.size()};
+            switch (auto& [type, payload] = *packet; type) {
+                case MessageType::MESSAGE: {
+                    stats.messages_received.fetch_add(1, std::memory_order_relaxed);
+                    stats.bytes_received.fetch_add(sizeof(MsgHeader) + payload.size(), std::memory_order_relaxed);
+
+                    // over the limit: drop before paying for decode and decryption
+                    if (!bucket.try_acquire()) {
+                        throttle(stats_.messages_throttled);
+                        break;
+                    }
+                    if (refuse_message(session->user_id())) {
+                        stats_.overload_messages_refused.fetch_add(1, std::memory_order_relaxed);
+                        session->send(Protocol::encode(MessageType::RETRY_LATER, RetryLaterMsg{
+                                                           static_cast<uint16_t>(MessageType::MESSAGE),
+                                                           overload_retry_after_ms()
+                                                       }));
+                        break;
+                    }
+
+                    const auto msg = Protocol::try_decode<TextMsg>(payload);
+                    if (!msg) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+
+                    if (!session->keyed()) {
+                        session->send(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"Missing session key"}));
+                        break;
+                    }
+
+                    const auto encrypted = auth::SRPUtils::base64_to_bytes(msg->ciphertext_b64);
+                    auto text            = inflate ? inflate_text(*inflate, encrypted, session->receive_key())
+                                                   : crypto::AESEngine::try_decrypt_string(encrypted, session->receive_key());
+                    if (!text) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                        // one bad frame leaves the rest of the stream undecodable
+                        if (text.error() == Errc::decompression_failed || text.error() == Errc::payload_too_large)
+                            conn.close();
+                        break;
+                    }
+
+                    if (const char* reason = screen_text(*text, stats)) {
+                        session->send(Protocol::encode(MessageType::MESSAGE_REJECTED, RejectedMsg{reason}));
+                        break;
+                    }
+
+                    try {
+                        if (handle_message(session->user_id(), session->username(), *text, conn.last_read_ns()))
+                            frame.messages = 1;
+                        else
+                            throttle(stats_.fanout_rejected);
+                    }
+                    catch (const std::exception& e) {
+                        std::cerr << "Message handling error: " << e.what() << std::endl;
+                    }
+                    break;
+                }
+                case MessageType::EPHEMERAL: {
+                    stats.bytes_received.fetch_add(sizeof(MsgHeader) + payload.size(), std::memory_order_relaxed);
+
+                    // nobody is told: a lost typing or presence update is superseded by the next one
+                    if (!ephemeral_bucket.try_acquire()) {
+                        stats_.ephemeral_shed.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
 
-                        const auto encrypted = auth::SRPUtils::base64_to_bytes(ciphertext_b64);
-                        const auto text      = crypto::AESEngine::decrypt_string(encrypted, key);
-                        handle_message(username, text);
+                    const auto msg = Protocol::try_decode<EphemeralMsg>(payload);
+                    if (!msg || msg->kind >= kEphemeralKinds || !session->keyed()) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
                         break;
                     }
-                    case MessageType::DISCONNECT:
-                        conn->close();
+
+                    const auto encrypted = auth::SRPUtils::base64_to_bytes(msg->ciphertext_b64);
+                    auto text            = crypto::AESEngine::try_decrypt_string(encrypted, session->receive_key());
+                    if (!text) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
                         break;
-                    default:
-                        std::cerr << "Unknown message type from " << username << std::endl;
+                    }
+
+                    handle_ephemeral(session->user_id(), session->username(), static_cast<EphemeralKind>(msg->kind),
+                                     std::move(*text));
+                    frame.messages = 1;
+                    break;
+                }
+                case MessageType::AWAY: {
+                    const auto msg = Protocol::try_decode<AwayMsg>(payload);
+                    if (!msg || msg->away > 1) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
                         break;
+                    }
+                    // digests are CATCH_UP frames, which a client that cannot resume does not read
+                    if (conn.features().has(Capability::Resume))
+                        handle_away(session, msg->away == 1);
+                    break;
                 }
+                case MessageType::DISCONNECT:
+                    conn.close();
+                    break;
+                default:
+                    std::cerr << "Unknown message type from " << session->username() << std::endl;
+                    break;
             }
+
+            frame.ingress_ns = thread_cpu_ns() - cpu_started;
+            usage_.charge(session->username(), frame);
         }
-        catch (const std::exception& e) {
-            std::cerr << "Client error: " << e.what() << std::endl;
+
+        handle_disconnect(*session);
+        std::cout << "User '" << session->username() << "' disconnected" << std::endl;
+
+        conn.close();
+    }
+
+    Result<std::string> Server::inflate_text(InflateStream& inflate, const std::vector<uint8_t>& encrypted,
+                                             const std::vector<uint8_t>& key)
+    {
+        const auto body = crypto::AESEngine::try_decrypt(encrypted, key);
+        if (!body)
+            return body.error();
+
+        auto text = inflate.decompress(*body, ProtocolHelpers::kMaxPayloadSize);
+        if (text) {
+            stats_.compression_plain_bytes.fetch_add(text->size(), std::memory_order_relaxed);
+            stats_.compression_wire_bytes.fetch_add(body->size(), std::memory_order_relaxed);
         }
+        return text;
+    }
 
-        if (!user_id.empty()) {
-            handle_disconnect(user_id);
-            std::cout << "User '" << username << "' disconnected" << std::endl;
+    const char* Server::screen_text(std::string& text, SessionStats& stats)
+    {
+        // nothing that is not valid UTF-8 reaches the log or other clients
+        if (!is_valid_utf8(text)) {
+            stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+            stats_.messages_invalid_utf8.fetch_add(1, std::memory_order_relaxed);
+            return "invalid UTF-8";
         }
 
-        conn->close();
+        const auto action = text_filter_.apply(text);
+        if (action == FilterAction::Block) {
+            stats_.messages_blocked.fetch_add(1, std::memory_order_relaxed);
+            return "message contains a blocked term";
+        }
+        if (action == FilterAction::Redact)
+            stats_.messages_redacted.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
     }
 
-    void Server::handle_message(const std::string& username, const std::string& text)
+    bool Server::handle_message(const std::string& user_id, const std::string& username, const std::string& text,
+                                const int64_t received_ns)
     {
         if (username.empty())
-            return;
+            return true;
 
         const auto now             = std::chrono::system_clock::now();
         const auto duration        = now.time_since_epoch();
@@ -314,62 +949,562 @@ namespace chat::server
         std::ostringstream oss;
         oss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%S");
 
-        std::cout << "[" << oss.str() << "] " << username << ": " << text << std::endl;
-
-        // store message in history
         {
+            // the lock makes log order, seq order and submission order the same
             std::lock_guard<std::mutex> lock(message_mutex_);
-            message_history_.emplace_back(username, text, now);
+            const uint64_t seq = message_log_->last_seq() + 1;
+
+            // fanout runs on the scheduler so one sender cannot monopolize encryption capacity;
+            // the job's cost is the number of per-recipient encryptions it will do
+            fanout_in_flight_.insert(seq);
+            const size_t cost   = connection_manager_->fanout()->size();
+            const auto enqueued = OverloadController::Clock::now();
+            const bool accepted = fanout_scheduler_->submit(
+                user_id, cost,
+                [this, username, text, timestamp_ms, seq, enqueued, received_ns]() {
+                    fanout_overload_.observe(OverloadController::Clock::now() - enqueued);
+                    fanout_message(username, text, timestamp_ms, seq, received_ns);
+
+                    std::lock_guard<std::mutex> done_lock(message_mutex_);
+                    fanout_in_flight_.erase(fanout_in_flight_.find(seq));
+                });
+            if (!accepted) {
+                fanout_in_flight_.erase(fanout_in_flight_.find(seq));
+                return false;
+            }
+
+            Message message{username, text, now};
+            message_log_->append(message);
+            append_segment(message);
 
-            // keep only last kMaxMessageHistory messages
+            // keep only last kMaxMessageHistory messages in memory
+            message_history_.push_back(std::move(message));
             if (message_history_.size() > kMaxMessageHistory)
                 message_history_.erase(message_history_.begin());
         }
 
-        // encrypt and broadcast to each active user with their session key
-        for (const auto& user : connection_manager_->get_active_users()) {
-            std::vector<uint8_t> key;
-            {
-                std::lock_guard<std::mutex> lock(user_keys_mutex_);
-                if (const auto it = user_keys_.find(user.user_id); it != user_keys_.end())
-                    key = it->second;
-            }
+        std::cout << "[" << oss.str() << "] " << username << ": " << text << std::endl;
+        return true;
+    }
 
-            if (key.empty())
+    void Server::append_segment(const Message& message)
+    {
+        // segments only cache the log: after a write error joins fall back to encoding the window
+        if (!segments_ok_)
+            return;
+        try {
+            segments_->append(message);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "History segments disabled: " << e.what() << std::endl;
+            segments_ok_ = false;
+        }
+    }
+
+    void Server::fanout_message(const std::string& username, const std::string& text, const int64_t timestamp_ms,
+                                const uint64_t seq, const int64_t received_ns)
+    {
+        // encrypt and send to each active session with its own key; the snapshot
+        // holds the recipients directly, so there are no per-recipient lookups
+        const uint64_t cpu_started = thread_cpu_ns();
+        UserUsage cost{};
+
+        const auto recipients = connection_manager_->fanout();
+        stats_.fanout_jobs.fetch_add(1, std::memory_order_relaxed);
+        for (const auto& recipient : *recipients) {
+            if (!recipient->keyed() || !recipient->is_open())
                 continue;
 
+            // an away client gets this message in a digest instead
+            if (recipient->skips(seq)) {
+                stats_.away_skipped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
             try {
-                const auto encrypted = crypto::AESEngine::encrypt_string(text, key);
-                connection_manager_->send_to(
-                    user.user_id,
-                    Protocol::encode(
+                stats_.fanout_recipients.fetch_add(1, std::memory_order_relaxed);
+                recipient->send_text(text, [&](const std::span<const uint8_t> body) {
+                    if (recipient->compression() != Compression::None) {
+                        stats_.compression_plain_bytes.fetch_add(text.size(), std::memory_order_relaxed);
+                        stats_.compression_wire_bytes.fetch_add(body.size(), std::memory_order_relaxed);
+                    }
+
+                    const auto encrypted = recipient->sealer().seal(body);
+                    auto packet          = Protocol::encode(
                         MessageType::BROADCAST,
                         BroadcastMsg{
                             username,
                             auth::SRPUtils::bytes_to_base64(encrypted),
                             timestamp_ms
                         }
-                    )
-                );
+                    );
+                    ++cost.fanout_recipients;
+                    cost.fanout_bytes += packet.size();
+                    usage_.charge(recipient->username(), {.bytes_out = packet.size()});
+                    return packet;
+                });
+                if (wire_latency_ && received_ns != 0)
+                    wire_latency_->processing.record(realtime_ns() - received_ns);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Encryption/broadcast error for " << recipient->user_id() << ": " << e.what() << std::endl;
+            }
+        }
+
+        // each gateway gets the text once and seals it for its own clients
+        const auto links = connection_manager_->links();
+        if (!links->empty()) {
+            const auto packet = std::make_shared<const std::vector<uint8_t>>(Protocol::encode(
+                MessageType::BROADCAST, BroadcastMsg{username, text, timestamp_ms}));
+            for (const auto& link : *links) {
+                if (!link->is_open())
+                    continue;
+                stats_.gateway_copies.fetch_add(1, std::memory_order_relaxed);
+                cost.fanout_bytes += packet->size();
+                link->send(packet);
+            }
+        }
+
+        cost.fanout_ns = thread_cpu_ns() - cpu_started;
+        usage_.charge(username, cost);
+    }
+
+    void Server::handle_away(const std::shared_ptr<Session>& session, const bool away)
+    {
+        uint64_t last_seq = 0;
+        {
+            // switching between two log appends puts every message on exactly one path, live or digest
+            std::lock_guard<std::mutex> lock(message_mutex_);
+            last_seq = message_log_->last_seq();
+            if (!session->set_away(away, last_seq))
+                return;
+        }
+        stats_.away_changes.fetch_add(1, std::memory_order_relaxed);
+
+        // back: the whole window at once, including messages logged but still queued for fanout
+        if (!away && !send_digest(*session, last_seq))
+            session->connection().close();
+    }
+
+    bool Server::send_digest(Session& session, const uint64_t through)
+    {
+        const auto [after, end] = session.claim_digest(through);
+        if (after >= end)
+            return true;
+
+        // one seal per batch of up to kCatchUpBatchMessages, however long the client was away
+        if (!send_catch_up(session, after, end))
+            return false;
+
+        session.digest_delivered(end);
+        stats_.digests_sent.fetch_add(1, std::memory_order_relaxed);
+        stats_.digest_messages.fetch_add(end - after, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Server::handle_ephemeral(const std::string& user_id, const std::string& username, const EphemeralKind kind,
+                                  std::string text)
+    {
+        static_assert(kEphemeralKinds <= 4);
+
+        // one queue slot per (sender, kind) in every recipient's outbound queue; the top bit keeps it non-zero
+        const uint64_t collapse_key = (std::hash<std::string>{}(user_id) << 2 | static_cast<uint8_t>(kind)) |
+            uint64_t{1} << 63;
+
+        // overloaded: only the latest state per sender and kind is kept, and sent once the queues drain
+        if (overload_level() >= OverloadLevel::DeferEphemeral) {
+            stats_.overload_ephemerals_deferred.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(deferred_mutex_);
+            auto [it, inserted] = deferred_ephemerals_.try_emplace(collapse_key);
+            if (!inserted)
+                stats_.overload_ephemerals_replaced.fetch_add(1, std::memory_order_relaxed);
+            it->second = {user_id, username, kind, std::move(text)};
+            return;
+        }
+
+        // same fair scheduler as chat messages, but a full queue just sheds the update
+        const size_t cost   = connection_manager_->fanout()->size();
+        const auto enqueued = OverloadController::Clock::now();
+        const bool accepted = fanout_scheduler_->submit(
+            user_id, cost,
+            [this, sender_id = user_id, username, kind, text = std::move(text), collapse_key, enqueued]() {
+                fanout_overload_.observe(OverloadController::Clock::now() - enqueued);
+                fanout_ephemeral(sender_id, username, kind, text, collapse_key);
+            });
+        if (!accepted)
+            stats_.ephemeral_shed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Server::fanout_ephemeral(const std::string& sender_id, const std::string& username, const EphemeralKind kind,
+                                  const std::string& text, const uint64_t collapse_key)
+    {
+        const uint64_t cpu_started = thread_cpu_ns();
+        UserUsage cost{};
+
+        const auto recipients = connection_manager_->fanout();
+        stats_.ephemeral_relayed.fetch_add(1, std::memory_order_relaxed);
+        for (const auto& recipient : *recipients) {
+            // nobody is looking at an away client's screen, and the next update supersedes this one anyway
+            if (recipient->user_id() == sender_id || !recipient->keyed() || !recipient->is_open() ||
+                recipient->away())
+                continue;
+
+            // a backed-up recipient would shed it anyway; skip the encryption too
+            if (recipient->queued() >= Session::kEphemeralDropDepth) {
+                recipient->stats().ephemeral_dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            try {
+                const auto encrypted = recipient->sealer().seal_string(text);
+                auto packet          = std::make_shared<const std::vector<uint8_t>>(Protocol::encode(
+                    MessageType::EPHEMERAL_BROADCAST,
+                    EphemeralBroadcastMsg{
+                        username, static_cast<uint8_t>(kind), auth::SRPUtils::bytes_to_base64(encrypted)
+                    }));
+                ++cost.fanout_recipients;
+                cost.fanout_bytes += packet->size();
+                usage_.charge(recipient->username(), {.bytes_out = packet->size()});
+                recipient->send_ephemeral(std::move(packet), collapse_key);
             }
             catch (const std::exception& e) {
-                std::cerr << "Encryption/broadcast error for " << user.user_id << ": " << e.what() << std::endl;
+                std::cerr << "Encryption/ephemeral error for " << recipient->user_id() << ": " << e.what() << std::endl;
+            }
+        }
+
+        const auto links = connection_manager_->links();
+        if (!links->empty()) {
+            const auto packet = std::make_shared<const std::vector<uint8_t>>(Protocol::encode(
+                MessageType::EPHEMERAL_BROADCAST, EphemeralBroadcastMsg{username, static_cast<uint8_t>(kind), text}));
+            for (const auto& link : *links) {
+                if (!link->is_open())
+                    continue;
+                cost.fanout_bytes += packet->size();
+                link->send_ephemeral(packet, collapse_key);
+            }
+        }
+
+        cost.fanout_ns = thread_cpu_ns() - cpu_started;
+        usage_.charge(username, cost);
+    }
+
+    bool Server::send_catch_up(Session& session, const uint64_t after, const uint64_t through)
+    {
+        // one sealed INIT_V2 payload per batch, so catch-up costs one AES-GCM operation per batch, not per message
+        const std::vector<uint8_t> aad(kCatchUpAad.begin(), kCatchUpAad.end());
+        return stream_catch_up(session.username(), after, through, [&](const std::vector<uint8_t> payload) {
+            auto packet = ProtocolHelpers::make_packet(MessageType::CATCH_UP, payload, crypto::AESEngine::IV_SIZE,
+                                                       crypto::AESEngine::TAG_SIZE);
+            session.sealer().seal_in_place(std::span(packet).subspan(sizeof(MsgHeader)), aad);
+            usage_.charge(session.username(), {.bytes_out = packet.size()});
+            return session.send(std::move(packet));
+        });
+    }
+
+    std::vector<uint8_t> Server::seal_init(const std::vector<Message>& seen, const std::vector<User>& users,
+                                           const crypto::Sealer& sealer)
+    {
+        // encoded once, copied once into the frame, encrypted where it lies
+        const auto payload = InitCodec::encode_payload(seen, users);
+        auto packet        = ProtocolHelpers::make_packet(MessageType::INIT_SEALED, payload,
+                                                          crypto::AESEngine::IV_SIZE, crypto::AESEngine::TAG_SIZE);
+        const std::vector<uint8_t> aad(kInitAad.begin(), kInitAad.end());
+        sealer.seal_in_place(std::span(packet).subspan(sizeof(MsgHeader)), aad);
+        stats_.sealed_inits.fetch_add(1, std::memory_order_relaxed);
+        stats_.sealed_init_bytes.fetch_add(payload.size(), std::memory_order_relaxed);
+        return packet;
+    }
+
+    bool Server::stream_catch_up(const std::string& username, uint64_t after, const uint64_t through,
+                                 const std::function<bool(std::vector<uint8_t> payload)>& deliver)
+    {
+        // batches come off the log in sequential reads
+        while (after < through) {
+            const auto batch = message_log_->read(after, through, kCatchUpBatchMessages, kCatchUpBatchBytes);
+            if (batch.empty())
+                break;
+
+            if (!deliver(InitCodec::encode_payload(batch)))
+                return false;
+
+            after = batch.back().seq;
+            stats_.catch_up_frames.fetch_add(1, std::memory_order_relaxed);
+            stats_.catch_up_messages.fetch_add(batch.size(), std::memory_order_relaxed);
+
+            // a client dropping mid-way resumes from the last batch it was sent
+            save_cursor(username, after);
+        }
+
+        if (!cursors_->get(username))
+            save_cursor(username, after);
+        return true;
+    }
+
+    std::pair<uint64_t, uint64_t> Server::join_range(const std::string& username)
+    {
+        // a first login starts the cursor at the end of the log
+        const uint64_t through = message_log_->last_seq();
+        return {std::min(cursors_->get(username).value_or(through), through), through};
+    }
+
+    void Server::save_cursor(const std::string& username, const uint64_t seq)
+    {
+        // a failed write costs the user a repeated catch-up, not the connection
+        try {
+            cursors_->set(username, seq);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Cursor update failed for " << username << ": " << e.what() << std::endl;
+        }
+    }
+
+    void Server::count_eviction(const Session& session)
+    {
+        const auto& s = session.stats();
+        if (s.queue_overflows.load(std::memory_order_relaxed) > 0)
+            stats_.evicted_queue_full.fetch_add(1, std::memory_order_relaxed);
+        else if (s.send_timeouts.load(std::memory_order_relaxed) > 0)
+            stats_.evicted_send_timeout.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t Server::delivered_seq() const
+    {
+        return fanout_in_flight_.empty() ? message_log_->last_seq() : *fanout_in_flight_.begin() - 1;
+    }
+
+    void Server::handle_disconnect(const Session& session, const bool advance_cursor)
+    {
+        count_eviction(session);
+        connection_manager_->remove(session.user_id());
+        leave_room(session.username(), advance_cursor,
+                   session.undelivered_from().value_or(std::numeric_limits<uint64_t>::max()));
+    }
+
+    void Server::leave_room(const std::string& username, const bool advance_cursor, const uint64_t cursor_cap)
+    {
+        if (username.empty())
+            return;
+
+        // everything fanned out while the user was in reached them; messages still queued
+        // for fanout, or skipped while away and not digested yet, are left for the next catch-up
+        if (advance_cursor) {
+            uint64_t seq = 0;
+            {
+                std::lock_guard<std::mutex> lock(message_mutex_);
+                seq = std::min(delivered_seq(), cursor_cap);
+            }
+            save_cursor(username, seq);
+        }
+
+        // notify other users
+        connection_manager_->broadcast(Protocol::encode(MessageType::USER_LEFT, UserLeftMsg{username}));
+    }
+
+    void Server::handle_gateway(const std::shared_ptr<Connection>& conn)
+    {
+        const auto link = connection_manager_->add_link("gateway-" + std::to_string(next_user_id_++), conn);
+        auto& stats     = link->stats();
+
+        // what handle_client keeps per connection, kept here per stream
+        struct Stream
+        {
+            std::string user_id;
+            std::string username;
+            TokenBucket bucket;
+            TokenBucket ephemeral_bucket;
+            uint32_t dropped_since_notice{0};
+            TokenBucket::Clock::time_point next_notice{};
+            bool caught_up{true};
+        };
+        std::unordered_map<uint64_t, Stream> streams;
+
+        const auto reply = [&link](const uint64_t id, const std::vector<uint8_t>& packet) {
+            link->send(StreamCodec::wrap_packet(id, packet));
+        };
+
+        const auto throttle = [&](const uint64_t id, Stream& stream, std::atomic<uint64_t>& counter) {
+            counter.fetch_add(1, std::memory_order_relaxed);
+            stats.messages_throttled.fetch_add(1, std::memory_order_relaxed);
+            ++stream.dropped_since_notice;
+
+            const auto now = TokenBucket::Clock::now();
+            if (now < stream.next_notice)
+                return;
+
+            const auto retry_after = static_cast<uint32_t>(stream.bucket.retry_after(now).count());
+            reply(id, Protocol::encode(MessageType::SLOW_DOWN, SlowDownMsg{stream.dropped_since_notice, retry_after}));
+            stream.dropped_since_notice = 0;
+            stream.next_notice          = now + kSlowDownNoticeInterval;
+        };
+
+        // frames arrive already decrypted by the gateway; the rest is handle_client's path
+        while (conn->is_open() && running_) {
+            const uint64_t cpu_started = thread_cpu_ns();
+            auto packet = conn->try_receive_packet();
+            if (!packet)
+                break;
+
+            stats.bytes_received.fetch_add(sizeof(MsgHeader) + packet->second.size(), std::memory_order_relaxed);
+            const auto frame = packet->first == MessageType::STREAM
+                                   ? StreamCodec::try_unwrap(packet->second)
+                                   : Result<StreamFrame>(Errc::invalid_encoding);
+            if (!frame) {
+                stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            const auto it = streams.find(frame->stream);
+            if (frame->type == MessageType::STREAM_OPEN) {
+                const auto msg = Protocol::try_decode<StreamOpenMsg>(frame->payload);
+                if (!msg || msg->username.empty() || it != streams.end()) {
+                    stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                const auto caught_up = join_remote(*link, frame->stream, msg->user_id, msg->username);
+                if (!caught_up)
+                    continue;
+
+                Stream stream;
+                stream.user_id  = msg->user_id;
+                stream.username = msg->username;
+                if (options_.rate_limit > 0)
+                    stream.bucket = TokenBucket(options_.rate_limit, options_.rate_burst);
+                if (options_.ephemeral_rate > 0)
+                    stream.ephemeral_bucket = TokenBucket(options_.ephemeral_rate, options_.ephemeral_burst);
+                stream.caught_up = *caught_up;
+                streams.try_emplace(frame->stream, std::move(stream));
+                continue;
+            }
+
+            // a stream the server refused, or one both sides closed at once
+            if (it == streams.end())
+                continue;
+
+            auto& stream = it->second;
+            UserUsage usage{.bytes_in = sizeof(MsgHeader) + packet->second.size()};
+            switch (frame->type) {
+                case MessageType::MESSAGE: {
+                    stats.messages_received.fetch_add(1, std::memory_order_relaxed);
+                    if (!stream.bucket.try_acquire()) {
+                        throttle(frame->stream, stream, stats_.messages_throttled);
+                        break;
+                    }
+                    if (refuse_message(stream.user_id)) {
+                        stats_.overload_messages_refused.fetch_add(1, std::memory_order_relaxed);
+                        reply(frame->stream, Protocol::encode(MessageType::RETRY_LATER, RetryLaterMsg{
+                                                                  static_cast<uint16_t>(MessageType::MESSAGE),
+                                                                  overload_retry_after_ms()
+                                                              }));
+                        break;
+                    }
+
+                    auto msg = Protocol::try_decode<TextMsg>(frame->payload);
+                    if (!msg) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+
+                    std::string& text = msg->ciphertext_b64; // plaintext on a link
+                    if (const char* reason = screen_text(text, stats)) {
+                        reply(frame->stream, Protocol::encode(MessageType::MESSAGE_REJECTED, RejectedMsg{reason}));
+                        break;
+                    }
+
+                    try {
+                        if (handle_message(stream.user_id, stream.username, text))
+                            usage.messages = 1;
+                        else
+                            throttle(frame->stream, stream, stats_.fanout_rejected);
+                    }
+                    catch (const std::exception& e) {
+                        std::cerr << "Message handling error: " << e.what() << std::endl;
+                    }
+                    break;
+                }
+                case MessageType::EPHEMERAL: {
+                    if (!stream.ephemeral_bucket.try_acquire()) {
+                        stats_.ephemeral_shed.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+
+                    auto msg = Protocol::try_decode<EphemeralMsg>(frame->payload);
+                    if (!msg || msg->kind >= kEphemeralKinds) {
+                        stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+
+                    handle_ephemeral(stream.user_id, stream.username, static_cast<EphemeralKind>(msg->kind),
+                                     std::move(msg->ciphertext_b64));
+                    usage.messages = 1;
+                    break;
+                }
+                case MessageType::STREAM_CLOSE:
+                    leave_remote(stream.user_id, stream.username, stream.caught_up);
+                    streams.erase(it);
+                    continue;
+                default:
+                    stats.malformed_frames.fetch_add(1, std::memory_order_relaxed);
+                    break;
             }
+
+            usage.ingress_ns = thread_cpu_ns() - cpu_started;
+            usage_.charge(stream.username, usage);
         }
+
+        // a lost link takes all of its users with it
+        for (const auto& [id, stream] : streams)
+            leave_remote(stream.user_id, stream.username, stream.caught_up);
+        count_eviction(*link);
+        connection_manager_->remove_link(*link);
+        conn->close();
+        std::cout << "Gateway link '" << link->user_id() << "' closed, " << streams.size() << " users left"
+            << std::endl;
     }
 
-    void Server::handle_disconnect(const std::string& user_id)
+    std::optional<bool> Server::join_remote(Session& link, const uint64_t stream, const std::string& user_id,
+                                            const std::string& username)
     {
-        // get username before removing
-        const std::string username = connection_manager_->get_username_by_user_id(user_id);
+        const auto reply = [&link, stream](const std::vector<uint8_t>& packet) {
+            return link.send(StreamCodec::wrap_packet(stream, packet));
+        };
+
+        if (!connection_manager_->add_remote(user_id, username)) {
+            reply(Protocol::encode(MessageType::ERROR_MSG, ErrorMsg{"User already logged in"}));
+            reply(ProtocolHelpers::make_empty_packet(MessageType::STREAM_CLOSE));
+            return std::nullopt;
+        }
+        stats_.gateway_streams.fetch_add(1, std::memory_order_relaxed);
+        std::cout << "User '" << username << "' (ID: " << user_id << ") joined through " << link.user_id()
+            << std::endl;
+
+        // same history as a direct join, always inline and unsealed: the gateway seals INIT with its client's key
+        uint64_t cursor = 0, through = 0;
         {
-            std::lock_guard<std::mutex> lock(user_keys_mutex_);
-            user_keys_.erase(user_id);
+            std::lock_guard<std::mutex> lock(message_mutex_);
+            std::tie(cursor, through) = join_range(username);
+
+            const auto seen_end = std::ranges::upper_bound(message_history_, cursor, {}, &Message::seq);
+            const std::vector<Message> seen(message_history_.begin(), seen_end);
+            auto init = InitCodec::encode(seen, connection_manager_->get_active_users());
+            usage_.charge(username, {.bytes_out = init.size()});
+            reply(init);
         }
-        connection_manager_->remove(user_id);
 
-        if (!username.empty())
-            // notify other users
-            connection_manager_->broadcast(Protocol::encode(MessageType::USER_LEFT, UserLeftMsg{username}));
+        connection_manager_->broadcast(
+            Protocol::encode(MessageType::USER_JOINED, UserJoinedMsg{username, user_id}), user_id);
+
+        // unsealed: the gateway seals each batch with its client's key
+        return stream_catch_up(username, cursor, through, [&](const std::vector<uint8_t> payload) {
+            usage_.charge(username, {.bytes_out = payload.size()});
+            return link.send(StreamCodec::wrap(stream, MessageType::CATCH_UP, payload));
+        });
+    }
+
+    void Server::leave_remote(const std::string& user_id, const std::string& username, const bool advance_cursor)
+    {
+        connection_manager_->remove_remote(user_id);
+        leave_room(username, advance_cursor);
+        std::cout << "User '" << username << "' disconnected" << std::endl;
     }
 } // namespace chat::server
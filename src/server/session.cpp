@@ -0,0 +1,321 @@
+#include "chat/server/session.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <limits>
+#include <system_error>
+#include <utility>
+
+#include <boost/asio/error.hpp>
+#include <boost/system/system_error.hpp>
+
+#include "chat/server/connection_manager.hpp"
+
+namespace chat::server
+{
+    namespace
+    {
+        // a write the kernel gave up on after TCP_USER_TIMEOUT (see SocketTuning::user_timeout_ms)
+        bool timed_out(const std::exception& e)
+        {
+            if (const auto* error = dynamic_cast<const boost::system::system_error*>(&e))
+                return error->code() == boost::asio::error::timed_out;
+            if (const auto* error = dynamic_cast<const std::system_error*>(&e))
+                return error->code().value() == ETIMEDOUT;
+            return false;
+        }
+    }
+
+    Session::Session(std::string user_id, std::string username, std::shared_ptr<Connection> conn,
+                     crypto::SessionKeys keys, const Compression compression, const size_t max_queued_bytes)
+        : user_id_(std::move(user_id)),
+          username_(std::move(username)),
+          sealer_(std::move(keys.server_to_client)),
+          receive_key_(std::move(keys.client_to_server.key)),
+          conn_(std::move(conn)),
+          deflate_(compression == Compression::Deflate ? std::make_unique<DeflateStream>() : nullptr),
+          max_queued_bytes_(max_queued_bytes)
+    {
+    }
+
+    Session::~Session()
+    {
+        stop_writer();
+    }
+
+    bool Session::send_text(const std::string_view text,
+                            const std::function<std::vector<uint8_t>(std::span<const uint8_t>)>& seal)
+    {
+        if (!deflate_)
+            return send(seal({reinterpret_cast<const uint8_t*>(text.data()), text.size()}));
+
+        // the stream's order must be the queue's, but the socket write happens outside the lock:
+        // a recipient that stops reading would otherwise hold every fanout worker here
+        bool write = false;
+        {
+            std::lock_guard<std::mutex> lock(deflate_mutex_);
+            auto packet = std::make_shared<const std::vector<uint8_t>>(seal(deflate_->compress(text)));
+            if (!push({std::move(packet), 0}, write))
+                return false;
+        }
+        if (!write)
+            return true;
+        drain();
+        return conn_->is_open();
+    }
+
+    bool Session::send(std::vector<uint8_t> packet)
+    {
+        return send(std::make_shared<const std::vector<uint8_t>>(std::move(packet)));
+    }
+
+    bool Session::send(SharedPacket packet)
+    {
+        return enqueue({std::move(packet), 0});
+    }
+
+    bool Session::send_file(FileSpan span)
+    {
+        return enqueue({nullptr, 0, std::move(span)});
+    }
+
+    bool Session::send_ephemeral(SharedPacket packet, const uint64_t collapse_key)
+    {
+        return enqueue({std::move(packet), collapse_key});
+    }
+
+    bool Session::enqueue(Outbound outbound)
+    {
+        bool write = false;
+        if (!push(std::move(outbound), write))
+            return false;
+        if (!write)
+            return true;
+        drain();
+        return conn_->is_open();
+    }
+
+    bool Session::push(Outbound outbound, bool& write)
+    {
+        if (!conn_->is_open())
+            return false;
+
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (outbound.collapse_key != 0) {
+            // newer state for the same sender and kind supersedes the queued one
+            if (ephemeral_queued_ > 0) {
+                const auto queued = std::find_if(queue_.rbegin(), queue_.rend(), [&](const Outbound& o) {
+                    return o.collapse_key == outbound.collapse_key;
+                });
+                if (queued != queue_.rend()) {
+                    // states differ in length, so the count moves by the difference
+                    queued_bytes_  = queued_bytes_ - queued->packet->size() + outbound.packet->size();
+                    queued->packet = std::move(outbound.packet);
+                    stats_.ephemeral_collapsed.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            if (queue_.size() >= kEphemeralDropDepth) {
+                stats_.ephemeral_dropped.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            ++ephemeral_queued_;
+        }
+        else if (outbound.packet && !queue_.empty() &&
+                 queued_bytes_ + outbound.packet->size() > max_queued_bytes_) {
+            // a client this far behind is not coming back; better to drop it than to hold its backlog
+            stats_.queue_overflows.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "Evicting " << user_id_ << ": " << queued_bytes_ << " bytes queued" << std::endl;
+            queue_.clear();
+            ephemeral_queued_ = 0;
+            queued_bytes_     = 0;
+            lock.unlock();
+            conn_->close();
+            return false;
+        }
+        else if (queue_.size() >= kEphemeralDropDepth && ephemeral_queued_ > 0) {
+            // under pressure, durable traffic goes ahead of anything volatile still waiting
+            stats_.ephemeral_dropped.fetch_add(ephemeral_queued_, std::memory_order_relaxed);
+            std::erase_if(queue_, [this](const Outbound& o) {
+                if (o.collapse_key == 0)
+                    return false;
+                queued_bytes_ -= o.packet->size();
+                return true;
+            });
+            ephemeral_queued_ = 0;
+        }
+        if (outbound.packet)
+            queued_bytes_ += outbound.packet->size();
+        queue_.push_back(std::move(outbound));
+
+        if (own_writer_) {
+            queue_cv_.notify_one();
+            return true;
+        }
+
+        // another thread is writing and will pick this packet up
+        if (flushing_)
+            return true;
+
+        flushing_ = true;
+        write     = true;
+        return true;
+    }
+
+    void Session::drain()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        flush(lock);
+    }
+
+    void Session::start_writer()
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (own_writer_)
+            return;
+        own_writer_ = true;
+        writer_     = std::thread([this]() { run_writer(); });
+    }
+
+    void Session::stop_writer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            writer_stopping_ = true;
+        }
+        queue_cv_.notify_one();
+        if (writer_.joinable())
+            writer_.join();
+    }
+
+    void Session::run_writer()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        while (true) {
+            queue_cv_.wait(lock, [this]() { return writer_stopping_ || !queue_.empty(); });
+            if (queue_.empty())
+                return;
+            flushing_ = true;
+            flush(lock);
+        }
+    }
+
+    void Session::flush(std::unique_lock<std::mutex>& lock)
+    {
+        while (!queue_.empty()) {
+            auto [packet, collapse_key, file] = std::move(queue_.front());
+            queue_.pop_front();
+            if (collapse_key != 0)
+                --ephemeral_queued_;
+            if (packet)
+                queued_bytes_ -= packet->size();
+            lock.unlock();
+
+            try {
+                if (packet) {
+                    conn_->send_packet(*packet);
+                    stats_.packets_sent.fetch_add(1, std::memory_order_relaxed);
+                    stats_.bytes_sent.fetch_add(packet->size(), std::memory_order_relaxed);
+                }
+                else {
+                    conn_->send_file(file.fd, file.offset, file.length);
+                    stats_.bytes_sent.fetch_add(file.length, std::memory_order_relaxed);
+                }
+            }
+            catch (const std::exception& e) {
+                stats_.send_errors.fetch_add(1, std::memory_order_relaxed);
+                if (timed_out(e))
+                    stats_.send_timeouts.fetch_add(1, std::memory_order_relaxed);
+                std::cerr << "Error sending to " << user_id_ << ": " << e.what() << std::endl;
+                conn_->close();
+
+                lock.lock();
+                queue_.clear();
+                ephemeral_queued_ = 0;
+                queued_bytes_     = 0;
+                break;
+            }
+
+            lock.lock();
+        }
+
+        flushing_ = false;
+    }
+
+    bool Session::set_away(const bool away, const uint64_t last_seq)
+    {
+        std::lock_guard<std::mutex> lock(away_mutex_);
+        if (away_.away == away)
+            return false;
+
+        away_.away = away;
+        if (!away) {
+            away_.skip_through = last_seq;
+            return true;
+        }
+
+        // a digest of the previous window still on its way keeps digest_done where it is
+        if (away_.digest_done == away_.digest_next)
+            away_.digest_done = last_seq;
+        away_.skip_after   = last_seq;
+        away_.skip_through = std::numeric_limits<uint64_t>::max();
+        away_.digest_next  = last_seq;
+        return true;
+    }
+
+    bool Session::away() const
+    {
+        std::lock_guard<std::mutex> lock(away_mutex_);
+        return away_.away;
+    }
+
+    bool Session::skips(const uint64_t seq) const
+    {
+        std::lock_guard<std::mutex> lock(away_mutex_);
+        return seq > away_.skip_after && seq <= away_.skip_through;
+    }
+
+    std::pair<uint64_t, uint64_t> Session::claim_digest(const uint64_t through)
+    {
+        std::lock_guard<std::mutex> lock(away_mutex_);
+        const uint64_t end = std::min(through, away_.skip_through);
+        if (end <= away_.digest_next)
+            return {0, 0};
+
+        const auto range  = std::pair(away_.digest_next, end);
+        away_.digest_next = end;
+        return range;
+    }
+
+    void Session::digest_delivered(const uint64_t through)
+    {
+        std::lock_guard<std::mutex> lock(away_mutex_);
+        away_.digest_done = std::max(away_.digest_done, through);
+    }
+
+    std::optional<uint64_t> Session::undelivered_from() const
+    {
+        std::lock_guard<std::mutex> lock(away_mutex_);
+        if (away_.digest_done < away_.skip_through)
+            return away_.digest_done;
+        return std::nullopt;
+    }
+
+    size_t Session::queued() const
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        return queue_.size();
+    }
+
+    size_t Session::queued_bytes() const
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        return queued_bytes_;
+    }
+
+    bool Session::is_open() const
+    {
+        return conn_->is_open();
+    }
+} // namespace chat::server
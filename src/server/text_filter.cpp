@@ -0,0 +1,300 @@
+#include "chat/server/text_filter.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+
+#include "chat/common/utf8.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CHAT_FILTER_AVX2 1
+#endif
+
+namespace chat::server
+{
+    namespace
+    {
+        uint8_t fold(const uint8_t b)
+        {
+            return b >= 'A' && b <= 'Z' ? static_cast<uint8_t>(b + ('a' - 'A')) : b;
+        }
+
+        std::string_view trim(std::string_view s)
+        {
+            constexpr std::string_view kSpace = " \t\r\n";
+            const auto first = s.find_first_not_of(kSpace);
+            if (first == std::string_view::npos)
+                return {};
+            return s.substr(first, s.find_last_not_of(kSpace) - first + 1);
+        }
+
+        // every set gets a distinct generation, so thread-local caches never confuse two filters
+        std::atomic<uint64_t> g_next_generation{1};
+
+#ifdef CHAT_FILTER_AVX2
+        bool avx2_available()
+        {
+            static const bool available = __builtin_cpu_supports("avx2");
+            return available;
+        }
+
+        // shufti: a byte is a candidate when its low- and high-nibble lookups share a bit;
+        // returns the first candidate, or where fewer than 32 bytes remain
+        __attribute__((target("avx2")))
+        size_t skip_avx2(const uint8_t* p, size_t i, const size_t n, const uint8_t* low, const uint8_t* high)
+        {
+            const __m256i low_table  = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(low)));
+            const __m256i high_table = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(high)));
+            const __m256i nibble     = _mm256_set1_epi8(0x0F);
+
+            for (; i + 32 <= n; i += 32) {
+                const __m256i v    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                const __m256i lo   = _mm256_shuffle_epi8(low_table, _mm256_and_si256(v, nibble));
+                const __m256i hi   = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+                const __m256i hits = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256());
+                const auto candidates = ~static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+                if (candidates != 0)
+                    return i + static_cast<size_t>(std::countr_zero(candidates));
+            }
+            return i;
+        }
+#endif
+    }
+
+    PatternSet::PatternSet(const std::vector<FilterPattern>& patterns)
+    {
+        // equivalence classes: one per distinct (case-folded) byte used by any term
+        for (const auto& pattern : patterns)
+            for (const char ch : pattern.term)
+                if (auto& cls = class_of_[fold(static_cast<uint8_t>(ch))]; cls == 0)
+                    cls = static_cast<uint8_t>(std::min<uint32_t>(classes_++, 255));
+        for (size_t b = 0; b < 256; ++b)
+            class_of_[b] = class_of_[fold(static_cast<uint8_t>(b))];
+
+        // trie; during construction a 0 transition means "no child", as nothing points back to the root yet
+        transitions_.assign(classes_, 0);
+        outputs_.assign(1, Output{});
+        for (const auto& pattern : patterns) {
+            if (pattern.term.empty() || pattern.term.size() > kMaxTermLength || pattern.action == FilterAction::Pass)
+                continue;
+
+            uint32_t state = 0;
+            for (const char ch : pattern.term) {
+                const size_t slot = state * classes_ + class_of_[static_cast<uint8_t>(ch)];
+                if (transitions_[slot] == 0) {
+                    transitions_[slot] = static_cast<uint32_t>(outputs_.size());
+                    transitions_.resize(transitions_.size() + classes_, 0);
+                    outputs_.emplace_back();
+                }
+                state = transitions_[slot];
+            }
+
+            auto& out  = outputs_[state];
+            out.length = static_cast<uint16_t>(pattern.term.size());
+            out.action = std::max(out.action, pattern.action);
+            ++pattern_count_;
+        }
+
+        // breadth-first failure links, folded into a complete DFA; outputs inherit from
+        // their failure state, which only ever adds shorter terms ending at the same byte
+        std::vector<uint32_t> fail(outputs_.size(), 0);
+        std::deque<uint32_t> queue;
+        for (uint32_t c = 0; c < classes_; ++c)
+            if (const auto child = transitions_[c]; child != 0)
+                queue.push_back(child);
+
+        while (!queue.empty()) {
+            const auto state = queue.front();
+            queue.pop_front();
+
+            auto& out          = outputs_[state];
+            const auto& suffix = outputs_[fail[state]];
+            out.length         = std::max(out.length, suffix.length);
+            out.action         = std::max(out.action, suffix.action);
+
+            for (uint32_t c = 0; c < classes_; ++c) {
+                const size_t slot = state * classes_ + c;
+                const auto via_fail = transitions_[fail[state] * classes_ + c];
+                if (const auto child = transitions_[slot]; child != 0) {
+                    fail[child] = via_fail;
+                    queue.push_back(child);
+                }
+                else
+                    transitions_[slot] = via_fail;
+            }
+        }
+
+        // store row offsets rather than state numbers, flagging states with an output,
+        // so the hot loop is one load and a mask per byte
+        for (auto& next : transitions_)
+            next = next * classes_ | (outputs_[next].action != FilterAction::Pass ? kMatchFlag : 0);
+
+        // prefilter over bytes that leave the root; high nibbles h and h ^ 8 share a bucket bit,
+        // which can only cause false positives
+        for (size_t b = 0; b < 256; ++b) {
+            if ((transitions_[class_of_[b]] & ~kMatchFlag) == 0)
+                continue;
+            starts_term_[b] = true;
+            const auto bucket = static_cast<uint8_t>(1u << ((b >> 4) & 7));
+            prefilter_high_[b >> 4] = bucket;
+            prefilter_low_[b & 0x0F] |= bucket;
+        }
+    }
+
+    std::vector<FilterPattern> PatternSet::parse(std::istream& in, size_t* rejected)
+    {
+        std::vector<FilterPattern> patterns;
+        size_t bad = 0;
+
+        std::string line;
+        while (std::getline(in, line)) {
+            const auto content = trim(line);
+            if (content.empty() || content.front() == '#')
+                continue;
+
+            const auto split     = content.find_first_of(" \t");
+            const auto directive = content.substr(0, split);
+            const auto term      = split == std::string_view::npos ? std::string_view{} : trim(content.substr(split));
+
+            FilterAction action = FilterAction::Pass;
+            if (directive == "block")
+                action = FilterAction::Block;
+            else if (directive == "redact")
+                action = FilterAction::Redact;
+
+            if (action == FilterAction::Pass || term.empty() || term.size() > kMaxTermLength || !is_valid_utf8(term)) {
+                ++bad;
+                continue;
+            }
+            patterns.push_back({std::string(term), action});
+        }
+
+        if (rejected)
+            *rejected = bad;
+        return patterns;
+    }
+
+    size_t PatternSet::skip(const uint8_t* p, size_t i, const size_t n) const
+    {
+#ifdef CHAT_FILTER_AVX2
+        if (avx2_available())
+            i = skip_avx2(p, i, n, prefilter_low_.data(), prefilter_high_.data());
+#endif
+        while (i < n && !starts_term_[p[i]])
+            ++i;
+        return i;
+    }
+
+    template <bool Rewrite>
+    FilterAction PatternSet::run(char* rewrite, const std::string_view text) const
+    {
+        if (pattern_count_ == 0)
+            return FilterAction::Pass;
+
+        const auto* p  = reinterpret_cast<const uint8_t*>(text.data());
+        const size_t n = text.size();
+
+        FilterAction result = FilterAction::Pass;
+        uint32_t row        = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (row == 0 && !starts_term_[p[i]]) {
+                i = skip(p, i + 1, n);
+                if (i >= n)
+                    break;
+            }
+
+            const auto next = transitions_[row + class_of_[p[i]]];
+            row             = next & ~kMatchFlag;
+            if ((next & kMatchFlag) == 0)
+                continue;
+
+            const auto& out = outputs_[row / classes_];
+            if (out.action == FilterAction::Block)
+                return FilterAction::Block;
+
+            // only bytes already consumed are rewritten, so the scan ahead is unaffected
+            result = FilterAction::Redact;
+            if constexpr (Rewrite)
+                std::memset(rewrite + i + 1 - out.length, '*', out.length);
+        }
+        return result;
+    }
+
+    FilterAction PatternSet::apply(std::string& text) const
+    {
+        return run<true>(text.data(), text);
+    }
+
+    FilterAction PatternSet::scan(const std::string_view text) const
+    {
+        return run<false>(nullptr, text);
+    }
+
+    TextFilter::TextFilter(std::string path)
+        : path_(std::move(path))
+    {
+        install(std::make_shared<const PatternSet>());
+        reload_if_changed();
+    }
+
+    bool TextFilter::reload_if_changed()
+    {
+        if (path_.empty())
+            return false;
+
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+
+        // a missing or unreadable file keeps the current set
+        std::error_code ec;
+        const auto mtime = std::filesystem::last_write_time(path_, ec);
+        if (ec || mtime == mtime_)
+            return false;
+
+        std::ifstream in(path_);
+        if (!in) {
+            std::cerr << "Filter file " << path_ << " could not be opened" << std::endl;
+            return false;
+        }
+
+        size_t rejected = 0;
+        const auto patterns = PatternSet::parse(in, &rejected);
+        install(std::make_shared<const PatternSet>(patterns));
+        mtime_ = mtime;
+
+        std::cout << "Loaded " << patterns.size() << " filter terms from " << path_ << std::endl;
+        if (rejected > 0)
+            std::cerr << "Filter file " << path_ << ": skipped " << rejected << " invalid line(s)" << std::endl;
+        return true;
+    }
+
+    void TextFilter::install(std::shared_ptr<const PatternSet> patterns)
+    {
+        patterns_.store(std::move(patterns), std::memory_order_release);
+        generation_.store(g_next_generation.fetch_add(1, std::memory_order_relaxed), std::memory_order_release);
+    }
+
+    FilterAction TextFilter::apply(std::string& text) const
+    {
+        struct Cached
+        {
+            uint64_t generation{0};
+            std::shared_ptr<const PatternSet> patterns;
+        };
+        thread_local Cached cached;
+
+        if (const auto generation = generation_.load(std::memory_order_acquire); cached.generation != generation) {
+            cached.patterns   = patterns_.load(std::memory_order_acquire);
+            cached.generation = generation;
+        }
+        return cached.patterns->apply(text);
+    }
+
+    std::shared_ptr<const PatternSet> TextFilter::current() const
+    {
+        return patterns_.load(std::memory_order_acquire);
+    }
+} // namespace chat::server
@@ -0,0 +1,147 @@
+#include "chat/server/usage_ledger.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <mutex>
+
+#include "chat/common/flat_hash_map.hpp"
+
+namespace chat::server
+{
+    uint64_t thread_cpu_ns()
+    {
+        timespec ts{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    UserUsage& UserUsage::operator+=(const UserUsage& other)
+    {
+        login_ns += other.login_ns;
+        ingress_ns += other.ingress_ns;
+        fanout_ns += other.fanout_ns;
+        bytes_in += other.bytes_in;
+        bytes_out += other.bytes_out;
+        fanout_bytes += other.fanout_bytes;
+        messages += other.messages;
+        fanout_recipients += other.fanout_recipients;
+        return *this;
+    }
+
+    namespace
+    {
+        using UsageMap = FlatHashMap<std::string, UserUsage>;
+
+        // one thread's accumulator for one ledger
+        struct Slab
+        {
+            std::mutex mutex;
+            UsageMap users;
+        };
+
+        void merge(UsageMap& into, const UsageMap& from)
+        {
+            for (const auto& [username, usage] : from)
+                into.try_emplace(username).first->second += usage;
+        }
+    }
+
+    struct UsageLedger::Core
+    {
+        mutable std::mutex mutex;
+        std::vector<std::shared_ptr<Slab>> slabs; // live threads
+        UsageMap retired;                         // folded in from threads that have exited
+
+        void retire(const std::shared_ptr<Slab>& slab)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            {
+                std::lock_guard<std::mutex> slab_lock(slab->mutex);
+                merge(retired, slab->users);
+            }
+            std::erase(slabs, slab);
+        }
+    };
+
+    namespace
+    {
+        // the calling thread's slabs, one per ledger it has charged; the weak reference
+        // lets a thread outlive a ledger, and tells a reused address from the old ledger
+        struct ThreadSlabs
+        {
+            struct Entry
+            {
+                const void* core;
+                std::weak_ptr<UsageLedger::Core> owner;
+                std::shared_ptr<Slab> slab;
+            };
+            std::vector<Entry> entries;
+
+            ~ThreadSlabs()
+            {
+                for (const auto& entry : entries)
+                    if (const auto core = entry.owner.lock())
+                        core->retire(entry.slab);
+            }
+        };
+
+        thread_local ThreadSlabs t_slabs;
+    }
+
+    UsageLedger::UsageLedger()
+        : core_(std::make_shared<Core>())
+    {
+    }
+
+    UsageLedger::~UsageLedger() = default;
+
+    void UsageLedger::charge(const std::string_view username, const UserUsage& delta)
+    {
+        auto& entries = t_slabs.entries;
+        auto entry    = std::find_if(entries.begin(), entries.end(), [&](const ThreadSlabs::Entry& e) {
+            return e.core == core_.get() && !e.owner.expired();
+        });
+
+        if (entry == entries.end()) {
+            std::erase_if(entries, [](const ThreadSlabs::Entry& e) { return e.owner.expired(); });
+
+            auto slab = std::make_shared<Slab>();
+            {
+                std::lock_guard<std::mutex> lock(core_->mutex);
+                core_->slabs.push_back(slab);
+            }
+            entries.push_back({core_.get(), core_, std::move(slab)});
+            entry = std::prev(entries.end());
+        }
+
+        // uncontended unless a stats dump is reading this slab right now
+        std::lock_guard<std::mutex> lock(entry->slab->mutex);
+        entry->slab->users.try_emplace(username).first->second += delta;
+    }
+
+    std::vector<std::pair<std::string, UserUsage>> UsageLedger::top(const size_t n) const
+    {
+        UsageMap totals;
+        {
+            std::lock_guard<std::mutex> lock(core_->mutex);
+            totals = core_->retired;
+            for (const auto& slab : core_->slabs) {
+                std::lock_guard<std::mutex> slab_lock(slab->mutex);
+                merge(totals, slab->users);
+            }
+        }
+
+        std::vector<std::pair<std::string, UserUsage>> result(totals.begin(), totals.end());
+        const auto heavier = [](const auto& a, const auto& b) {
+            return a.second.cpu_ns() != b.second.cpu_ns() ? a.second.cpu_ns() > b.second.cpu_ns()
+                                                          : a.second.fanout_bytes > b.second.fanout_bytes;
+        };
+        if (n > 0 && n < result.size()) {
+            std::partial_sort(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(n), result.end(), heavier);
+            result.resize(n);
+        }
+        else
+            std::sort(result.begin(), result.end(), heavier);
+        return result;
+    }
+} // namespace chat::server
@@ -0,0 +1,75 @@
+#include "chat/server/wire_latency.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <ostream>
+
+namespace chat::server
+{
+    int64_t realtime_ns()
+    {
+        timespec ts{};
+        ::clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    }
+
+    void LatencyHistogram::record(const int64_t ns)
+    {
+        // kernel and user clocks are the same clock, but a step in between can make a stage negative
+        const auto value    = static_cast<uint64_t>(std::max<int64_t>(ns, 0));
+        const size_t bucket = value == 0 ? 0 : std::min<size_t>(std::bit_width(value) - 1, kBuckets - 1);
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::count() const
+    {
+        uint64_t total = 0;
+        for (const auto& bucket : buckets_)
+            total += bucket.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    std::chrono::nanoseconds LatencyHistogram::percentile(const double p) const
+    {
+        std::array<uint64_t, kBuckets> snapshot{};
+        uint64_t total = 0;
+        for (size_t i = 0; i < kBuckets; ++i)
+            total += snapshot[i] = buckets_[i].load(std::memory_order_relaxed);
+        if (total == 0)
+            return std::chrono::nanoseconds(0);
+
+        const double rank = std::ceil(p * static_cast<double>(total));
+        double below      = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            if (below + static_cast<double>(snapshot[i]) >= rank) {
+                const double low   = i == 0 ? 0.0 : static_cast<double>(uint64_t{1} << i);
+                const double width = static_cast<double>(uint64_t{1} << i);
+                return std::chrono::nanoseconds(
+                    static_cast<int64_t>(low + width * (rank - below) / static_cast<double>(snapshot[i])));
+            }
+            below += static_cast<double>(snapshot[i]);
+        }
+        return std::chrono::nanoseconds(int64_t{1} << kBuckets);
+    }
+
+    void WireLatency::dump(std::ostream& out) const
+    {
+        const auto line = [&out](const char* label, const LatencyHistogram& histogram) {
+            const auto us = [&histogram](const double p) {
+                return static_cast<double>(histogram.percentile(p).count()) / 1000.0;
+            };
+            const auto precision = out.precision();
+            out << label << histogram.count() << " samples, p50 " << std::fixed << std::setprecision(1) << us(0.50)
+                << " us, p99 " << us(0.99) << " us, p99.9 " << us(0.999) << " us\n"
+                << std::defaultfloat << std::setprecision(static_cast<int>(precision));
+        };
+
+        line("wire rx queue:     ", rx_queue);
+        line("wire processing:   ", processing);
+        line("wire tx queue:     ", tx_queue);
+        line("wire network+ack:  ", ack);
+    }
+} // namespace chat::server
@@ -0,0 +1,102 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "chat/auth/srp_server.hpp"
+#include "chat/tools/traffic_replay.hpp"
+
+namespace
+{
+    void print_usage(const char* program)
+    {
+        std::cerr << "Usage: " << program << " provision <capture> [--db <path>]" << std::endl;
+        std::cerr << "       " << program << " run <capture> [--host <host>] [--port <port>] [--speed <1-100>]"
+            << std::endl;
+        std::cerr << "provision adds one synthetic SRP user per captured login to the user database" << std::endl;
+        std::cerr << "(default users.db); run replays the capture against a server using that database." << std::endl;
+        std::cerr << "Example: " << program << " run day.cap --port 8888 --speed 20" << std::endl;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const std::string mode    = argv[1];
+        const std::string capture = argv[2];
+        std::string db_path       = "users.db";
+        chat::tools::ReplayOptions options;
+
+        for (int i = 3; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--db" && i + 1 < argc) {
+                db_path = argv[++i];
+            }
+            else if (arg == "--host" && i + 1 < argc) {
+                options.host = argv[++i];
+            }
+            else if (arg == "--port" && i + 1 < argc) {
+                options.port = std::stoi(argv[++i]);
+            }
+            else if (arg == "--speed" && i + 1 < argc) {
+                options.speed = std::stod(argv[++i]);
+            }
+            else {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        const auto frames  = chat::TrafficCapture::load(capture);
+        const auto scripts = chat::tools::build_scripts(frames);
+        std::cout << "Loaded " << frames.size() << " frames, " << scripts.size() << " logins from " << capture
+            << std::endl;
+
+        if (mode == "provision") {
+            chat::auth::SRPServer server;
+            server.load_users(db_path);
+            const auto added = server.register_users(chat::tools::make_credentials(scripts, options));
+            server.save_users(db_path);
+            std::cout << "Added " << added << " replay users to " << db_path << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        if (mode != "run") {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (options.speed < 1.0 || options.speed > 100.0) {
+            std::cerr << "Speed must be between 1 and 100" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // clients narrate their progress on stdout, and a missing user must not wait for a registration answer
+        std::ostringstream log;
+        std::istringstream no_input;
+        auto* const saved_out = std::cout.rdbuf(log.rdbuf());
+        auto* const saved_in  = std::cin.rdbuf(no_input.rdbuf());
+        const auto report     = chat::tools::replay(scripts, options);
+        std::cout.rdbuf(saved_out);
+        std::cin.rdbuf(saved_in);
+
+        std::cout << std::fixed << std::setprecision(2)
+            << "Replayed " << report.logins << " logins at " << options.speed << "x in " << report.seconds << "s"
+            << std::endl
+            << "  login failures: " << report.login_failures << std::endl
+            << "  messages: " << report.messages << ", ephemerals: " << report.ephemerals << std::endl
+            << "  late frames: " << report.late_frames << ", max lag " << report.max_lag.count() / 1000.0 << " ms"
+            << std::endl;
+
+        return report.login_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,193 @@
+#include "chat/tools/traffic_replay.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "chat/client/client.hpp"
+
+namespace chat::tools
+{
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+
+        // AES-GCM seal: 12-byte IV in front, 16-byte tag behind
+        constexpr size_t kSealOverhead = 28;
+
+        struct Tally
+        {
+            std::mutex mutex;
+            ReplayReport report;
+
+            void lag(const Clock::duration behind)
+            {
+                const auto us = std::chrono::duration_cast<std::chrono::microseconds>(behind);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (us > std::chrono::milliseconds(1))
+                    ++report.late_frames;
+                report.max_lag = std::max(report.max_lag, us);
+            }
+        };
+
+        Clock::duration scaled(const uint64_t ns, const double speed)
+        {
+            return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::nano>(ns / speed));
+        }
+
+        void run_script(const ReplayScript& script, const ReplayOptions& options, const Clock::time_point start,
+                        Tally& tally)
+        {
+            client::ClientOptions client_options;
+            client_options.password_source = [&options]() { return options.password; };
+            // captured sizes are what went on the wire, so the filler must not be compressed further
+            client_options.compression = false;
+            client::Client client(options.host, options.port, username_for(options, script.connection),
+                                  std::move(client_options));
+
+            try {
+                client.connect();
+            }
+            catch (const std::exception&) {
+                std::lock_guard<std::mutex> lock(tally.mutex);
+                ++tally.report.login_failures;
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(tally.mutex);
+                ++tally.report.logins;
+            }
+
+            size_t messages   = 0;
+            size_t ephemerals = 0;
+            for (const auto& frame : script.frames) {
+                const auto due = start + scaled(frame.time_ns, options.speed);
+                std::this_thread::sleep_until(due);
+                tally.lag(Clock::now() - due);
+
+                if (frame.type == MessageType::DISCONNECT || !client.is_connected())
+                    break;
+
+                const std::string filler(filler_length(frame), 'x');
+                if (frame.type == MessageType::MESSAGE) {
+                    client.send_message(filler);
+                    ++messages;
+                }
+                else {
+                    client.send_ephemeral(EphemeralKind::Presence, filler);
+                    ++ephemerals;
+                }
+            }
+
+            client.stop();
+            std::lock_guard<std::mutex> lock(tally.mutex);
+            tally.report.messages += messages;
+            tally.report.ephemerals += ephemerals;
+        }
+    }
+
+    std::vector<ReplayScript> build_scripts(const std::vector<CapturedFrame>& frames)
+    {
+        std::map<uint32_t, ReplayScript> by_connection;
+        std::map<uint32_t, bool> logged_in;
+
+        for (const auto& frame : frames) {
+            auto [it, first] = by_connection.try_emplace(frame.connection);
+            if (first) {
+                it->second.connection = frame.connection;
+                it->second.login_ns   = frame.time_ns;
+            }
+
+            if (frame.type == MessageType::SRP_RESPONSE) {
+                logged_in[frame.connection] = true;
+                continue;
+            }
+            if (!logged_in[frame.connection])
+                continue;
+
+            if (frame.type == MessageType::MESSAGE || frame.type == MessageType::EPHEMERAL ||
+                frame.type == MessageType::DISCONNECT)
+                it->second.frames.push_back(frame);
+        }
+
+        std::vector<ReplayScript> scripts;
+        for (auto& [connection, script] : by_connection)
+            if (logged_in[connection])
+                scripts.push_back(std::move(script));
+
+        std::ranges::sort(scripts, {}, &ReplayScript::login_ns);
+        return scripts;
+    }
+
+    std::string username_for(const ReplayOptions& options, const uint32_t connection)
+    {
+        return options.username_prefix + std::to_string(connection);
+    }
+
+    std::vector<auth::UserCredentials> make_credentials(const std::vector<ReplayScript>& scripts,
+                                                        const ReplayOptions& options)
+    {
+        auth::VerifierEngine engine;
+        std::vector<auth::UserCredentials> credentials;
+        credentials.reserve(scripts.size());
+        for (const auto& script : scripts)
+            credentials.push_back(engine.make_credentials(username_for(options, script.connection), options.password));
+        return credentials;
+    }
+
+    size_t filler_length(const CapturedFrame& frame)
+    {
+        // MESSAGE is a length-prefixed base64 string; EPHEMERAL has its kind byte in front of that
+        const size_t header = frame.type == MessageType::EPHEMERAL ? 5 : 4;
+        if (frame.size <= header)
+            return 1;
+
+        const size_t sealed = (frame.size - header) / 4 * 3;
+        return sealed > kSealOverhead ? sealed - kSealOverhead : 1;
+    }
+
+    ReplayReport replay(const std::vector<ReplayScript>& scripts, const ReplayOptions& options)
+    {
+        Tally tally;
+        if (scripts.empty())
+            return tally.report;
+
+        // the first login happens right away
+        const auto launched = Clock::now();
+        const auto start    = launched - scaled(scripts.front().login_ns, options.speed);
+
+        struct Worker
+        {
+            std::thread thread;
+            std::shared_ptr<std::atomic<bool>> done;
+        };
+        std::vector<Worker> workers;
+
+        const auto reap = [&workers](const bool all) {
+            std::erase_if(workers, [all](Worker& worker) {
+                if (!all && !worker.done->load())
+                    return false;
+                worker.thread.join();
+                return true;
+            });
+        };
+
+        for (const auto& script : scripts) {
+            std::this_thread::sleep_until(start + scaled(script.login_ns, options.speed));
+            reap(false);
+
+            auto done = std::make_shared<std::atomic<bool>>(false);
+            workers.push_back({std::thread([&script, &options, start, &tally, done]() {
+                run_script(script, options, start, tally);
+                done->store(true);
+            }), done});
+        }
+        reap(true);
+
+        tally.report.seconds = std::chrono::duration<double>(Clock::now() - launched).count();
+        return tally.report;
+    }
+} // namespace chat::tools
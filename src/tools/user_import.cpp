@@ -0,0 +1,468 @@
+#include "chat/tools/user_import.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "chat/auth/verifier_engine.hpp"
+
+namespace chat::tools
+{
+    namespace
+    {
+        // fixed-capacity MPMC queue; close() wakes everyone and makes pop() drain then stop
+        template <class T>
+        class BoundedQueue
+        {
+        private:
+            std::mutex mutex_;
+            std::condition_variable not_empty_;
+            std::condition_variable not_full_;
+            std::deque<T> items_;
+            const size_t capacity_;
+            bool closed_ = false;
+
+        public:
+            explicit BoundedQueue(const size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+            bool push(T item)
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_full_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+                if (closed_)
+                    return false;
+                items_.push_back(std::move(item));
+                not_empty_.notify_one();
+                return true;
+            }
+
+            std::optional<T> pop()
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+                if (items_.empty())
+                    return std::nullopt;
+                T item = std::move(items_.front());
+                items_.pop_front();
+                not_full_.notify_one();
+                return item;
+            }
+
+            void close()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+                not_empty_.notify_all();
+                not_full_.notify_all();
+            }
+        };
+
+        // splits one CSV line; nullopt on an unterminated quote
+        std::optional<std::vector<std::string>> split_csv(const std::string& line)
+        {
+            std::vector<std::string> fields(1);
+            bool quoted = false;
+
+            for (size_t i = 0; i < line.size(); ++i) {
+                const char c = line[i];
+                if (quoted) {
+                    if (c != '"')
+                        fields.back() += c;
+                    else if (i + 1 < line.size() && line[i + 1] == '"')
+                        fields.back() += line[++i];
+                    else
+                        quoted = false;
+                }
+                else if (c == ',')
+                    fields.emplace_back();
+                else if (c == '"' && fields.back().empty())
+                    quoted = true;
+                else
+                    fields.back() += c;
+            }
+
+            if (quoted)
+                return std::nullopt;
+            return fields;
+        }
+
+        void append_utf8(std::string& out, const uint32_t cp)
+        {
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            }
+            else if (cp < 0x800) {
+                out += static_cast<char>(0xC0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000) {
+                out += static_cast<char>(0xE0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else {
+                out += static_cast<char>(0xF0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        // minimal pull parser over the stream: only what the import records need
+        class JsonScanner
+        {
+        private:
+            std::istream& in_;
+
+            bool read_hex4(uint32_t& value)
+            {
+                value = 0;
+                for (int i = 0; i < 4; ++i) {
+                    const int c = in_.get();
+                    value <<= 4;
+                    if (c >= '0' && c <= '9') value |= static_cast<uint32_t>(c - '0');
+                    else if (c >= 'a' && c <= 'f') value |= static_cast<uint32_t>(c - 'a' + 10);
+                    else if (c >= 'A' && c <= 'F') value |= static_cast<uint32_t>(c - 'A' + 10);
+                    else return false;
+                }
+                return true;
+            }
+
+        public:
+            explicit JsonScanner(std::istream& in) : in_(in) {}
+
+            int peek()
+            {
+                skip_ws();
+                return in_.peek();
+            }
+
+            int get() { return in_.get(); }
+
+            void skip_ws()
+            {
+                while (std::isspace(in_.peek()))
+                    in_.get();
+            }
+
+            void skip_line() { in_.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); }
+
+            // expects the opening quote next
+            bool read_string(std::string& out)
+            {
+                out.clear();
+                if (in_.get() != '"')
+                    return false;
+
+                while (true) {
+                    const int c = in_.get();
+                    if (c == std::char_traits<char>::eof() || c == '\n')
+                        return false;
+                    if (c == '"')
+                        return true;
+                    if (c != '\\') {
+                        out += static_cast<char>(c);
+                        continue;
+                    }
+
+                    switch (in_.get()) {
+                        case '"': out += '"'; break;
+                        case '\\': out += '\\'; break;
+                        case '/': out += '/'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'n': out += '\n'; break;
+                        case 'r': out += '\r'; break;
+                        case 't': out += '\t'; break;
+                        case 'u': {
+                            uint32_t cp;
+                            if (!read_hex4(cp))
+                                return false;
+                            // surrogate pair
+                            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                                uint32_t low;
+                                if (in_.get() != '\\' || in_.get() != 'u' || !read_hex4(low) ||
+                                    low < 0xDC00 || low > 0xDFFF)
+                                    return false;
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            }
+                            append_utf8(out, cp);
+                            break;
+                        }
+                        default: return false;
+                    }
+                }
+            }
+
+            // skips a number, literal, or nested object/array
+            bool skip_value()
+            {
+                const int first = peek();
+                if (first == '"') {
+                    std::string ignored;
+                    return read_string(ignored);
+                }
+
+                if (first != '{' && first != '[') {
+                    while (true) {
+                        const int c = in_.peek();
+                        if (c == ',' || c == '}' || c == ']' || std::isspace(c) ||
+                            c == std::char_traits<char>::eof())
+                            return true;
+                        in_.get();
+                    }
+                }
+
+                int depth = 0;
+                do {
+                    const int c = peek();
+                    if (c == std::char_traits<char>::eof())
+                        return false;
+                    if (c == '"') {
+                        std::string ignored;
+                        if (!read_string(ignored))
+                            return false;
+                        continue;
+                    }
+                    in_.get();
+                    if (c == '{' || c == '[')
+                        ++depth;
+                    else if (c == '}' || c == ']')
+                        --depth;
+                } while (depth > 0);
+                return true;
+            }
+        };
+
+        bool read_json_object(JsonScanner& json, ImportRecord& record)
+        {
+            bool has_username = false, has_password = false;
+            json.get(); // '{'
+
+            if (json.peek() == '}') {
+                json.get();
+                return false;
+            }
+
+            std::string key;
+            while (true) {
+                if (json.peek() != '"' || !json.read_string(key))
+                    return false;
+                if (json.peek() != ':')
+                    return false;
+                json.get();
+
+                if (key == "username" && json.peek() == '"')
+                    has_username = json.read_string(record.username);
+                else if (key == "password" && json.peek() == '"')
+                    has_password = json.read_string(record.password);
+                else if (!json.skip_value())
+                    return false;
+
+                const int c = json.peek();
+                json.get();
+                if (c == '}')
+                    return has_username && has_password;
+                if (c != ',')
+                    return false;
+            }
+        }
+    }
+
+    bool is_valid_username(const std::string& username)
+    {
+        return !username.empty() && username.size() <= 64 &&
+            std::none_of(username.begin(), username.end(), [](const char c) {
+                return c == ':' || c == '\n' || c == '\r' || c == '\0';
+            });
+    }
+
+    RecordReader::RecordReader(std::istream& in, const ImportFormat format)
+        : in_(in),
+          format_(format)
+    {
+    }
+
+    std::optional<ImportRecord> RecordReader::next()
+    {
+        return format_ == ImportFormat::CSV ? next_csv() : next_json();
+    }
+
+    std::optional<ImportRecord> RecordReader::next_csv()
+    {
+        std::string line;
+        while (std::getline(in_, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            auto fields = split_csv(line);
+            const bool first_line = !header_checked_;
+            header_checked_       = true;
+
+            if (!fields || fields->size() != 2) {
+                ++malformed_;
+                continue;
+            }
+            if (first_line && (*fields)[0] == "username" && (*fields)[1] == "password")
+                continue;
+
+            return ImportRecord{std::move((*fields)[0]), std::move((*fields)[1])};
+        }
+        return std::nullopt;
+    }
+
+    std::optional<ImportRecord> RecordReader::next_json()
+    {
+        JsonScanner json(in_);
+        while (true) {
+            const int c = json.peek();
+            if (c == std::char_traits<char>::eof())
+                return std::nullopt;
+
+            // array brackets and separators between records carry no information
+            if (c == '[' || c == ']' || c == ',') {
+                json.get();
+                continue;
+            }
+
+            ImportRecord record;
+            if (c == '{' && read_json_object(json, record))
+                return record;
+
+            // resynchronize at the next line, which is where the next JSON Lines record starts
+            ++malformed_;
+            json.skip_line();
+        }
+    }
+
+    ImportReport import_users(std::istream& in, const ImportFormat format, auth::SRPServer& server,
+                              const ImportOptions& options)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        const size_t threads    = options.threads > 0 ? options.threads : std::max(1U, std::thread::hardware_concurrency());
+        const size_t batch_size = std::max<size_t>(options.batch_size, 1);
+
+        // a couple of batches in flight per worker keeps every core busy without buffering the input
+        BoundedQueue<std::vector<ImportRecord>> pending(threads * 2);
+        BoundedQueue<std::vector<auth::UserCredentials>> finished(threads * 2);
+
+        std::atomic<size_t> duplicates{0};
+        std::atomic<size_t> invalid{0};
+        std::atomic<size_t> read{0};
+
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        const auto fail = [&](std::exception_ptr e) {
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::move(e);
+            }
+            pending.close();
+            finished.close();
+        };
+
+        RecordReader reader(in, format);
+        std::thread producer([&]() {
+            try {
+                std::vector<ImportRecord> batch;
+                batch.reserve(batch_size);
+                while (auto record = reader.next()) {
+                    read.fetch_add(1, std::memory_order_relaxed);
+                    batch.push_back(std::move(*record));
+                    if (batch.size() == batch_size) {
+                        if (!pending.push(std::move(batch)))
+                            return;
+                        batch = {};
+                        batch.reserve(batch_size);
+                    }
+                }
+                if (!batch.empty())
+                    pending.push(std::move(batch));
+                pending.close();
+            }
+            catch (...) {
+                fail(std::current_exception());
+            }
+        });
+
+        std::atomic<size_t> workers_left{threads};
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([&]() {
+                try {
+                    auth::VerifierEngine engine;
+                    while (auto batch = pending.pop()) {
+                        std::vector<auth::UserCredentials> out;
+                        out.reserve(batch->size());
+
+                        for (const auto& record : *batch) {
+                            if (!is_valid_username(record.username)) {
+                                invalid.fetch_add(1, std::memory_order_relaxed);
+                                continue;
+                            }
+                            // skip the modexp for accounts that are already there
+                            if (server.user_exists(record.username)) {
+                                duplicates.fetch_add(1, std::memory_order_relaxed);
+                                continue;
+                            }
+                            out.push_back(engine.make_credentials(record.username, record.password));
+                        }
+
+                        if (!finished.push(std::move(out)))
+                            break;
+                    }
+                }
+                catch (...) {
+                    fail(std::current_exception());
+                }
+
+                if (workers_left.fetch_sub(1) == 1)
+                    finished.close();
+            });
+        }
+
+        ImportReport report;
+        try {
+            while (auto batch = finished.pop()) {
+                const size_t computed = batch->size();
+                const size_t added    = server.register_users(std::move(*batch));
+
+                // repeated usernames within the input only collide here
+                duplicates.fetch_add(computed - added, std::memory_order_relaxed);
+                report.imported += added;
+
+                if (options.on_progress)
+                    options.on_progress(report.imported);
+            }
+        }
+        catch (...) {
+            fail(std::current_exception());
+        }
+
+        producer.join();
+        for (auto& worker : workers)
+            worker.join();
+
+        if (error)
+            std::rethrow_exception(error);
+
+        report.read       = read.load();
+        report.duplicates = duplicates.load();
+        report.rejected   = reader.malformed() + invalid.load();
+        report.seconds    = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+} // namespace chat::tools
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "chat/auth/srp_server.hpp"
+#include "chat/tools/user_import.hpp"
+
+namespace
+{
+    void print_usage(const char* program)
+    {
+        std::cerr << "Usage: " << program << " import <file|-> [options]" << std::endl;
+        std::cerr << "Options:" << std::endl;
+        std::cerr << "  --format <csv|json>   input format (default: from extension, else csv)" << std::endl;
+        std::cerr << "  --db <path>           user database to merge into (default users.db)" << std::endl;
+        std::cerr << "  --threads <n>         verifier threads (default: all cores)" << std::endl;
+        std::cerr << "  --batch <n>           records per work unit (default 1024)" << std::endl;
+        std::cerr << "CSV rows are username,password; JSON is JSON Lines or an array of" << std::endl;
+        std::cerr << "{\"username\": ..., \"password\": ...} objects." << std::endl;
+        std::cerr << "Example: " << program << " import accounts.csv --db users.db" << std::endl;
+    }
+
+    chat::tools::ImportFormat format_from_path(const std::string& path)
+    {
+        for (const char* ext : {".json", ".jsonl", ".ndjson"})
+            if (path.ends_with(ext))
+                return chat::tools::ImportFormat::JSON;
+        return chat::tools::ImportFormat::CSV;
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    if (argc < 3 || std::string(argv[1]) != "import") {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const std::string input = argv[2];
+        auto format             = format_from_path(input);
+        std::string db_path     = "users.db";
+        chat::tools::ImportOptions options;
+
+        for (int i = 3; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--format" && i + 1 < argc) {
+                const std::string value = argv[++i];
+                if (value == "csv")
+                    format = chat::tools::ImportFormat::CSV;
+                else if (value == "json")
+                    format = chat::tools::ImportFormat::JSON;
+                else {
+                    std::cerr << "Unknown format: " << value << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+            else if (arg == "--db" && i + 1 < argc) {
+                db_path = argv[++i];
+            }
+            else if (arg == "--threads" && i + 1 < argc) {
+                options.threads = std::stoul(argv[++i]);
+            }
+            else if (arg == "--batch" && i + 1 < argc) {
+                options.batch_size = std::stoul(argv[++i]);
+            }
+            else {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::ifstream file;
+        if (input != "-") {
+            file.open(input, std::ios::binary);
+            if (!file.is_open()) {
+                std::cerr << "Cannot open " << input << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        std::istream& in = input == "-" ? std::cin : file;
+
+        chat::auth::SRPServer server;
+        server.load_users(db_path);
+        std::cout << "Loaded " << server.user_count() << " existing users from " << db_path << std::endl;
+
+        // progress line at most every couple of seconds
+        auto last_report = std::chrono::steady_clock::now();
+        const auto start = last_report;
+        options.on_progress = [&](const size_t imported) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now - last_report < std::chrono::seconds(2))
+                return;
+            last_report        = now;
+            const double secs  = std::chrono::duration<double>(now - start).count();
+            std::cerr << "  " << imported << " users imported (" << static_cast<size_t>(imported / secs)
+                << " users/sec)" << std::endl;
+        };
+
+        const auto report = chat::tools::import_users(in, format, server, options);
+
+        const auto save_start = std::chrono::steady_clock::now();
+        server.save_users(db_path);
+        const double save_secs =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - save_start).count();
+
+        std::cout << std::fixed << std::setprecision(2)
+            << "Imported " << report.imported << " of " << report.read << " users in " << report.seconds << "s ("
+            << (report.seconds > 0 ? report.imported / report.seconds : 0.0) << " users/sec)" << std::endl
+            << "  duplicates: " << report.duplicates << ", rejected: " << report.rejected << std::endl
+            << "  wrote " << server.user_count() << " users to " << db_path << " in " << save_secs << "s" << std::endl;
+
+        return EXIT_SUCCESS;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -1,4 +1,5 @@
 #include "chat/crypto/aes_engine.hpp"
+#include "chat/crypto/session_keys.hpp"
 #include "chat/auth/srp_utils.hpp"
 #include <gtest/gtest.h>
 
@@ -239,4 +240,99 @@ namespace chat::crypto
 
         EXPECT_EQ(decrypted, plaintext);
     }
+    TEST_F(AESEngineTest, TryDecryptRoundTrip)
+    {
+        auto encrypted = AESEngine::encrypt_string("Hello", test_key);
+        auto decrypted = AESEngine::try_decrypt_string(encrypted, test_key);
+
+        ASSERT_TRUE(decrypted);
+        EXPECT_EQ(*decrypted, "Hello");
+    }
+
+    TEST_F(AESEngineTest, TryDecryptTamperedReturnsError)
+    {
+        auto encrypted = AESEngine::encrypt_string("Secret message", test_key);
+        encrypted[encrypted.size() - 1] ^= 0xFF;
+
+        auto decrypted = AESEngine::try_decrypt(encrypted, test_key);
+        EXPECT_FALSE(decrypted);
+        EXPECT_EQ(decrypted.error(), Errc::authentication_failed);
+    }
+
+    TEST_F(AESEngineTest, TryDecryptRejectsMalformedInput)
+    {
+        std::vector<uint8_t> short_data(AESEngine::IV_SIZE + AESEngine::TAG_SIZE - 1, 0);
+        EXPECT_EQ(AESEngine::try_decrypt(short_data, test_key).error(), Errc::invalid_ciphertext);
+
+        std::vector<uint8_t> bad_key(16, 0);
+        auto encrypted = AESEngine::encrypt_string("data", test_key);
+        EXPECT_EQ(AESEngine::try_decrypt(encrypted, bad_key).error(), Errc::invalid_key_size);
+    }
+
+    TEST_F(AESEngineTest, EncryptInPlaceSealsInsideALargerBuffer)
+    {
+        const std::string plaintext = "users and history in one envelope";
+        const std::vector<uint8_t> aad = {'i', 'n', 'i', 't'};
+
+        // a 6-byte frame header ahead of the envelope stays as it was
+        std::vector<uint8_t> frame(6 + AESEngine::IV_SIZE + plaintext.size() + AESEngine::TAG_SIZE, 0x5A);
+        std::copy(plaintext.begin(), plaintext.end(), frame.begin() + 6 + AESEngine::IV_SIZE);
+        AESEngine::encrypt_in_place(std::span(frame).subspan(6), test_key, aad);
+
+        EXPECT_EQ(std::vector<uint8_t>(frame.begin(), frame.begin() + 6), std::vector<uint8_t>(6, 0x5A));
+        const std::vector<uint8_t> sealed(frame.begin() + 6, frame.end());
+        EXPECT_EQ(AESEngine::decrypt_string(sealed, test_key, aad), plaintext);
+        EXPECT_EQ(AESEngine::try_decrypt(sealed, test_key).error(), Errc::authentication_failed);
+
+        std::vector<uint8_t> too_small(AESEngine::IV_SIZE + AESEngine::TAG_SIZE - 1);
+        EXPECT_THROW(AESEngine::encrypt_in_place(too_small, test_key), std::runtime_error);
+    }
+
+    TEST_F(AESEngineTest, SessionKeysAreDeterministicAndDistinctPerDirection)
+    {
+        const auto shared_secret = auth::SRPUtils::random_bytes(32);
+        const auto keys          = derive_session_keys(shared_secret);
+        const auto again         = derive_session_keys(shared_secret);
+
+        // both ends of a login arrive at the same keys
+        EXPECT_EQ(keys.client_to_server.key, again.client_to_server.key);
+        EXPECT_EQ(keys.server_to_client.key, again.server_to_client.key);
+        EXPECT_EQ(keys.client_to_server.nonce_salt, again.client_to_server.nonce_salt);
+        EXPECT_EQ(keys.client_to_server.key.size(), AESEngine::KEY_SIZE);
+
+        EXPECT_NE(keys.client_to_server.key, keys.server_to_client.key);
+        EXPECT_NE(keys.client_to_server.nonce_salt, keys.server_to_client.nonce_salt);
+        EXPECT_NE(derive_session_keys(auth::SRPUtils::random_bytes(32)).client_to_server.key,
+                  keys.client_to_server.key);
+        EXPECT_THROW(derive_session_keys({}), std::runtime_error);
+    }
+
+    TEST_F(AESEngineTest, SealerCountsIVsUnderTheDirectionSalt)
+    {
+        auto keys          = derive_session_keys(auth::SRPUtils::random_bytes(32));
+        const auto salt    = keys.server_to_client.nonce_salt;
+        const auto key     = keys.server_to_client.key;
+        const Sealer sealer(std::move(keys.server_to_client));
+
+        const std::vector<uint8_t> aad = {'a', 'a', 'd'};
+        const auto first  = sealer.seal_string("first");
+        const auto second = sealer.seal_string("second", aad);
+
+        // the receiver opens them like any AESEngine output
+        EXPECT_EQ(AESEngine::decrypt_string(first, key), "first");
+        EXPECT_EQ(AESEngine::decrypt_string(second, key, aad), "second");
+        EXPECT_EQ(AESEngine::try_decrypt(first, keys.client_to_server.key).error(), Errc::authentication_failed);
+
+        // salt, then a big-endian counter
+        for (size_t i = 0; i < kNonceSaltSize; ++i) {
+            EXPECT_EQ(first[i], salt[i]);
+            EXPECT_EQ(second[i], salt[i]);
+        }
+        EXPECT_EQ(first[AESEngine::IV_SIZE - 1], 0);
+        EXPECT_EQ(second[AESEngine::IV_SIZE - 1], 1);
+        EXPECT_TRUE(std::equal(first.begin() + kNonceSaltSize, first.begin() + AESEngine::IV_SIZE - 1,
+                               second.begin() + kNonceSaltSize));
+
+        EXPECT_THROW(Sealer().seal_string("no key"), std::runtime_error);
+    }
 } // namespace chat::crypto
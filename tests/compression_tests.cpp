@@ -0,0 +1,105 @@
+#include "chat/common/compression.hpp"
+
+#include <gtest/gtest.h>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace chat
+{
+    class CompressionTest : public ::testing::Test
+    {
+    protected:
+        static constexpr size_t kMaxSize = 64 * 1024;
+
+        DeflateStream deflate_;
+        InflateStream inflate_;
+
+        static std::span<const uint8_t> bytes(const std::string& text)
+        {
+            return {reinterpret_cast<const uint8_t*>(text.data()), text.size()};
+        }
+    };
+
+    TEST_F(CompressionTest, StreamRoundTripsMessagesInOrder)
+    {
+        const std::vector<std::string> messages = {
+            "good morning", "", "did you see the build is broken again?", std::string(5000, 'z'),
+            "\xF0\x9F\x91\x8D thanks for the help", "good morning",
+        };
+        for (const auto& text : messages) {
+            const auto wire = deflate_.compress(text);
+            const auto back = inflate_.decompress(wire, kMaxSize);
+            ASSERT_TRUE(back) << to_string(back.error());
+            EXPECT_EQ(*back, text);
+        }
+    }
+
+    TEST_F(CompressionTest, EarlierMessagesAndTheDictionaryShrinkLaterOnes)
+    {
+        const std::string line = "can someone take a look at the pull request when you have a minute";
+
+        DeflateStream no_dictionary(std::span<const uint8_t>{});
+        const auto cold  = no_dictionary.compress(line);
+        const auto again = no_dictionary.compress(line);
+        EXPECT_LT(again.size(), cold.size() / 4);
+
+        // the preset dictionary covers the first message of a connection
+        EXPECT_LT(deflate_.compress(line).size(), cold.size());
+    }
+
+    TEST_F(CompressionTest, CorruptFrameFailsAndTheStreamStaysFailed)
+    {
+        ASSERT_TRUE(inflate_.decompress(deflate_.compress("hello there"), kMaxSize));
+
+        auto wire = deflate_.compress("general kenobi");
+        std::vector<uint8_t> garbage(wire.size() + 8, 0xff);
+        const auto bad = inflate_.decompress(garbage, kMaxSize);
+        ASSERT_FALSE(bad);
+        EXPECT_EQ(bad.error(), Errc::decompression_failed);
+
+        // even the frame that was meant to come next is refused
+        const auto after = inflate_.decompress(wire, kMaxSize);
+        ASSERT_FALSE(after);
+        EXPECT_EQ(after.error(), Errc::decompression_failed);
+    }
+
+    TEST_F(CompressionTest, OutputIsCappedAtMaxSize)
+    {
+        const auto wire = deflate_.compress(std::string(100'000, 'a'));
+        EXPECT_LT(wire.size(), 1000u);
+
+        const auto bomb = inflate_.decompress(wire, 10'000);
+        ASSERT_FALSE(bomb);
+        EXPECT_EQ(bomb.error(), Errc::payload_too_large);
+    }
+
+    TEST_F(CompressionTest, PeersNeedTheSameDictionary)
+    {
+        const std::string other_dictionary = "an entirely different preset dictionary ";
+        EXPECT_NE(dictionary_id(bytes(other_dictionary)), dictionary_id(chat_dictionary()));
+
+        // a back-reference into the wrong dictionary decodes to the wrong text, or not at all
+        InflateStream mismatched(bytes(other_dictionary));
+        const auto wire = deflate_.compress("what do you think");
+        const auto text = mismatched.decompress(wire, kMaxSize);
+        EXPECT_FALSE(text && *text == "what do you think");
+    }
+
+    TEST_F(CompressionTest, TrainedDictionaryKeepsRepeatedPhrasesBestLast)
+    {
+        std::vector<std::string> samples;
+        for (int i = 0; i < 20; ++i)
+            samples.push_back("sounds good to me " + std::to_string(i));
+        samples.push_back("said once");
+
+        const auto dictionary = train_dictionary(samples, 64);
+        EXPECT_LE(dictionary.size(), 64u);
+        EXPECT_EQ(dictionary.find("once"), std::string::npos);
+
+        // the longest phrase seen every time scores highest and ends the dictionary
+        const std::string best = "sounds good to ";
+        ASSERT_GE(dictionary.size(), best.size());
+        EXPECT_EQ(dictionary.substr(dictionary.size() - best.size()), best);
+    }
+} // namespace chat
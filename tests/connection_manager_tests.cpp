@@ -6,6 +6,7 @@
 #include <chrono>
 #include <set>
 #include <atomic>
+#include <future>
 
 
 namespace chat::server
@@ -276,6 +277,82 @@ namespace chat::server
         manager_.add("user_1", "bob", conn2);
 
         EXPECT_EQ(manager_.get_username_by_user_id("user_1"), "bob");
+        EXPECT_FALSE(manager_.username_exists("alice"));
+        EXPECT_TRUE(manager_.username_exists("bob"));
+        EXPECT_EQ(manager_.fanout()->size(), 1);
+    }
+
+    TEST_F(ConnectionManagerTest, AddReturnsAttachedSession)
+    {
+        auto conn    = create_test_connection();
+        auto session = manager_.add("user_1", "alice", conn,
+                                    crypto::derive_session_keys(std::vector<uint8_t>(32, 0x42)));
+
+        ASSERT_NE(session, nullptr);
+        EXPECT_EQ(session->user_id(), "user_1");
+        EXPECT_EQ(session->username(), "alice");
+        EXPECT_TRUE(session->keyed());
+        EXPECT_EQ(session->receive_key().size(), 32);
+        EXPECT_EQ(session->sealer().key().size(), 32);
+        EXPECT_EQ(conn->session(), session);
+        EXPECT_EQ(manager_.find("user_1"), session);
+    }
+
+    TEST_F(ConnectionManagerTest, FindNonexistentSession)
+    {
+        EXPECT_EQ(manager_.find("nonexistent"), nullptr);
+    }
+
+    TEST_F(ConnectionManagerTest, FanoutSnapshotTracksJoinAndLeave)
+    {
+        manager_.add("user_1", "alice", create_test_connection());
+        manager_.add("user_2", "bob", create_test_connection());
+
+        const auto before = manager_.fanout();
+        EXPECT_EQ(before->size(), 2);
+
+        manager_.remove("user_1");
+
+        // a snapshot taken earlier stays valid and unchanged
+        EXPECT_EQ(before->size(), 2);
+
+        const auto after = manager_.fanout();
+        ASSERT_EQ(after->size(), 1);
+        EXPECT_EQ(after->front()->username(), "bob");
+    }
+
+    TEST_F(ConnectionManagerTest, RemoteUsersAreListedButReachedThroughTheirLink)
+    {
+        manager_.add("user_1", "alice", create_test_connection());
+        const auto link = manager_.add_link("gateway-1", create_test_connection());
+
+        EXPECT_TRUE(manager_.add_remote("user_2", "bob"));
+        EXPECT_FALSE(manager_.add_remote("user_3", "alice")); // logged in directly
+        EXPECT_FALSE(manager_.add_remote("user_2", "bob"));   // already joined through a gateway
+        EXPECT_TRUE(manager_.username_exists("bob"));
+        EXPECT_EQ(manager_.remote_count(), 1);
+
+        // listed in INIT, but neither bob nor the link is a fanout recipient
+        EXPECT_EQ(manager_.get_active_users().size(), 2);
+        EXPECT_EQ(manager_.fanout()->size(), 1);
+        ASSERT_EQ(manager_.links()->size(), 1);
+        EXPECT_EQ(manager_.links()->front(), link);
+
+        manager_.remove_remote("user_2");
+        EXPECT_FALSE(manager_.username_exists("bob"));
+        EXPECT_EQ(manager_.get_active_users().size(), 1);
+
+        manager_.remove_link(*link);
+        EXPECT_TRUE(manager_.links()->empty());
+    }
+
+    TEST_F(ConnectionManagerTest, SendToClosedSessionFails)
+    {
+        auto session = manager_.add("user_1", "alice", create_test_connection());
+
+        EXPECT_FALSE(session->send(std::vector<uint8_t>{1, 2, 3}));
+        EXPECT_FALSE(manager_.send_to("user_1", {1, 2, 3}));
+        EXPECT_EQ(session->queued(), 0);
     }
 
     TEST_F(ConnectionManagerTest, EmptyUsername)
@@ -306,4 +383,307 @@ namespace chat::server
         EXPECT_TRUE(manager_.username_exists(long_username));
         EXPECT_EQ(manager_.get_username_by_user_id("user_1"), long_username);
     }
+
+    TEST_F(ConnectionManagerTest, EphemeralPacketsCollapseAndShedUnderPressure)
+    {
+        using boost::asio::ip::tcp;
+        static boost::asio::io_context io_context;
+
+        tcp::acceptor acceptor(io_context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        auto conn = create_test_connection();
+        conn->socket().connect(acceptor.local_endpoint());
+        tcp::socket peer(io_context);
+        acceptor.accept(peer);
+
+        auto session = manager_.add("user_1", "alice", conn);
+        const auto packet = [](const uint8_t tag) {
+            return std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{tag});
+        };
+
+        // a payload far beyond the socket buffers keeps the writer blocked until the peer reads
+        const std::vector<uint8_t> big(64 << 20, 0xBB);
+        std::thread writer([&]() { session->send(big); });
+        while (peer.available() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        EXPECT_TRUE(session->send_ephemeral(packet('a'), 1));
+        EXPECT_TRUE(session->send_ephemeral(packet('A'), 1)); // replaces 'a'
+        EXPECT_TRUE(session->send_ephemeral(packet('b'), 2));
+        EXPECT_EQ(session->queued(), 2);
+        EXPECT_EQ(session->stats().ephemeral_collapsed.load(), 1);
+
+        for (uint8_t i = 0; session->queued() < Session::kEphemeralDropDepth; ++i)
+            session->send(std::vector<uint8_t>{static_cast<uint8_t>('0' + i)});
+        const size_t durable = Session::kEphemeralDropDepth - 2;
+
+        // a full queue refuses new ephemerals, and durable traffic evicts the queued ones
+        EXPECT_TRUE(session->send_ephemeral(packet('c'), 3));
+        EXPECT_EQ(session->queued(), Session::kEphemeralDropDepth);
+        session->send(std::vector<uint8_t>{'z'});
+        EXPECT_EQ(session->queued(), durable + 1);
+        EXPECT_EQ(session->stats().ephemeral_dropped.load(), 3);
+
+        std::vector<uint8_t> received(big.size() + durable + 1);
+        boost::asio::read(peer, boost::asio::buffer(received));
+        writer.join();
+
+        // 'A' and 'b' were queued ahead of the durable packets but never reached the wire
+        std::string tail(received.end() - static_cast<std::ptrdiff_t>(durable + 1), received.end());
+        EXPECT_EQ(tail, "0123456789:;<=z");
+        EXPECT_EQ(session->queued(), 0);
+
+        conn->close();
+    }
+
+    TEST_F(ConnectionManagerTest, SessionFallingTooFarBehindIsClosed)
+    {
+        using boost::asio::ip::tcp;
+        static boost::asio::io_context io_context;
+
+        tcp::acceptor acceptor(io_context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        auto conn = create_test_connection();
+        conn->socket().connect(acceptor.local_endpoint());
+        tcp::socket peer(io_context);
+        acceptor.accept(peer);
+
+        Session session("user_1", "alice", conn, {}, Compression::None, 1024);
+
+        // the peer never reads, so the writer stays blocked on the first packet
+        std::atomic<bool> written{true};
+        std::thread writer([&]() { written = session.send(std::vector<uint8_t>(64 << 20, 0xBB)); });
+        while (peer.available() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // one packet past the cap closes the connection, which also frees the blocked writer
+        const std::vector<uint8_t> chunk(300, 0xCC);
+        EXPECT_TRUE(session.send(chunk));
+        EXPECT_TRUE(session.send(chunk));
+        EXPECT_TRUE(session.send(chunk));
+        EXPECT_FALSE(session.send(chunk));
+        writer.join();
+
+        EXPECT_FALSE(written);
+        EXPECT_FALSE(session.is_open());
+        EXPECT_EQ(session.queued(), 0u);
+        EXPECT_EQ(session.stats().queue_overflows.load(), 1u);
+        EXPECT_FALSE(session.send(chunk));
+    }
+
+    TEST_F(ConnectionManagerTest, CollapsedEphemeralsKeepTheQueuedByteCount)
+    {
+        using boost::asio::ip::tcp;
+        static boost::asio::io_context io_context;
+
+        tcp::acceptor acceptor(io_context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        auto conn = create_test_connection();
+        conn->socket().connect(acceptor.local_endpoint());
+        tcp::socket peer(io_context);
+        acceptor.accept(peer);
+
+        Session session("user_1", "alice", conn, {}, Compression::None, 1024);
+        const auto stall = [&]() {
+            std::thread writer([&]() { session.send(std::vector<uint8_t>(64 << 20, 0xBB)); });
+            while (peer.available() == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return writer;
+        };
+        const auto ephemeral = [](const size_t size) {
+            return std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>(size, 0xEE));
+        };
+
+        // a longer state replaces a shorter one under the same key
+        auto writer = stall();
+        EXPECT_TRUE(session.send_ephemeral(ephemeral(10), 1));
+        EXPECT_TRUE(session.send_ephemeral(ephemeral(100), 1));
+        EXPECT_EQ(session.queued_bytes(), 100u);
+
+        std::vector<uint8_t> received((64 << 20) + 100);
+        boost::asio::read(peer, boost::asio::buffer(received));
+        writer.join();
+        EXPECT_EQ(session.queued(), 0u);
+        EXPECT_EQ(session.queued_bytes(), 0u);
+
+        // so a later backlog well under the cap is left alone
+        writer = stall();
+        for (int i = 0; i < 3; ++i)
+            EXPECT_TRUE(session.send(std::vector<uint8_t>(300, 0xCC)));
+        EXPECT_EQ(session.queued_bytes(), 900u);
+
+        received.resize((64 << 20) + 900);
+        boost::asio::read(peer, boost::asio::buffer(received));
+        writer.join();
+        EXPECT_TRUE(session.is_open());
+        EXPECT_EQ(session.stats().queue_overflows.load(), 0u);
+        EXPECT_EQ(session.queued_bytes(), 0u);
+
+        conn->close();
+    }
+
+    TEST_F(ConnectionManagerTest, ShedEphemeralsReleaseTheirQueuedBytes)
+    {
+        using boost::asio::ip::tcp;
+        static boost::asio::io_context io_context;
+
+        tcp::acceptor acceptor(io_context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        auto conn = create_test_connection();
+        conn->socket().connect(acceptor.local_endpoint());
+        tcp::socket peer(io_context);
+        acceptor.accept(peer);
+
+        Session session("user_1", "alice", conn, {}, Compression::None, 1024);
+        const auto stall = [&]() {
+            std::thread writer([&]() { session.send(std::vector<uint8_t>(64 << 20, 0xBB)); });
+            while (peer.available() == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return writer;
+        };
+
+        // a full queue of ephemerals, then durable traffic that sheds them all
+        auto writer = stall();
+        for (uint64_t key = 1; session.queued() < Session::kEphemeralDropDepth; ++key)
+            session.send_ephemeral(std::make_shared<const std::vector<uint8_t>>(60, 0xEE), key);
+        EXPECT_EQ(session.queued_bytes(), Session::kEphemeralDropDepth * 60);
+        EXPECT_TRUE(session.send(std::vector<uint8_t>{'z'}));
+        EXPECT_EQ(session.queued(), 1u);
+        EXPECT_EQ(session.queued_bytes(), 1u);
+
+        std::vector<uint8_t> received((64 << 20) + 1);
+        boost::asio::read(peer, boost::asio::buffer(received));
+        writer.join();
+        EXPECT_EQ(session.queued(), 0u);
+        EXPECT_EQ(session.queued_bytes(), 0u);
+
+        // the shed bytes no longer count against a later backlog
+        writer = stall();
+        for (int i = 0; i < 3; ++i)
+            EXPECT_TRUE(session.send(std::vector<uint8_t>(300, 0xCC)));
+
+        received.resize((64 << 20) + 900);
+        boost::asio::read(peer, boost::asio::buffer(received));
+        writer.join();
+        EXPECT_TRUE(session.is_open());
+        EXPECT_EQ(session.stats().queue_overflows.load(), 0u);
+        EXPECT_EQ(session.queued_bytes(), 0u);
+
+        conn->close();
+    }
+
+    TEST_F(ConnectionManagerTest, CompressedSendDoesNotWaitForABlockedWriter)
+    {
+        using boost::asio::ip::tcp;
+        static boost::asio::io_context io_context;
+
+        tcp::acceptor acceptor(io_context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        auto conn = create_test_connection();
+        conn->socket().connect(acceptor.local_endpoint());
+        tcp::socket peer(io_context);
+        acceptor.accept(peer);
+
+        auto session = manager_.add("user_1", "alice", conn, {}, Compression::Deflate);
+
+        // the first recipient-side write outgrows the socket buffers and blocks, the peer never reads
+        std::thread writer([&]() {
+            session->send_text("first", [](std::span<const uint8_t>) { return std::vector<uint8_t>(64 << 20); });
+        });
+        while (peer.available() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        auto second = std::async(std::launch::async, [&]() {
+            return session->send_text("second", [](const std::span<const uint8_t> body) {
+                return std::vector<uint8_t>(body.begin(), body.end());
+            });
+        });
+        ASSERT_EQ(second.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+        EXPECT_TRUE(second.get());
+        EXPECT_EQ(session->queued(), 1u);
+
+        conn->close();
+        writer.join();
+    }
+
+    TEST_F(ConnectionManagerTest, DedicatedWriterKeepsSendersOffTheSocket)
+    {
+        using boost::asio::ip::tcp;
+        static boost::asio::io_context io_context;
+
+        tcp::acceptor acceptor(io_context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        auto conn = create_test_connection();
+        conn->socket().connect(acceptor.local_endpoint());
+        tcp::socket peer(io_context);
+        acceptor.accept(peer);
+
+        Session session("user_1", "alice", conn);
+        session.start_writer();
+
+        // the peer is not reading, yet neither send waits for the socket
+        const std::vector<uint8_t> big(64 << 20, 0xBB);
+        EXPECT_TRUE(session.send(big));
+        while (peer.available() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        EXPECT_TRUE(session.send(std::vector<uint8_t>{'z'}));
+        EXPECT_EQ(session.queued(), 1u);
+
+        // stopping drains what is left before the thread exits
+        std::vector<uint8_t> received(big.size() + 1);
+        std::thread reader([&]() { boost::asio::read(peer, boost::asio::buffer(received)); });
+        session.stop_writer();
+        reader.join();
+        EXPECT_EQ(received.back(), 'z');
+        EXPECT_EQ(session.queued(), 0u);
+
+        conn->close();
+    }
+
+    TEST_F(ConnectionManagerTest, AwayWindowSplitsMessagesBetweenFanoutAndDigests)
+    {
+        using Range  = std::pair<uint64_t, uint64_t>;
+        auto session = manager_.add("user_1", "alice", create_test_connection());
+        EXPECT_FALSE(session->skips(1));
+        EXPECT_FALSE(session->undelivered_from());
+
+        // away after seq 10: everything later is left for a digest
+        EXPECT_TRUE(session->set_away(true, 10));
+        EXPECT_FALSE(session->set_away(true, 12));
+        EXPECT_FALSE(session->skips(10));
+        EXPECT_TRUE(session->skips(11));
+        EXPECT_TRUE(session->skips(1000));
+        EXPECT_EQ(session->undelivered_from(), 10u);
+
+        // a claimed range is not handed out twice, and only counts once delivered
+        EXPECT_EQ(session->claim_digest(14), Range(10, 14));
+        EXPECT_EQ(session->claim_digest(14), Range(0, 0));
+        EXPECT_EQ(session->undelivered_from(), 10u);
+        session->digest_delivered(14);
+        EXPECT_EQ(session->undelivered_from(), 14u);
+
+        // back at seq 20: messages up to it stay skipped, later ones are live again
+        EXPECT_TRUE(session->set_away(false, 20));
+        EXPECT_TRUE(session->skips(20));
+        EXPECT_FALSE(session->skips(21));
+        EXPECT_EQ(session->claim_digest(25), Range(14, 20));
+        session->digest_delivered(20);
+        EXPECT_FALSE(session->undelivered_from());
+
+        EXPECT_TRUE(session->set_away(true, 30));
+        EXPECT_FALSE(session->skips(25));
+        EXPECT_TRUE(session->skips(31));
+        EXPECT_EQ(session->undelivered_from(), 30u);
+    }
+
+    TEST(LatencyHistogramTest, PercentilesFallInTheRightBucket)
+    {
+        LatencyHistogram histogram;
+        EXPECT_EQ(histogram.percentile(0.5).count(), 0);
+
+        for (int i = 0; i < 99; ++i)
+            histogram.record(1'500);     // [1024, 2048)
+        histogram.record(3'000'000);     // [2^21, 2^22)
+        histogram.record(-5);            // clock step: counted as 0
+
+        EXPECT_EQ(histogram.count(), 101u);
+        EXPECT_GE(histogram.percentile(0.5).count(), 1024);
+        EXPECT_LT(histogram.percentile(0.5).count(), 2048);
+        EXPECT_GE(histogram.percentile(1.0).count(), int64_t{1} << 21);
+        EXPECT_LE(histogram.percentile(1.0).count(), int64_t{1} << 22);
+    }
 } // namespace chat::server
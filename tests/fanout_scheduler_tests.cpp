@@ -0,0 +1,354 @@
+#include "chat/server/fanout_scheduler.hpp"
+#include "chat/server/overload_controller.hpp"
+#include "chat/server/rate_limiter.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace chat::server
+{
+    class TokenBucketTest : public ::testing::Test
+    {
+    protected:
+        using Clock = TokenBucket::Clock;
+        const Clock::time_point t0_ = Clock::now();
+    };
+
+    TEST_F(TokenBucketTest, DefaultIsUnlimited)
+    {
+        TokenBucket bucket;
+        EXPECT_TRUE(bucket.unlimited());
+        for (int i = 0; i < 1000; ++i)
+            EXPECT_TRUE(bucket.try_acquire(t0_));
+        EXPECT_EQ(bucket.retry_after(t0_).count(), 0);
+    }
+
+    TEST_F(TokenBucketTest, BurstThenThrottle)
+    {
+        TokenBucket bucket(10.0, 5.0, t0_);
+        for (int i = 0; i < 5; ++i)
+            EXPECT_TRUE(bucket.try_acquire(t0_));
+        EXPECT_FALSE(bucket.try_acquire(t0_));
+        EXPECT_EQ(bucket.retry_after(t0_).count(), 100);
+    }
+
+    TEST_F(TokenBucketTest, RefillsAtRateUpToBurst)
+    {
+        TokenBucket bucket(10.0, 5.0, t0_);
+        for (int i = 0; i < 5; ++i)
+            ASSERT_TRUE(bucket.try_acquire(t0_));
+
+        const auto later = t0_ + std::chrono::milliseconds(250);
+        EXPECT_TRUE(bucket.try_acquire(later));
+        EXPECT_TRUE(bucket.try_acquire(later));
+        EXPECT_FALSE(bucket.try_acquire(later));
+
+        // a long idle period refills to the burst size, not beyond
+        const auto much_later = later + std::chrono::seconds(60);
+        int admitted          = 0;
+        while (bucket.try_acquire(much_later))
+            ++admitted;
+        EXPECT_EQ(admitted, 5);
+    }
+
+    class OverloadControllerTest : public ::testing::Test
+    {
+    protected:
+        using Clock = OverloadController::Clock;
+        const Clock::time_point t0_ = Clock::now();
+
+        static constexpr auto kAbove = std::chrono::milliseconds(8);
+        static constexpr auto kBelow = std::chrono::milliseconds(1);
+
+        OverloadController controller_{OverloadOptions{std::chrono::milliseconds(5), std::chrono::milliseconds(100)}};
+
+        // one sample every 10 ms from `from` for `span`
+        void feed(const Clock::duration sojourn, const Clock::time_point from, const Clock::duration span)
+        {
+            for (auto t = from; t <= from + span; t += std::chrono::milliseconds(10))
+                controller_.observe(sojourn, t);
+        }
+    };
+
+    TEST_F(OverloadControllerTest, BriefSpikesAreTolerated)
+    {
+        // above target most of the time, but one sample per interval shows the queue draining
+        for (int i = 0; i < 50; ++i)
+            controller_.observe(i % 8 == 7 ? kBelow : kAbove, t0_ + std::chrono::milliseconds(15 * i));
+        EXPECT_EQ(controller_.level(), OverloadLevel::Normal);
+        EXPECT_EQ(controller_.retry_after().count(), 0);
+    }
+
+    TEST_F(OverloadControllerTest, StandingQueueEscalatesFasterTheLongerItStands)
+    {
+        feed(kAbove, t0_, std::chrono::milliseconds(90));
+        EXPECT_EQ(controller_.level(), OverloadLevel::Normal);
+
+        controller_.observe(kAbove, t0_ + std::chrono::milliseconds(100));
+        EXPECT_EQ(controller_.level(), OverloadLevel::DeferEphemeral);
+        EXPECT_EQ(controller_.retry_after().count(), 100);
+
+        // the next step comes after interval/sqrt(2), about 71 ms, then interval/sqrt(3)
+        controller_.observe(kAbove, t0_ + std::chrono::milliseconds(160));
+        EXPECT_EQ(controller_.level(), OverloadLevel::DeferEphemeral);
+        controller_.observe(kAbove, t0_ + std::chrono::milliseconds(175));
+        EXPECT_EQ(controller_.level(), OverloadLevel::RefuseLogins);
+        controller_.observe(kAbove, t0_ + std::chrono::milliseconds(235));
+        EXPECT_EQ(controller_.level(), OverloadLevel::RefuseMessages);
+
+        // and no further
+        feed(kAbove, t0_ + std::chrono::milliseconds(240), std::chrono::seconds(1));
+        EXPECT_EQ(controller_.level(), OverloadLevel::RefuseMessages);
+        EXPECT_EQ(controller_.stats().escalations, 3);
+    }
+
+    TEST_F(OverloadControllerTest, RecoversOneLevelPerIntervalBelowTarget)
+    {
+        feed(kAbove, t0_, std::chrono::milliseconds(500));
+        ASSERT_EQ(controller_.level(), OverloadLevel::RefuseMessages);
+
+        const auto t1 = t0_ + std::chrono::milliseconds(510);
+        feed(kBelow, t1, std::chrono::milliseconds(100));
+        EXPECT_EQ(controller_.level(), OverloadLevel::RefuseLogins);
+
+        // an above-target sample restarts the recovery interval without escalating
+        controller_.observe(kAbove, t1 + std::chrono::milliseconds(150));
+        feed(kBelow, t1 + std::chrono::milliseconds(160), std::chrono::milliseconds(90));
+        EXPECT_EQ(controller_.level(), OverloadLevel::RefuseLogins);
+
+        feed(kBelow, t1 + std::chrono::milliseconds(260), std::chrono::milliseconds(300));
+        EXPECT_EQ(controller_.level(), OverloadLevel::Normal);
+        EXPECT_EQ(controller_.stats().recoveries, 3);
+    }
+
+    TEST_F(OverloadControllerTest, SilenceCountsAsADrainedQueue)
+    {
+        // refused traffic leaves no samples; ticks alone must bring the level down
+        feed(kAbove, t0_, std::chrono::milliseconds(500));
+        ASSERT_EQ(controller_.level(), OverloadLevel::RefuseMessages);
+
+        for (int i = 1; i <= 10; ++i)
+            controller_.tick(t0_ + std::chrono::milliseconds(500 + 100 * i));
+        EXPECT_EQ(controller_.level(), OverloadLevel::Normal);
+
+        // ticks do not mask samples that keep arriving
+        feed(kAbove, t0_ + std::chrono::seconds(2), std::chrono::milliseconds(200));
+        controller_.tick(t0_ + std::chrono::milliseconds(2205));
+        EXPECT_NE(controller_.level(), OverloadLevel::Normal);
+    }
+
+    TEST_F(OverloadControllerTest, ZeroTargetDisables)
+    {
+        OverloadController disabled(OverloadOptions{.target = std::chrono::microseconds(0)});
+        EXPECT_FALSE(disabled.enabled());
+        for (int i = 0; i < 100; ++i)
+            disabled.observe(std::chrono::seconds(1), t0_ + std::chrono::milliseconds(50 * i));
+        EXPECT_EQ(disabled.level(), OverloadLevel::Normal);
+    }
+
+    class FanoutSchedulerTest : public ::testing::Test
+    {
+    protected:
+        // holds the single worker inside a job until released, so queues can be staged
+        struct Gate
+        {
+            std::promise<void> entered;
+            std::promise<void> release;
+        };
+
+        static FanoutScheduler::Job blocking_job(Gate& gate)
+        {
+            return [&gate]() {
+                gate.entered.set_value();
+                gate.release.get_future().wait();
+            };
+        }
+    };
+
+    TEST_F(FanoutSchedulerTest, RunsJobsInOrderPerSender)
+    {
+        FanoutScheduler scheduler;
+        std::mutex mutex;
+        std::vector<int> order;
+        std::promise<void> done;
+
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(scheduler.submit("alice", 1, [&, i]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(i);
+                if (order.size() == 10)
+                    done.set_value();
+            }));
+        }
+
+        ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+        for (int i = 0; i < 10; ++i)
+            EXPECT_EQ(order[i], i);
+    }
+
+    TEST_F(FanoutSchedulerTest, RejectsWhenSenderQueueFull)
+    {
+        FanoutScheduler scheduler(FanoutOptions{.workers = 1, .quantum = 1, .max_queued_jobs = 2});
+        Gate gate;
+        ASSERT_TRUE(scheduler.submit("blocker", 1, blocking_job(gate)));
+        gate.entered.get_future().wait();
+
+        EXPECT_TRUE(scheduler.submit("alice", 1, []() {}));
+        EXPECT_TRUE(scheduler.submit("alice", 1, []() {}));
+        EXPECT_FALSE(scheduler.submit("alice", 1, []() {}));
+        EXPECT_TRUE(scheduler.submit("bob", 1, []() {})); // limits are per sender
+        EXPECT_EQ(scheduler.pending(), 3);
+        EXPECT_EQ(scheduler.queued("alice"), 2);
+        EXPECT_EQ(scheduler.queued("carol"), 0);
+
+        gate.release.set_value();
+    }
+
+    TEST_F(FanoutSchedulerTest, SharesCapacityFairlyBetweenSenders)
+    {
+        // a flooding sender with a deep backlog must not delay a quiet one behind all of it
+        FanoutScheduler scheduler(FanoutOptions{.workers = 1, .quantum = 10, .max_queued_jobs = 1000});
+        Gate gate;
+        ASSERT_TRUE(scheduler.submit("blocker", 1, blocking_job(gate)));
+        gate.entered.get_future().wait();
+
+        std::mutex mutex;
+        std::vector<std::string> order;
+        const auto record = [&](std::string sender) {
+            return [&, sender]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(sender);
+            };
+        };
+
+        for (int i = 0; i < 100; ++i)
+            ASSERT_TRUE(scheduler.submit("flood", 10, record("flood")));
+        for (int i = 0; i < 3; ++i)
+            ASSERT_TRUE(scheduler.submit("quiet", 10, record("quiet")));
+
+        gate.release.set_value();
+        while (scheduler.pending() > 0)
+            std::this_thread::yield();
+        scheduler.stop();
+
+        ASSERT_EQ(order.size(), 103);
+        // with equal quanta the two senders alternate until the quiet one runs dry
+        size_t last_quiet = 0;
+        for (size_t i = 0; i < order.size(); ++i)
+            if (order[i] == "quiet")
+                last_quiet = i;
+        EXPECT_LE(last_quiet, 6);
+    }
+
+    TEST_F(FanoutSchedulerTest, ExpensiveJobWaitsForCredit)
+    {
+        FanoutScheduler scheduler(FanoutOptions{.workers = 1, .quantum = 4, .max_queued_jobs = 16});
+        std::promise<void> done;
+        ASSERT_TRUE(scheduler.submit("alice", 10, [&]() { done.set_value(); }));
+        EXPECT_EQ(done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    }
+
+    TEST_F(FanoutSchedulerTest, StopDropsPendingAndRejectsNewJobs)
+    {
+        FanoutScheduler scheduler;
+        Gate gate;
+        std::atomic<int> ran{0};
+        ASSERT_TRUE(scheduler.submit("blocker", 1, blocking_job(gate)));
+        gate.entered.get_future().wait();
+        ASSERT_TRUE(scheduler.submit("alice", 1, [&]() { ++ran; }));
+
+        auto stopped = std::async(std::launch::async, [&]() { scheduler.stop(); });
+
+        // release the worker only once stop() is under way
+        for (int probe = 0; scheduler.submit("probe" + std::to_string(probe), 1, [&]() { ++ran; }); ++probe)
+            std::this_thread::yield();
+        gate.release.set_value();
+        stopped.wait();
+
+        EXPECT_EQ(ran.load(), 0);
+        EXPECT_FALSE(scheduler.submit("alice", 1, []() {}));
+        EXPECT_EQ(scheduler.pending(), 0);
+    }
+
+    TEST_F(FanoutSchedulerTest, AddsWorkersWhenQueueWaitExceedsTarget)
+    {
+        FanoutScheduler scheduler(FanoutOptions{
+            .workers = 1, .max_queued_jobs = 100, .max_workers = 4,
+            .target_wait = std::chrono::milliseconds(1), .scale_interval = std::chrono::milliseconds(5)
+        });
+        EXPECT_EQ(scheduler.pool_stats().workers, 1);
+
+        // slow jobs from many senders back the queue up well past the target
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 40; ++i) {
+            ASSERT_TRUE(scheduler.submit("sender" + std::to_string(i % 8), 1, [&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                ++ran;
+            }));
+        }
+
+        while (ran.load() < 40)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        const auto stats = scheduler.pool_stats();
+        EXPECT_GT(stats.started, 0);
+        EXPECT_GT(stats.workers, 1);
+        EXPECT_LE(stats.workers, 4);
+    }
+
+    TEST_F(FanoutSchedulerTest, IdleWorkersRetireDownToTheFloor)
+    {
+        FanoutScheduler scheduler(FanoutOptions{
+            .workers = 1, .max_queued_jobs = 100, .max_workers = 3,
+            .target_wait = std::chrono::microseconds(100), .scale_interval = std::chrono::milliseconds(1),
+            .idle_timeout = std::chrono::milliseconds(50)
+        });
+
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 20; ++i) {
+            ASSERT_TRUE(scheduler.submit("sender" + std::to_string(i % 4), 1, [&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                ++ran;
+            }));
+        }
+        while (ran.load() < 20)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ASSERT_GT(scheduler.pool_stats().started, 0);
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (scheduler.pool_stats().workers > 1 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        const auto stats = scheduler.pool_stats();
+        EXPECT_EQ(stats.workers, 1);
+        EXPECT_EQ(stats.retired, stats.started);
+
+        // the remaining worker still serves, and a later submit reaps the exited threads
+        std::promise<void> done;
+        ASSERT_TRUE(scheduler.submit("late", 1, [&]() { done.set_value(); }));
+        EXPECT_EQ(done.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    }
+
+    TEST_F(FanoutSchedulerTest, FixedPoolNeverScales)
+    {
+        FanoutScheduler scheduler(FanoutOptions{.workers = 2, .max_queued_jobs = 100});
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 20; ++i)
+            ASSERT_TRUE(scheduler.submit("s" + std::to_string(i % 4), 1, [&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                ++ran;
+            }));
+        while (ran.load() < 20)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        const auto stats = scheduler.pool_stats();
+        EXPECT_EQ(stats.workers, 2);
+        EXPECT_EQ(stats.started, 0);
+    }
+} // namespace chat::server
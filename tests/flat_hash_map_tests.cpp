@@ -0,0 +1,202 @@
+#include "chat/common/flat_hash_map.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace chat
+{
+    class FlatHashMapTest : public ::testing::Test
+    {
+    protected:
+        FlatHashMap<std::string, int> map_;
+    };
+
+    TEST_F(FlatHashMapTest, EmptyMap)
+    {
+        EXPECT_TRUE(map_.empty());
+        EXPECT_EQ(map_.size(), 0);
+        EXPECT_EQ(map_.find("missing"), map_.end());
+        EXPECT_EQ(map_.erase("missing"), 0);
+        EXPECT_EQ(map_.begin(), map_.end());
+    }
+
+    TEST_F(FlatHashMapTest, InsertAndFind)
+    {
+        map_["alice"] = 1;
+        map_["bob"]   = 2;
+
+        ASSERT_NE(map_.find("alice"), map_.end());
+        EXPECT_EQ(map_.find("alice")->second, 1);
+        EXPECT_EQ(map_.find("bob")->second, 2);
+        EXPECT_EQ(map_.size(), 2);
+    }
+
+    TEST_F(FlatHashMapTest, HeterogeneousLookup)
+    {
+        map_["user_1"] = 7;
+
+        const std::string_view view = "user_1";
+        const char* cstr            = "user_1";
+
+        EXPECT_TRUE(map_.contains(view));
+        EXPECT_TRUE(map_.contains(cstr));
+        EXPECT_EQ(map_.find(view)->second, 7);
+        EXPECT_EQ(map_.erase(view), 1);
+        EXPECT_FALSE(map_.contains(std::string("user_1")));
+    }
+
+    TEST_F(FlatHashMapTest, TryEmplaceDoesNotOverwrite)
+    {
+        EXPECT_TRUE(map_.try_emplace("alice", 1).second);
+        EXPECT_FALSE(map_.try_emplace("alice", 2).second);
+        EXPECT_EQ(map_["alice"], 1);
+
+        map_.insert_or_assign("alice", 3);
+        EXPECT_EQ(map_["alice"], 3);
+    }
+
+    TEST_F(FlatHashMapTest, GrowthKeepsAllEntries)
+    {
+        constexpr int kCount = 10000;
+        for (int i = 0; i < kCount; ++i)
+            map_["key_" + std::to_string(i)] = i;
+
+        EXPECT_EQ(map_.size(), kCount);
+        for (int i = 0; i < kCount; ++i) {
+            auto it = map_.find("key_" + std::to_string(i));
+            ASSERT_NE(it, map_.end());
+            EXPECT_EQ(it->second, i);
+        }
+    }
+
+    TEST_F(FlatHashMapTest, IterationVisitsEveryEntryOnce)
+    {
+        for (int i = 0; i < 100; ++i)
+            map_["k" + std::to_string(i)] = i;
+
+        int sum   = 0;
+        int count = 0;
+        for (const auto& [key, value] : map_) {
+            sum += value;
+            ++count;
+        }
+
+        EXPECT_EQ(count, 100);
+        EXPECT_EQ(sum, 99 * 100 / 2);
+    }
+
+    TEST_F(FlatHashMapTest, EraseThenReinsert)
+    {
+        for (int round = 0; round < 50; ++round) {
+            for (int i = 0; i < 200; ++i)
+                map_["k" + std::to_string(i)] = i + round;
+            for (int i = 0; i < 200; i += 2)
+                map_.erase("k" + std::to_string(i));
+
+            EXPECT_EQ(map_.size(), 100);
+            EXPECT_FALSE(map_.contains("k0"));
+            EXPECT_EQ(map_["k1"], 1 + round);
+        }
+
+        // tombstones must not leak capacity across rounds
+        EXPECT_LE(map_.capacity(), 1024);
+    }
+
+    TEST_F(FlatHashMapTest, EraseByIterator)
+    {
+        for (int i = 0; i < 50; ++i)
+            map_["k" + std::to_string(i)] = i;
+
+        for (auto it = map_.begin(); it != map_.end();) {
+            if (it->second % 2 == 0)
+                it = map_.erase(it);
+            else
+                ++it;
+        }
+
+        EXPECT_EQ(map_.size(), 25);
+        for (const auto& [key, value] : map_)
+            EXPECT_EQ(value % 2, 1);
+    }
+
+    TEST_F(FlatHashMapTest, ClearResetsMap)
+    {
+        for (int i = 0; i < 100; ++i)
+            map_["k" + std::to_string(i)] = i;
+
+        map_.clear();
+        EXPECT_TRUE(map_.empty());
+        EXPECT_FALSE(map_.contains("k1"));
+
+        map_["k1"] = 5;
+        EXPECT_EQ(map_["k1"], 5);
+    }
+
+    TEST_F(FlatHashMapTest, CopyAndMove)
+    {
+        map_["alice"] = 1;
+        map_["bob"]   = 2;
+
+        FlatHashMap<std::string, int> copy = map_;
+        EXPECT_EQ(copy.size(), 2);
+        EXPECT_EQ(copy["alice"], 1);
+
+        FlatHashMap<std::string, int> moved = std::move(copy);
+        EXPECT_EQ(moved.size(), 2);
+        EXPECT_EQ(moved["bob"], 2);
+    }
+
+    TEST_F(FlatHashMapTest, NonTrivialValuesAreDestroyed)
+    {
+        auto tracker = std::make_shared<int>(0);
+        {
+            FlatHashMap<std::string, std::shared_ptr<int>> map;
+            for (int i = 0; i < 100; ++i)
+                map["k" + std::to_string(i)] = tracker;
+            EXPECT_EQ(tracker.use_count(), 101);
+
+            map.erase("k0");
+            EXPECT_EQ(tracker.use_count(), 100);
+        }
+        EXPECT_EQ(tracker.use_count(), 1);
+    }
+
+    TEST_F(FlatHashMapTest, IntegerKeys)
+    {
+        FlatHashMap<uint64_t, uint64_t> map;
+        for (uint64_t i = 0; i < 5000; ++i)
+            map[i * 4096] = i;
+
+        for (uint64_t i = 0; i < 5000; ++i)
+            EXPECT_EQ(map.find(i * 4096)->second, i);
+    }
+
+    TEST_F(FlatHashMapTest, MatchesUnorderedMapUnderRandomOps)
+    {
+        std::mt19937 rng(42);
+        std::unordered_map<std::string, int> reference;
+
+        for (int step = 0; step < 20000; ++step) {
+            const auto key = "k" + std::to_string(rng() % 500);
+            switch (rng() % 3) {
+                case 0:
+                    map_[key]      = step;
+                    reference[key] = step;
+                    break;
+                case 1:
+                    EXPECT_EQ(map_.erase(key), reference.erase(key));
+                    break;
+                default:
+                    EXPECT_EQ(map_.contains(key), reference.contains(key));
+            }
+        }
+
+        EXPECT_EQ(map_.size(), reference.size());
+        for (const auto& [key, value] : reference)
+            EXPECT_EQ(map_[key], value);
+    }
+} // namespace chat
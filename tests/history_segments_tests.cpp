@@ -0,0 +1,182 @@
+#include "chat/server/history_segments.hpp"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "chat/common/init_codec.hpp"
+#include "chat/common/protocol.hpp"
+#include "chat/server/connection_manager.hpp"
+
+namespace chat::server
+{
+    class HistorySegmentsTest : public ::testing::Test
+    {
+    protected:
+        std::filesystem::path dir_;
+
+        void SetUp() override
+        {
+            const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+            dir_ = std::filesystem::temp_directory_path() / (std::string("chat_history_segments_") + info->name());
+            std::filesystem::remove_all(dir_);
+        }
+
+        void TearDown() override
+        {
+            std::filesystem::remove_all(dir_);
+        }
+
+        static Message make_message(const uint64_t seq)
+        {
+            Message message;
+            message.username  = "user" + std::to_string(seq % 3);
+            message.text      = "message " + std::to_string(seq);
+            message.timestamp = std::chrono::system_clock::time_point(std::chrono::milliseconds(1'000 * seq));
+            message.seq       = seq;
+            return message;
+        }
+
+        static void fill(HistorySegments& segments, const uint64_t first, const uint64_t last)
+        {
+            for (uint64_t seq = first; seq <= last; ++seq)
+                segments.append(make_message(seq));
+        }
+
+        // parses the HISTORY frames a span covers, the way a client would
+        static std::vector<uint64_t> read_seqs(const std::vector<FileSpan>& spans)
+        {
+            std::vector<uint8_t> bytes;
+            for (const auto& span : spans) {
+                std::vector<uint8_t> chunk(span.length);
+                EXPECT_EQ(::pread(span.fd, chunk.data(), chunk.size(), static_cast<off_t>(span.offset)),
+                          static_cast<ssize_t>(chunk.size()));
+                bytes.insert(bytes.end(), chunk.begin(), chunk.end());
+            }
+            return decode_frames(bytes);
+        }
+
+        static std::vector<uint64_t> decode_frames(const std::vector<uint8_t>& bytes)
+        {
+            std::vector<uint64_t> seqs;
+            for (size_t pos = 0; pos < bytes.size();) {
+                MsgHeader header{};
+                std::memcpy(&header, bytes.data() + pos, sizeof(header));
+                EXPECT_EQ(header.type, static_cast<uint16_t>(MessageType::HISTORY));
+                const std::span<const uint8_t> payload(bytes.data() + pos + sizeof(header), header.size);
+                const auto init = InitCodec::decode(payload);
+                for (const auto& message : init.messages) {
+                    EXPECT_EQ(message.text, "message " + std::to_string(message.seq));
+                    seqs.push_back(message.seq);
+                }
+                pos += sizeof(header) + header.size;
+            }
+            return seqs;
+        }
+
+        static std::vector<uint64_t> iota(const uint64_t first, const uint64_t last)
+        {
+            std::vector<uint64_t> seqs;
+            for (uint64_t seq = first; seq <= last; ++seq)
+                seqs.push_back(seq);
+            return seqs;
+        }
+    };
+
+    TEST_F(HistorySegmentsTest, SpansCoverExactlyTheRequestedRange)
+    {
+        HistorySegments segments(dir_.string(), 1'000);
+        fill(segments, 1, 150);
+        EXPECT_EQ(segments.segment_count(), 3);
+
+        // inside one segment, across a boundary, and across all three
+        for (const auto& [after, through] : {std::pair<uint64_t, uint64_t>{4, 10}, {60, 70}, {0, 150}, {63, 64}}) {
+            const auto spans = segments.spans(after, through);
+            ASSERT_TRUE(spans.has_value());
+            EXPECT_EQ(read_seqs(*spans), iota(after + 1, through)) << after << ".." << through;
+        }
+
+        EXPECT_TRUE(segments.spans(10, 10)->empty());
+        EXPECT_FALSE(segments.spans(140, 151).has_value());
+    }
+
+    TEST_F(HistorySegmentsTest, OldSegmentsRetireOnceTheWindowMovesOn)
+    {
+        HistorySegments segments(dir_.string(), 100);
+        fill(segments, 1, 200);
+
+        // seq 101..200 must stay addressable; whole segments older than that are gone from disk
+        EXPECT_LE(segments.first_seq(), 101);
+        EXPECT_EQ(segments.last_seq(), 200);
+        EXPECT_EQ(read_seqs(*segments.spans(100, 200)), iota(101, 200));
+        EXPECT_FALSE(segments.spans(0, 200).has_value());
+
+        size_t files = 0;
+        for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(dir_))
+            ++files;
+        EXPECT_EQ(files, segments.segment_count());
+
+        // a span taken before retirement still reads its unlinked file
+        const auto held = segments.spans(128, 140);
+        fill(segments, 201, 400);
+        EXPECT_EQ(read_seqs(*held), iota(129, 140));
+    }
+
+    TEST_F(HistorySegmentsTest, RestartStartsFromAnEmptyDirectoryAndRejectsGaps)
+    {
+        {
+            HistorySegments segments(dir_.string(), 100);
+            fill(segments, 1, 70);
+        }
+
+        HistorySegments segments(dir_.string(), 100);
+        EXPECT_EQ(segments.segment_count(), 0);
+        EXPECT_EQ(std::filesystem::directory_iterator(dir_), std::filesystem::directory_iterator());
+
+        // the server refills from the log tail, which need not start at 1
+        fill(segments, 41, 70);
+        EXPECT_EQ(read_seqs(*segments.spans(40, 70)), iota(41, 70));
+        EXPECT_THROW(segments.append(make_message(72)), std::invalid_argument);
+    }
+
+    TEST_F(HistorySegmentsTest, SessionStreamsSpansInOrderWithPackets)
+    {
+        using boost::asio::ip::tcp;
+        boost::asio::io_context io_context;
+
+        HistorySegments segments(dir_.string(), 100);
+        fill(segments, 1, 90);
+
+        tcp::acceptor acceptor(io_context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        auto conn = std::make_shared<Connection>(io_context);
+        conn->socket().connect(acceptor.local_endpoint());
+        tcp::socket peer(io_context);
+        acceptor.accept(peer);
+
+        Session session("user_1", "alice", conn);
+        const auto spans    = segments.spans(30, 90);
+        uint64_t span_bytes = 0;
+        for (const auto& span : *spans) {
+            span_bytes += span.length;
+            EXPECT_TRUE(session.send_file(span));
+        }
+        const auto trailer = ProtocolHelpers::make_packet(MessageType::INIT_V2, InitCodec::encode_payload({}));
+        EXPECT_TRUE(session.send(trailer));
+        EXPECT_EQ(session.stats().bytes_sent.load(), span_bytes + trailer.size());
+
+        std::vector<uint8_t> received(span_bytes + trailer.size());
+        boost::asio::read(peer, boost::asio::buffer(received));
+
+        const auto split = received.begin() + static_cast<std::ptrdiff_t>(span_bytes);
+        EXPECT_EQ(decode_frames(std::vector<uint8_t>(received.begin(), split)), iota(31, 90));
+        EXPECT_TRUE(std::equal(trailer.begin(), trailer.end(), split));
+
+        conn->close();
+    }
+} // namespace chat::server
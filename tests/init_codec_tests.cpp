@@ -0,0 +1,204 @@
+#include "chat/common/init_codec.hpp"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <limits>
+#include <string>
+
+namespace chat
+{
+    class InitCodecTest : public ::testing::Test
+    {
+    protected:
+        static std::chrono::system_clock::time_point at_ms(const int64_t ms)
+        {
+            return std::chrono::system_clock::time_point(std::chrono::milliseconds(ms));
+        }
+
+        static std::vector<uint8_t> payload_of(const std::vector<uint8_t>& packet)
+        {
+            EXPECT_GE(packet.size(), sizeof(MsgHeader));
+            return {packet.begin() + sizeof(MsgHeader), packet.end()};
+        }
+
+        static MsgHeader header_of(const std::vector<uint8_t>& packet)
+        {
+            MsgHeader header{};
+            std::memcpy(&header, packet.data(), sizeof(MsgHeader));
+            return header;
+        }
+    };
+
+    TEST_F(InitCodecTest, VarintRoundTrip)
+    {
+        const std::vector<uint64_t> values = {0, 1, 127, 128, 16383, 16384, 1ULL << 35,
+                                              std::numeric_limits<uint64_t>::max()};
+        BufferWriter w;
+        for (const auto v : values)
+            w.write_varint(v);
+        w.write_zigzag(-1);
+        w.write_zigzag(std::numeric_limits<int64_t>::min());
+
+        BufferReader r(w.data);
+        for (const auto v : values) {
+            auto decoded = r.try_read_varint();
+            ASSERT_TRUE(decoded);
+            EXPECT_EQ(*decoded, v);
+        }
+        EXPECT_EQ(*r.try_read_zigzag(), -1);
+        EXPECT_EQ(*r.try_read_zigzag(), std::numeric_limits<int64_t>::min());
+        EXPECT_EQ(r.remaining(), 0);
+    }
+
+    TEST_F(InitCodecTest, VarintRejectsOverlongEncoding)
+    {
+        std::vector<uint8_t> overlong(11, 0x80);
+        BufferReader r(overlong);
+        auto decoded = r.try_read_varint();
+        ASSERT_FALSE(decoded);
+        EXPECT_EQ(decoded.error(), Errc::invalid_encoding);
+
+        std::vector<uint8_t> truncated = {0x80, 0x80};
+        BufferReader t(truncated);
+        EXPECT_EQ(t.try_read_varint().error(), Errc::buffer_underflow);
+    }
+
+    TEST_F(InitCodecTest, EmptyRoundTrip)
+    {
+        auto packet = InitCodec::encode({}, {});
+        EXPECT_EQ(header_of(packet).type, static_cast<uint16_t>(MessageType::INIT_V2));
+        EXPECT_EQ(header_of(packet).size, packet.size() - sizeof(MsgHeader));
+
+        auto decoded = InitCodec::try_decode(payload_of(packet));
+        ASSERT_TRUE(decoded);
+        EXPECT_TRUE(decoded->messages.empty());
+        EXPECT_TRUE(decoded->users.empty());
+    }
+
+    TEST_F(InitCodecTest, RoundTripPreservesTimestampsAndSequence)
+    {
+        const std::vector<User> users = {{"alice", "user_1"}, {"bob", "user_2"}};
+        const std::vector<Message> messages = {
+            {"alice", "hello", at_ms(1'700'000'000'000), 10},
+            {"bob", "", at_ms(1'700'000'000'250), 11},
+            {"carol", "hi\nthere", at_ms(1'699'999'999'000), 15}, // clock stepped back
+            {"alice", std::string(300, 'x'), at_ms(1'700'000'001'000), 16},
+        };
+
+        auto decoded = InitCodec::try_decode(payload_of(InitCodec::encode(messages, users)));
+        ASSERT_TRUE(decoded);
+
+        ASSERT_EQ(decoded->users.size(), users.size());
+        for (size_t i = 0; i < users.size(); ++i) {
+            EXPECT_EQ(decoded->users[i].username, users[i].username);
+            EXPECT_EQ(decoded->users[i].user_id, users[i].user_id);
+        }
+
+        ASSERT_EQ(decoded->messages.size(), messages.size());
+        for (size_t i = 0; i < messages.size(); ++i) {
+            EXPECT_EQ(decoded->messages[i].username, messages[i].username);
+            EXPECT_EQ(decoded->messages[i].text, messages[i].text);
+            EXPECT_EQ(decoded->messages[i].timestamp, messages[i].timestamp);
+            EXPECT_EQ(decoded->messages[i].seq, messages[i].seq);
+        }
+    }
+
+    TEST_F(InitCodecTest, PayloadOnlyMatchesPacketBody)
+    {
+        const std::vector<Message> messages = {
+            {"alice", "hello", at_ms(1'700'000'000'000), 41},
+            {"bob", "world", at_ms(1'700'000'000'500), 42},
+        };
+
+        const auto payload = InitCodec::encode_payload(messages);
+        EXPECT_EQ(payload, payload_of(InitCodec::encode(messages, {})));
+
+        const auto decoded = InitCodec::try_decode(payload);
+        ASSERT_TRUE(decoded);
+        EXPECT_TRUE(decoded->users.empty());
+        ASSERT_EQ(decoded->messages.size(), 2);
+        EXPECT_EQ(decoded->messages[1].seq, 42);
+    }
+
+    TEST_F(InitCodecTest, EncodingFollowsPeerFeatures)
+    {
+        const std::vector<Message> messages = {{"alice", "hello", at_ms(1'700'000'000'000), 7}};
+        const std::vector<User> users       = {{"alice", "u1"}};
+
+        const auto columnar = InitCodec::encode(PeerFeatures{1, static_cast<uint32_t>(Capability::BinaryFields)},
+                                                messages, users);
+        EXPECT_EQ(columnar, InitCodec::encode(messages, users));
+
+        // a client that never sent HELLO gets the v1 tuples it has always read
+        const auto legacy = InitCodec::encode(PeerFeatures{}, messages, users);
+        EXPECT_EQ(header_of(legacy).type, static_cast<uint16_t>(MessageType::INIT));
+        const auto decoded = Protocol::decode<InitMsg>(payload_of(legacy));
+        ASSERT_EQ(decoded.messages.size(), 1);
+        EXPECT_EQ(decoded.messages[0].text, "hello");
+        ASSERT_EQ(decoded.users.size(), 1);
+        EXPECT_EQ(decoded.users[0].user_id, "u1");
+    }
+
+    TEST_F(InitCodecTest, SmallerThanNestedEncoding)
+    {
+        std::vector<User> users;
+        for (int i = 0; i < 20; ++i)
+            users.push_back({"user" + std::to_string(i), "user_" + std::to_string(i)});
+
+        std::vector<Message> messages;
+        for (int i = 0; i < 100; ++i)
+            messages.push_back({"user" + std::to_string(i % 20), "message " + std::to_string(i),
+                                at_ms(1'700'000'000'000 + i * 1000), static_cast<uint64_t>(i + 1)});
+
+        const auto v1 = Protocol::encode(MessageType::INIT, InitMsg{messages, users});
+        const auto v2 = InitCodec::encode(messages, users);
+        // v2 also carries timestamps and sequence numbers, v1 does not
+        EXPECT_LT(v2.size() * 3, v1.size() * 2);
+    }
+
+    TEST_F(InitCodecTest, TruncatedPayloadIsRejected)
+    {
+        const std::vector<User> users = {{"alice", "user_1"}};
+        const std::vector<Message> messages = {{"alice", "hello", at_ms(1000), 1}};
+        const auto payload = payload_of(InitCodec::encode(messages, users));
+
+        for (size_t cut = 0; cut < payload.size(); ++cut) {
+            const std::vector<uint8_t> truncated(payload.begin(), payload.begin() + static_cast<std::ptrdiff_t>(cut));
+            EXPECT_FALSE(InitCodec::try_decode(truncated)) << "cut at " << cut;
+        }
+        EXPECT_THROW(InitCodec::decode(std::vector<uint8_t>{0x01}), std::runtime_error);
+    }
+
+    TEST_F(InitCodecTest, DictionaryIndexOutOfRange)
+    {
+        BufferWriter w;
+        w.write_varint(1); // dict: "alice"
+        w.write_varint(5);
+        w.write_bytes(std::vector<uint8_t>{'a', 'l', 'i', 'c', 'e'});
+        w.write_varint(1); // one user referencing entry 3
+        w.write_varint(3);
+        w.write_varint(0);
+
+        auto decoded = InitCodec::try_decode(w.data);
+        ASSERT_FALSE(decoded);
+        EXPECT_EQ(decoded.error(), Errc::invalid_encoding);
+    }
+
+    TEST_F(InitCodecTest, CountsAreBoundedBeforeAllocating)
+    {
+        BufferWriter limit;
+        limit.write_varint(0);
+        limit.write_varint(User::kMaxDecodeCount + 1);
+        EXPECT_EQ(InitCodec::try_decode(limit.data).error(), Errc::limit_exceeded);
+
+        BufferWriter unbacked;
+        unbacked.write_varint(0);
+        unbacked.write_varint(User::kMaxDecodeCount);
+        EXPECT_EQ(InitCodec::try_decode(unbacked.data).error(), Errc::buffer_underflow);
+
+        const std::vector<Message> messages(100, Message{"alice", std::string(100, 'x'), at_ms(0), 1});
+        const auto payload = payload_of(InitCodec::encode(messages, {}));
+        DecodeBudget budget{.remaining = 4096};
+        EXPECT_EQ(InitCodec::try_decode(payload, budget).error(), Errc::budget_exceeded);
+    }
+} // namespace chat
@@ -0,0 +1,174 @@
+#include "chat/server/cursor_store.hpp"
+#include "chat/server/message_log.hpp"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace chat::server
+{
+    class MessageLogTest : public ::testing::Test
+    {
+    protected:
+        std::filesystem::path dir_;
+
+        void SetUp() override
+        {
+            const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+            dir_ = std::filesystem::temp_directory_path() / (std::string("chat_message_log_") + info->name());
+            std::filesystem::remove_all(dir_);
+            std::filesystem::create_directories(dir_);
+        }
+
+        void TearDown() override
+        {
+            std::filesystem::remove_all(dir_);
+        }
+
+        [[nodiscard]] std::string path(const std::string& name) const
+        {
+            return (dir_ / name).string();
+        }
+
+        static Message make_message(const int i)
+        {
+            return Message{
+                "user" + std::to_string(i % 3), "message " + std::to_string(i),
+                std::chrono::system_clock::time_point(std::chrono::milliseconds(1'700'000'000'000 + i))
+            };
+        }
+    };
+
+    TEST_F(MessageLogTest, AppendAssignsSequenceAndReadsRanges)
+    {
+        MessageLog log(path("messages.log"));
+        EXPECT_EQ(log.last_seq(), 0);
+
+        for (int i = 0; i < 300; ++i) {
+            auto message = make_message(i);
+            EXPECT_EQ(log.append(message), static_cast<uint64_t>(i + 1));
+            EXPECT_EQ(message.seq, static_cast<uint64_t>(i + 1));
+        }
+
+        // a range starting mid-way between index entries
+        const auto range = log.read(100, 250, 1000, 1 << 20);
+        ASSERT_EQ(range.size(), 150);
+        EXPECT_EQ(range.front().seq, 101);
+        EXPECT_EQ(range.front().text, "message 100");
+        EXPECT_EQ(range.front().username, "user1");
+        EXPECT_EQ(range.back().seq, 250);
+        EXPECT_EQ(range.back().timestamp, make_message(249).timestamp);
+
+        EXPECT_EQ(log.read(100, 250, 10, 1 << 20).size(), 10);
+        EXPECT_TRUE(log.read(300, 400, 10, 1 << 20).empty());
+
+        const auto tail = log.tail(5);
+        ASSERT_EQ(tail.size(), 5);
+        EXPECT_EQ(tail.front().seq, 296);
+        EXPECT_EQ(tail.back().seq, 300);
+    }
+
+    TEST_F(MessageLogTest, ByteBudgetStopsBatchButReturnsAtLeastOne)
+    {
+        MessageLog log(path("messages.log"));
+        Message big{"alice", std::string(1000, 'x'), std::chrono::system_clock::now()};
+        for (int i = 0; i < 10; ++i) {
+            auto copy = big;
+            log.append(copy);
+        }
+
+        EXPECT_EQ(log.read(0, 10, 100, 1).size(), 1);
+        EXPECT_EQ(log.read(0, 10, 100, 3000).size(), 3);
+    }
+
+    TEST_F(MessageLogTest, ReopenRecoversAndTruncatesTornTail)
+    {
+        const auto file = path("messages.log");
+        uint64_t intact_size = 0;
+        {
+            MessageLog log(file);
+            for (int i = 0; i < 70; ++i) {
+                auto message = make_message(i);
+                log.append(message);
+            }
+            intact_size = log.size_bytes();
+        }
+
+        // a crash in the middle of the next append
+        {
+            std::ofstream out(file, std::ios::binary | std::ios::app);
+            const char partial[] = {40, 0, 0, 0, 71, 0, 0};
+            out.write(partial, sizeof(partial));
+        }
+
+        MessageLog log(file);
+        EXPECT_EQ(log.last_seq(), 70);
+        EXPECT_EQ(log.size_bytes(), intact_size);
+        EXPECT_EQ(std::filesystem::file_size(file), intact_size);
+
+        auto message = make_message(70);
+        EXPECT_EQ(log.append(message), 71);
+        EXPECT_EQ(log.read(65, 71, 100, 1 << 20).size(), 6);
+    }
+
+    TEST_F(MessageLogTest, CorruptRecordEndsTheLog)
+    {
+        const auto file = path("messages.log");
+        uint64_t first_size = 0;
+        {
+            MessageLog log(file);
+            auto first = make_message(0);
+            log.append(first);
+            first_size = log.size_bytes();
+            auto second = make_message(1);
+            log.append(second);
+        }
+
+        // change a byte of the second record's username so its checksum no longer matches
+        {
+            std::fstream io(file, std::ios::binary | std::ios::in | std::ios::out);
+            io.seekp(static_cast<std::streamoff>(first_size + 4 + 8 + 8 + 2 + 2));
+            io.put('!');
+        }
+
+        MessageLog log(file);
+        EXPECT_EQ(log.last_seq(), 1);
+        EXPECT_EQ(log.size_bytes(), first_size);
+    }
+
+    TEST_F(MessageLogTest, CursorsPersistAndUpdateInPlace)
+    {
+        const auto file = path("cursors.db");
+        {
+            CursorStore cursors(file);
+            EXPECT_FALSE(cursors.get("alice").has_value());
+
+            cursors.set("alice", 5);
+            cursors.set("bob", 7);
+            cursors.set("alice", 42);
+            EXPECT_EQ(cursors.get("alice"), 42);
+            EXPECT_EQ(cursors.size(), 2);
+        }
+
+        // two records, however many updates
+        EXPECT_EQ(std::filesystem::file_size(file), 2 * (2 + 8) + 5 + 3);
+
+        {
+            std::ofstream out(file, std::ios::binary | std::ios::app);
+            const char torn[] = {5, 0, 'c', 'a'};
+            out.write(torn, sizeof(torn));
+        }
+
+        CursorStore cursors(file);
+        EXPECT_EQ(cursors.get("alice"), 42);
+        EXPECT_EQ(cursors.get("bob"), 7);
+        EXPECT_FALSE(cursors.get("carol").has_value());
+        EXPECT_EQ(cursors.size(), 2);
+
+        cursors.set("carol", 1);
+        EXPECT_EQ(cursors.get("carol"), 1);
+    }
+} // namespace chat::server
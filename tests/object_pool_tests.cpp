@@ -0,0 +1,143 @@
+#include "chat/common/object_pool.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace chat
+{
+    class ObjectPoolTest : public ::testing::Test
+    {
+    protected:
+        struct Widget
+        {
+            std::vector<int> buffer;
+            int uses{0};
+        };
+
+        std::atomic<int> constructed_{0};
+        std::atomic<int> recycled_{0};
+
+        ObjectPool<Widget>::Factory factory()
+        {
+            return [this]() {
+                constructed_.fetch_add(1);
+                return std::make_unique<Widget>();
+            };
+        }
+
+        ObjectPool<Widget>::Recycler recycler()
+        {
+            return [this](Widget& widget) {
+                recycled_.fetch_add(1);
+                widget.buffer.clear();
+            };
+        }
+    };
+
+    TEST_F(ObjectPoolTest, PreWarmsToCapacity)
+    {
+        ObjectPool<Widget> pool(40, factory(), recycler());
+
+        const auto stats = pool.stats();
+        EXPECT_EQ(constructed_.load(), 40);
+        EXPECT_EQ(stats.capacity, 40);
+        EXPECT_EQ(stats.idle, 40);
+        EXPECT_EQ(stats.in_use, 0);
+        EXPECT_EQ(stats.created, 40);
+        EXPECT_EQ(stats.reused, 0);
+    }
+
+    TEST_F(ObjectPoolTest, ReleasedObjectsAreRecycledAndReused)
+    {
+        ObjectPool<Widget> pool(4, factory(), recycler());
+
+        Widget* first = nullptr;
+        {
+            auto widget = pool.acquire();
+            widget->buffer.assign(100, 7);
+            ++widget->uses;
+            first = widget.get();
+            EXPECT_EQ(pool.stats().in_use, 1);
+        }
+        EXPECT_EQ(recycled_.load(), 5); // four during warm-up
+
+        // the most recently released object comes back first, buffer emptied but its capacity kept
+        auto again = pool.acquire();
+        EXPECT_EQ(again.get(), first);
+        EXPECT_TRUE(again->buffer.empty());
+        EXPECT_GE(again->buffer.capacity(), 100);
+        EXPECT_EQ(again->uses, 1);
+        EXPECT_EQ(constructed_.load(), 4);
+        EXPECT_EQ(pool.stats().reused, 2);
+    }
+
+    TEST_F(ObjectPoolTest, GrowsPastCapacityButKeepsOnlyCapacityIdle)
+    {
+        ObjectPool<Widget> pool(8, factory(), recycler());
+
+        std::vector<std::shared_ptr<Widget>> held;
+        for (int i = 0; i < 20; ++i)
+            held.push_back(pool.acquire());
+        EXPECT_EQ(constructed_.load(), 20);
+        EXPECT_EQ(pool.stats().in_use, 20);
+        EXPECT_EQ(pool.stats().idle, 0);
+
+        held.clear();
+        EXPECT_EQ(pool.stats().in_use, 0);
+        EXPECT_EQ(pool.stats().idle, 8);
+    }
+
+    TEST_F(ObjectPoolTest, ThreadCachesReturnToTheSharedListOnExit)
+    {
+        constexpr size_t kCapacity = 64;
+        ObjectPool<Widget> pool(kCapacity, factory(), recycler());
+
+        // each thread drains part of the pool, then exits holding released objects in its cache
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&pool]() {
+                std::vector<std::shared_ptr<Widget>> held;
+                for (size_t i = 0; i < kCapacity / 4; ++i)
+                    held.push_back(pool.acquire());
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        EXPECT_EQ(constructed_.load(), static_cast<int>(kCapacity));
+        EXPECT_EQ(pool.stats().idle, kCapacity);
+
+        // all of them are reachable from this thread again, without constructing more
+        std::set<Widget*> distinct;
+        std::vector<std::shared_ptr<Widget>> held;
+        for (size_t i = 0; i < kCapacity; ++i) {
+            held.push_back(pool.acquire());
+            distinct.insert(held.back().get());
+        }
+        EXPECT_EQ(distinct.size(), kCapacity);
+        EXPECT_EQ(constructed_.load(), static_cast<int>(kCapacity));
+    }
+
+    TEST_F(ObjectPoolTest, ObjectsMayOutliveThePool)
+    {
+        std::shared_ptr<Widget> survivor;
+        {
+            ObjectPool<Widget> pool(2, factory(), recycler());
+            survivor = pool.acquire();
+            survivor->buffer.push_back(1);
+        }
+        EXPECT_EQ(survivor->buffer.size(), 1);
+        survivor.reset(); // released into a pool nobody can reach; freed with it
+
+        // a thread that cached objects of a dead pool frees them when it exits
+        std::thread([this]() {
+            ObjectPool<Widget> pool(2, factory(), recycler());
+            auto widget = pool.acquire();
+        }).join();
+        EXPECT_EQ(constructed_.load(), 4);
+    }
+} // namespace chat
@@ -1,5 +1,7 @@
+#include "chat/common/capabilities.hpp"
 #include "chat/common/protocol.hpp"
 #include "chat/common/messages.hpp"
+#include "chat/common/stream_codec.hpp"
 
 #include <gtest/gtest.h>
 #include <chrono>
@@ -241,4 +243,181 @@ namespace chat
         EXPECT_EQ(i32, 42);
         EXPECT_EQ(u16, 123);
     }
+
+    TEST_F(ProtocolTest, TryReadUnderflowKeepsPosition)
+    {
+        BufferWriter w;
+        w.write(static_cast<uint16_t>(7));
+
+        BufferReader r(w.data);
+        auto too_wide = r.try_read<uint32_t>();
+        EXPECT_FALSE(too_wide);
+        EXPECT_EQ(too_wide.error(), Errc::buffer_underflow);
+        EXPECT_EQ(r.pos, 0);
+
+        auto value = r.try_read<uint16_t>();
+        ASSERT_TRUE(value);
+        EXPECT_EQ(*value, 7);
+    }
+
+    TEST_F(ProtocolTest, TryReadStringWithBogusLength)
+    {
+        BufferWriter w;
+        w.write(static_cast<uint32_t>(1000));
+        w.write(static_cast<uint8_t>('a'));
+
+        BufferReader r(w.data);
+        auto str = r.try_read_string();
+        EXPECT_FALSE(str);
+        EXPECT_EQ(r.pos, 0);
+    }
+
+    TEST_F(ProtocolTest, TryDecodeTruncatedPayload)
+    {
+        auto packet  = Protocol::encode(MessageType::BROADCAST, BroadcastMsg{"alice", "ciphertext", 42});
+        auto payload = extract_payload(packet);
+
+        for (size_t cut = 0; cut < payload.size(); ++cut) {
+            std::vector<uint8_t> truncated(payload.begin(), payload.begin() + static_cast<std::ptrdiff_t>(cut));
+            auto decoded = Protocol::try_decode<BroadcastMsg>(truncated);
+            EXPECT_FALSE(decoded) << "cut at " << cut;
+            EXPECT_EQ(decoded.error(), Errc::buffer_underflow);
+        }
+
+        auto decoded = Protocol::try_decode<BroadcastMsg>(payload);
+        ASSERT_TRUE(decoded);
+        EXPECT_EQ(decoded->username, "alice");
+        EXPECT_EQ(decoded->timestamp_ms, 42);
+    }
+
+    TEST_F(ProtocolTest, TryDecodeTruncatedNestedItem)
+    {
+        auto packet  = Protocol::encode(MessageType::INIT, InitMsg{{}, {{"alice", "user_1"}, {"bob", "user_2"}}});
+        auto payload = extract_payload(packet);
+        payload.resize(payload.size() - 3);
+
+        EXPECT_FALSE(Protocol::try_decode<InitMsg>(payload));
+    }
+
+    TEST_F(ProtocolTest, TryDecodeRejectsCountAboveSchemaLimit)
+    {
+        BufferWriter w;
+        w.write(static_cast<uint32_t>(Message::kMaxDecodeCount + 1));
+
+        auto decoded = Protocol::try_decode<InitMsg>(w.data);
+        ASSERT_FALSE(decoded);
+        EXPECT_EQ(decoded.error(), Errc::limit_exceeded);
+    }
+
+    TEST_F(ProtocolTest, TryDecodeRejectsCountNotBackedByPayload)
+    {
+        // a few bytes claiming thousands of history entries
+        BufferWriter w;
+        w.write(static_cast<uint32_t>(Message::kMaxDecodeCount));
+        w.write(static_cast<uint32_t>(0));
+
+        auto decoded = Protocol::try_decode<InitMsg>(w.data);
+        ASSERT_FALSE(decoded);
+        EXPECT_EQ(decoded.error(), Errc::buffer_underflow);
+    }
+
+    TEST_F(ProtocolTest, TryDecodeEnforcesBudget)
+    {
+        auto packet  = Protocol::encode(MessageType::MESSAGE, TextMsg{std::string(1000, 'x')});
+        auto payload = extract_payload(packet);
+
+        DecodeBudget small{.remaining = 999};
+        auto rejected = Protocol::try_decode<TextMsg>(payload, small);
+        ASSERT_FALSE(rejected);
+        EXPECT_EQ(rejected.error(), Errc::budget_exceeded);
+
+        DecodeBudget exact{.remaining = 1000};
+        auto accepted = Protocol::try_decode<TextMsg>(payload, exact);
+        ASSERT_TRUE(accepted);
+        EXPECT_EQ(accepted->ciphertext_b64.size(), 1000);
+        EXPECT_EQ(exact.remaining, 0);
+    }
+
+    TEST_F(ProtocolTest, TryDecodeBudgetCoversNestedItems)
+    {
+        InitMsg init;
+        for (int i = 0; i < 50; ++i)
+            init.users.push_back({"user" + std::to_string(i), "user_" + std::to_string(i)});
+
+        auto payload = extract_payload(Protocol::encode(MessageType::INIT, init));
+
+        DecodeBudget budget{.remaining = 50 * sizeof(User)};
+        auto decoded = Protocol::try_decode<InitMsg>(payload, budget);
+        ASSERT_FALSE(decoded);
+        EXPECT_EQ(decoded.error(), Errc::budget_exceeded);
+
+        EXPECT_TRUE(Protocol::try_decode<InitMsg>(payload));
+    }
+
+    TEST_F(ProtocolTest, StreamFramesCarryTheInnerFrameAndItsStream)
+    {
+        const auto inner = Protocol::encode(MessageType::MESSAGE, TextMsg{"hello"});
+        const auto outer = StreamCodec::wrap_packet(300, inner);
+
+        const auto header = extract_header(outer);
+        EXPECT_EQ(header.type, static_cast<uint16_t>(MessageType::STREAM));
+        EXPECT_EQ(header.size, outer.size() - sizeof(header));
+
+        const auto payload = extract_payload(outer);
+        const auto frame   = StreamCodec::try_unwrap(payload);
+        ASSERT_TRUE(frame);
+        EXPECT_EQ(frame->stream, 300);
+        EXPECT_EQ(frame->type, MessageType::MESSAGE);
+        EXPECT_EQ(Protocol::decode<TextMsg>(frame->payload).ciphertext_b64, "hello");
+
+        // an empty inner payload survives, a missing inner type does not
+        const auto close = StreamCodec::wrap(1, MessageType::STREAM_CLOSE, {});
+        const auto closed = StreamCodec::try_unwrap(extract_payload(close));
+        ASSERT_TRUE(closed);
+        EXPECT_TRUE(closed->payload.empty());
+        EXPECT_FALSE(StreamCodec::try_unwrap(std::vector<uint8_t>{0x01, 0x05}));
+    }
+
+    TEST_F(ProtocolTest, MakePacketLeavesRoomAroundThePayload)
+    {
+        const std::vector<uint8_t> payload = {1, 2, 3};
+        const auto packet = ProtocolHelpers::make_packet(MessageType::INIT_SEALED, payload, 12, 16);
+
+        const auto header = extract_header(packet);
+        EXPECT_EQ(header.type, static_cast<uint16_t>(MessageType::INIT_SEALED));
+        EXPECT_EQ(header.size, 12u + payload.size() + 16u);
+        ASSERT_EQ(packet.size(), sizeof(MsgHeader) + header.size);
+        EXPECT_EQ(std::vector<uint8_t>(packet.begin() + sizeof(MsgHeader) + 12, packet.end() - 16), payload);
+    }
+
+    TEST_F(ProtocolTest, HelloNegotiatesTheCommonSubset)
+    {
+        const auto packet = Protocol::encode(MessageType::HELLO, HelloMsg{3, Capability::BinaryFields | Capability::GroupKey});
+        EXPECT_EQ(extract_header(packet).type, static_cast<uint16_t>(MessageType::HELLO));
+        const auto hello = Protocol::decode<HelloMsg>(extract_payload(packet));
+
+        const auto agreed = PeerFeatures::negotiate(hello.version, hello.capabilities, 1,
+                                                    Capability::BinaryFields | Capability::Resume);
+        EXPECT_EQ(agreed.version, 1);
+        EXPECT_TRUE(agreed.has(Capability::BinaryFields));
+        EXPECT_FALSE(agreed.has(Capability::GroupKey));
+        EXPECT_FALSE(agreed.has(Capability::Resume));
+
+        // a sealed snapshot is an INIT_V2 payload, so Batching goes with BinaryFields
+        const auto no_binary = PeerFeatures::negotiate(1, Capability::Batching | Capability::Resume, 1,
+                                                       Capability::BinaryFields | Capability::Batching |
+                                                       Capability::Resume);
+        EXPECT_FALSE(no_binary.has(Capability::Batching));
+        EXPECT_TRUE(no_binary.has(Capability::Resume));
+
+        // no HELLO: version 0 and nothing optional
+        EXPECT_EQ(PeerFeatures{}.version, 0);
+        EXPECT_EQ(PeerFeatures{}.capabilities, 0u);
+    }
+
+    TEST_F(ProtocolTest, DecodeStillThrowsOnMalformedInput)
+    {
+        std::vector<uint8_t> garbage = {0x01, 0x02};
+        EXPECT_THROW(Protocol::decode<TextMsg>(garbage), std::runtime_error);
+    }
 } // namespace chat
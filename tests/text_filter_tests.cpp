@@ -0,0 +1,248 @@
+#include "chat/common/utf8.hpp"
+#include "chat/server/text_filter.hpp"
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace chat::server
+{
+    class TextFilterTest : public ::testing::Test
+    {
+    protected:
+        std::filesystem::path dir_;
+
+        void SetUp() override
+        {
+            const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+            dir_ = std::filesystem::temp_directory_path() / (std::string("chat_text_filter_") + info->name());
+            std::filesystem::remove_all(dir_);
+            std::filesystem::create_directories(dir_);
+        }
+
+        void TearDown() override
+        {
+            std::filesystem::remove_all(dir_);
+        }
+
+        [[nodiscard]] std::string path(const std::string& name) const
+        {
+            return (dir_ / name).string();
+        }
+
+        // both paths must agree; the AVX2 one only when this machine has it
+        static bool validate(const std::string& text)
+        {
+            const bool scalar = detail::is_valid_utf8_scalar(text);
+            if (detail::utf8_avx2_available()) {
+                EXPECT_EQ(detail::is_valid_utf8_avx2(text), scalar) << "length " << text.size();
+            }
+            EXPECT_EQ(is_valid_utf8(text), scalar);
+            return scalar;
+        }
+
+        // places the sequence across the 32-byte block boundary and at the very end
+        static std::vector<std::string> placements(const std::string& sequence)
+        {
+            return {sequence, std::string(30, 'a') + sequence + std::string(40, 'b'), std::string(61, 'c') + sequence};
+        }
+
+        static PatternSet make_set(const std::vector<FilterPattern>& patterns)
+        {
+            return PatternSet(patterns);
+        }
+    };
+
+    TEST_F(TextFilterTest, Utf8AcceptsWellFormedText)
+    {
+        for (const std::string text : {"", "hello", "żółć gęślą jaźń", "日本語のテキスト", "emoji 😀🎉 ok",
+                                       "\xF4\x8F\xBF\xBF", "\xEF\xBF\xBD", "\xC2\x80", "\xE0\xA0\x80", "\xF0\x90\x80\x80"})
+            for (const auto& placed : placements(text))
+                EXPECT_TRUE(validate(placed)) << placed;
+    }
+
+    TEST_F(TextFilterTest, Utf8RejectsMalformedSequences)
+    {
+        const std::vector<std::string> invalid = {
+            "\x80",             // stray continuation
+            "\xC0\xAF",         // overlong '/'
+            "\xC1\xBF",         // overlong
+            "\xE0\x9F\xBF",     // overlong three-byte
+            "\xF0\x8F\xBF\xBF", // overlong four-byte
+            "\xED\xA0\x80",     // surrogate
+            "\xF4\x90\x80\x80", // above U+10FFFF
+            "\xF5\x80\x80\x80",
+            "\xFF",
+            "\xC3",             // truncated
+            "\xE6\x97",
+            "\xF0\x9F\x98",
+            "\xC3\x28",         // lead followed by ASCII
+            "\xE6\x97\x28",
+            "\xC3\xA9\xA9",     // one continuation too many
+        };
+        for (const auto& text : invalid)
+            for (const auto& placed : placements(text))
+                EXPECT_FALSE(validate(placed));
+    }
+
+    TEST_F(TextFilterTest, Utf8PathsAgreeOnEveryBytePair)
+    {
+        std::string text(64, 'x');
+        for (const size_t offset : {0, 15, 31, 62}) {
+            for (int a = 0x80; a < 0x100; ++a) {
+                for (int b = 0; b < 0x100; ++b) {
+                    text[offset]     = static_cast<char>(a);
+                    text[offset + 1] = static_cast<char>(b);
+                    validate(text);
+                }
+            }
+            text[offset] = text[offset + 1] = 'x';
+        }
+    }
+
+    TEST_F(TextFilterTest, Utf8PathsAgreeOnRandomMutations)
+    {
+        std::mt19937 rng(7);
+        const std::string base = "Zażółć gęślą jaźń — 日本語 😀 plain ascii text to pad the block out. ";
+        for (int round = 0; round < 20'000; ++round) {
+            std::string text = base.substr(rng() % base.size());
+            for (int flips = static_cast<int>(rng() % 3); flips > 0 && !text.empty(); --flips)
+                text[rng() % text.size()] = static_cast<char>(rng());
+            validate(text);
+        }
+    }
+
+    TEST_F(TextFilterTest, BlockAndRedactAreCaseInsensitive)
+    {
+        const auto set = make_set({{"darn", FilterAction::Redact}, {"forbidden", FilterAction::Block}});
+        EXPECT_EQ(set.size(), 2);
+
+        std::string text = "Well DARN it, darn.";
+        EXPECT_EQ(set.apply(text), FilterAction::Redact);
+        EXPECT_EQ(text, "Well **** it, ****.");
+
+        std::string blocked = "this is ForBidden talk";
+        EXPECT_EQ(set.apply(blocked), FilterAction::Block);
+        EXPECT_EQ(set.scan("nothing to see"), FilterAction::Pass);
+    }
+
+    TEST_F(TextFilterTest, OverlappingTermsUseFailureLinks)
+    {
+        // "she" ends inside "ushers"; "hers" overlaps "she"; "his" needs a fall back from "hi"
+        const auto set = make_set({{"he", FilterAction::Redact}, {"she", FilterAction::Redact},
+                                   {"his", FilterAction::Redact}, {"hers", FilterAction::Redact}});
+
+        std::string text = "ushers";
+        EXPECT_EQ(set.apply(text), FilterAction::Redact);
+        EXPECT_EQ(text, "u*****");
+
+        std::string nested = "hhis";
+        set.apply(nested);
+        EXPECT_EQ(nested, "h***");
+
+        // a block term found only through a failure link still wins
+        const auto strict = make_set({{"abcd", FilterAction::Redact}, {"bc", FilterAction::Block}});
+        EXPECT_EQ(strict.scan("xabcx"), FilterAction::Block);
+    }
+
+    TEST_F(TextFilterTest, LongInputsExerciseThePrefilter)
+    {
+        const auto set = make_set({{"zq", FilterAction::Redact}, {"\xC3\xA9t\xC3\xA9", FilterAction::Redact}});
+
+        for (const size_t at : {0, 31, 32, 33, 95, 198}) {
+            std::string text(200, 'a');
+            text.replace(at, 2, "zq");
+            EXPECT_EQ(set.apply(text), FilterAction::Redact) << at;
+            EXPECT_EQ(text.find("zq"), std::string::npos);
+            EXPECT_EQ(text.substr(at, 2), "**");
+        }
+
+        std::string utf8 = std::string(40, ' ') + "l'\xC3\xA9t\xC3\xA9" + std::string(40, ' ');
+        EXPECT_EQ(set.apply(utf8), FilterAction::Redact);
+        EXPECT_EQ(utf8.substr(42, 5), "*****");
+
+        // bytes sharing a low nibble with a term start must not match
+        std::string near_miss(100, 'j');
+        EXPECT_EQ(set.apply(near_miss), FilterAction::Pass);
+        EXPECT_EQ(near_miss, std::string(100, 'j'));
+    }
+
+    TEST_F(TextFilterTest, ParseSkipsCommentsAndRejectsBadLines)
+    {
+        std::istringstream in("# comment\n"
+                              "\n"
+                              "block  spam link \r\n"
+                              "redact\theck\n"
+                              "mute whatever\n"
+                              "redact\n"
+                              "block \xC3\x28\n");
+        size_t rejected = 0;
+        const auto patterns = PatternSet::parse(in, &rejected);
+
+        ASSERT_EQ(patterns.size(), 2);
+        EXPECT_EQ(patterns[0].term, "spam link");
+        EXPECT_EQ(patterns[0].action, FilterAction::Block);
+        EXPECT_EQ(patterns[1].term, "heck");
+        EXPECT_EQ(patterns[1].action, FilterAction::Redact);
+        EXPECT_EQ(rejected, 3);
+    }
+
+    TEST_F(TextFilterTest, ReloadsWhenTheFileChanges)
+    {
+        const auto file = path("filter.txt");
+        {
+            std::ofstream out(file);
+            out << "redact heck\n";
+        }
+
+        TextFilter filter(file);
+        const auto first = filter.generation();
+        std::string text = "what the heck";
+        EXPECT_EQ(filter.apply(text), FilterAction::Redact);
+        EXPECT_FALSE(filter.reload_if_changed());
+
+        {
+            std::ofstream out(file);
+            out << "block heck\n";
+        }
+        std::filesystem::last_write_time(file, std::filesystem::last_write_time(file) + std::chrono::seconds(1));
+
+        EXPECT_TRUE(filter.reload_if_changed());
+        EXPECT_GT(filter.generation(), first);
+
+        // the calling thread's cached set is refreshed, and so is a fresh thread's
+        std::string again = "what the heck";
+        EXPECT_EQ(filter.apply(again), FilterAction::Block);
+
+        FilterAction other = FilterAction::Pass;
+        std::thread([&] {
+            std::string copy = "heck";
+            other = filter.apply(copy);
+        }).join();
+        EXPECT_EQ(other, FilterAction::Block);
+
+        // a vanished file keeps the last good set
+        std::filesystem::remove(file);
+        EXPECT_FALSE(filter.reload_if_changed());
+        std::string kept = "heck";
+        EXPECT_EQ(filter.apply(kept), FilterAction::Block);
+    }
+
+    TEST_F(TextFilterTest, TwoFiltersDoNotShareCachedSets)
+    {
+        TextFilter redacting;
+        redacting.install(std::make_shared<const PatternSet>(std::vector<FilterPattern>{{"x", FilterAction::Redact}}));
+        TextFilter blocking;
+        blocking.install(std::make_shared<const PatternSet>(std::vector<FilterPattern>{{"x", FilterAction::Block}}));
+
+        std::string a = "x", b = "x";
+        EXPECT_EQ(redacting.apply(a), FilterAction::Redact);
+        EXPECT_EQ(blocking.apply(b), FilterAction::Block);
+        EXPECT_EQ(redacting.apply(a), FilterAction::Pass); // already masked
+    }
+} // namespace chat::server
@@ -0,0 +1,162 @@
+#include "chat/common/traffic_capture.hpp"
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chat/auth/srp_utils.hpp"
+#include "chat/common/messages.hpp"
+#include "chat/common/protocol.hpp"
+#include "chat/crypto/aes_engine.hpp"
+#include "chat/tools/traffic_replay.hpp"
+
+namespace chat
+{
+    class TrafficCaptureTest : public ::testing::Test
+    {
+    protected:
+        std::filesystem::path path_;
+
+        void SetUp() override
+        {
+            const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+            path_ = std::filesystem::temp_directory_path() / (std::string("chat_capture_") + info->name() + ".cap");
+        }
+
+        void TearDown() override
+        {
+            std::filesystem::remove(path_);
+        }
+
+        static CapturedFrame frame(const uint64_t time_ns, const uint32_t connection, const MessageType type,
+                                   const uint32_t size = 0)
+        {
+            return {.time_ns = time_ns, .connection = connection, .type = type, .size = size};
+        }
+    };
+
+    TEST_F(TrafficCaptureTest, RoundTripsFramesInOrder)
+    {
+        {
+            TrafficCapture capture(path_.string());
+            capture.record(1, MessageType::SRP_INIT, 40);
+            capture.record(1, MessageType::MESSAGE, 120);
+            capture.record(2, MessageType::EPHEMERAL, 0);
+            EXPECT_EQ(capture.frames(), 3);
+        }
+
+        const auto frames = TrafficCapture::load(path_.string());
+        ASSERT_EQ(frames.size(), 3);
+        EXPECT_EQ(frames[0].connection, 1);
+        EXPECT_EQ(frames[0].type, MessageType::SRP_INIT);
+        EXPECT_EQ(frames[1].size, 120);
+        EXPECT_EQ(frames[2].connection, 2);
+        EXPECT_EQ(frames[2].type, MessageType::EPHEMERAL);
+        EXPECT_LE(frames[0].time_ns, frames[1].time_ns);
+        EXPECT_LE(frames[1].time_ns, frames[2].time_ns);
+    }
+
+    TEST_F(TrafficCaptureTest, TornTailIsDroppedAndForeignFilesRejected)
+    {
+        {
+            TrafficCapture capture(path_.string());
+            capture.record(7, MessageType::MESSAGE, 300);
+            capture.record(7, MessageType::MESSAGE, 300);
+        }
+
+        // the size varint of the last record loses its final byte
+        std::filesystem::resize_file(path_, std::filesystem::file_size(path_) - 1);
+        const auto frames = TrafficCapture::load(path_.string());
+        ASSERT_EQ(frames.size(), 1);
+        EXPECT_EQ(frames[0].size, 300);
+
+        std::ofstream(path_, std::ios::trunc) << "users.db contents";
+        EXPECT_THROW(TrafficCapture::load(path_.string()), std::runtime_error);
+    }
+
+    TEST_F(TrafficCaptureTest, ConcurrentRecordersKeepTimestampsMonotonic)
+    {
+        constexpr uint32_t kThreads = 4;
+        constexpr uint32_t kFrames  = 20'000; // several buffer flushes per thread
+
+        {
+            TrafficCapture capture(path_.string());
+            std::vector<std::thread> threads;
+            for (uint32_t t = 1; t <= kThreads; ++t)
+                threads.emplace_back([&capture, t]() {
+                    for (uint32_t i = 0; i < kFrames; ++i)
+                        capture.record(t, MessageType::MESSAGE, i);
+                });
+            for (auto& thread : threads)
+                thread.join();
+        }
+
+        const auto frames = TrafficCapture::load(path_.string());
+        ASSERT_EQ(frames.size(), kThreads * kFrames);
+
+        // per connection the sizes come back in the order they were recorded
+        std::vector<uint32_t> next(kThreads + 1, 0);
+        for (size_t i = 0; i < frames.size(); ++i) {
+            if (i > 0) {
+                EXPECT_LE(frames[i - 1].time_ns, frames[i].time_ns);
+            }
+            EXPECT_EQ(frames[i].size, next[frames[i].connection]++);
+        }
+    }
+
+    TEST_F(TrafficCaptureTest, ScriptsKeepOnlyTrafficAfterALogin)
+    {
+        const std::vector<CapturedFrame> frames = {
+            frame(100, 1, MessageType::SRP_INIT),
+            frame(110, 2, MessageType::SRP_INIT),
+            frame(150, 1, MessageType::SRP_RESPONSE),
+            frame(200, 1, MessageType::MESSAGE, 64),
+            frame(210, 2, MessageType::MESSAGE, 64), // never logged in
+            frame(250, 3, MessageType::SRP_INIT),
+            frame(260, 3, MessageType::SRP_RESPONSE),
+            frame(270, 3, MessageType::EPHEMERAL, 45),
+            frame(300, 1, MessageType::DISCONNECT),
+        };
+
+        const auto scripts = tools::build_scripts(frames);
+        ASSERT_EQ(scripts.size(), 2);
+
+        EXPECT_EQ(scripts[0].connection, 1);
+        EXPECT_EQ(scripts[0].login_ns, 100);
+        ASSERT_EQ(scripts[0].frames.size(), 2);
+        EXPECT_EQ(scripts[0].frames[0].type, MessageType::MESSAGE);
+        EXPECT_EQ(scripts[0].frames[1].type, MessageType::DISCONNECT);
+
+        EXPECT_EQ(scripts[1].connection, 3);
+        EXPECT_EQ(scripts[1].login_ns, 250);
+        ASSERT_EQ(scripts[1].frames.size(), 1);
+
+        tools::ReplayOptions options;
+        EXPECT_EQ(tools::username_for(options, 3), "replay3");
+    }
+
+    TEST_F(TrafficCaptureTest, FillerSealsToTheCapturedSize)
+    {
+        const std::vector<uint8_t> key(32, 0x42);
+
+        for (const size_t length : {1, 10, 100, 1'000, 4'000}) {
+            const std::string text(length, 'a');
+            const auto sealed = auth::SRPUtils::bytes_to_base64(crypto::AESEngine::encrypt_string(text, key));
+
+            const auto message = Protocol::encode(MessageType::MESSAGE, TextMsg{sealed});
+            const auto message_size = static_cast<uint32_t>(message.size() - sizeof(MsgHeader));
+            const auto filler = tools::filler_length(frame(0, 1, MessageType::MESSAGE, message_size));
+            EXPECT_GE(filler, length);
+            EXPECT_LE(filler, length + 2); // base64 padding hides up to two bytes
+
+            const auto update = Protocol::encode(MessageType::EPHEMERAL, EphemeralMsg{0, sealed});
+            const auto update_size = static_cast<uint32_t>(update.size() - sizeof(MsgHeader));
+            EXPECT_EQ(tools::filler_length(frame(0, 1, MessageType::EPHEMERAL, update_size)), filler);
+        }
+
+        EXPECT_EQ(tools::filler_length(frame(0, 1, MessageType::MESSAGE, 0)), 1);
+    }
+} // namespace chat
@@ -0,0 +1,100 @@
+#include "chat/server/usage_ledger.hpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace chat::server
+{
+    class UsageLedgerTest : public ::testing::Test
+    {
+    protected:
+        UsageLedger ledger_;
+
+        [[nodiscard]] UserUsage usage_of(const std::string& username) const
+        {
+            for (const auto& [name, usage] : ledger_.top(0))
+                if (name == username)
+                    return usage;
+            return {};
+        }
+    };
+
+    TEST_F(UsageLedgerTest, ChargesAccumulatePerUser)
+    {
+        ledger_.charge("alice", {.ingress_ns = 100, .bytes_in = 40, .messages = 1});
+        ledger_.charge("alice", {.ingress_ns = 50, .bytes_in = 60, .messages = 1});
+        ledger_.charge("bob", {.login_ns = 10});
+
+        const auto alice = usage_of("alice");
+        EXPECT_EQ(alice.ingress_ns, 150);
+        EXPECT_EQ(alice.bytes_in, 100);
+        EXPECT_EQ(alice.messages, 2);
+        EXPECT_EQ(usage_of("bob").cpu_ns(), 10);
+        EXPECT_EQ(ledger_.top(0).size(), 2);
+    }
+
+    TEST_F(UsageLedgerTest, TopOrdersByCpuAndTruncates)
+    {
+        ledger_.charge("light", {.ingress_ns = 10});
+        ledger_.charge("heavy", {.fanout_ns = 1000});
+        ledger_.charge("medium", {.login_ns = 200, .ingress_ns = 300});
+
+        const auto top = ledger_.top(2);
+        ASSERT_EQ(top.size(), 2);
+        EXPECT_EQ(top[0].first, "heavy");
+        EXPECT_EQ(top[1].first, "medium");
+        EXPECT_EQ(top[1].second.cpu_ns(), 500);
+    }
+
+    TEST_F(UsageLedgerTest, ThreadsAccumulateSeparatelyAndSurviveExit)
+    {
+        constexpr int kThreads = 8, kCharges = 10'000;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([this, t]() {
+                for (int i = 0; i < kCharges; ++i) {
+                    ledger_.charge("shared", {.fanout_recipients = 1});
+                    ledger_.charge("user" + std::to_string(t), {.bytes_out = 2});
+                }
+            });
+        }
+
+        // reading while they run sees a consistent subset
+        EXPECT_LE(usage_of("shared").fanout_recipients, static_cast<uint64_t>(kThreads * kCharges));
+
+        for (auto& thread : threads)
+            thread.join();
+
+        // every thread has exited, so all of this comes from folded-in accumulators
+        EXPECT_EQ(usage_of("shared").fanout_recipients, static_cast<uint64_t>(kThreads * kCharges));
+        for (int t = 0; t < kThreads; ++t)
+            EXPECT_EQ(usage_of("user" + std::to_string(t)).bytes_out, 2u * kCharges);
+    }
+
+    TEST_F(UsageLedgerTest, ThreadOutlivingALedgerDoesNotLeakIntoTheNext)
+    {
+        {
+            UsageLedger first;
+            first.charge("alice", {.ingress_ns = 5});
+        }
+
+        // a later ledger may reuse the address; this thread's old accumulator must not carry over
+        UsageLedger second;
+        second.charge("bob", {.ingress_ns = 7});
+        const auto top = second.top(0);
+        ASSERT_EQ(top.size(), 1);
+        EXPECT_EQ(top[0].first, "bob");
+    }
+
+    TEST_F(UsageLedgerTest, ThreadCpuClockAdvancesWithWork)
+    {
+        const uint64_t start = thread_cpu_ns();
+        volatile uint64_t sink = 0;
+        for (int i = 0; i < 5'000'000; ++i)
+            sink = sink + static_cast<uint64_t>(i);
+        EXPECT_GT(thread_cpu_ns(), start);
+    }
+} // namespace chat::server
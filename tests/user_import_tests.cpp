@@ -0,0 +1,163 @@
+#include "chat/tools/user_import.hpp"
+#include "chat/auth/verifier_engine.hpp"
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace chat::tools
+{
+    class UserImportTest : public ::testing::Test
+    {
+    protected:
+        static std::vector<ImportRecord> read_all(const std::string& input, const ImportFormat format,
+                                                  size_t* malformed = nullptr)
+        {
+            std::istringstream in(input);
+            RecordReader reader(in, format);
+            std::vector<ImportRecord> records;
+            while (auto record = reader.next())
+                records.push_back(std::move(*record));
+            if (malformed)
+                *malformed = reader.malformed();
+            return records;
+        }
+    };
+
+    TEST_F(UserImportTest, VerifierEngineMatchesReferenceComputation)
+    {
+        auth::VerifierEngine engine;
+        const auto salt  = auth::SRPUtils::random_bytes(auth::SRP_SALT_SIZE);
+        const auto creds = engine.make_credentials("alice", "correct horse", salt);
+
+        const auth::SRPUtils::BigNum N{std::string(auth::SRP_N_HEX_2048)};
+        const auth::SRPUtils::BigNum g{std::string(auth::SRP_G_HEX)};
+        const auto x = auth::SRPUtils::calculate_x(salt, "alice", "correct horse");
+        const auto v = auth::SRPUtils::calculate_verifier(g, x, N);
+
+        EXPECT_EQ(creds.username, "alice");
+        EXPECT_EQ(creds.salt, salt);
+        EXPECT_EQ(creds.verifier, v.to_bytes());
+
+        // reused contexts must not leak state between users
+        const auto again = engine.make_credentials("alice", "correct horse", salt);
+        EXPECT_EQ(again.verifier, creds.verifier);
+    }
+
+    TEST_F(UserImportTest, CsvHeaderQuotingAndComments)
+    {
+        size_t malformed = 0;
+        const auto records = read_all(
+            "username,password\r\n"
+            "# comment\n"
+            "alice,secret\n"
+            "\n"
+            "bob,\"pa,ss \"\"word\"\"\"\n"
+            "broken\n"
+            "carol,\"unterminated\n"
+            "dave,x,extra\n",
+            ImportFormat::CSV, &malformed);
+
+        ASSERT_EQ(records.size(), 2);
+        EXPECT_EQ(records[0].username, "alice");
+        EXPECT_EQ(records[0].password, "secret");
+        EXPECT_EQ(records[1].username, "bob");
+        EXPECT_EQ(records[1].password, "pa,ss \"word\"");
+        EXPECT_EQ(malformed, 3);
+    }
+
+    TEST_F(UserImportTest, JsonLinesAndArray)
+    {
+        const auto lines = read_all(
+            "{\"username\": \"alice\", \"password\": \"s\\\"e\\\\c\"}\n"
+            "{\"password\": \"pw\", \"id\": 7, \"tags\": [\"a\", {\"b\": 1}], \"username\": \"bob\"}\n",
+            ImportFormat::JSON);
+        ASSERT_EQ(lines.size(), 2);
+        EXPECT_EQ(lines[0].password, "s\"e\\c");
+        EXPECT_EQ(lines[1].username, "bob");
+        EXPECT_EQ(lines[1].password, "pw");
+
+        const auto array = read_all(
+            "[\n  {\"username\": \"caf\\u00e9\", \"password\": \"\\ud83d\\ude00\"},\n"
+            "  {\"username\": \"dave\", \"password\": \"x\"}\n]\n",
+            ImportFormat::JSON);
+        ASSERT_EQ(array.size(), 2);
+        EXPECT_EQ(array[0].username, "caf\xC3\xA9");
+        EXPECT_EQ(array[0].password, "\xF0\x9F\x98\x80");
+        EXPECT_EQ(array[1].username, "dave");
+    }
+
+    TEST_F(UserImportTest, JsonMalformedLineIsSkipped)
+    {
+        size_t malformed = 0;
+        const auto records = read_all(
+            "{\"username\": \"alice\"}\n"
+            "{\"username\": \"bob\", \"password\": oops}\n"
+            "not json\n"
+            "{\"username\": \"carol\", \"password\": \"pw\"}\n",
+            ImportFormat::JSON, &malformed);
+
+        ASSERT_EQ(records.size(), 1);
+        EXPECT_EQ(records[0].username, "carol");
+        EXPECT_EQ(malformed, 3);
+    }
+
+    TEST_F(UserImportTest, UsernameValidation)
+    {
+        EXPECT_TRUE(is_valid_username("alice"));
+        EXPECT_FALSE(is_valid_username(""));
+        EXPECT_FALSE(is_valid_username("a:b"));
+        EXPECT_FALSE(is_valid_username("a\nb"));
+        EXPECT_FALSE(is_valid_username(std::string(65, 'a')));
+    }
+
+    TEST_F(UserImportTest, ImportCountsDuplicatesAndRejects)
+    {
+        auth::SRPServer server;
+        ASSERT_TRUE(server.register_user("existing", auth::UserCredentials{"existing", {1}, {2}}));
+
+        std::ostringstream csv;
+        for (int i = 0; i < 20; ++i)
+            csv << "user" << i << ",password" << i << "\n";
+        csv << "user3,again\n";   // repeated within the input
+        csv << "existing,pw\n";   // already in the database
+        csv << "bad:name,pw\n";   // cannot be stored
+        csv << "no-password\n";   // malformed
+
+        std::istringstream in(csv.str());
+        const auto report = import_users(in, ImportFormat::CSV, server, ImportOptions{.threads = 3, .batch_size = 4});
+
+        EXPECT_EQ(report.read, 23);
+        EXPECT_EQ(report.imported, 20);
+        EXPECT_EQ(report.duplicates, 2);
+        EXPECT_EQ(report.rejected, 2);
+        EXPECT_EQ(server.user_count(), 21);
+        EXPECT_TRUE(server.user_exists("user19"));
+        EXPECT_FALSE(server.user_exists("bad:name"));
+    }
+
+    TEST_F(UserImportTest, BulkInsertSurvivesSaveAndLoad)
+    {
+        const auto path = (std::filesystem::temp_directory_path() / "chat_user_import_test.db").string();
+
+        auth::SRPServer server;
+        std::vector<auth::UserCredentials> batch = {
+            {"alice", {0x00, 0xAB}, {0x01, 0xFF, 0x10}},
+            {"bob", {0x7F}, {0x80}},
+            {"alice", {0x01}, {0x02}},
+        };
+        EXPECT_EQ(server.register_users(std::move(batch)), 2);
+        server.save_users(path);
+
+        auth::SRPServer loaded;
+        loaded.load_users(path);
+        EXPECT_EQ(loaded.user_count(), 2);
+        EXPECT_TRUE(loaded.user_exists("alice"));
+        EXPECT_TRUE(loaded.user_exists("bob"));
+        EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+        std::filesystem::remove(path);
+    }
+} // namespace chat::tools